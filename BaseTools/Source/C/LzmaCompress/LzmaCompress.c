@@ -39,6 +39,13 @@ static ISzAlloc g_Alloc = { SzAlloc, SzFree };
 
 static Bool mQuietMode = False;
 
+//
+// Number of encoder threads, -1 for the SDK default. When the tool is built
+// with COMPRESS_MF_MT the default is 2: the match finder runs in its own
+// thread, and the output is the same as with 1 thread.
+//
+static int mNumThreads = -1;
+
 #define UTILITY_NAME "LzmaCompress"
 #define UTILITY_MAJOR_VERSION 0
 #define UTILITY_MINOR_VERSION 1
@@ -53,6 +60,8 @@ void PrintHelp(char *buffer)
              "  -e: encode file\n"
              "  -d: decode file\n"
              "  -o FileName, --output FileName: specify the output filename\n"
+             "  --threads [1-2]: number of encoder threads, 1 disables the\n"
+             "                   multi-threaded match finder\n"
              "  -v, --verbose: increase output messages\n"
              "  -q, --quiet: reduce output messages\n"
              "  --debug [0-9]: set debug level\n"
@@ -180,6 +189,7 @@ static SRes Encode(ISeqOutStream *outStream, ISeqInStream *inStream, UInt64 file
     return SZ_ERROR_MEM;
 
   LzmaEncProps_Init(&props);
+  props.numThreads = mNumThreads;
   res = LzmaEnc_SetProps(enc, &props);
 
   if (res == SZ_OK)
@@ -236,6 +246,14 @@ int main2(int numArgs, const char *args[], char *rs)
         return PrintUserError(rs);
       }
       outputFile = args[++param];
+    } else if (strcmp(args[param], "--threads") == 0) {
+      if (numArgs < (param + 2)) {
+        return PrintUserError(rs);
+      }
+      mNumThreads = atoi(args[++param]);
+      if (mNumThreads < 1 || mNumThreads > 2) {
+        return PrintUserError(rs);
+      }
     } else if (strcmp(args[param], "--debug") == 0) {
       if (numArgs < (param + 2)) {
         return PrintUserError(rs);
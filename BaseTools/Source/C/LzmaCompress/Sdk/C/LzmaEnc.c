@@ -2177,10 +2177,11 @@ SRes LzmaEnc_Encode(CLzmaEncHandle pp, ISeqOutStream *outStream, ISeqInStream *i
   SRes res = SZ_OK;
 
   #ifdef COMPRESS_MF_MT
-  Byte allocaDummy[0x300];
+  volatile Byte allocaDummy[0x300];
   int i = 0;
   for (i = 0; i < 16; i++)
     allocaDummy[i] = (Byte)i;
+  (void)allocaDummy;
   #endif
 
   RINOK(LzmaEnc_Prepare(pp, inStream, outStream, alloc, allocBig));
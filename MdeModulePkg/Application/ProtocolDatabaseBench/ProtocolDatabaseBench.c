@@ -0,0 +1,241 @@
+/** @file
+  Micro-benchmark of the protocol database of the DXE core.
+
+  It installs handles in steps up to 10000. Every handle carries one interface
+  of a protocol shared by all of them and one interface of a protocol of its
+  own, so that both the handles of a protocol and the protocols of the database
+  grow with the step. At each step, the average time of HandleProtocol(),
+  OpenProtocol(), LocateProtocol() and LocateHandleBuffer() is printed. The
+  handles are uninstalled before the application returns.
+
+  The times are computed from the performance counter of TimerLib. With a
+  TimerLib instance that has no counter, only the number of calls is printed.
+
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+
+#define BENCH_MAX_HANDLES   10000
+#define BENCH_LOOKUPS       2000
+
+//
+// Protocol installed on every handle of the benchmark. The protocols of the
+// single handles are derived from it by changing the first UINT32.
+//
+EFI_GUID  mBenchSharedProtocolGuid = { 0x7C1F6A4E, 0x2B90, 0x4D3A, { 0x9E, 0x15, 0x63, 0xA8, 0x0D, 0xF2, 0x4B, 0x71 } };
+EFI_GUID  mBenchSingleProtocolGuid = { 0x0E2D5C83, 0x6A47, 0x4F19, { 0xB2, 0x8C, 0x31, 0x7E, 0x94, 0x05, 0xDA, 0x6B } };
+
+UINT64    mBenchFrequency;
+BOOLEAN   mBenchCountUp;
+
+/**
+  Reads the performance counter so that the difference of two reads is the
+  number of ticks between them.
+
+  @return The current value of the performance counter.
+
+**/
+UINT64
+BenchNow (
+  VOID
+  )
+{
+  UINT64  Ticks;
+
+  Ticks = GetPerformanceCounter ();
+  return mBenchCountUp ? Ticks : (UINT64) (0 - Ticks);
+}
+
+/**
+  Prints the average time of Count calls that took Ticks ticks.
+
+  @param[in] Name     Name of the service called.
+  @param[in] Ticks    Ticks the calls took.
+  @param[in] Count    Number of calls.
+
+**/
+VOID
+BenchPrint (
+  IN CONST CHAR16  *Name,
+  IN UINT64        Ticks,
+  IN UINTN         Count
+  )
+{
+  UINT64  MicroSeconds;
+
+  if (mBenchFrequency == 0) {
+    Print (L"  %-20s %d calls\n", Name, Count);
+    return;
+  }
+
+  MicroSeconds = DivU64x64Remainder (MultU64x32 (Ticks, 1000000), mBenchFrequency, NULL);
+  Print (L"  %-20s %ld ns/call\n", Name, DivU64x32 (MultU64x32 (MicroSeconds, 1000), (UINT32) Count));
+}
+
+/**
+  Times the lookups of the protocol database with the handles installed.
+
+  @param[in] Handles    The handles installed.
+  @param[in] Guids      The protocol of its own of each handle.
+  @param[in] Count      Number of handles installed.
+
+**/
+VOID
+BenchLookups (
+  IN EFI_HANDLE  *Handles,
+  IN EFI_GUID    *Guids,
+  IN UINTN       Count
+  )
+{
+  UINT64      Start;
+  UINTN       Index;
+  UINTN       Target;
+  VOID        *Interface;
+  EFI_HANDLE  *Buffer;
+  UINTN       BufferCount;
+  UINTN       Loops;
+
+  Print (L"%d handles:\n", Count);
+
+  Start = BenchNow ();
+  for (Index = 0; Index < BENCH_LOOKUPS; Index++) {
+    Target = (Index * 7919) % Count;
+    gBS->HandleProtocol (Handles[Target], &Guids[Target], &Interface);
+  }
+  BenchPrint (L"HandleProtocol", BenchNow () - Start, BENCH_LOOKUPS);
+
+  Start = BenchNow ();
+  for (Index = 0; Index < BENCH_LOOKUPS; Index++) {
+    Target = (Index * 7919) % Count;
+    gBS->OpenProtocol (
+           Handles[Target],
+           &mBenchSharedProtocolGuid,
+           &Interface,
+           gImageHandle,
+           NULL,
+           EFI_OPEN_PROTOCOL_GET_PROTOCOL
+           );
+  }
+  BenchPrint (L"OpenProtocol", BenchNow () - Start, BENCH_LOOKUPS);
+
+  Start = BenchNow ();
+  for (Index = 0; Index < BENCH_LOOKUPS; Index++) {
+    Target = (Index * 7919) % Count;
+    gBS->LocateProtocol (&Guids[Target], NULL, &Interface);
+  }
+  BenchPrint (L"LocateProtocol", BenchNow () - Start, BENCH_LOOKUPS);
+
+  //
+  // LocateHandleBuffer() returns every handle, so it is called fewer times
+  //
+  Loops = MAX (BENCH_LOOKUPS * 10 / Count, 1);
+  Start = BenchNow ();
+  for (Index = 0; Index < Loops; Index++) {
+    if (!EFI_ERROR (gBS->LocateHandleBuffer (ByProtocol, &mBenchSharedProtocolGuid, NULL, &BufferCount, &Buffer))) {
+      FreePool (Buffer);
+    }
+  }
+  BenchPrint (L"LocateHandleBuffer", BenchNow () - Start, Loops);
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this
+  function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS            The benchmark ran.
+  @retval EFI_OUT_OF_RESOURCES   There is no memory for the handles.
+  @retval other                  A handle could not be installed.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  *Handles;
+  EFI_GUID    *Guids;
+  UINT64      StartValue;
+  UINT64      EndValue;
+  UINTN       Count;
+  UINTN       Step;
+  UINTN       Index;
+
+  mBenchFrequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  mBenchCountUp   = (BOOLEAN) (EndValue >= StartValue);
+
+  Handles = AllocateZeroPool (BENCH_MAX_HANDLES * sizeof (EFI_HANDLE));
+  Guids   = AllocatePool (BENCH_MAX_HANDLES * sizeof (EFI_GUID));
+  if (Handles == NULL || Guids == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Status = EFI_SUCCESS;
+  Count  = 0;
+  for (Step = 10; Step <= BENCH_MAX_HANDLES; Step *= 10) {
+    for (; Count < Step; Count++) {
+      CopyGuid (&Guids[Count], &mBenchSingleProtocolGuid);
+      Guids[Count].Data1 += (UINT32) Count;
+      //
+      // The interfaces are never used, any address is fine
+      //
+      Status = gBS->InstallMultipleProtocolInterfaces (
+                      &Handles[Count],
+                      &mBenchSharedProtocolGuid,
+                      Handles,
+                      &Guids[Count],
+                      Handles,
+                      NULL
+                      );
+      if (EFI_ERROR (Status)) {
+        Print (L"Handle %d could not be installed: %r\n", Count, Status);
+        goto Done;
+      }
+    }
+
+    BenchLookups (Handles, Guids, Count);
+  }
+
+Done:
+  if (Handles != NULL) {
+    for (Index = 0; Index < BENCH_MAX_HANDLES && Handles[Index] != NULL; Index++) {
+      gBS->UninstallMultipleProtocolInterfaces (
+             Handles[Index],
+             &mBenchSharedProtocolGuid,
+             Handles,
+             &Guids[Index],
+             Handles,
+             NULL
+             );
+    }
+    FreePool (Handles);
+  }
+  if (Guids != NULL) {
+    FreePool (Guids);
+  }
+
+  return Status;
+}
@@ -0,0 +1,386 @@
+/** @file
+  Stress test and micro-benchmark of the USB host controller memory pool.
+
+  It creates a memory pool of UsbHcMemLib on the PCI I/O protocol of a USB host
+  controller, or of the first PCI device when there is no USB host controller.
+  It then allocates and frees memory of random sizes in rounds, checking that
+  every allocation is zeroed and aligned to USBHC_MEM_UNIT, and that no live
+  allocation was overwritten by another one. At last it keeps a number of QH
+  and QTD sized allocations live and prints the average time of an allocation
+  or release while the others are churned. The pool is freed before the
+  application returns.
+
+  The times are computed from the performance counter of TimerLib. With a
+  TimerLib instance that has no counter, only the number of calls is printed.
+
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <IndustryStandard/Pci.h>
+#include <Protocol/PciIo.h>
+#include <Library/BaseLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UsbHcMemLib.h>
+
+#define STRESS_SLOTS        4096
+#define STRESS_ROUNDS       200
+#define STRESS_CHURN_OPS    2000000
+
+UINT64    mBenchFrequency;
+BOOLEAN   mBenchCountUp;
+UINT32    mStressSeed = 7;
+
+/**
+  Reads the performance counter so that the difference of two reads is the
+  number of ticks between them.
+
+  @return The current value of the performance counter.
+
+**/
+UINT64
+BenchNow (
+  VOID
+  )
+{
+  UINT64  Ticks;
+
+  Ticks = GetPerformanceCounter ();
+  return mBenchCountUp ? Ticks : (UINT64) (0 - Ticks);
+}
+
+/**
+  Prints the average time of Count calls that took Ticks ticks.
+
+  @param[in] Name     Name of the service called.
+  @param[in] Ticks    Ticks the calls took.
+  @param[in] Count    Number of calls.
+
+**/
+VOID
+BenchPrint (
+  IN CONST CHAR16  *Name,
+  IN UINT64        Ticks,
+  IN UINTN         Count
+  )
+{
+  UINT64  MicroSeconds;
+
+  if (mBenchFrequency == 0) {
+    Print (L"  %-20s %d calls\n", Name, Count);
+    return;
+  }
+
+  MicroSeconds = DivU64x64Remainder (MultU64x32 (Ticks, 1000000), mBenchFrequency, NULL);
+  Print (L"  %-20s %ld ns/call\n", Name, DivU64x32 (MultU64x32 (MicroSeconds, 1000), (UINT32) Count));
+}
+
+/**
+  Returns the next number of a linear congruential generator, so that every
+  run of the test does the same allocations.
+
+  @return A pseudo random number from 0 to 0x7FFF.
+
+**/
+UINTN
+StressRandom (
+  VOID
+  )
+{
+  mStressSeed = mStressSeed * 1103515245 + 12345;
+  return (mStressSeed >> 16) & 0x7FFF;
+}
+
+/**
+  Returns the size of a random allocation. Most allocations are QH and QTD
+  sized, a few are data buffers of up to 200KB.
+
+  @return The size in bytes.
+
+**/
+UINTN
+StressRandomSize (
+  VOID
+  )
+{
+  UINTN  Percent;
+
+  Percent = StressRandom () % 100;
+  if (Percent < 45) {
+    return 96;
+  } else if (Percent < 80) {
+    return 160;
+  } else if (Percent < 99) {
+    return 1 + StressRandom () % 1024;
+  }
+  return 1 + (StressRandom () * 8) % (200 * 1024);
+}
+
+/**
+  Finds the PCI I/O protocol of a USB host controller, or of the first PCI
+  device when there is no USB host controller.
+
+  @return The PCI I/O protocol or NULL if there is no PCI device.
+
+**/
+EFI_PCI_IO_PROTOCOL *
+StressFindPciIo (
+  VOID
+  )
+{
+  EFI_HANDLE           *Handles;
+  UINTN                HandleCount;
+  UINTN                Index;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  EFI_PCI_IO_PROTOCOL  *Found;
+  UINT8                ClassCode[3];
+
+  Found = NULL;
+  if (EFI_ERROR (gBS->LocateHandleBuffer (ByProtocol, &gEfiPciIoProtocolGuid, NULL, &HandleCount, &Handles))) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    if (EFI_ERROR (gBS->HandleProtocol (Handles[Index], &gEfiPciIoProtocolGuid, (VOID **) &PciIo))) {
+      continue;
+    }
+    if (Found == NULL) {
+      Found = PciIo;
+    }
+    if (!EFI_ERROR (PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, PCI_CLASSCODE_OFFSET, 3, ClassCode)) &&
+        ClassCode[2] == PCI_CLASS_SERIAL && ClassCode[1] == PCI_CLASS_SERIAL_USB) {
+      Found = PciIo;
+      break;
+    }
+  }
+
+  FreePool (Handles);
+  return Found;
+}
+
+/**
+  Allocates and frees memory of random sizes and checks the allocations.
+
+  @param[in] Pool     The memory pool.
+  @param[in] Mem      The live allocations of each slot.
+  @param[in] Size     The size of the live allocation of each slot.
+
+  @retval EFI_SUCCESS            All the checks passed.
+  @retval EFI_OUT_OF_RESOURCES   An allocation failed.
+  @retval EFI_DEVICE_ERROR       An allocation wasn't zeroed or aligned, or
+                                 was overwritten by another one.
+
+**/
+EFI_STATUS
+StressPool (
+  IN USBHC_MEM_POOL  *Pool,
+  IN UINT8           **Mem,
+  IN UINTN           *Size
+  )
+{
+  UINTN  Round;
+  UINTN  Slot;
+  UINTN  Index;
+
+  for (Round = 0; Round < STRESS_ROUNDS; Round++) {
+    for (Slot = 0; Slot < STRESS_SLOTS; Slot++) {
+      if (Mem[Slot] != NULL || (StressRandom () & 1) == 0) {
+        continue;
+      }
+
+      Size[Slot] = StressRandomSize ();
+      Mem[Slot]  = UsbHcAllocateMem (Pool, Size[Slot]);
+      if (Mem[Slot] == NULL) {
+        Print (L"Allocation of %d bytes failed\n", Size[Slot]);
+        return EFI_OUT_OF_RESOURCES;
+      }
+      if (((UINTN) Mem[Slot] & USBHC_MEM_UNIT_MASK) != 0) {
+        Print (L"Allocation 0x%p isn't aligned\n", Mem[Slot]);
+        return EFI_DEVICE_ERROR;
+      }
+      for (Index = 0; Index < Size[Slot]; Index++) {
+        if (Mem[Slot][Index] != 0) {
+          Print (L"Allocation 0x%p isn't zeroed\n", Mem[Slot]);
+          return EFI_DEVICE_ERROR;
+        }
+      }
+      SetMem (Mem[Slot], Size[Slot], (UINT8) Slot);
+    }
+
+    for (Slot = 0; Slot < STRESS_SLOTS; Slot++) {
+      if (Mem[Slot] == NULL) {
+        continue;
+      }
+      for (Index = 0; Index < Size[Slot]; Index++) {
+        if (Mem[Slot][Index] != (UINT8) Slot) {
+          Print (L"Allocation 0x%p was overwritten\n", Mem[Slot]);
+          return EFI_DEVICE_ERROR;
+        }
+      }
+      if ((StressRandom () & 1) != 0) {
+        UsbHcFreeMem (Pool, Mem[Slot], Size[Slot]);
+        Mem[Slot] = NULL;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Times the allocation and release of QH and QTD sized memory with Live of
+  them kept allocated.
+
+  @param[in] Pool     The memory pool.
+  @param[in] Mem      The live allocations of each slot.
+  @param[in] Size     The size of the live allocation of each slot.
+  @param[in] Live     Number of slots used.
+
+**/
+VOID
+BenchPool (
+  IN USBHC_MEM_POOL  *Pool,
+  IN UINT8           **Mem,
+  IN UINTN           *Size,
+  IN UINTN           Live
+  )
+{
+  UINT64  Start;
+  UINTN   Ops;
+  UINTN   Slot;
+
+  for (Slot = 0; Slot < Live; Slot++) {
+    Size[Slot] = ((Slot % 3) != 0) ? 96 : 160;
+    Mem[Slot]  = UsbHcAllocateMem (Pool, Size[Slot]);
+  }
+  for (Slot = 0; Slot < Live; Slot += 2) {
+    if (Mem[Slot] != NULL) {
+      UsbHcFreeMem (Pool, Mem[Slot], Size[Slot]);
+      Mem[Slot] = NULL;
+    }
+  }
+
+  Print (L"%d live allocations:\n", Live);
+  Start = BenchNow ();
+  for (Ops = 0; Ops < STRESS_CHURN_OPS; Ops++) {
+    Slot = Ops % Live;
+    if (Mem[Slot] != NULL) {
+      UsbHcFreeMem (Pool, Mem[Slot], Size[Slot]);
+      Mem[Slot] = NULL;
+    } else {
+      Mem[Slot] = UsbHcAllocateMem (Pool, Size[Slot]);
+    }
+  }
+  BenchPrint (L"Allocate/Free", BenchNow () - Start, STRESS_CHURN_OPS);
+}
+
+/**
+  Frees the live allocations of the slots.
+
+  @param[in] Pool     The memory pool.
+  @param[in] Mem      The live allocations of each slot.
+  @param[in] Size     The size of the live allocation of each slot.
+
+**/
+VOID
+StressFreeAll (
+  IN USBHC_MEM_POOL  *Pool,
+  IN UINT8           **Mem,
+  IN UINTN           *Size
+  )
+{
+  UINTN  Slot;
+
+  for (Slot = 0; Slot < STRESS_SLOTS; Slot++) {
+    if (Mem[Slot] != NULL) {
+      UsbHcFreeMem (Pool, Mem[Slot], Size[Slot]);
+      Mem[Slot] = NULL;
+    }
+  }
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this
+  function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS            The test passed.
+  @retval EFI_UNSUPPORTED        There is no PCI device.
+  @retval EFI_OUT_OF_RESOURCES   There is no memory for the test.
+  @retval other                  The test failed.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS           Status;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  USBHC_MEM_POOL       *Pool;
+  UINT8                **Mem;
+  UINTN                *Size;
+  UINT64               StartValue;
+  UINT64               EndValue;
+  UINTN                Live;
+
+  mBenchFrequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  mBenchCountUp   = (BOOLEAN) (EndValue >= StartValue);
+
+  PciIo = StressFindPciIo ();
+  if (PciIo == NULL) {
+    Print (L"No PCI device was found.\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Pool = UsbHcInitMemPool (PciIo, FALSE, 0);
+  Mem  = AllocateZeroPool (STRESS_SLOTS * sizeof (UINT8 *));
+  Size = AllocateZeroPool (STRESS_SLOTS * sizeof (UINTN));
+  if (Pool == NULL || Mem == NULL || Size == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Status = StressPool (Pool, Mem, Size);
+  StressFreeAll (Pool, Mem, Size);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  Print (L"USB HC memory pool stress test passed.\n");
+
+  for (Live = 16; Live <= STRESS_SLOTS; Live *= 4) {
+    BenchPool (Pool, Mem, Size, Live);
+    StressFreeAll (Pool, Mem, Size);
+  }
+
+Done:
+  if (Pool != NULL) {
+    UsbHcFreeMemPool (Pool);
+  }
+  if (Mem != NULL) {
+    FreePool (Mem);
+  }
+  if (Size != NULL) {
+    FreePool (Size);
+  }
+
+  return Status;
+}
@@ -0,0 +1,224 @@
+/** @file
+  Test application of the Variable Batch Protocol.
+
+  It fills the non-volatile variable store with test variables until only a few
+  records fit in it, so that the last test variable sits in the last spare area
+  sized window of blocks of the store. It then changes that variable with the
+  Variable Batch Protocol, checks the new content, and, when the Variable
+  services provide the store statistics, checks that the Fault Tolerant Write
+  of the batch rewrote the last window of the store and no block outside of it.
+  The test variables are deleted before the application returns.
+
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Protocol/VariableBatch.h>
+#include <Protocol/FaultTolerantWrite.h>
+#include <Guid/VariableFormat.h>
+#include <Guid/VariableStoreStatistics.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+
+#define TEST_VARIABLE_DATA_SIZE   128
+#define TEST_VARIABLE_ATTRIBUTES  (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS)
+
+//
+// Vendor GUID of the test variables
+//
+EFI_GUID  mVariableBatchTestGuid = { 0x5B4A2E31, 0x9C07, 0x4F5D, { 0x8E, 0x62, 0x1A, 0x3D, 0xC4, 0x7B, 0x90, 0xE6 } };
+
+/**
+  Builds the name of a test variable.
+
+  @param[out] Name     Buffer of 16 characters receiving the name.
+  @param[in]  Index    Number of the test variable.
+
+**/
+VOID
+TestVariableName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Index
+  )
+{
+  UnicodeSPrint (Name, 16 * sizeof (CHAR16), L"BatchTest%04d", Index);
+}
+
+/**
+  Deletes the test variables.
+
+  @param[in] Count     Number of test variables written.
+
+**/
+VOID
+DeleteTestVariables (
+  IN UINTN  Count
+  )
+{
+  CHAR16  Name[16];
+  UINTN   Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    TestVariableName (Name, Index);
+    gRT->SetVariable (Name, &mVariableBatchTestGuid, TEST_VARIABLE_ATTRIBUTES, 0, NULL);
+  }
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this
+  function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The test passed.
+  @retval EFI_UNSUPPORTED   The Variable Batch Protocol is not installed.
+  @retval other             The test failed.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                         Status;
+  EFI_VARIABLE_BATCH_PROTOCOL        *VariableBatch;
+  EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *Ftw;
+  VARIABLE_STORE_STATISTICS          *Statistics;
+  UINT32                             *EraseCount;
+  UINT32                             ReclaimCount;
+  EFI_VARIABLE_BATCH_ENTRY           Entry;
+  CHAR16                             Name[16];
+  UINT8                              Data[TEST_VARIABLE_DATA_SIZE];
+  UINT8                              ReadData[TEST_VARIABLE_DATA_SIZE];
+  UINTN                              DataSize;
+  UINTN                              RecordSize;
+  UINT64                             MaximumStorageSize;
+  UINT64                             RemainingStorageSize;
+  UINT64                             MaximumVariableSize;
+  UINTN                              Count;
+  UINTN                              SpareSize;
+  UINTN                              WindowBlocks;
+  UINTN                              Index;
+
+  Status = gBS->LocateProtocol (&gEfiVariableBatchProtocolGuid, NULL, (VOID **) &VariableBatch);
+  if (EFI_ERROR (Status)) {
+    Print (L"Variable Batch Protocol is not installed.\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Fill the store until fewer than four more test records fit in it. The
+  // variables are written in order, so the last one is at the end of the store.
+  //
+  RecordSize = sizeof (VARIABLE_HEADER) + StrSize (L"BatchTest0000") + TEST_VARIABLE_DATA_SIZE;
+  for (Count = 0; ; Count++) {
+    Status = gRT->QueryVariableInfo (
+                    TEST_VARIABLE_ATTRIBUTES,
+                    &MaximumStorageSize,
+                    &RemainingStorageSize,
+                    &MaximumVariableSize
+                    );
+    if (EFI_ERROR (Status) || RemainingStorageSize < 4 * RecordSize) {
+      break;
+    }
+
+    TestVariableName (Name, Count);
+    SetMem (Data, sizeof (Data), (UINT8) Count);
+    Status = gRT->SetVariable (Name, &mVariableBatchTestGuid, TEST_VARIABLE_ATTRIBUTES, sizeof (Data), Data);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+
+  if (Count == 0) {
+    Print (L"No test variable could be written: %r\n", Status);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Save the erase counters to compare them after the batch
+  //
+  Statistics   = NULL;
+  EraseCount   = NULL;
+  ReclaimCount = 0;
+  if (!EFI_ERROR (EfiGetSystemConfigurationTable (&gVariableStoreStatisticsGuid, (VOID **) &Statistics)) &&
+      (Statistics != NULL)) {
+    EraseCount   = AllocateCopyPool (Statistics->BlockCount * sizeof (UINT32), Statistics->EraseCount);
+    ReclaimCount = Statistics->ReclaimCount;
+  }
+
+  //
+  // Change the last test variable in a batch
+  //
+  TestVariableName (Name, Count - 1);
+  SetMem (Data, sizeof (Data), 0x5A);
+  Entry.VariableName = Name;
+  Entry.VendorGuid   = &mVariableBatchTestGuid;
+  Entry.Attributes   = TEST_VARIABLE_ATTRIBUTES;
+  Entry.DataSize     = sizeof (Data);
+  Entry.Data         = Data;
+  Status = VariableBatch->SetVariables (VariableBatch, 1, &Entry);
+  if (EFI_ERROR (Status)) {
+    Print (L"Batch of %s failed: %r\n", Name, Status);
+    goto Done;
+  }
+
+  DataSize = sizeof (ReadData);
+  Status   = gRT->GetVariable (Name, &mVariableBatchTestGuid, NULL, &DataSize, ReadData);
+  if (EFI_ERROR (Status) || DataSize != sizeof (Data) || CompareMem (ReadData, Data, sizeof (Data)) != 0) {
+    Print (L"%s does not hold the data of the batch: %r\n", Name, Status);
+    Status = EFI_DEVICE_ERROR;
+    goto Done;
+  }
+
+  //
+  // The batch must have rewritten the last spare area sized window of the store,
+  // or the whole store when it has no more blocks than the spare area. A reclaim
+  // done by the batch rewrites other blocks, so the check is skipped then.
+  //
+  if (EraseCount != NULL && Statistics->ReclaimCount == ReclaimCount &&
+      !EFI_ERROR (gBS->LocateProtocol (&gEfiFaultTolerantWriteProtocolGuid, NULL, (VOID **) &Ftw)) &&
+      !EFI_ERROR (Ftw->GetMaxBlockSize (Ftw, &SpareSize))) {
+    WindowBlocks = MIN (SpareSize / Statistics->BlockSize, Statistics->BlockCount);
+    for (Index = 0; Index < Statistics->BlockCount; Index++) {
+      if (Statistics->EraseCount[Index] - EraseCount[Index] != ((Index >= Statistics->BlockCount - WindowBlocks) ? 1u : 0u)) {
+        Print (
+          L"Block %d of the store was erased %d times by the batch\n",
+          Index,
+          Statistics->EraseCount[Index] - EraseCount[Index]
+          );
+        Status = EFI_DEVICE_ERROR;
+      }
+    }
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+    Print (L"The batch rewrote the last %d of %d blocks of the store.\n", WindowBlocks, Statistics->BlockCount);
+  }
+
+  Print (L"Variable batch test passed with %d test variables.\n", Count);
+
+Done:
+  if (EraseCount != NULL) {
+    FreePool (EraseCount);
+  }
+  DeleteTestVariables (Count);
+  return Status;
+}
@@ -0,0 +1,198 @@
+/** @file
+  Micro-benchmark of the variable lookups of the Variable services.
+
+  It writes up to 1000 volatile test variables, fewer if the volatile store
+  fills up first, and prints the average time of GetVariable() for variables
+  that exist and for variables that don't, and the time of a whole
+  GetNextVariableName() enumeration. The test variables are deleted before the
+  application returns.
+
+  The times are computed from the performance counter of TimerLib. With a
+  TimerLib instance that has no counter, only the number of calls is printed.
+
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiApplicationEntryPoint.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+
+#define BENCH_MAX_VARIABLES       1000
+#define BENCH_LOOKUPS             5000
+#define BENCH_VARIABLE_ATTRIBUTES EFI_VARIABLE_BOOTSERVICE_ACCESS
+
+//
+// Vendor GUID of the test variables
+//
+EFI_GUID  mVariableIndexBenchGuid = { 0x2F8E4B17, 0xC6D0, 0x4A93, { 0x85, 0x3B, 0x7E, 0x01, 0xF9, 0x6C, 0x2A, 0xD4 } };
+
+UINT64    mBenchFrequency;
+BOOLEAN   mBenchCountUp;
+
+/**
+  Reads the performance counter so that the difference of two reads is the
+  number of ticks between them.
+
+  @return The current value of the performance counter.
+
+**/
+UINT64
+BenchNow (
+  VOID
+  )
+{
+  UINT64  Ticks;
+
+  Ticks = GetPerformanceCounter ();
+  return mBenchCountUp ? Ticks : (UINT64) (0 - Ticks);
+}
+
+/**
+  Prints the average time of Count calls that took Ticks ticks.
+
+  @param[in] Name     Name of the service called.
+  @param[in] Ticks    Ticks the calls took.
+  @param[in] Count    Number of calls.
+
+**/
+VOID
+BenchPrint (
+  IN CONST CHAR16  *Name,
+  IN UINT64        Ticks,
+  IN UINTN         Count
+  )
+{
+  UINT64  MicroSeconds;
+
+  if (mBenchFrequency == 0) {
+    Print (L"  %-24s %d calls\n", Name, Count);
+    return;
+  }
+
+  MicroSeconds = DivU64x64Remainder (MultU64x32 (Ticks, 1000000), mBenchFrequency, NULL);
+  Print (L"  %-24s %ld ns/call\n", Name, DivU64x32 (MultU64x32 (MicroSeconds, 1000), (UINT32) Count));
+}
+
+/**
+  Builds the name of a test variable.
+
+  @param[out] Name     Buffer of 16 characters receiving the name.
+  @param[in]  Index    Number of the test variable.
+
+**/
+VOID
+BenchVariableName (
+  OUT CHAR16  *Name,
+  IN  UINTN   Index
+  )
+{
+  UnicodeSPrint (Name, 16 * sizeof (CHAR16), L"Bench%04d", Index);
+}
+
+/**
+  The user Entry Point for Application. The user code starts with this function
+  as the real entry point for the image goes into a library that calls this
+  function.
+
+  @param[in] ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in] SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS       The benchmark ran.
+  @retval other             No test variable could be written.
+
+**/
+EFI_STATUS
+EFIAPI
+UefiMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      Name[16];
+  CHAR16      NextName[256];
+  EFI_GUID    NextGuid;
+  UINT64      Data;
+  UINTN       DataSize;
+  UINTN       NameSize;
+  UINT64      StartValue;
+  UINT64      EndValue;
+  UINT64      Start;
+  UINTN       Count;
+  UINTN       Found;
+  UINTN       Index;
+
+  mBenchFrequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  mBenchCountUp   = (BOOLEAN) (EndValue >= StartValue);
+
+  Status = EFI_SUCCESS;
+  for (Count = 0; Count < BENCH_MAX_VARIABLES; Count++) {
+    BenchVariableName (Name, Count);
+    Data   = Count;
+    Status = gRT->SetVariable (Name, &mVariableIndexBenchGuid, BENCH_VARIABLE_ATTRIBUTES, sizeof (Data), &Data);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+  }
+
+  if (Count == 0) {
+    Print (L"No test variable could be written: %r\n", Status);
+    return Status;
+  }
+
+  Print (L"%d test variables:\n", Count);
+
+  Found = 0;
+  Start = BenchNow ();
+  for (Index = 0; Index < BENCH_LOOKUPS; Index++) {
+    BenchVariableName (Name, (Index * 7919) % Count);
+    DataSize = sizeof (Data);
+    if (!EFI_ERROR (gRT->GetVariable (Name, &mVariableIndexBenchGuid, NULL, &DataSize, &Data))) {
+      Found++;
+    }
+  }
+  BenchPrint (L"GetVariable", BenchNow () - Start, BENCH_LOOKUPS);
+  if (Found != BENCH_LOOKUPS) {
+    Print (L"  only %d of %d variables were found\n", Found, BENCH_LOOKUPS);
+    Status = EFI_NOT_FOUND;
+  }
+
+  Start = BenchNow ();
+  for (Index = 0; Index < BENCH_LOOKUPS; Index++) {
+    BenchVariableName (Name, BENCH_MAX_VARIABLES + Index);
+    DataSize = sizeof (Data);
+    gRT->GetVariable (Name, &mVariableIndexBenchGuid, NULL, &DataSize, &Data);
+  }
+  BenchPrint (L"GetVariable (not found)", BenchNow () - Start, BENCH_LOOKUPS);
+
+  Found       = 0;
+  NextName[0] = 0;
+  Start       = BenchNow ();
+  while (TRUE) {
+    NameSize = sizeof (NextName);
+    if (EFI_ERROR (gRT->GetNextVariableName (&NameSize, NextName, &NextGuid))) {
+      break;
+    }
+    Found++;
+  }
+  BenchPrint (L"GetNextVariableName", BenchNow () - Start, Found);
+
+  for (Index = 0; Index < Count; Index++) {
+    BenchVariableName (Name, Index);
+    gRT->SetVariable (Name, &mVariableIndexBenchGuid, BENCH_VARIABLE_ATTRIBUTES, 0, NULL);
+  }
+
+  return Status;
+}
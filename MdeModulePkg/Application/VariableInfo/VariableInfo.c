@@ -3,6 +3,9 @@
   the EFI system table will contain statistical information about variable usage
   an this utility will print out the information. You can use console redirection
   to capture the data.
+
+  The reclaim latency and the per block erase counts of the non-volatile variable
+  store are printed as well when the Variable services provide them.
   
   Copyright (c) 2006 - 2007, Intel Corporation                                                         
   All rights reserved. This program and the accompanying materials                          
@@ -19,6 +22,56 @@
 #include <Library/UefiLib.h>
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Guid/VariableFormat.h>
+#include <Guid/VariableStoreStatistics.h>
+
+
+/**
+  Prints the reclaim statistics of the non-volatile variable store.
+
+  @param[in] Statistics     The variable store statistics from the EFI system table.
+
+**/
+VOID
+PrintStoreStatistics (
+  IN VARIABLE_STORE_STATISTICS  *Statistics
+  )
+{
+  UINTN   Index;
+
+  Print (L"Non-Volatile Variable Store Writes:\n");
+  Print (
+    L"  Variables written %d, bytes written %ld\n",
+    Statistics->VariableWriteCount,
+    Statistics->VariableBytesWritten
+    );
+  Print (
+    L"  Batches %d of %d variables, bytes written %ld\n",
+    Statistics->BatchCount,
+    Statistics->BatchVariableCount,
+    Statistics->BatchBytesWritten
+    );
+  Print (
+    L"  Reclaims %d, blocks written %d, blocks skipped %d, bytes written %ld\n",
+    Statistics->ReclaimCount,
+    Statistics->BlocksWritten,
+    Statistics->BlocksSkipped,
+    Statistics->ReclaimBytesWritten
+    );
+
+  Print (L"  Latency (max %d ms):\n", Statistics->MaxLatency);
+  for (Index = 0; Index < VARIABLE_RECLAIM_LATENCY_BUCKETS; Index++) {
+    if (Index < VARIABLE_RECLAIM_LATENCY_BUCKETS - 1) {
+      Print (L"    < %5d ms: %d\n", 1 << Index, Statistics->LatencyHistogram[Index]);
+    } else {
+      Print (L"    >=%5d ms: %d\n", 1 << (Index - 1), Statistics->LatencyHistogram[Index]);
+    }
+  }
+
+  Print (L"  Erase count per block of 0x%x bytes:\n", Statistics->BlockSize);
+  for (Index = 0; Index < Statistics->BlockCount; Index++) {
+    Print (L"    Block %03d: %d\n", (UINT32) Index, Statistics->EraseCount[Index]);
+  }
+}
 
 
 /**
@@ -41,9 +94,10 @@ UefiMain (
   IN EFI_SYSTEM_TABLE  *SystemTable
   )
 {
-  EFI_STATUS            Status;
-  VARIABLE_INFO_ENTRY   *VariableInfo;
-  VARIABLE_INFO_ENTRY   *Entry;
+  EFI_STATUS                  Status;
+  VARIABLE_INFO_ENTRY         *VariableInfo;
+  VARIABLE_INFO_ENTRY         *Entry;
+  VARIABLE_STORE_STATISTICS   *StoreStatistics;
 
   Status = EfiGetSystemConfigurationTable (&gEfiVariableGuid, (VOID **)&Entry);
   if (!EFI_ERROR (Status) && (Entry != NULL)) {
@@ -82,6 +136,11 @@ UefiMain (
       VariableInfo = VariableInfo->Next;
     } while (VariableInfo != NULL);
 
+    if (!EFI_ERROR (EfiGetSystemConfigurationTable (&gVariableStoreStatisticsGuid, (VOID **) &StoreStatistics)) &&
+        (StoreStatistics != NULL)) {
+      PrintStoreStatistics (StoreStatistics);
+    }
+
   } else {
     Print (L"Warning: Variable Dxe driver doesn't enable the feature of statistical information!\n");
     Print (L"If you want to see this info, please:\n");
@@ -1390,6 +1390,8 @@ EhcCreateUsb2Hc (
 {
   USB2_HC_DEV             *Ehc;
   EFI_STATUS              Status;
+  UINT64                  StartValue;
+  UINT64                  EndValue;
 
   Ehc = AllocateZeroPool (sizeof (USB2_HC_DEV));
 
@@ -1429,13 +1431,21 @@ EhcCreateUsb2Hc (
 
   DEBUG ((EFI_D_INFO, "EhcCreateUsb2Hc: capability length %d\n", Ehc->CapLen));
 
+  Ehc->IocCompletion  = FeaturePcdGet (PcdEhciIocCompletion);
+
+  if (FeaturePcdGet (PcdEhciCollectStatistics)) {
+    GetPerformanceCounterProperties (&StartValue, &EndValue);
+    Ehc->Statistics.CountDown = (BOOLEAN) (StartValue > EndValue);
+  }
+
   //
-  // Create AsyncRequest Polling Timer
+  // Create AsyncRequest Polling Timer. In IOC completion mode, the timer
+  // only checks USBSTS, and AsyncDoneEvent checks the transfers.
   //
   Status = gBS->CreateEvent (
                   EVT_TIMER | EVT_NOTIFY_SIGNAL,
                   TPL_CALLBACK,
-                  EhcMonitorAsyncRequests,
+                  Ehc->IocCompletion ? EhcPollAsyncStatus : EhcMonitorAsyncRequests,
                   Ehc,
                   &Ehc->PollTimer
                   );
@@ -1445,6 +1455,22 @@ EhcCreateUsb2Hc (
     return NULL;
   }
 
+  if (Ehc->IocCompletion) {
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    EhcMonitorAsyncRequests,
+                    Ehc,
+                    &Ehc->AsyncDoneEvent
+                    );
+
+    if (EFI_ERROR (Status)) {
+      gBS->CloseEvent (Ehc->PollTimer);
+      gBS->FreePool (Ehc);
+      return NULL;
+    }
+  }
+
   return Ehc;
 }
 
@@ -1760,6 +1786,9 @@ UNINSTALL_USBHC:
 FREE_POOL:
   EhcFreeSched (Ehc);
   gBS->CloseEvent (Ehc->PollTimer);
+  if (Ehc->AsyncDoneEvent != NULL) {
+    gBS->CloseEvent (Ehc->AsyncDoneEvent);
+  }
   gBS->FreePool (Ehc);
 
 CLOSE_PCIIO:
@@ -1855,6 +1884,12 @@ EhcDriverBindingStop (
     gBS->CloseEvent (Ehc->PollTimer);
   }
 
+  if (Ehc->AsyncDoneEvent != NULL) {
+    gBS->CloseEvent (Ehc->AsyncDoneEvent);
+  }
+
+  EhcDumpStatistics (Ehc);
+
   if (Ehc->ExitBootServiceEvent != NULL) {
     gBS->CloseEvent (Ehc->ExitBootServiceEvent);
   }
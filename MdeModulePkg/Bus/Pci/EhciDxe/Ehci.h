@@ -32,12 +32,13 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UsbHcMemLib.h>
 
 #include <IndustryStandard/Pci.h>
 
 typedef struct _USB2_HC_DEV  USB2_HC_DEV;
 
-#include "UsbHcMem.h"
 #include "EhciReg.h"
 #include "EhciUrb.h"
 #include "EhciSched.h"
@@ -65,9 +66,32 @@ typedef enum {
   // and the unit of Async is 100us, means 50ms as interval.
   //
   EHC_SYNC_POLL_INTERVAL       = 20 * EHC_1_MICROSECOND,
-  EHC_ASYNC_POLL_INTERVAL      = 50 * 10000U
+  EHC_ASYNC_POLL_INTERVAL      = 50 * 10000U,
+
+  //
+  // In IOC completion mode, the QTDs are still walked every so many
+  // polls even if USBSTS reports nothing, in case the controller
+  // misses to report a completion: 1ms for the synchronous transfers
+  // and 1s for the asynchronous interrupt transfers.
+  //
+  EHC_SYNC_IOC_CHECK_POLLS     = 50,
+  EHC_ASYNC_IOC_CHECK_POLLS    = 20
 } EHC_TIMEOUT_EXPERIENCE_VALUE;
 
+//
+// Counters of the synchronous transfers executed by EhcExecTransfer,
+// reported when the driver stops managing the controller. They are
+// only collected if PcdEhciCollectStatistics is TRUE.
+//
+typedef struct {
+  UINT64                    Transfers;   // Number of transfers executed
+  UINT64                    Bytes;       // Number of bytes transferred
+  UINT64                    WaitTicks;   // Performance counter ticks spent waiting for the transfers
+  UINT64                    CheckTicks;  // Ticks spent walking the QTDs of the transfers
+  UINT64                    Checks;      // Number of QTD walks
+  BOOLEAN                   CountDown;   // The performance counter counts down
+} EHC_TRANSFER_STATISTICS;
+
 
 //
 // EHC raises TPL to TPL_NOTIFY to serialize all its operations
@@ -122,6 +146,17 @@ struct _USB2_HC_DEV {
   EHC_QTD                  *ShortReadStop;
   EFI_EVENT                 PollTimer;
 
+  //
+  // IOC completion mode, see PcdEhciIocCompletion. IntPending latches
+  // the USBINT/USBERRINT bits acknowledged by anyone until the PollTimer
+  // picks them up and signals AsyncDoneEvent, which checks all the
+  // asynchronous interrupt transfers in one batch.
+  //
+  BOOLEAN                   IocCompletion;
+  UINT32                    IntPending;
+  UINTN                     AsyncPolls;
+  EFI_EVENT                 AsyncDoneEvent;
+
   //
   // ExitBootServicesEvent is used to stop the EHC DMA operation 
   // after exit boot service.
@@ -157,6 +192,7 @@ struct _USB2_HC_DEV {
   // Misc
   //
   EFI_UNICODE_STRING_TABLE  *ControllerNameTable;
+  EHC_TRANSFER_STATISTICS   Statistics;
 };
 
 
@@ -227,3 +227,51 @@ EhcDumpBuf (
 
   DEBUG ((EFI_D_INFO, "\n"));
 }
+
+
+/**
+  Dump the time spent on the synchronous transfers per MB transferred.
+
+  The time waiting is what the CPU spends polling the transfers, the time
+  walking QTDs is the part of it that isn't spent in the stalls between the
+  polls.
+
+  @param  Ehc      The EHCI device.
+
+**/
+VOID
+EhcDumpStatistics (
+  IN USB2_HC_DEV          *Ehc
+  )
+{
+  EHC_TRANSFER_STATISTICS *Statistics;
+  UINT64                  TicksPerUs;
+  UINT64                  WaitUs;
+  UINT64                  CheckUs;
+
+  Statistics = &Ehc->Statistics;
+
+  if (!FeaturePcdGet (PcdEhciCollectStatistics) || (Statistics->Bytes == 0)) {
+    return;
+  }
+
+  TicksPerUs = DivU64x32 (GetPerformanceCounterProperties (NULL, NULL), 1000000);
+  if (TicksPerUs == 0) {
+    TicksPerUs = 1;
+  }
+
+  WaitUs  = DivU64x64Remainder (Statistics->WaitTicks, TicksPerUs, NULL);
+  CheckUs = DivU64x64Remainder (Statistics->CheckTicks, TicksPerUs, NULL);
+
+  DEBUG ((EFI_D_INFO, "EhcDumpStatistics: %a, %ld transfers, %ld KB, %ld QTD walks\n",
+          Ehc->IocCompletion ? "IOC completion" : "polling",
+          Statistics->Transfers,
+          RShiftU64 (Statistics->Bytes, 10),
+          Statistics->Checks
+          ));
+
+  DEBUG ((EFI_D_INFO, "EhcDumpStatistics: %ld us waiting, %ld us walking QTDs per MB\n",
+          DivU64x64Remainder (MultU64x32 (WaitUs, SIZE_1MB), Statistics->Bytes, NULL),
+          DivU64x64Remainder (MultU64x32 (CheckUs, SIZE_1MB), Statistics->Bytes, NULL)
+          ));
+}
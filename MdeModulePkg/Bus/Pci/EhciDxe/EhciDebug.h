@@ -60,4 +60,16 @@ EhcDumpBuf (
   IN UINTN                Len
   );
 
+
+/**
+  Dump the time spent on the synchronous transfers per MB transferred.
+
+  @param  Ehc      The EHCI device.
+
+**/
+VOID
+EhcDumpStatistics (
+  IN USB2_HC_DEV          *Ehc
+  );
+
 #endif
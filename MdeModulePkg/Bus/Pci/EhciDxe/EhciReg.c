@@ -306,7 +306,50 @@ EhcAckAllInterrupt (
   IN  USB2_HC_DEV         *Ehc
   )
 {
-  EhcWriteOpReg (Ehc, EHC_USBSTS_OFFSET, USBSTS_INTACK_MASK);
+  UINT32                  Data;
+
+  if (!Ehc->IocCompletion) {
+    EhcWriteOpReg (Ehc, EHC_USBSTS_OFFSET, USBSTS_INTACK_MASK);
+    return;
+  }
+
+  //
+  // Only ACK the bits that are read. A transfer completion that sets
+  // USBINT after the read is left for the next check. The completions
+  // are latched so that the asynchronous interrupt monitor sees them.
+  //
+  Data = EhcReadOpReg (Ehc, EHC_USBSTS_OFFSET) & USBSTS_INTACK_MASK;
+  if (Data != 0) {
+    EhcWriteOpReg (Ehc, EHC_USBSTS_OFFSET, Data);
+  }
+
+  Ehc->IntPending |= Data & (USBSTS_USBINT | USBSTS_USBERRINT);
+}
+
+
+/**
+  Clear the transfer interrupt status bits, USBINT and USBERRINT,
+  and latch them for the asynchronous interrupt monitor.
+
+  @param  Ehc      The EHCI device.
+
+  @return The transfer interrupt status bits that were set.
+
+**/
+UINT32
+EhcAckTransferInterrupt (
+  IN  USB2_HC_DEV         *Ehc
+  )
+{
+  UINT32                  Data;
+
+  Data = EhcReadOpReg (Ehc, EHC_USBSTS_OFFSET) & (USBSTS_USBINT | USBSTS_USBERRINT);
+  if (Data != 0) {
+    EhcWriteOpReg (Ehc, EHC_USBSTS_OFFSET, Data);
+    Ehc->IntPending |= Data;
+  }
+
+  return Data;
 }
 
 
@@ -57,6 +57,8 @@ typedef enum {
   USBCMD_ENABLE_ASYNC     = 0x20,   // Enable asynchronous schedule
   USBCMD_IAAD             = 0x40,   // Interrupt on async advance doorbell
 
+  USBSTS_USBINT           = 0x01,   // Transfer completed with IOC set or short packet
+  USBSTS_USBERRINT        = 0x02,   // Transfer completed with error
   USBSTS_IAA              = 0x20,   // Interrupt on async advance
   USBSTS_PERIOD_ENABLED   = 0x4000, // Periodic schedule status
   USBSTS_ASYNC_ENABLED    = 0x8000, // Asynchronous schedule status
@@ -234,6 +236,21 @@ EhcAckAllInterrupt (
   );
 
 
+/**
+  Clear the transfer interrupt status bits, USBINT and USBERRINT,
+  and latch them for the asynchronous interrupt monitor.
+
+  @param  Ehc      The EHCI device.
+
+  @return The transfer interrupt status bits that were set.
+
+**/
+UINT32
+EhcAckTransferInterrupt (
+  IN  USB2_HC_DEV         *Ehc
+  );
+
+
 
 /**
   Whether Ehc is halted.
@@ -610,9 +610,37 @@ ON_EXIT:
 }
 
 
+/**
+  Add the performance counter ticks between two values to a counter.
+
+  @param  Ehc               The EHCI device.
+  @param  Ticks             The counter to add to.
+  @param  StartTick         The performance counter value at the start.
+  @param  EndTick           The performance counter value at the end.
+
+**/
+VOID
+EhcAddTicks (
+  IN     USB2_HC_DEV      *Ehc,
+  IN OUT UINT64           *Ticks,
+  IN     UINT64           StartTick,
+  IN     UINT64           EndTick
+  )
+{
+  if (Ehc->Statistics.CountDown) {
+    *Ticks += StartTick - EndTick;
+  } else {
+    *Ticks += EndTick - StartTick;
+  }
+}
+
+
 /**
   Execute the transfer by polling the URB. This is a synchronous operation.
 
+  In IOC completion mode, each poll reads USBSTS only, and the QTDs of the
+  URB are walked when USBSTS reports a completion or an error.
+
   @param  Ehc               The EHCI device.
   @param  Urb               The URB to execute.
   @param  TimeOut           The time to wait before abort, in millisecond.
@@ -633,21 +661,53 @@ EhcExecTransfer (
   UINTN                   Index;
   UINTN                   Loop;
   BOOLEAN                 Finished;
+  BOOLEAN                 Check;
+  UINT64                  StartTick;
+  UINT64                  CheckTick;
 
   Status    = EFI_SUCCESS;
   Loop      = (TimeOut * EHC_1_MILLISECOND / EHC_SYNC_POLL_INTERVAL) + 1;
   Finished  = FALSE;
+  StartTick = 0;
+
+  if (FeaturePcdGet (PcdEhciCollectStatistics)) {
+    StartTick = GetPerformanceCounter ();
+  }
 
   for (Index = 0; Index < Loop; Index++) {
-    Finished = EhcCheckUrbResult (Ehc, Urb);
+    //
+    // Without a reported completion, still walk the QTDs every
+    // EHC_SYNC_IOC_CHECK_POLLS polls and before giving up.
+    //
+    Check = TRUE;
+    if (Ehc->IocCompletion && (EhcAckTransferInterrupt (Ehc) == 0)) {
+      Check = (BOOLEAN) ((((Index + 1) % EHC_SYNC_IOC_CHECK_POLLS) == 0) || ((Index + 1) == Loop));
+    }
 
-    if (Finished) {
-      break;
+    if (Check) {
+      if (FeaturePcdGet (PcdEhciCollectStatistics)) {
+        CheckTick = GetPerformanceCounter ();
+        Finished  = EhcCheckUrbResult (Ehc, Urb);
+        EhcAddTicks (Ehc, &Ehc->Statistics.CheckTicks, CheckTick, GetPerformanceCounter ());
+        Ehc->Statistics.Checks++;
+      } else {
+        Finished  = EhcCheckUrbResult (Ehc, Urb);
+      }
+
+      if (Finished) {
+        break;
+      }
     }
 
     gBS->Stall (EHC_SYNC_POLL_INTERVAL);
   }
 
+  if (FeaturePcdGet (PcdEhciCollectStatistics)) {
+    EhcAddTicks (Ehc, &Ehc->Statistics.WaitTicks, StartTick, GetPerformanceCounter ());
+    Ehc->Statistics.Transfers++;
+    Ehc->Statistics.Bytes += Urb->Completed;
+  }
+
   if (!Finished) {
     DEBUG ((EFI_D_ERROR, "EhcExecTransfer: transfer not finished in %dms\n", (UINT32)TimeOut));
     EhcDumpQh (Urb->Qh, NULL, FALSE);
@@ -972,3 +1032,45 @@ EhcMonitorAsyncRequests (
 
   gBS->RestoreTPL (OldTpl);
 }
+
+
+/**
+  Asynchronous interrupt transfer periodic check handler in IOC completion
+  mode. It only reads USBSTS, and signals AsyncDoneEvent to check all the
+  asynchronous interrupt transfers at once when any transfer completed
+  since the last check, or every EHC_ASYNC_IOC_CHECK_POLLS rounds.
+
+  @param  Event                 Interrupt event.
+  @param  Context               Pointer to USB2_HC_DEV.
+
+**/
+VOID
+EFIAPI
+EhcPollAsyncStatus (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  )
+{
+  USB2_HC_DEV             *Ehc;
+  EFI_TPL                 OldTpl;
+  BOOLEAN                 Signal;
+
+  OldTpl  = gBS->RaiseTPL (EHC_TPL);
+  Ehc     = (USB2_HC_DEV *) Context;
+  Signal  = FALSE;
+
+  EhcAckTransferInterrupt (Ehc);
+  Ehc->AsyncPolls++;
+
+  if ((Ehc->IntPending != 0) || (Ehc->AsyncPolls >= EHC_ASYNC_IOC_CHECK_POLLS)) {
+    Ehc->IntPending = 0;
+    Ehc->AsyncPolls = 0;
+    Signal          = (BOOLEAN) !IsListEmpty (&Ehc->AsyncIntTransfers);
+  }
+
+  gBS->RestoreTPL (OldTpl);
+
+  if (Signal) {
+    gBS->SignalEvent (Ehc->AsyncDoneEvent);
+  }
+}
@@ -177,4 +177,22 @@ EhcMonitorAsyncRequests (
   IN VOID                 *Context
   );
 
+
+/**
+  Asynchronous interrupt transfer periodic check handler in IOC completion
+  mode. It only reads USBSTS, and signals AsyncDoneEvent to check all the
+  asynchronous interrupt transfers at once when any transfer completed
+  since the last check, or every EHC_ASYNC_IOC_CHECK_POLLS rounds.
+
+  @param  Event          Interrupt event.
+  @param  Context        Pointer to USB2_HC_DEV.
+
+**/
+VOID
+EFIAPI
+EhcPollAsyncStatus (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  );
+
 #endif
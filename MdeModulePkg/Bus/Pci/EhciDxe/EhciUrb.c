@@ -495,6 +495,14 @@ EhcCreateQtds (
     Qtd->QtdHw.NextQtd  = QTD_LINK (NextQtd, FALSE);
   }
 
+  //
+  // In IOC completion mode, the last QTD sets USBINT when it retires.
+  // A short read sets USBINT by itself, and an error sets USBERRINT.
+  //
+  if (Ehc->IocCompletion) {
+    Qtd->QtdHw.IOC = 1;
+  }
+
   //
   // Link the QTDs to the queue head
   //
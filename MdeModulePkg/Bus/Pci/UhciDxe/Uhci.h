@@ -33,12 +33,12 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PcdLib.h>
+#include <Library/UsbHcMemLib.h>
 
 #include <IndustryStandard/Pci.h>
 
 typedef struct _USB_HC_DEV  USB_HC_DEV;
 
-#include "UsbHcMem.h"
 #include "UhciQueue.h"
 #include "UhciReg.h"
 #include "UhciSched.h"
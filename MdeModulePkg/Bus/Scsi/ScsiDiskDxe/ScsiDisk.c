@@ -248,6 +248,7 @@ ScsiDiskDriverBindingStart (
     // Determine if Block IO should be produced on this controller handle
     //
     if (DetermineInstallBlockIo(Controller)) {
+      ScsiDiskInitAsyncIo (ScsiDiskDevice);
       Status = gBS->InstallMultipleProtocolInterfaces (
                       &Controller,
                       &gEfiBlockIoProtocolGuid,
@@ -275,6 +276,7 @@ ScsiDiskDriverBindingStart (
     } 
   }
 
+  ScsiDiskFreeAsyncIo (ScsiDiskDevice);
   gBS->FreePool (ScsiDiskDevice->SenseData);
   gBS->FreePool (ScsiDiskDevice);
   gBS->CloseProtocol (
@@ -880,6 +882,7 @@ ScsiDiskInquiryDevice (
     //
   if ((Status == EFI_SUCCESS) || (Status == EFI_WARN_BUFFER_TOO_SMALL)) {
      ParseInquiryData (ScsiDiskDevice);
+     ScsiDiskInquiryBlockLimits (ScsiDiskDevice);
      return EFI_SUCCESS;
  
    } else if (Status == EFI_NOT_READY) {
@@ -1561,6 +1564,204 @@ ParseInquiryData (
   ScsiDiskDevice->BlkIoMedia.RemovableMedia = (BOOLEAN) (!ScsiDiskDevice->FixedDevice);
 }
 
+/**
+  Send out Inquiry command with the EVPD bit set to get a VPD page.
+
+  @param  ScsiDiskDevice    The pointer of SCSI_DISK_DEV
+  @param  PageCode          The code of the VPD page to get
+  @param  PageBuffer        The buffer to receive the VPD page
+  @param  PageLength        On input the size of PageBuffer, on output the bytes received
+
+  @retval EFI_SUCCESS       The VPD page is received.
+  @retval EFI_DEVICE_ERROR  The device failed to return the VPD page.
+
+**/
+EFI_STATUS
+ScsiDiskInquiryVpdPage (
+  IN     SCSI_DISK_DEV   *ScsiDiskDevice,
+  IN     UINT8           PageCode,
+     OUT VOID            *PageBuffer,
+  IN OUT UINT32          *PageLength
+  )
+{
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET CommandPacket;
+  EFI_SCSI_SENSE_DATA             SenseData;
+  UINT64                          Lun;
+  UINT8                           *Target;
+  UINT8                           TargetArray[SCSI_DISK_TARGET_MAX_BYTES];
+  EFI_STATUS                      Status;
+  UINT8                           Cdb[SCSI_DISK_CDB_LENGTH_SIX];
+
+  //
+  // The allocation length is kept in one byte, as SPC-2 devices expect.
+  //
+  if (*PageLength > 0xff) {
+    *PageLength = 0xff;
+  }
+
+  ZeroMem (&CommandPacket, sizeof (EFI_SCSI_IO_SCSI_REQUEST_PACKET));
+  ZeroMem (Cdb, SCSI_DISK_CDB_LENGTH_SIX);
+  ZeroMem (PageBuffer, *PageLength);
+
+  Target = &TargetArray[0];
+  ScsiDiskDevice->ScsiIo->GetDeviceLocation (ScsiDiskDevice->ScsiIo, &Target, &Lun);
+
+  Cdb[0] = EFI_SCSI_OP_INQUIRY;
+  Cdb[1] = (UINT8) ((LShiftU64 (Lun, 5) & SCSI_DISK_LUN_MASK) | 0x01);
+  Cdb[2] = PageCode;
+  Cdb[4] = (UINT8) *PageLength;
+
+  CommandPacket.Timeout          = EFI_TIMER_PERIOD_SECONDS (1);
+  CommandPacket.InDataBuffer     = PageBuffer;
+  CommandPacket.InTransferLength = *PageLength;
+  CommandPacket.SenseData        = &SenseData;
+  CommandPacket.SenseDataLength  = (UINT8) sizeof (EFI_SCSI_SENSE_DATA);
+  CommandPacket.Cdb              = Cdb;
+  CommandPacket.CdbLength        = SCSI_DISK_CDB_LENGTH_SIX;
+  CommandPacket.DataDirection    = EFI_SCSI_DATA_IN;
+
+  Status = ScsiDiskDevice->ScsiIo->ExecuteScsiCommand (ScsiDiskDevice->ScsiIo, &CommandPacket, NULL);
+
+  if (((Status != EFI_SUCCESS) && (Status != EFI_WARN_BUFFER_TOO_SMALL)) ||
+      (CommandPacket.HostAdapterStatus != EFI_SCSI_IO_STATUS_HOST_ADAPTER_OK) ||
+      (CommandPacket.TargetStatus != EFI_SCSI_IO_STATUS_TARGET_GOOD) ||
+      (CommandPacket.InTransferLength < 4) ||
+      (((UINT8 *) PageBuffer)[1] != PageCode)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  *PageLength = CommandPacket.InTransferLength;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the transfer limits of the device from the Block Limits VPD page.
+
+  The limits are left 0 if the device doesn't support the page.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskInquiryBlockLimits (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  )
+{
+  EFI_SCSI_SUPPORTED_VPD_PAGES_VPD_PAGE *SupportedVpdPages;
+  EFI_SCSI_BLOCK_LIMITS_VPD_PAGE        *BlockLimits;
+  UINT32                                PageLength;
+  UINTN                                 Index;
+  UINT32                                Granularity;
+  EFI_STATUS                            Status;
+
+  ScsiDiskDevice->BlockLimitsVpd        = FALSE;
+  ScsiDiskDevice->MaxTransferBlocks     = 0;
+  ScsiDiskDevice->OptimalTransferBlocks = 0;
+
+  //
+  // The page is defined by SBC-2, the Supported VPD Pages page is mandatory
+  // from SPC-2 (version 4) on. Older devices aren't asked at all.
+  //
+  if ((ScsiDiskDevice->DeviceType != EFI_SCSI_TYPE_DISK) || (ScsiDiskDevice->InquiryData.Version < 4)) {
+    return ;
+  }
+
+  SupportedVpdPages = AllocateZeroPool (sizeof (EFI_SCSI_SUPPORTED_VPD_PAGES_VPD_PAGE));
+  BlockLimits       = AllocateZeroPool (sizeof (EFI_SCSI_BLOCK_LIMITS_VPD_PAGE));
+
+  if ((SupportedVpdPages == NULL) || (BlockLimits == NULL)) {
+    goto ON_EXIT;
+  }
+
+  PageLength = sizeof (EFI_SCSI_SUPPORTED_VPD_PAGES_VPD_PAGE);
+  Status = ScsiDiskInquiryVpdPage (
+             ScsiDiskDevice,
+             EFI_SCSI_PAGE_CODE_SUPPORTED_VPD_PAGES,
+             SupportedVpdPages,
+             &PageLength
+             );
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  //
+  // The page length is big-endian, and counts the bytes after the header.
+  //
+  PageLength = MIN (
+                 PageLength - 4,
+                 ((UINT32) SupportedVpdPages->PageLength1 << 8) | SupportedVpdPages->PageLength0
+                 );
+  for (Index = 0; Index < PageLength; Index++) {
+    if (SupportedVpdPages->SupportedVpdPageList[Index] == EFI_SCSI_PAGE_CODE_BLOCK_LIMITS) {
+      break;
+    }
+  }
+
+  if (Index == PageLength) {
+    goto ON_EXIT;
+  }
+
+  PageLength = sizeof (EFI_SCSI_BLOCK_LIMITS_VPD_PAGE);
+  Status = ScsiDiskInquiryVpdPage (
+             ScsiDiskDevice,
+             EFI_SCSI_PAGE_CODE_BLOCK_LIMITS,
+             BlockLimits,
+             &PageLength
+             );
+  if (EFI_ERROR (Status)) {
+    goto ON_EXIT;
+  }
+
+  PageLength = MIN (
+                 PageLength,
+                 4 + (((UINT32) BlockLimits->PageLength1 << 8) | BlockLimits->PageLength0)
+                 );
+  if (PageLength < 16) {
+    goto ON_EXIT;
+  }
+
+  ScsiDiskDevice->BlockLimitsVpd        = TRUE;
+  ScsiDiskDevice->MaxTransferBlocks     = ((UINT32) BlockLimits->MaximumTransferLength3 << 24) |
+                                          ((UINT32) BlockLimits->MaximumTransferLength2 << 16) |
+                                          ((UINT32) BlockLimits->MaximumTransferLength1 << 8)  |
+                                           (UINT32) BlockLimits->MaximumTransferLength0;
+  ScsiDiskDevice->OptimalTransferBlocks = ((UINT32) BlockLimits->OptimalTransferLength3 << 24) |
+                                          ((UINT32) BlockLimits->OptimalTransferLength2 << 16) |
+                                          ((UINT32) BlockLimits->OptimalTransferLength1 << 8)  |
+                                           (UINT32) BlockLimits->OptimalTransferLength0;
+  Granularity                           = ((UINT32) BlockLimits->OptimalTransferLengthGranularity1 << 8) |
+                                           (UINT32) BlockLimits->OptimalTransferLengthGranularity0;
+
+  //
+  // Without an optimal length, commands are at least aligned to the
+  // granularity. An optimal length above the maximum is of no use.
+  //
+  if (ScsiDiskDevice->OptimalTransferBlocks == 0) {
+    ScsiDiskDevice->OptimalTransferBlocks = Granularity;
+  }
+
+  if ((ScsiDiskDevice->MaxTransferBlocks != 0) &&
+      (ScsiDiskDevice->OptimalTransferBlocks > ScsiDiskDevice->MaxTransferBlocks)) {
+    ScsiDiskDevice->OptimalTransferBlocks = 0;
+  }
+
+  DEBUG ((
+    EFI_D_INFO,
+    "ScsiDisk: block limits, maximum %d blocks, optimal %d blocks\n",
+    ScsiDiskDevice->MaxTransferBlocks,
+    ScsiDiskDevice->OptimalTransferBlocks
+    ));
+
+ON_EXIT:
+  if (SupportedVpdPages != NULL) {
+    FreePool (SupportedVpdPages);
+  }
+
+  if (BlockLimits != NULL) {
+    FreePool (BlockLimits);
+  }
+}
+
 /**
   Read sector from SCSI Disk.
 
@@ -1585,13 +1786,13 @@ ScsiDiskReadSectors (
   UINT8               *PtrBuffer;
   UINT32              BlockSize;
   UINT32              ByteCount;
-  UINT32              MaxBlock;
   UINT32              SectorCount;
   UINT64              Timeout;
   EFI_STATUS          Status;
   UINT8               Index;
   UINT8               MaxRetry;
   BOOLEAN             NeedRetry;
+  BOOLEAN             Cdb16Byte;
   EFI_SCSI_SENSE_DATA *SenseData;
   UINTN               NumberOfSenseKeys;
 
@@ -1602,36 +1803,37 @@ ScsiDiskReadSectors (
 
   BlocksRemaining   = NumberOfBlocks;
   BlockSize         = ScsiDiskDevice->BlkIo.Media->BlockSize;
-  
+
   //
-  // limit the data bytes that can be transferred by one Read(10) or Read(16) Command
+  // A request that takes several commands is first tried with the commands
+  // outstanding together. If that fails, the whole request is done again
+  // below one command at a time.
   //
-  if (!ScsiDiskDevice->Cdb16Byte) {
-    MaxBlock         = 0xFFFF;
-  } else {
-    MaxBlock         = 0xFFFFFFFF;
+  if (ScsiDiskDevice->AsyncIo) {
+    Status = ScsiDiskAsyncReadWriteSectors (ScsiDiskDevice, FALSE, Buffer, Lba, NumberOfBlocks);
+    if (!EFI_ERROR (Status)) {
+      return EFI_SUCCESS;
+    }
+    if (Status == EFI_ABORTED) {
+      //
+      // The pass-thru driver may still write into the buffer
+      //
+      return EFI_DEVICE_ERROR;
+    }
   }
 
   PtrBuffer = Buffer;
 
   while (BlocksRemaining > 0) {
 
-    if (BlocksRemaining <= MaxBlock) {
-      if (!ScsiDiskDevice->Cdb16Byte) {
-        SectorCount = (UINT16) BlocksRemaining;
-      } else {
-        SectorCount = (UINT32) BlocksRemaining;
-      }
-    } else {
-      SectorCount = MaxBlock;
-    }
-
-    ByteCount = SectorCount * BlockSize;
-    Timeout   = EFI_TIMER_PERIOD_SECONDS (2);
+    SectorCount = ScsiDiskGetTransferBlocks (ScsiDiskDevice, BlocksRemaining, &Cdb16Byte);
 
     MaxRetry  = 2;
     for (Index = 0; Index < MaxRetry; Index++) {
-      if (!ScsiDiskDevice->Cdb16Byte) {
+      ByteCount = SectorCount * BlockSize;
+      Timeout   = SCSI_DISK_TRANSFER_TIMEOUT (ByteCount);
+
+      if (!Cdb16Byte) {
         Status = ScsiDiskRead10 (
                   ScsiDiskDevice,
                   &NeedRetry,
@@ -1660,13 +1862,25 @@ ScsiDiskReadSectors (
         break;
       }
 
+      if (ScsiDiskLimitHostTransfer (ScsiDiskDevice, Status, ByteCount, SectorCount)) {
+        break;
+      }
+
       if (!NeedRetry) {
         return EFI_DEVICE_ERROR;
       }
 
     }
 
-    if ((Index == MaxRetry) && (Status != EFI_SUCCESS)) {
+    if (EFI_ERROR (Status)) {
+      //
+      // Split the rest of the request again if the pass-thru driver
+      // asked for smaller commands, otherwise the retries are used up.
+      //
+      if ((Status == EFI_BAD_BUFFER_SIZE) && (Index < MaxRetry)) {
+        continue;
+      }
+
       return EFI_DEVICE_ERROR;
     }
 
@@ -1707,13 +1921,13 @@ ScsiDiskWriteSectors (
   UINT8               *PtrBuffer;
   UINT32              BlockSize;
   UINT32              ByteCount;
-  UINT32              MaxBlock;
   UINT32              SectorCount;
   UINT64              Timeout;
   EFI_STATUS          Status;
   UINT8               Index;
   UINT8               MaxRetry;
   BOOLEAN             NeedRetry;
+  BOOLEAN             Cdb16Byte;
   EFI_SCSI_SENSE_DATA *SenseData;
   UINTN               NumberOfSenseKeys;
 
@@ -1726,33 +1940,34 @@ ScsiDiskWriteSectors (
   BlockSize         = ScsiDiskDevice->BlkIo.Media->BlockSize;
 
   //
-  // limit the data bytes that can be transferred by one Read(10) or Read(16) Command
+  // Rewriting the same data is harmless, so a failed non-blocking
+  // attempt is also followed by the whole request one command at a time.
   //
-  if (!ScsiDiskDevice->Cdb16Byte) {
-    MaxBlock         = 0xFFFF;
-  } else {
-    MaxBlock         = 0xFFFFFFFF;
+  if (ScsiDiskDevice->AsyncIo) {
+    Status = ScsiDiskAsyncReadWriteSectors (ScsiDiskDevice, TRUE, Buffer, Lba, NumberOfBlocks);
+    if (!EFI_ERROR (Status)) {
+      return EFI_SUCCESS;
+    }
+    if (Status == EFI_ABORTED) {
+      //
+      // The pass-thru driver may still read from the buffer
+      //
+      return EFI_DEVICE_ERROR;
+    }
   }
 
   PtrBuffer = Buffer;
 
   while (BlocksRemaining > 0) {
 
-    if (BlocksRemaining <= MaxBlock) {
-      if (!ScsiDiskDevice->Cdb16Byte) {
-        SectorCount = (UINT16) BlocksRemaining;
-      } else {
-        SectorCount = (UINT32) BlocksRemaining;
-      }
-    } else {
-      SectorCount = MaxBlock;
-    }
+    SectorCount = ScsiDiskGetTransferBlocks (ScsiDiskDevice, BlocksRemaining, &Cdb16Byte);
 
-    ByteCount = SectorCount * BlockSize;
-    Timeout   = EFI_TIMER_PERIOD_SECONDS (2);
     MaxRetry  = 2;
     for (Index = 0; Index < MaxRetry; Index++) {
-      if (!ScsiDiskDevice->Cdb16Byte) {
+      ByteCount = SectorCount * BlockSize;
+      Timeout   = SCSI_DISK_TRANSFER_TIMEOUT (ByteCount);
+
+      if (!Cdb16Byte) {
         Status = ScsiDiskWrite10 (
                   ScsiDiskDevice,
                   &NeedRetry,
@@ -1781,12 +1996,20 @@ ScsiDiskWriteSectors (
         break;
       }
 
+      if (ScsiDiskLimitHostTransfer (ScsiDiskDevice, Status, ByteCount, SectorCount)) {
+        break;
+      }
+
       if (!NeedRetry) {
         return EFI_DEVICE_ERROR;
       }
     }
 
-    if ((Index == MaxRetry) && (Status != EFI_SUCCESS)) {
+    if (EFI_ERROR (Status)) {
+      if ((Status == EFI_BAD_BUFFER_SIZE) && (Index < MaxRetry)) {
+        continue;
+      }
+
       return EFI_DEVICE_ERROR;
     }
     //
@@ -1803,6 +2026,475 @@ ScsiDiskWriteSectors (
 }
 
 
+/**
+  Get the number of blocks the next Read/Write command transfers.
+
+  @param  ScsiDiskDevice   The pointer of SCSI_DISK_DEV
+  @param  BlocksRemaining  The number of blocks left in the request
+  @param  Cdb16Byte        Returns TRUE if a 16-byte command is to be used
+
+  @return The number of blocks to transfer.
+
+**/
+UINT32
+ScsiDiskGetTransferBlocks (
+  IN  SCSI_DISK_DEV     *ScsiDiskDevice,
+  IN  UINTN             BlocksRemaining,
+  OUT BOOLEAN           *Cdb16Byte
+  )
+{
+  UINT32              MaxBlock;
+  UINT32              Optimal;
+
+  //
+  // The byte count of one command is kept in 32 bits, then it is limited
+  // by what the device and the pass-thru driver have reported.
+  //
+  MaxBlock = 0xFFFFFFFF / ScsiDiskDevice->BlkIo.Media->BlockSize;
+
+  if ((ScsiDiskDevice->MaxTransferBlocks != 0) && (ScsiDiskDevice->MaxTransferBlocks < MaxBlock)) {
+    MaxBlock = ScsiDiskDevice->MaxTransferBlocks;
+  }
+
+  if ((ScsiDiskDevice->HostMaxTransferBlocks != 0) && (ScsiDiskDevice->HostMaxTransferBlocks < MaxBlock)) {
+    MaxBlock = ScsiDiskDevice->HostMaxTransferBlocks;
+  }
+
+  //
+  // Read(16)/Write(16) are needed above 2TB. A device reporting the Block
+  // Limits VPD page also gets them when a command can move more blocks
+  // than the 16-bit transfer length of Read(10)/Write(10) holds.
+  //
+  *Cdb16Byte = ScsiDiskDevice->Cdb16Byte;
+
+  if (!*Cdb16Byte) {
+    if (ScsiDiskDevice->BlockLimitsVpd && (MaxBlock > 0xFFFF) && (BlocksRemaining > 0xFFFF)) {
+      *Cdb16Byte = TRUE;
+    } else if (MaxBlock > 0xFFFF) {
+      MaxBlock = 0xFFFF;
+    }
+  }
+
+  if (BlocksRemaining <= MaxBlock) {
+    return (UINT32) BlocksRemaining;
+  }
+
+  //
+  // A request longer than one command is split at a multiple of the
+  // optimal transfer length, so only its last command is shorter.
+  //
+  Optimal = ScsiDiskDevice->OptimalTransferBlocks;
+  if ((Optimal != 0) && (MaxBlock >= Optimal)) {
+    MaxBlock -= MaxBlock % Optimal;
+  }
+
+  return MaxBlock;
+}
+
+/**
+  Record the transfer limit the pass-thru driver reports with EFI_BAD_BUFFER_SIZE.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Status          The status of the Read/Write command
+  @param  ByteCount       The bytes the pass-thru driver can transfer
+  @param  SectorCount     The blocks the command tried to transfer
+
+  @retval TRUE    A smaller limit is recorded, the command can be split again.
+  @retval FALSE   The status doesn't report a usable limit.
+
+**/
+BOOLEAN
+ScsiDiskLimitHostTransfer (
+  IN OUT SCSI_DISK_DEV     *ScsiDiskDevice,
+  IN     EFI_STATUS        Status,
+  IN     UINT32            ByteCount,
+  IN     UINT32            SectorCount
+  )
+{
+  UINT32              BlockSize;
+
+  BlockSize = ScsiDiskDevice->BlkIo.Media->BlockSize;
+
+  //
+  // Nothing was transferred, and ByteCount holds what the pass-thru
+  // driver can do in one go. The limit only ever shrinks.
+  //
+  if ((Status != EFI_BAD_BUFFER_SIZE) || (ByteCount < BlockSize) || (ByteCount / BlockSize >= SectorCount)) {
+    return FALSE;
+  }
+
+  ScsiDiskDevice->HostMaxTransferBlocks = ByteCount / BlockSize;
+  DEBUG ((EFI_D_INFO, "ScsiDisk: pass-thru takes %d blocks per command\n", ScsiDiskDevice->HostMaxTransferBlocks));
+
+  return TRUE;
+}
+
+/**
+  Set up the non-blocking Read/Write commands if the pass-thru driver supports them.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskInitAsyncIo (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  )
+{
+  EFI_EXT_SCSI_PASS_THRU_PROTOCOL *ExtScsiPassThru;
+  UINTN                           QueueDepth;
+  UINTN                           Index;
+  EFI_STATUS                      Status;
+
+  ScsiDiskDevice->AsyncIo    = FALSE;
+  ScsiDiskDevice->QueueDepth = 0;
+  ScsiDiskDevice->AsyncSlots = NULL;
+
+  QueueDepth = PcdGet32 (PcdScsiDiskQueueDepth);
+  if (QueueDepth <= 1) {
+    return ;
+  }
+
+  //
+  // Only an Extended SCSI Pass Thru driver is given several commands at once.
+  // The SCSI bus driver converts the packets for the older SCSI Pass Thru
+  // through a single working buffer, which holds one command at a time.
+  //
+  ExtScsiPassThru = (EFI_EXT_SCSI_PASS_THRU_PROTOCOL *) GetParentProtocol (&gEfiExtScsiPassThruProtocolGuid, ScsiDiskDevice->Handle);
+  if ((ExtScsiPassThru == NULL) ||
+      ((ExtScsiPassThru->Mode->Attributes & EFI_EXT_SCSI_PASS_THRU_ATTRIBUTES_NONBLOCKIO) == 0)) {
+    return ;
+  }
+
+  ScsiDiskDevice->AsyncSlots = AllocateZeroPool (QueueDepth * sizeof (SCSI_DISK_ASYNC_SLOT));
+  if (ScsiDiskDevice->AsyncSlots == NULL) {
+    return ;
+  }
+
+  ScsiDiskDevice->QueueDepth = QueueDepth;
+
+  //
+  // The events have no notification function, their state is
+  // polled with CheckEvent() while the Block I/O call waits.
+  //
+  for (Index = 0; Index < QueueDepth; Index++) {
+    Status = gBS->CreateEvent (
+                    0,
+                    TPL_CALLBACK,
+                    NULL,
+                    NULL,
+                    &ScsiDiskDevice->AsyncSlots[Index].Event
+                    );
+    if (EFI_ERROR (Status)) {
+      ScsiDiskFreeAsyncIo (ScsiDiskDevice);
+      return ;
+    }
+  }
+
+  ScsiDiskDevice->AsyncIo = TRUE;
+}
+
+/**
+  Release the resources of the non-blocking Read/Write commands.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskFreeAsyncIo (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  )
+{
+  UINTN               Index;
+
+  ScsiDiskDevice->AsyncIo = FALSE;
+
+  if (ScsiDiskDevice->AsyncSlots == NULL) {
+    return ;
+  }
+
+  for (Index = 0; Index < ScsiDiskDevice->QueueDepth; Index++) {
+    if (ScsiDiskDevice->AsyncSlots[Index].Event != NULL) {
+      gBS->CloseEvent (ScsiDiskDevice->AsyncSlots[Index].Event);
+    }
+  }
+
+  FreePool (ScsiDiskDevice->AsyncSlots);
+  ScsiDiskDevice->AsyncSlots = NULL;
+  ScsiDiskDevice->QueueDepth = 0;
+}
+
+/**
+  Fill in the packet of a non-blocking Read/Write command.
+
+  @param  Slot         The slot of the command
+  @param  Write        TRUE for a write command, FALSE for a read command
+  @param  Cdb16Byte    TRUE to use Read(16)/Write(16)
+  @param  Lun          The logical unit number of the device
+  @param  Buffer       The buffer of the data
+  @param  Lba          Logic block address
+  @param  SectorCount  The number of blocks to transfer
+  @param  BlockSize    The size of a block
+
+**/
+VOID
+ScsiDiskBuildAsyncCommand (
+  IN OUT SCSI_DISK_ASYNC_SLOT  *Slot,
+  IN     BOOLEAN               Write,
+  IN     BOOLEAN               Cdb16Byte,
+  IN     UINT64                Lun,
+  IN     UINT8                 *Buffer,
+  IN     EFI_LBA               Lba,
+  IN     UINT32                SectorCount,
+  IN     UINT32                BlockSize
+  )
+{
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET *Packet;
+  UINT8                           *Cdb;
+
+  Packet = &Slot->Packet;
+  Cdb    = Slot->Cdb;
+
+  ZeroMem (Packet, sizeof (EFI_SCSI_IO_SCSI_REQUEST_PACKET));
+  ZeroMem (Cdb, SCSI_DISK_CDB_LENGTH_SIXTEEN);
+
+  Slot->ByteCount         = SectorCount * BlockSize;
+  Packet->Timeout         = SCSI_DISK_TRANSFER_TIMEOUT (Slot->ByteCount);
+  Packet->SenseData       = &Slot->SenseData;
+  Packet->SenseDataLength = (UINT8) sizeof (EFI_SCSI_SENSE_DATA);
+  Packet->Cdb             = Cdb;
+
+  if (Write) {
+    Packet->OutDataBuffer     = Buffer;
+    Packet->OutTransferLength = Slot->ByteCount;
+    Packet->DataDirection     = EFI_SCSI_DATA_OUT;
+  } else {
+    Packet->InDataBuffer      = Buffer;
+    Packet->InTransferLength  = Slot->ByteCount;
+    Packet->DataDirection     = EFI_SCSI_DATA_IN;
+  }
+
+  Cdb[1] = (UINT8) (LShiftU64 (Lun, 5) & SCSI_DISK_LUN_MASK);
+
+  if (Cdb16Byte) {
+    Cdb[0] = (UINT8) (Write ? EFI_SCSI_OP_WRITE16 : EFI_SCSI_OP_READ16);
+    WriteUnaligned64 ((UINT64 *) &Cdb[2], SwapBytes64 (Lba));
+    WriteUnaligned32 ((UINT32 *) &Cdb[10], SwapBytes32 (SectorCount));
+    Packet->CdbLength = SCSI_DISK_CDB_LENGTH_SIXTEEN;
+  } else {
+    Cdb[0] = (UINT8) (Write ? EFI_SCSI_OP_WRITE10 : EFI_SCSI_OP_READ10);
+    WriteUnaligned32 ((UINT32 *) &Cdb[2], SwapBytes32 ((UINT32) Lba));
+    WriteUnaligned16 ((UINT16 *) &Cdb[7], SwapBytes16 ((UINT16) SectorCount));
+    Packet->CdbLength = SCSI_DISK_CDB_LENGTH_TEN;
+  }
+}
+
+/**
+  Wait for the non-blocking commands still outstanding after the device is reset.
+
+  The pass-thru driver owns the packet, the event and the data buffer of a
+  command until the command completes. If some commands don't complete even
+  after the reset, their slots are left to the pass-thru driver rather than
+  freed, and the data buffer of the request must not be reused.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+  @retval EFI_TIMEOUT     All the commands completed.
+  @retval EFI_ABORTED     Some commands are still outstanding, their slots are left
+                          to the pass-thru driver.
+
+**/
+EFI_STATUS
+ScsiDiskDrainAsyncCommands (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  )
+{
+  SCSI_DISK_ASYNC_SLOT  *Slot;
+  UINTN                 Outstanding;
+  UINTN                 Index;
+  UINT64                Waited;
+
+  Waited = 0;
+  while (TRUE) {
+    Outstanding = 0;
+    for (Index = 0; Index < ScsiDiskDevice->QueueDepth; Index++) {
+      Slot = &ScsiDiskDevice->AsyncSlots[Index];
+      if (!Slot->InUse) {
+        continue;
+      }
+
+      if (gBS->CheckEvent (Slot->Event) == EFI_SUCCESS) {
+        Slot->InUse = FALSE;
+      } else {
+        Outstanding++;
+      }
+    }
+
+    if (Outstanding == 0) {
+      return EFI_TIMEOUT;
+    }
+
+    if (Waited > SCSI_DISK_ASYNC_ABORT_TIMEOUT) {
+      break;
+    }
+
+    gBS->Stall (SCSI_DISK_ASYNC_POLL_INTERVAL);
+    Waited += SCSI_DISK_ASYNC_POLL_INTERVAL * 10;
+  }
+
+  DEBUG ((EFI_D_ERROR, "ScsiDisk: %d non-blocking commands still outstanding after reset\n", Outstanding));
+  ScsiDiskDevice->AsyncSlots = NULL;
+  ScsiDiskDevice->QueueDepth = 0;
+  return EFI_ABORTED;
+}
+
+/**
+  Read or write sectors with several Read/Write commands outstanding.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Write           TRUE to write to the device, FALSE to read
+  @param  Buffer          The buffer of the data
+  @param  Lba             Logic block address
+  @param  NumberOfBlocks  The number of blocks to transfer
+
+  @retval EFI_SUCCESS       All the commands completed successfully.
+  @retval EFI_UNSUPPORTED   The request fits in one command.
+  @retval EFI_TIMEOUT       The commands didn't complete and were aborted, non-blocking
+                            I/O is turned off.
+  @retval EFI_ABORTED       The commands didn't complete and some are still outstanding
+                            after a reset, the buffer must not be reused for the request.
+  @retval EFI_DEVICE_ERROR  A command failed.
+
+**/
+EFI_STATUS
+ScsiDiskAsyncReadWriteSectors (
+  IN  SCSI_DISK_DEV     *ScsiDiskDevice,
+  IN  BOOLEAN           Write,
+  IN  VOID              *Buffer,
+  IN  EFI_LBA           Lba,
+  IN  UINTN             NumberOfBlocks
+  )
+{
+  EFI_SCSI_IO_PROTOCOL  *ScsiIo;
+  SCSI_DISK_ASYNC_SLOT  *Slot;
+  UINT8                 *PtrBuffer;
+  UINTN                 BlocksRemaining;
+  UINT32                BlockSize;
+  UINT32                SectorCount;
+  BOOLEAN               Cdb16Byte;
+  UINT64                Lun;
+  UINT8                 *Target;
+  UINT8                 TargetArray[SCSI_DISK_TARGET_MAX_BYTES];
+  UINTN                 Outstanding;
+  UINTN                 Completed;
+  UINTN                 Index;
+  UINT64                Timeout;
+  UINT64                Waited;
+  BOOLEAN               Failed;
+  EFI_STATUS            Status;
+
+  ScsiIo    = ScsiDiskDevice->ScsiIo;
+  BlockSize = ScsiDiskDevice->BlkIo.Media->BlockSize;
+
+  if (ScsiDiskGetTransferBlocks (ScsiDiskDevice, NumberOfBlocks, &Cdb16Byte) >= NumberOfBlocks) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Target = &TargetArray[0];
+  ScsiIo->GetDeviceLocation (ScsiIo, &Target, &Lun);
+
+  PtrBuffer       = Buffer;
+  BlocksRemaining = NumberOfBlocks;
+  Outstanding     = 0;
+  Timeout         = 0;
+  Waited          = 0;
+  Failed          = FALSE;
+
+  while (TRUE) {
+    //
+    // Keep the free slots busy with the next parts of the request.
+    //
+    for (Index = 0; (Index < ScsiDiskDevice->QueueDepth) && (BlocksRemaining > 0) && !Failed; Index++) {
+      Slot = &ScsiDiskDevice->AsyncSlots[Index];
+      if (Slot->InUse) {
+        continue;
+      }
+
+      SectorCount = ScsiDiskGetTransferBlocks (ScsiDiskDevice, BlocksRemaining, &Cdb16Byte);
+      ScsiDiskBuildAsyncCommand (Slot, Write, Cdb16Byte, Lun, PtrBuffer, Lba, SectorCount, BlockSize);
+
+      Status = ScsiIo->ExecuteScsiCommand (ScsiIo, &Slot->Packet, Slot->Event);
+      if (EFI_ERROR (Status)) {
+        ScsiDiskLimitHostTransfer (
+          ScsiDiskDevice,
+          Status,
+          Write ? Slot->Packet.OutTransferLength : Slot->Packet.InTransferLength,
+          SectorCount
+          );
+        Failed = TRUE;
+        break;
+      }
+
+      Slot->InUse = TRUE;
+      Outstanding++;
+      Timeout     = MAX (Timeout, Slot->Packet.Timeout);
+
+      Lba             += SectorCount;
+      PtrBuffer       += SectorCount * BlockSize;
+      BlocksRemaining -= SectorCount;
+    }
+
+    if (Outstanding == 0) {
+      break;
+    }
+
+    //
+    // Pick up the commands that have completed. Any short or failed
+    // command fails the request, the rest are still waited for since
+    // they own parts of the buffer.
+    //
+    Completed = 0;
+    for (Index = 0; Index < ScsiDiskDevice->QueueDepth; Index++) {
+      Slot = &ScsiDiskDevice->AsyncSlots[Index];
+      if (!Slot->InUse || (gBS->CheckEvent (Slot->Event) != EFI_SUCCESS)) {
+        continue;
+      }
+
+      Slot->InUse = FALSE;
+      Outstanding--;
+      Completed++;
+
+      if ((Slot->Packet.HostAdapterStatus != EFI_SCSI_IO_STATUS_HOST_ADAPTER_OK) ||
+          (Slot->Packet.TargetStatus != EFI_SCSI_IO_STATUS_TARGET_GOOD) ||
+          ((Write ? Slot->Packet.OutTransferLength : Slot->Packet.InTransferLength) != Slot->ByteCount)) {
+        Failed = TRUE;
+      }
+    }
+
+    if (Completed != 0) {
+      Waited = 0;
+      continue;
+    }
+
+    //
+    // The pass-thru driver may make progress only from a timer callback
+    // that can't run at the TPL of this call. Don't wait for it forever:
+    // reset the device to abort the commands and stay blocking from now on.
+    //
+    if (Waited > Timeout) {
+      DEBUG ((EFI_D_ERROR, "ScsiDisk: non-blocking commands timed out, turning them off\n"));
+      ScsiDiskDevice->AsyncIo = FALSE;
+      ScsiIo->ResetDevice (ScsiIo);
+      return ScsiDiskDrainAsyncCommands (ScsiDiskDevice);
+    }
+
+    gBS->Stall (SCSI_DISK_ASYNC_POLL_INTERVAL);
+    Waited += SCSI_DISK_ASYNC_POLL_INTERVAL * 10;
+  }
+
+  return Failed ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+}
+
+
 /**
   Submit Read(10) command.
 
@@ -2393,6 +3085,8 @@ ReleaseScsiDiskDeviceResources (
     ScsiDiskDevice->ControllerNameTable = NULL;
   }
 
+  ScsiDiskFreeAsyncIo (ScsiDiskDevice);
+
   FreePool (ScsiDiskDevice);
 
   ScsiDiskDevice = NULL;
@@ -27,6 +27,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/ScsiPassThru.h>
 
 #include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/PcdLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/UefiLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -40,6 +42,44 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #define SCSI_DISK_DEV_SIGNATURE SIGNATURE_32 ('s', 'c', 'd', 'k')
 
+//
+// Max bytes needed to represent ID of a SCSI device, the logical unit
+// number bits of the second CDB byte, and the CDB lengths in use.
+//
+#define SCSI_DISK_TARGET_MAX_BYTES   0x10
+#define SCSI_DISK_LUN_MASK           0xe0
+#define SCSI_DISK_CDB_LENGTH_SIX     0x06
+#define SCSI_DISK_CDB_LENGTH_TEN     0x0a
+#define SCSI_DISK_CDB_LENGTH_SIXTEEN 0x10
+
+//
+// A Read/Write command is given 2 seconds plus 1 second per MB.
+//
+#define SCSI_DISK_TRANSFER_TIMEOUT(ByteCount)  EFI_TIMER_PERIOD_SECONDS (2 + (ByteCount) / SIZE_1MB)
+
+//
+// Interval in microseconds to check the non-blocking commands for completion.
+//
+#define SCSI_DISK_ASYNC_POLL_INTERVAL  10
+
+//
+// Time to wait for the non-blocking commands to complete after the device is reset.
+//
+#define SCSI_DISK_ASYNC_ABORT_TIMEOUT  EFI_TIMER_PERIOD_SECONDS (2)
+
+//
+// One Read/Write command submitted as non-blocking I/O. The packet,
+// the CDB and the sense data must stay put until the event is signaled.
+//
+typedef struct {
+  EFI_SCSI_IO_SCSI_REQUEST_PACKET Packet;
+  UINT8                           Cdb[SCSI_DISK_CDB_LENGTH_SIXTEEN];
+  EFI_SCSI_SENSE_DATA             SenseData;
+  EFI_EVENT                       Event;
+  UINT32                          ByteCount;
+  BOOLEAN                         InUse;
+} SCSI_DISK_ASYNC_SLOT;
+
 typedef struct {
   UINT32                    Signature;
 
@@ -62,6 +102,24 @@ typedef struct {
   // The flag indicates if 16-byte command can be used
   //
   BOOLEAN                   Cdb16Byte;
+
+  //
+  // Transfer lengths in blocks reported by the Block Limits VPD page,
+  // 0 if not reported. HostMaxTransferBlocks is the limit reported by
+  // the pass-thru driver through EFI_BAD_BUFFER_SIZE, 0 if none.
+  //
+  BOOLEAN                   BlockLimitsVpd;
+  UINT32                    MaxTransferBlocks;
+  UINT32                    OptimalTransferBlocks;
+  UINT32                    HostMaxTransferBlocks;
+
+  //
+  // Up to QueueDepth Read/Write commands may be outstanding while AsyncIo
+  // is TRUE, each in one of the AsyncSlots.
+  //
+  BOOLEAN                   AsyncIo;
+  UINTN                     QueueDepth;
+  SCSI_DISK_ASYNC_SLOT      *AsyncSlots;
 } SCSI_DISK_DEV;
 
 #define SCSI_DISK_DEV_FROM_THIS(a)  CR (a, SCSI_DISK_DEV, BlkIo, SCSI_DISK_DEV_SIGNATURE)
@@ -558,6 +616,165 @@ ParseInquiryData (
   IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
   );
 
+/**
+  Send out Inquiry command with the EVPD bit set to get a VPD page.
+
+  @param  ScsiDiskDevice    The pointer of SCSI_DISK_DEV
+  @param  PageCode          The code of the VPD page to get
+  @param  PageBuffer        The buffer to receive the VPD page
+  @param  PageLength        On input the size of PageBuffer, on output the bytes received
+
+  @retval EFI_SUCCESS       The VPD page is received.
+  @retval EFI_DEVICE_ERROR  The device failed to return the VPD page.
+
+**/
+EFI_STATUS
+ScsiDiskInquiryVpdPage (
+  IN     SCSI_DISK_DEV   *ScsiDiskDevice,
+  IN     UINT8           PageCode,
+     OUT VOID            *PageBuffer,
+  IN OUT UINT32          *PageLength
+  );
+
+/**
+  Get the transfer limits of the device from the Block Limits VPD page.
+
+  The limits are left 0 if the device doesn't support the page.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskInquiryBlockLimits (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  );
+
+/**
+  Get the number of blocks the next Read/Write command transfers.
+
+  @param  ScsiDiskDevice   The pointer of SCSI_DISK_DEV
+  @param  BlocksRemaining  The number of blocks left in the request
+  @param  Cdb16Byte        Returns TRUE if a 16-byte command is to be used
+
+  @return The number of blocks to transfer.
+
+**/
+UINT32
+ScsiDiskGetTransferBlocks (
+  IN  SCSI_DISK_DEV     *ScsiDiskDevice,
+  IN  UINTN             BlocksRemaining,
+  OUT BOOLEAN           *Cdb16Byte
+  );
+
+/**
+  Record the transfer limit the pass-thru driver reports with EFI_BAD_BUFFER_SIZE.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Status          The status of the Read/Write command
+  @param  ByteCount       The bytes the pass-thru driver can transfer
+  @param  SectorCount     The blocks the command tried to transfer
+
+  @retval TRUE    A smaller limit is recorded, the command can be split again.
+  @retval FALSE   The status doesn't report a usable limit.
+
+**/
+BOOLEAN
+ScsiDiskLimitHostTransfer (
+  IN OUT SCSI_DISK_DEV     *ScsiDiskDevice,
+  IN     EFI_STATUS        Status,
+  IN     UINT32            ByteCount,
+  IN     UINT32            SectorCount
+  );
+
+/**
+  Set up the non-blocking Read/Write commands if the pass-thru driver supports them.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskInitAsyncIo (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  );
+
+/**
+  Release the resources of the non-blocking Read/Write commands.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+**/
+VOID
+ScsiDiskFreeAsyncIo (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  );
+
+/**
+  Fill in the packet of a non-blocking Read/Write command.
+
+  @param  Slot         The slot of the command
+  @param  Write        TRUE for a write command, FALSE for a read command
+  @param  Cdb16Byte    TRUE to use Read(16)/Write(16)
+  @param  Lun          The logical unit number of the device
+  @param  Buffer       The buffer of the data
+  @param  Lba          Logic block address
+  @param  SectorCount  The number of blocks to transfer
+  @param  BlockSize    The size of a block
+
+**/
+VOID
+ScsiDiskBuildAsyncCommand (
+  IN OUT SCSI_DISK_ASYNC_SLOT  *Slot,
+  IN     BOOLEAN               Write,
+  IN     BOOLEAN               Cdb16Byte,
+  IN     UINT64                Lun,
+  IN     UINT8                 *Buffer,
+  IN     EFI_LBA               Lba,
+  IN     UINT32                SectorCount,
+  IN     UINT32                BlockSize
+  );
+
+/**
+  Wait for the non-blocking commands still outstanding after the device is reset.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+
+  @retval EFI_TIMEOUT     All the commands completed.
+  @retval EFI_ABORTED     Some commands are still outstanding, their slots are left
+                          to the pass-thru driver.
+
+**/
+EFI_STATUS
+ScsiDiskDrainAsyncCommands (
+  IN OUT SCSI_DISK_DEV   *ScsiDiskDevice
+  );
+
+/**
+  Read or write sectors with several Read/Write commands outstanding.
+
+  @param  ScsiDiskDevice  The pointer of SCSI_DISK_DEV
+  @param  Write           TRUE to write to the device, FALSE to read
+  @param  Buffer          The buffer of the data
+  @param  Lba             Logic block address
+  @param  NumberOfBlocks  The number of blocks to transfer
+
+  @retval EFI_SUCCESS       All the commands completed successfully.
+  @retval EFI_UNSUPPORTED   The request fits in one command.
+  @retval EFI_TIMEOUT       The commands didn't complete and were aborted, non-blocking
+                            I/O is turned off.
+  @retval EFI_ABORTED       The commands didn't complete and some are still outstanding
+                            after a reset, the buffer must not be reused for the request.
+  @retval EFI_DEVICE_ERROR  A command failed.
+
+**/
+EFI_STATUS
+ScsiDiskAsyncReadWriteSectors (
+  IN  SCSI_DISK_DEV     *ScsiDiskDevice,
+  IN  BOOLEAN           Write,
+  IN  VOID              *Buffer,
+  IN  EFI_LBA           Lba,
+  IN  UINTN             NumberOfBlocks
+  );
+
 /**
   Read sector from SCSI Disk.
 
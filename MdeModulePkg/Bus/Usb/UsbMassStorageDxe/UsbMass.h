@@ -31,6 +31,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/UefiLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/TimerLib.h>
+#include <Library/PcdLib.h>
 
 #define USB_IS_IN_ENDPOINT(EndPointAddr)      (((EndPointAddr) & BIT7) == BIT7)
 #define USB_IS_OUT_ENDPOINT(EndPointAddr)     (((EndPointAddr) & BIT7) == 0)
@@ -188,6 +190,17 @@ typedef struct {
   USB_MASS_CLEAN_UP       CleanUp;     ///< Clean up the resources.
 } USB_MASS_TRANSPORT;
 
+///
+/// Counters of the READ/WRITE commands issued to one logic unit,
+/// reported when the driver stops managing it. They are only
+/// collected if PcdUsbMassCollectStatistics is TRUE.
+///
+typedef struct {
+  UINT64                  Commands;    ///< Number of commands completed
+  UINT64                  Bytes;       ///< Number of bytes transferred
+  UINT64                  Ticks;       ///< Performance counter ticks spent in the commands
+} USB_MASS_IO_STATISTICS;
+
 typedef struct {
   UINT32                    Signature;
   EFI_HANDLE                Controller;
@@ -200,6 +213,11 @@ typedef struct {
   UINT8                     Pdt;          ///< Peripheral Device Type
   USB_MASS_TRANSPORT        *Transport;   ///< USB mass storage transport protocol
   VOID                      *Context;     
+  BOOLEAN                   MediaReady;   ///< Capacity is known and no media change was reported since
+  BOOLEAN                   Cdb16Byte;    ///< Use READ(16)/WRITE(16) for the media beyond 32-bit LBA
+  UINT32                    MaxIoSize;    ///< Largest data phase of one READ/WRITE command in bytes
+  USB_MASS_IO_STATISTICS    ReadStatistics;
+  USB_MASS_IO_STATISTICS    WriteStatistics;
 } USB_MASS_DEVICE;
 
 #endif
@@ -94,6 +94,7 @@ UsbBootRequestSense (
     Status = EFI_DEVICE_ERROR;
     if (SenseData.ASC == USB_BOOT_ASC_NO_MEDIA) {
       Media->MediaPresent = FALSE;
+      UsbMass->MediaReady = FALSE;
       Status = EFI_NO_MEDIA;
     } else if (SenseData.ASC == USB_BOOT_ASC_NOT_READY) {
       Status = EFI_NOT_READY;
@@ -113,6 +114,7 @@ UsbBootRequestSense (
       Status = EFI_MEDIA_CHANGED;
       Media->ReadOnly = FALSE;
       Media->MediaId++;
+      UsbMass->MediaReady = FALSE;
     }
     break;
 
@@ -356,6 +358,70 @@ UsbBootInquiry (
 }
 
 
+/**
+  Execute READ CAPACITY(16) command to request the capacity of the media
+  whose last block doesn't fit in the 32 bits of READ CAPACITY(10).
+
+  The command is only supported by BOT, since its command block is longer
+  than those of CBI.
+
+  @param  UsbMass                The device to retireve disk gemotric.
+
+  @retval EFI_SUCCESS            The disk geometry is successfully retrieved.
+  @retval EFI_UNSUPPORTED        The transport doesn't carry 16-byte commands.
+  @retval Other                  READ CAPACITY(16) command execution failed.
+
+**/
+EFI_STATUS
+UsbBootReadCapacity16 (
+  IN USB_MASS_DEVICE          *UsbMass
+  )
+{
+  USB_BOOT_READ_CAPACITY16_CMD  CapacityCmd;
+  USB_BOOT_READ_CAPACITY16_DATA CapacityData;
+  EFI_BLOCK_IO_MEDIA            *Media;
+  EFI_STATUS                    Status;
+  UINT32                        BlockSize;
+
+  if (UsbMass->Transport->Protocol != USB_MASS_STORE_BOT) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Media   = &UsbMass->BlockIoMedia;
+
+  ZeroMem (&CapacityCmd, sizeof (USB_BOOT_READ_CAPACITY16_CMD));
+  ZeroMem (&CapacityData, sizeof (USB_BOOT_READ_CAPACITY16_DATA));
+
+  CapacityCmd.OpCode        = USB_BOOT_READ_CAPACITY16_OPCODE;
+  CapacityCmd.ServiceAction = USB_BOOT_READ_CAPACITY16_SA;
+  WriteUnaligned32 ((UINT32 *) CapacityCmd.AllocLen, SwapBytes32 ((UINT32) sizeof (USB_BOOT_READ_CAPACITY16_DATA)));
+
+  Status = UsbBootExecCmdWithRetry (
+             UsbMass,
+             &CapacityCmd,
+             sizeof (USB_BOOT_READ_CAPACITY16_CMD),
+             EfiUsbDataIn,
+             &CapacityData,
+             sizeof (USB_BOOT_READ_CAPACITY16_DATA),
+             USB_BOOT_GENERAL_CMD_TIMEOUT
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  BlockSize = SwapBytes32 (ReadUnaligned32 ((CONST UINT32 *) CapacityData.BlockLen));
+  if (BlockSize == 0) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  Media->LastBlock   = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) CapacityData.LastLba));
+  Media->BlockSize   = BlockSize;
+  UsbMass->Cdb16Byte = (BOOLEAN) (Media->LastBlock > 0xFFFFFFFF);
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Execute READ CAPACITY command to request information regarding
   the capacity of the installed medium of the device.
@@ -420,6 +486,18 @@ UsbBootReadCapacity (
     Media->BlockSize = BlockSize;
   }
 
+  //
+  // The media is too large for READ CAPACITY(10) to report its last block.
+  // Ask READ CAPACITY(16) for it, and address the media with READ(16) and
+  // WRITE(16). If that fails, only the first 2^32 blocks are usable.
+  //
+  UsbMass->Cdb16Byte = FALSE;
+  if (Media->LastBlock == 0xFFFFFFFF) {
+    UsbBootReadCapacity16 (UsbMass);
+  }
+
+  UsbMass->MediaReady = TRUE;
+
   DEBUG ((EFI_D_INFO, "UsbBootReadCapacity Success LBA=%ld BlockSize=%d\n",
           Media->LastBlock, Media->BlockSize));
 
@@ -575,6 +653,16 @@ UsbBootDetectMedia (
     goto ON_ERROR;
   }
 
+  //
+  // A media change is reported as UNIT ATTENTION to the first command after
+  // it, which clears MediaReady in UsbBootRequestSense(). So if the unit is
+  // ready and nothing was reported since the last READ CAPACITY, the media
+  // parameters are still valid and the other round trips can be skipped.
+  //
+  if (UsbMass->MediaReady && Media->MediaPresent) {
+    return EFI_SUCCESS;
+  }
+
   if ((UsbMass->Pdt != USB_PDT_CDROM) && (CmdSet == USB_MASS_STORE_SCSI)) {
     //
     // MODE SENSE is required for the device with PDT of 0x00/0x07/0x0E,
@@ -595,6 +683,8 @@ UsbBootDetectMedia (
   return EFI_SUCCESS;
 
 ON_ERROR:
+  UsbMass->MediaReady = FALSE;
+
   //
   // Detect whether it is necessary to reinstall the Block I/O Protocol.
   //
@@ -649,74 +739,152 @@ ON_ERROR:
 
 
 /**
-  Read some blocks from the device.
+  Issue READ or WRITE commands to transfer some blocks.
 
-  @param  UsbMass                The USB mass storage device to read from
+  The blocks are carried by as few commands as the device accepts. READ(10)
+  and WRITE(10) are used unless the media is beyond 32-bit LBA, then READ(16)
+  and WRITE(16) are used. If a large command fails, the per-command limit of
+  the device is halved and the command is tried again, down to the limit of
+  USB_BOOT_IO_BLOCKS blocks that used to be the only size issued.
+
+  @param  UsbMass                The USB mass storage device to transfer with
+  @param  Write                  TRUE to write the blocks, FALSE to read them
   @param  Lba                    The start block number
-  @param  TotalBlock             Total block number to read
-  @param  Buffer                 The buffer to read to
+  @param  TotalBlock             Total block number to transfer
+  @param  Buffer                 The buffer to transfer the data from or to
 
-  @retval EFI_SUCCESS            Data are read into the buffer
-  @retval Others                 Failed to read all the data
+  @retval EFI_SUCCESS            All the blocks are transferred
+  @retval Others                 Failed to transfer all the data
 
 **/
 EFI_STATUS
-UsbBootReadBlocks (
-  IN  USB_MASS_DEVICE       *UsbMass,
-  IN  UINT32                Lba,
-  IN  UINTN                 TotalBlock,
-  OUT UINT8                 *Buffer
+UsbBootReadWriteBlocks (
+  IN     USB_MASS_DEVICE      *UsbMass,
+  IN     BOOLEAN              Write,
+  IN     EFI_LBA              Lba,
+  IN     UINTN                TotalBlock,
+  IN OUT UINT8                *Buffer
   )
 {
-  USB_BOOT_READ10_CMD       ReadCmd;
+  USB_BOOT_READ10_CMD       Cmd10;
+  USB_BOOT_READ_WRITE16_CMD Cmd16;
+  USB_MASS_IO_STATISTICS    *Statistics;
+  VOID                      *Cmd;
+  UINT8                     CmdLen;
   EFI_STATUS                Status;
-  UINT16                    Count;
+  UINTN                     MaxBlock;
+  UINT32                    Count;
   UINT32                    BlockSize;
   UINT32                    ByteSize;
   UINT32                    Timeout;
-
-  BlockSize = UsbMass->BlockIoMedia.BlockSize;
-  Status    = EFI_SUCCESS;
+  UINT64                    StartTick;
+  UINT64                    EndTick;
+  UINT64                    StartValue;
+  UINT64                    EndValue;
+
+  BlockSize  = UsbMass->BlockIoMedia.BlockSize;
+  Statistics = Write ? &UsbMass->WriteStatistics : &UsbMass->ReadStatistics;
+  Status     = EFI_SUCCESS;
+  StartTick  = 0;
+  EndTick    = 0;
+  StartValue = 0;
+  EndValue   = 0;
+
+  if (FeaturePcdGet (PcdUsbMassCollectStatistics)) {
+    GetPerformanceCounterProperties (&StartValue, &EndValue);
+  }
 
   while (TotalBlock > 0) {
     //
-    // Split the total blocks into smaller pieces to ease the pressure
-    // on the device. We must split the total block because the READ10
-    // command only has 16 bit transfer length (in the unit of block).
+    // Split the total blocks into the pieces the device accepts. READ(10)
+    // and WRITE(10) only have 16 bit transfer length (in the unit of block).
     //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
-    ByteSize  = (UINT32)Count * BlockSize;
+    MaxBlock = UsbMass->MaxIoSize / BlockSize;
+    if (MaxBlock < USB_BOOT_IO_BLOCKS) {
+      MaxBlock = USB_BOOT_IO_BLOCKS;
+    }
+    if (!UsbMass->Cdb16Byte && (MaxBlock > 0xFFFF)) {
+      MaxBlock = 0xFFFF;
+    }
+
+    Count     = (UINT32) ((TotalBlock < MaxBlock) ? TotalBlock : MaxBlock);
+    ByteSize  = Count * BlockSize;
 
     //
     // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
+    // Give the data phase of the large transfers another second per 1MB.
     //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
+    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT + (ByteSize / SIZE_1MB) * USB_MASS_1_SECOND;
 
     //
     // Fill in the command then execute
     //
-    ZeroMem (&ReadCmd, sizeof (USB_BOOT_READ10_CMD));
+    if (UsbMass->Cdb16Byte) {
+      ZeroMem (&Cmd16, sizeof (USB_BOOT_READ_WRITE16_CMD));
+
+      Cmd16.OpCode = (UINT8) (Write ? USB_BOOT_WRITE16_OPCODE : USB_BOOT_READ16_OPCODE);
+      WriteUnaligned64 ((UINT64 *) Cmd16.Lba, SwapBytes64 (Lba));
+      WriteUnaligned32 ((UINT32 *) Cmd16.TransferLen, SwapBytes32 (Count));
 
-    ReadCmd.OpCode  = USB_BOOT_READ10_OPCODE;
-    ReadCmd.Lun     = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
-    WriteUnaligned32 ((UINT32 *) ReadCmd.Lba, SwapBytes32 (Lba));
-    WriteUnaligned16 ((UINT16 *) ReadCmd.TransferLen, SwapBytes16 (Count));
+      Cmd    = &Cmd16;
+      CmdLen = (UINT8) sizeof (USB_BOOT_READ_WRITE16_CMD);
+    } else {
+      ZeroMem (&Cmd10, sizeof (USB_BOOT_READ10_CMD));
+
+      Cmd10.OpCode = (UINT8) (Write ? USB_BOOT_WRITE10_OPCODE : USB_BOOT_READ10_OPCODE);
+      Cmd10.Lun    = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
+      WriteUnaligned32 ((UINT32 *) Cmd10.Lba, SwapBytes32 ((UINT32) Lba));
+      WriteUnaligned16 ((UINT16 *) Cmd10.TransferLen, SwapBytes16 ((UINT16) Count));
+
+      Cmd    = &Cmd10;
+      CmdLen = (UINT8) sizeof (USB_BOOT_READ10_CMD);
+    }
+
+    if (FeaturePcdGet (PcdUsbMassCollectStatistics)) {
+      StartTick = GetPerformanceCounter ();
+    }
 
     Status = UsbBootExecCmdWithRetry (
                UsbMass,
-               &ReadCmd,
-               sizeof (USB_BOOT_READ10_CMD),
-               EfiUsbDataIn,
+               Cmd,
+               CmdLen,
+               Write ? EfiUsbDataOut : EfiUsbDataIn,
                Buffer,
                ByteSize,
                Timeout
                );
+
+    if (FeaturePcdGet (PcdUsbMassCollectStatistics)) {
+      EndTick = GetPerformanceCounter ();
+    }
+
     if (EFI_ERROR (Status)) {
+      //
+      // Some devices can't take large transfers. Halve the limit and
+      // try again, unless the error is about the media itself.
+      //
+      if ((Count > USB_BOOT_IO_BLOCKS) &&
+          ((Status == EFI_DEVICE_ERROR) || (Status == EFI_TIMEOUT) || (Status == EFI_INVALID_PARAMETER))) {
+        UsbMass->MaxIoSize = (Count / 2) * BlockSize;
+        DEBUG ((EFI_D_INFO, "UsbBootReadWriteBlocks: (%r) Lun %d limited to %d bytes per command\n",
+                Status, UsbMass->Lun, UsbMass->MaxIoSize));
+        continue;
+      }
       return Status;
     }
 
+    if (FeaturePcdGet (PcdUsbMassCollectStatistics)) {
+      Statistics->Commands++;
+      Statistics->Bytes += ByteSize;
+      if (StartValue > EndValue) {
+        Statistics->Ticks += StartTick - EndTick;
+      } else {
+        Statistics->Ticks += EndTick - StartTick;
+      }
+    }
+
     Lba        += Count;
-    Buffer     += Count * BlockSize;
+    Buffer     += ByteSize;
     TotalBlock -= Count;
   }
 
@@ -724,6 +892,30 @@ UsbBootReadBlocks (
 }
 
 
+/**
+  Read some blocks from the device.
+
+  @param  UsbMass                The USB mass storage device to read from
+  @param  Lba                    The start block number
+  @param  TotalBlock             Total block number to read
+  @param  Buffer                 The buffer to read to
+
+  @retval EFI_SUCCESS            Data are read into the buffer
+  @retval Others                 Failed to read all the data
+
+**/
+EFI_STATUS
+UsbBootReadBlocks (
+  IN  USB_MASS_DEVICE       *UsbMass,
+  IN  EFI_LBA               Lba,
+  IN  UINTN                 TotalBlock,
+  OUT UINT8                 *Buffer
+  )
+{
+  return UsbBootReadWriteBlocks (UsbMass, FALSE, Lba, TotalBlock, Buffer);
+}
+
+
 /**
   Write some blocks to the device.
 
@@ -739,64 +931,12 @@ UsbBootReadBlocks (
 EFI_STATUS
 UsbBootWriteBlocks (
   IN  USB_MASS_DEVICE         *UsbMass,
-  IN  UINT32                  Lba,
+  IN  EFI_LBA                 Lba,
   IN  UINTN                   TotalBlock,
   IN  UINT8                   *Buffer
   )
 {
-  USB_BOOT_WRITE10_CMD  WriteCmd;
-  EFI_STATUS            Status;
-  UINT16                Count;
-  UINT32                BlockSize;
-  UINT32                ByteSize;
-  UINT32                Timeout;
-
-  BlockSize = UsbMass->BlockIoMedia.BlockSize;
-  Status    = EFI_SUCCESS;
-
-  while (TotalBlock > 0) {
-    //
-    // Split the total blocks into smaller pieces to ease the pressure
-    // on the device. We must split the total block because the WRITE10
-    // command only has 16 bit transfer length (in the unit of block).
-    //
-    Count     = (UINT16)((TotalBlock < USB_BOOT_IO_BLOCKS) ? TotalBlock : USB_BOOT_IO_BLOCKS);
-    ByteSize  = (UINT32)Count * BlockSize;
-
-    //
-    // USB command's upper limit timeout is 5s. [USB2.0-9.2.6.1]
-    //
-    Timeout = (UINT32) USB_BOOT_GENERAL_CMD_TIMEOUT;
-
-    //
-    // Fill in the write10 command block
-    //
-    ZeroMem (&WriteCmd, sizeof (USB_BOOT_WRITE10_CMD));
-
-    WriteCmd.OpCode = USB_BOOT_WRITE10_OPCODE;
-    WriteCmd.Lun    = (UINT8) (USB_BOOT_LUN (UsbMass->Lun));
-    WriteUnaligned32 ((UINT32 *) WriteCmd.Lba, SwapBytes32 (Lba));
-    WriteUnaligned16 ((UINT16 *) WriteCmd.TransferLen, SwapBytes16 (Count));
-
-    Status = UsbBootExecCmdWithRetry (
-               UsbMass,
-               &WriteCmd,
-               sizeof (USB_BOOT_WRITE10_CMD),
-               EfiUsbDataOut,
-               Buffer,
-               ByteSize,
-               Timeout
-               );
-    if (EFI_ERROR (Status)) {
-      return Status;
-    }
-
-    Lba        += Count;
-    Buffer     += Count * BlockSize;
-    TotalBlock -= Count;
-  }
-
-  return Status;
+  return UsbBootReadWriteBlocks (UsbMass, TRUE, Lba, TotalBlock, Buffer);
 }
 
 /**
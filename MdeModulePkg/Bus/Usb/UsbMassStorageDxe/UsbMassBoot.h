@@ -33,6 +33,10 @@ typedef enum {
   USB_BOOT_TEST_UNIT_READY_OPCODE = 0x00,
   USB_BOOT_READ10_OPCODE          = 0x28,
   USB_BOOT_WRITE10_OPCODE         = 0x2A,
+  USB_BOOT_READ16_OPCODE          = 0x88,
+  USB_BOOT_WRITE16_OPCODE         = 0x8A,
+  USB_BOOT_READ_CAPACITY16_OPCODE = 0x9E,
+  USB_BOOT_READ_CAPACITY16_SA     = 0x10, ///< Service action of READ CAPACITY(16)
 
   USB_SCSI_MODE_SENSE6_OPCODE     = 0x1A,
   
@@ -67,10 +71,21 @@ typedef enum {
   USB_PDT_SIMPLE_DIRECT           = 0x0E,       ///< Simplified direct access device
   
   //
-  // Other parameters, Max carried size is 512B * 128 = 64KB
+  // Other parameters, Max carried size is 512B * 128 = 64KB. This is the
+  // fallback for the devices that fail larger transfers, and the limit
+  // for the CBI transport.
   //
   USB_BOOT_IO_BLOCKS              = 128,
 
+  //
+  // Largest data phase of one READ/WRITE command over BOT. The host
+  // controller drivers chain as many TDs as the transfer needs, so the
+  // limit is set by the device. A device that fails a large command has
+  // its limit halved until the commands succeed or USB_BOOT_IO_BLOCKS
+  // is reached.
+  //
+  USB_BOOT_MAX_IO_SIZE            = 0x100000,
+
   //
   // Retry mass command times, set by experience
   //
@@ -131,6 +146,24 @@ typedef struct {
   UINT8             BlockLen[4];
 } USB_BOOT_READ_CAPACITY_DATA;
 
+typedef struct {
+  UINT8             OpCode;
+  UINT8             ServiceAction;  ///< Service action (low 5 bits)
+  UINT8             Lba[8];
+  UINT8             AllocLen[4];
+  UINT8             Pmi;
+  UINT8             Control;
+} USB_BOOT_READ_CAPACITY16_CMD;
+
+typedef struct {
+  UINT8             LastLba[8];
+  UINT8             BlockLen[4];
+  UINT8             Protection;
+  UINT8             LogicPerPhysical;
+  UINT8             LowestAlignLba[2];
+  UINT8             Reserved[16];
+} USB_BOOT_READ_CAPACITY16_DATA;
+
 typedef struct {
   UINT8             OpCode;
   UINT8             Lun;
@@ -177,6 +210,19 @@ typedef struct {
   UINT8             Pad[2];
 } USB_BOOT_WRITE10_CMD;
 
+//
+// READ(16) and WRITE(16) share the same layout. They have no LUN field,
+// so they are only sent over BOT where the LUN is carried by the CBW.
+//
+typedef struct {
+  UINT8             OpCode;
+  UINT8             Flags;
+  UINT8             Lba[8];         ///< Logical block address
+  UINT8             TransferLen[4]; ///< Transfer length
+  UINT8             Group;
+  UINT8             Control;
+} USB_BOOT_READ_WRITE16_CMD;
+
 typedef struct {
   UINT8             OpCode;
   UINT8             Lun;            ///< Lun (High 3 bits)
@@ -290,7 +336,7 @@ UsbBootDetectMedia (
 EFI_STATUS
 UsbBootReadBlocks (
   IN  USB_MASS_DEVICE         *UsbMass,
-  IN  UINT32                  Lba,
+  IN  EFI_LBA                 Lba,
   IN  UINTN                   TotalBlock,
   OUT UINT8                   *Buffer
   );
@@ -310,7 +356,7 @@ UsbBootReadBlocks (
 EFI_STATUS
 UsbBootWriteBlocks (
   IN  USB_MASS_DEVICE         *UsbMass,
-  IN  UINT32                  Lba,
+  IN  EFI_LBA                 Lba,
   IN  UINTN                   TotalBlock,
   IN  UINT8                   *Buffer
   );
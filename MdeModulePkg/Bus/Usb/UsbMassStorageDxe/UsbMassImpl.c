@@ -168,7 +168,7 @@ UsbMassReadBlocks (
     goto ON_EXIT;
   }
 
-  Status = UsbBootReadBlocks (UsbMass, (UINT32) Lba, TotalBlock, Buffer);
+  Status = UsbBootReadBlocks (UsbMass, Lba, TotalBlock, Buffer);
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "UsbMassReadBlocks: UsbBootReadBlocks (%r) -> Reset\n", Status));
     UsbMassReset (This, TRUE);
@@ -280,7 +280,7 @@ UsbMassWriteBlocks (
   // Try to write the data even the device is marked as ReadOnly,
   // and clear the status should the write succeed.
   //
-  Status = UsbBootWriteBlocks (UsbMass, (UINT32) Lba, TotalBlock, Buffer);
+  Status = UsbBootWriteBlocks (UsbMass, Lba, TotalBlock, Buffer);
   if (EFI_ERROR (Status)) {
     DEBUG ((EFI_D_ERROR, "UsbMassWriteBlocks: UsbBootWriteBlocks (%r) -> Reset\n", Status));
     UsbMassReset (This, TRUE);
@@ -508,6 +508,7 @@ UsbMassInitMultiLun (
     UsbMass->Transport            = Transport;
     UsbMass->Context              = Context;
     UsbMass->Lun                  = Index;
+    UsbMass->MaxIoSize            = USB_BOOT_MAX_IO_SIZE;
     
     //
     // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
@@ -674,6 +675,9 @@ UsbMassInitNonLun (
   UsbMass->OpticalStorage       = FALSE;
   UsbMass->Transport            = Transport;
   UsbMass->Context              = Context;
+  if (Transport->Protocol == USB_MASS_STORE_BOT) {
+    UsbMass->MaxIoSize          = USB_BOOT_MAX_IO_SIZE;
+  }
   
   //
   // Initialize the media parameter data for EFI_BLOCK_IO_MEDIA of Block I/O Protocol.
@@ -886,6 +890,55 @@ USBMassDriverBindingStart (
 }
 
 
+/**
+  Report the READ/WRITE throughput of a logic unit to the debug output.
+
+  @param  UsbMass                The USB mass storage device.
+
+**/
+VOID
+UsbMassReportStatistics (
+  IN USB_MASS_DEVICE          *UsbMass
+  )
+{
+  USB_MASS_IO_STATISTICS      *Statistics;
+  UINT64                      Frequency;
+  UINT64                      KiloBytes;
+  UINT64                      Rate;
+  UINTN                       Index;
+
+  if (!FeaturePcdGet (PcdUsbMassCollectStatistics)) {
+    return;
+  }
+
+  Frequency = GetPerformanceCounterProperties (NULL, NULL);
+
+  for (Index = 0; Index < 2; Index++) {
+    Statistics = (Index == 0) ? &UsbMass->ReadStatistics : &UsbMass->WriteStatistics;
+    if (Statistics->Commands == 0) {
+      continue;
+    }
+
+    //
+    // Throughput in KB per second of the time spent in the commands
+    //
+    KiloBytes = RShiftU64 (Statistics->Bytes, 10);
+    Rate      = 0;
+    if (Statistics->Ticks != 0) {
+      Rate = DivU64x64Remainder (MultU64x64 (KiloBytes, Frequency), Statistics->Ticks, NULL);
+    }
+
+    DEBUG ((EFI_D_INFO, "UsbMass Lun %d: %a %ld KB in %ld commands, %ld KB/s, %d bytes per command at most\n",
+            UsbMass->Lun,
+            (Index == 0) ? "read" : "wrote",
+            KiloBytes,
+            Statistics->Commands,
+            Rate,
+            UsbMass->MaxIoSize
+            ));
+  }
+}
+
 /**
   Stop controlling the device.
 
@@ -977,6 +1030,7 @@ USBMassDriverBindingStop (
           Controller
           );
   
+    UsbMassReportStatistics (UsbMass);
     UsbMass->Transport->CleanUp (UsbMass->Context);
     FreePool (UsbMass);
     
@@ -1044,6 +1098,7 @@ USBMassDriverBindingStop (
       //
       // Succeed to stop this multi-lun handle, so go on with next child.
       //
+      UsbMassReportStatistics (UsbMass);
       if (((Index + 1) == NumberOfChildren) && AllChildrenStopped) {
         UsbMass->Transport->CleanUp (UsbMass->Context);
       }
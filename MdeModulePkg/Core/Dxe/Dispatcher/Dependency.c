@@ -159,7 +159,9 @@ PopBool (
   state of  Before, After, and SOR dependencies. If DriverEntry->Before
   or DriverEntry->After is set it will never be cleared. If SOR is set
   it will be cleared by CoreSchedule(), and then the driver can be
-  dispatched.
+  dispatched. Every protocol GUID pushed by the Depex is added to the
+  Depex protocol index, so the driver is only evaluated again when one
+  of those protocols is installed or uninstalled.
 
   @param  DriverEntry           DriverEntry element to update .
 
@@ -171,7 +173,11 @@ CorePreProcessDepex (
   IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
   )
 {
-  UINT8  *Iterator;
+  UINT8     *Iterator;
+  UINT8     *End;
+  EFI_GUID  ProtocolGuid;
+
+  DriverEntry->DepexDirty = TRUE;
 
   Iterator = DriverEntry->Depex;
   if (*Iterator == EFI_DEP_SOR) {
@@ -188,6 +194,29 @@ CorePreProcessDepex (
 
   if (DriverEntry->Before || DriverEntry->After) {
     CopyMem (&DriverEntry->BeforeAfterGuid, Iterator + 1, sizeof (EFI_GUID));
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Walk the opcodes and index the protocol GUIDs the Depex pushes. A Depex
+  // that is not well formed stops the walk, CoreIsSchedulable () will
+  // evaluate it to FALSE.
+  //
+  End = (UINT8 *) DriverEntry->Depex + DriverEntry->DepexSize;
+  while (Iterator < End && *Iterator != EFI_DEP_END) {
+    if (*Iterator == EFI_DEP_PUSH) {
+      if (Iterator + sizeof (EFI_GUID) >= End) {
+        break;
+      }
+      CopyMem (&ProtocolGuid, Iterator + 1, sizeof (EFI_GUID));
+      CoreAddDepexProtocolReference (DriverEntry, &ProtocolGuid);
+      Iterator += sizeof (EFI_GUID);
+    } else if (*Iterator == EFI_DEP_REPLACE_TRUE) {
+      Iterator += sizeof (EFI_GUID);
+    } else if (*Iterator > EFI_DEP_SOR) {
+      break;
+    }
+    Iterator++;
   }
 
   return EFI_SUCCESS;
@@ -228,6 +257,8 @@ CoreIsSchedulable (
     return FALSE;
   }
 
+  DriverEntry->DepexEvaluations++;
+
   if (DriverEntry->Depex == NULL) {
     //
     // A NULL Depex means treat the driver like an UEFI 2.0 thing.
@@ -19,6 +19,11 @@
             all Befores. It then addes the item that was passed in and then
             processess the After dependecies by recursively calling the routine.
 
+  Depex evaluation - The protocol GUIDs pushed by every Depex are hashed in
+            mDepexProtocolIndex when the Depex is pre-processed. Installing or
+            uninstalling a protocol marks only the drivers that refer to it,
+            and a dispatcher pass evaluates only the marked drivers.
+
   Dispatcher Rules:
   The rules for the dispatcher are in chapter 10 of the DXE CIS. Figure 10-3
   is the state diagram for the DXE dispatcher
@@ -57,7 +62,18 @@ LIST_ENTRY  mScheduledQueue = INITIALIZE_LIST_HEAD_VARIABLE (mScheduledQueue);
 LIST_ENTRY  mFvHandleList = INITIALIZE_LIST_HEAD_VARIABLE (mFvHandleList);           // list of KNOWN_HANDLE
 
 //
-// Lock for mDiscoveredList, mScheduledQueue, gDispatcherRunning.
+// Protocol GUIDs pushed by the Depex of the discovered drivers, hashed by
+// protocol GUID. Items are never removed. List of DEPEX_PROTOCOL_REFERENCE
+//
+DEPEX_PROTOCOL_REFERENCE  *mDepexProtocolIndex[DEPEX_PROTOCOL_HASH_BUCKETS];
+
+//
+// TRUE if a reference could not be added to mDepexProtocolIndex
+//
+BOOLEAN                   mDepexProtocolIndexIncomplete = FALSE;
+
+//
+// Lock for mDiscoveredList, mScheduledQueue, mDepexProtocolIndex, gDispatcherRunning.
 //
 EFI_LOCK  mDispatcherLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 
@@ -277,6 +293,7 @@ CoreGetDepexSectionAndPreProccess (
       //
       DriverEntry->Depex = NULL;
       DriverEntry->Dependent = TRUE;
+      DriverEntry->DepexDirty = TRUE;
       DriverEntry->DepexProtocolError = FALSE;
     }
   } else {
@@ -330,6 +347,7 @@ CoreSchedule (
       CoreAcquireDispatcherLock ();
       DriverEntry->Unrequested  = FALSE;
       DriverEntry->Dependent    = TRUE;
+      DriverEntry->DepexDirty   = TRUE;
       CoreReleaseDispatcherLock ();
 
       return EFI_SUCCESS;
@@ -412,6 +430,8 @@ CoreDispatcher (
   LIST_ENTRY                      *Link;
   EFI_CORE_DRIVER_ENTRY           *DriverEntry;
   BOOLEAN                         ReadyToRun;
+  UINT64                          StartTime;
+  UINT64                          EndTime;
 
   if (gDispatcherRunning) {
     //
@@ -501,8 +521,18 @@ CoreDispatcher (
         sizeof (DriverEntry->ImageHandle)
         );
 
+      StartTime = 0;
+      PERF_CODE (
+        StartTime = GetPerformanceCounter ();
+      );
+
       Status = CoreStartImage (DriverEntry->ImageHandle, NULL, NULL);
 
+      PERF_CODE (
+        EndTime = GetPerformanceCounter ();
+        DriverEntry->StartImageTime = (EndTime > StartTime) ? EndTime - StartTime : StartTime - EndTime;
+      );
+
       REPORT_STATUS_CODE_WITH_EXTENDED_DATA (
         EFI_PROGRESS_CODE,
         FixedPcdGet32(PcdStatusCodeValueDxeDriverEnd),
@@ -527,7 +557,14 @@ CoreDispatcher (
         Status = CoreGetDepexSectionAndPreProccess (DriverEntry);
       }
 
-      if (DriverEntry->Dependent) {
+      //
+      // Only evaluate the Depex again if a protocol it refers to has been
+      // installed or uninstalled since it was last evaluated. A NULL Depex
+      // depends on the Architectural Protocols and is always evaluated.
+      //
+      if (DriverEntry->Dependent &&
+          (DriverEntry->DepexDirty || DriverEntry->Depex == NULL || mDepexProtocolIndexIncomplete)) {
+        DriverEntry->DepexDirty = FALSE;
         if (CoreIsSchedulable (DriverEntry)) {
           CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (DriverEntry);
           ReadyToRun = TRUE;
@@ -542,6 +579,83 @@ CoreDispatcher (
 }
 
 
+/**
+  Record that the Depex of DriverEntry pushes ProtocolGuid, so that DriverEntry
+  is evaluated again when that protocol is installed or uninstalled.
+
+  @param  DriverEntry           Driver whose Depex refers to ProtocolGuid.
+  @param  ProtocolGuid          The protocol GUID pushed by the Depex.
+
+  @retval EFI_SUCCESS           The reference was added to the index.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough system memory for the reference.
+
+**/
+EFI_STATUS
+CoreAddDepexProtocolReference (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry,
+  IN  EFI_GUID                *ProtocolGuid
+  )
+{
+  DEPEX_PROTOCOL_REFERENCE  *Reference;
+  UINTN                     Bucket;
+
+  Reference = AllocatePool (sizeof (DEPEX_PROTOCOL_REFERENCE));
+  if (Reference == NULL) {
+    //
+    // Without the reference the driver might never be evaluated again, so
+    // fall back to evaluating every dependent driver on every pass.
+    //
+    mDepexProtocolIndexIncomplete = TRUE;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Reference->Signature   = DEPEX_PROTOCOL_REFERENCE_SIGNATURE;
+  Reference->DriverEntry = DriverEntry;
+  CopyGuid (&Reference->ProtocolGuid, ProtocolGuid);
+  Bucket = PROTOCOL_GUID_HASH (ProtocolGuid, DEPEX_PROTOCOL_HASH_BUCKETS);
+
+  CoreAcquireDispatcherLock ();
+
+  Reference->Next              = mDepexProtocolIndex[Bucket];
+  mDepexProtocolIndex[Bucket]  = Reference;
+
+  CoreReleaseDispatcherLock ();
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Mark every dependent driver whose Depex pushes Protocol for evaluation on
+  the next dispatcher pass. Called when an interface of Protocol is installed
+  or uninstalled.
+
+  @param  Protocol              The protocol GUID that was installed or uninstalled.
+
+**/
+VOID
+CoreNotifyDepexProtocolChange (
+  IN  EFI_GUID                *Protocol
+  )
+{
+  DEPEX_PROTOCOL_REFERENCE  *Reference;
+
+  CoreAcquireDispatcherLock ();
+
+  for (Reference = mDepexProtocolIndex[PROTOCOL_GUID_HASH (Protocol, DEPEX_PROTOCOL_HASH_BUCKETS)];
+       Reference != NULL;
+       Reference = Reference->Next) {
+    ASSERT (Reference->Signature == DEPEX_PROTOCOL_REFERENCE_SIGNATURE);
+    if (Reference->DriverEntry->Dependent &&
+        CompareGuid (&Reference->ProtocolGuid, Protocol)) {
+      Reference->DriverEntry->DepexDirty = TRUE;
+    }
+  }
+
+  CoreReleaseDispatcherLock ();
+}
+
+
 /**
   Insert InsertedDriverEntry onto the mScheduledQueue. To do this you
   must add any driver with a before dependency on InsertedDriverEntry first.
@@ -1161,3 +1275,45 @@ CoreDisplayDiscoveredNotDispatched (
     }
   }
 }
+
+
+/**
+  Display, for every driver that was started by the dispatcher, the time spent
+  in its entry point in performance counter ticks and the number of times its
+  dependency expression was evaluated.
+
+**/
+VOID
+CoreDisplayDriverDispatchTimes (
+  VOID
+  )
+{
+  LIST_ENTRY                    *Link;
+  EFI_CORE_DRIVER_ENTRY         *DriverEntry;
+  UINT64                        TotalTime;
+  UINTN                         TotalEvaluations;
+
+  TotalTime        = 0;
+  TotalEvaluations = 0;
+  for (Link = mDiscoveredList.ForwardLink;Link !=&mDiscoveredList; Link = Link->ForwardLink) {
+    DriverEntry = CR(Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    TotalEvaluations += DriverEntry->DepexEvaluations;
+    if (DriverEntry->Initialized && DriverEntry->ImageHandle != NULL) {
+      TotalTime += DriverEntry->StartImageTime;
+      DEBUG ((
+        DEBUG_INFO,
+        "Driver %g started in %ld ticks, Depex evaluated %d times\n",
+        &DriverEntry->FileName,
+        DriverEntry->StartImageTime,
+        DriverEntry->DepexEvaluations
+        ));
+    }
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Dispatcher: %ld ticks in driver entry points, %d Depex evaluations\n",
+    TotalTime,
+    (UINT32) TotalEvaluations
+    ));
+}
@@ -60,6 +60,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Guid/MemoryAllocationHob.h>
 #include <Guid/EventLegacyBios.h>
 #include <Guid/EventGroup.h>
+#include <Guid/FvFileIndexHob.h>
 
 
 #include <Library/DxeCoreEntryPoint.h>
@@ -153,11 +154,39 @@ typedef struct {
   BOOLEAN                         Untrusted;
   BOOLEAN                         Initialized;
   BOOLEAN                         DepexProtocolError;
+  BOOLEAN                         DepexDirty;       // Depex must be evaluated again
 
   EFI_HANDLE                      ImageHandle;
 
+  UINT32                          DepexEvaluations;
+  UINT64                          StartImageTime;
+
 } EFI_CORE_DRIVER_ENTRY;
 
+//
+// Hash of a protocol GUID into a table of Buckets entries, Buckets being a
+// power of 2. It is shared by the protocol database and the Depex index. The
+// GUID may not be 32-bit aligned, as in a Depex, so it is read unaligned.
+//
+#define PROTOCOL_GUID_HASH(Guid, Buckets)  \
+  ((ReadUnaligned32 ((CONST UINT32 *) (Guid)) ^ ReadUnaligned32 ((CONST UINT32 *) (Guid) + 3)) & ((Buckets) - 1))
+
+//
+// A protocol GUID pushed by the Depex of a driver. References are hashed by
+// protocol GUID, so that installing or uninstalling a protocol only marks the
+// drivers whose Depex refers to that protocol for evaluation.
+//
+#define DEPEX_PROTOCOL_HASH_BUCKETS     64
+
+#define DEPEX_PROTOCOL_REFERENCE_SIGNATURE  SIGNATURE_32('d','p','x','r')
+typedef struct _DEPEX_PROTOCOL_REFERENCE DEPEX_PROTOCOL_REFERENCE;
+struct _DEPEX_PROTOCOL_REFERENCE {
+  UINTN                           Signature;
+  DEPEX_PROTOCOL_REFERENCE        *Next;            // mDepexProtocolIndex bucket
+  EFI_GUID                        ProtocolGuid;
+  EFI_CORE_DRIVER_ENTRY           *DriverEntry;
+};
+
 //
 //The data structure of GCD memory map entry
 //
@@ -219,6 +248,17 @@ CoreInitializePool (
   );
 
 
+/**
+  Display, for every memory type that holds pool pages, the bytes in use by
+  pool allocations against the bytes of pages backing them.
+
+**/
+VOID
+CoreDisplayPoolStatistics (
+  VOID
+  );
+
+
 /**
   Called to initialize the memory map and add descriptors to
   the current descriptor list.
@@ -386,6 +426,18 @@ CoreTimerTick (
   );
 
 
+/**
+  Display the number of timer ticks and of timer database checks, and the
+  time spent checking the timer database in performance counter ticks when
+  performance measurement is enabled.
+
+**/
+VOID
+CoreDisplayTimerStatistics (
+  VOID
+  );
+
+
 /**
   Initialize the dispatcher. Initialize the notification function that runs when
   an FV2 protocol is added to the system.
@@ -434,6 +486,38 @@ CorePreProcessDepex (
   );
 
 
+/**
+  Record that the Depex of DriverEntry pushes ProtocolGuid, so that DriverEntry
+  is evaluated again when that protocol is installed or uninstalled.
+
+  @param  DriverEntry           Driver whose Depex refers to ProtocolGuid.
+  @param  ProtocolGuid          The protocol GUID pushed by the Depex.
+
+  @retval EFI_SUCCESS           The reference was added to the index.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough system memory for the reference.
+
+**/
+EFI_STATUS
+CoreAddDepexProtocolReference (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry,
+  IN  EFI_GUID                *ProtocolGuid
+  );
+
+
+/**
+  Mark every dependent driver whose Depex pushes Protocol for evaluation on
+  the next dispatcher pass. Called when an interface of Protocol is installed
+  or uninstalled.
+
+  @param  Protocol              The protocol GUID that was installed or uninstalled.
+
+**/
+VOID
+CoreNotifyDepexProtocolChange (
+  IN  EFI_GUID                *Protocol
+  );
+
+
 
 /**
   Terminates all boot services.
@@ -1970,6 +2054,18 @@ CoreDisplayDiscoveredNotDispatched (
   );
 
 
+/**
+  Display, for every driver that was started by the dispatcher, the time spent
+  in its entry point in performance counter ticks and the number of times its
+  dependency expression was evaluated.
+
+**/
+VOID
+CoreDisplayDriverDispatchTimes (
+  VOID
+  );
+
+
 /**
   Place holder function until all the Boot Services and Runtime Services are
   available.
@@ -386,6 +386,20 @@ DxeMain (
     CoreDisplayDiscoveredNotDispatched ();
   DEBUG_CODE_END ();
 
+  //
+  // Display the time spent starting each dispatched driver if this is a debug build
+  //
+  DEBUG_CODE_BEGIN ();
+    CoreDisplayDriverDispatchTimes ();
+  DEBUG_CODE_END ();
+
+  //
+  // Display pool usage and fragmentation per memory type if this is a debug build
+  //
+  DEBUG_CODE_BEGIN ();
+    CoreDisplayPoolStatistics ();
+  DEBUG_CODE_END ();
+
   //
   // Assert if the Architectural Protocols are not present.
   //
@@ -635,6 +649,15 @@ CoreExitBootServices (
     return Status;
   }
 
+  //
+  // Display the timer tick and timer database statistics if this is a debug build.
+  // A caller retries with a new MapKey until it matches, so they are only
+  // displayed once the memory map is accepted.
+  //
+  DEBUG_CODE_BEGIN ();
+    CoreDisplayTimerStatistics ();
+  DEBUG_CODE_END ();
+
   //
   // Notify other drivers that we are exiting boot services.
   //
@@ -16,17 +16,43 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include "DxeMain.h"
 #include "Event.h"
 
+//
+// The timer database is a hierarchical timer wheel. Time is cut in slots of
+// 2^TIMER_WHEEL_SLOT_SHIFT 100ns units. Level 0 holds the timers that expire
+// within the next TIMER_WHEEL_SLOTS slots, one list per slot; each higher
+// level covers TIMER_WHEEL_SLOTS times the span of the level below it. When
+// level 0 wraps, the next slot of level 1 is cascaded down, and so on.
+//
+#define TIMER_WHEEL_SLOT_SHIFT    16
+#define TIMER_WHEEL_LEVEL_SHIFT   6
+#define TIMER_WHEEL_SLOTS         (1 << TIMER_WHEEL_LEVEL_SHIFT)
+#define TIMER_WHEEL_SLOT_MASK     (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS        4
+
+#define TIMER_WHEEL_NO_TRIGGER    ((UINT64) -1)
+
 //
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+LIST_ENTRY       mEfiTimerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+UINT64           mEfiTimerWheelSlot = 0;
+UINT64           mEfiTimerNextTrigger = TIMER_WHEEL_NO_TRIGGER;
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+//
+// Timer statistics, the time is only accounted when performance measurement
+// is enabled
+//
+UINT64           mEfiTimerTickCount = 0;
+UINT64           mEfiTimerCheckCount = 0;
+UINT64           mEfiTimerCheckTime = 0;
+UINT64           mEfiTimerCheckMaxTime = 0;
+
 //
 // Timer functions
 //
@@ -43,8 +69,9 @@ CoreInsertEventTimer (
   )
 {
   UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  UINT64          Slot;
+  UINT64          Delta;
+  UINTN           Level;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
@@ -54,17 +81,201 @@ CoreInsertEventTimer (
   TriggerTime = Event->u.Timer.TriggerTime;
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Timers that are already due go in the current slot. Others go in the
+  // lowest level that spans their distance from the current slot; the ones
+  // beyond the top level are parked in it and placed again when cascaded.
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+  Slot = RShiftU64 (TriggerTime, TIMER_WHEEL_SLOT_SHIFT);
+  if (Slot < mEfiTimerWheelSlot) {
+    Slot = mEfiTimerWheelSlot;
+  }
 
-    if (Event2->u.Timer.TriggerTime > TriggerTime) {
+  Delta = Slot - mEfiTimerWheelSlot;
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS - 1; Level++) {
+    if (Delta < LShiftU64 (1, (Level + 1) * TIMER_WHEEL_LEVEL_SHIFT)) {
       break;
     }
   }
 
-  InsertTailList (Link, &Event->u.Timer.Link);
+  if (Delta >= LShiftU64 (1, TIMER_WHEEL_LEVELS * TIMER_WHEEL_LEVEL_SHIFT)) {
+    Slot = mEfiTimerWheelSlot + LShiftU64 (1, TIMER_WHEEL_LEVELS * TIMER_WHEEL_LEVEL_SHIFT) - 1;
+  }
+
+  InsertTailList (
+    &mEfiTimerWheel[Level][(UINTN) RShiftU64 (Slot, Level * TIMER_WHEEL_LEVEL_SHIFT) & TIMER_WHEEL_SLOT_MASK],
+    &Event->u.Timer.Link
+    );
+
+  //
+  // Let the tick handler know about the new earliest trigger time
+  //
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  if (TriggerTime < mEfiTimerNextTrigger) {
+    mEfiTimerNextTrigger = TriggerTime;
+  }
+  CoreReleaseLock (&mEfiSystemTimeLock);
+}
+
+
+/**
+  Moves the timers of the next slot of a level above level 0 down the wheel.
+  Called each time the current slot of the level below wraps to 0.
+
+  @param  Level                  The level to cascade
+
+**/
+VOID
+CoreCascadeEventTimers (
+  IN UINTN    Level
+  )
+{
+  LIST_ENTRY      *Slot;
+  IEVENT          *Event;
+
+  Slot = &mEfiTimerWheel[Level][(UINTN) RShiftU64 (mEfiTimerWheelSlot, Level * TIMER_WHEEL_LEVEL_SHIFT) & TIMER_WHEEL_SLOT_MASK];
+  while (!IsListEmpty (Slot)) {
+    Event = CR (Slot->ForwardLink, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+    RemoveEntryList (&Event->u.Timer.Link);
+    CoreInsertEventTimer (Event);
+  }
+}
+
+
+/**
+  Moves the current slot of the timer wheel forward to a slot far ahead of it.
+  Instead of stepping through every slot in between, all the timers are taken
+  out of the wheel and inserted again relative to the new slot, so the cost
+  depends on the number of timers and not on the time that has passed. The
+  timers that are due by then land in the new current slot.
+
+  @param  NewSlot                The slot to move the wheel to
+
+**/
+VOID
+CoreAdvanceEventTimers (
+  IN UINT64   NewSlot
+  )
+{
+  LIST_ENTRY      Pending;
+  IEVENT          *Event;
+  UINTN           Level;
+  UINTN           Index;
+
+  InitializeListHead (&Pending);
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    for (Index = 0; Index < TIMER_WHEEL_SLOTS; Index++) {
+      while (!IsListEmpty (&mEfiTimerWheel[Level][Index])) {
+        Event = CR (mEfiTimerWheel[Level][Index].ForwardLink, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+        RemoveEntryList (&Event->u.Timer.Link);
+        InsertTailList (&Pending, &Event->u.Timer.Link);
+      }
+    }
+  }
+
+  mEfiTimerWheelSlot = NewSlot;
+
+  while (!IsListEmpty (&Pending)) {
+    Event = CR (Pending.ForwardLink, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+    RemoveEntryList (&Event->u.Timer.Link);
+    CoreInsertEventTimer (Event);
+  }
+}
+
+
+/**
+  Moves the expired timers of the current slot of level 0 to a list.
+
+  @param  SystemTime             The current system time
+  @param  Expired                The list that receives the expired timers
+
+**/
+VOID
+CoreExpireEventTimers (
+  IN UINT64       SystemTime,
+  IN LIST_ENTRY   *Expired
+  )
+{
+  LIST_ENTRY      *Slot;
+  LIST_ENTRY      *Link;
+  IEVENT          *Event;
+
+  Slot = &mEfiTimerWheel[0][(UINTN) mEfiTimerWheelSlot & TIMER_WHEEL_SLOT_MASK];
+  for (Link = Slot->ForwardLink; Link != Slot; ) {
+    Event = CR (Link, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+    Link  = Link->ForwardLink;
+
+    if (Event->u.Timer.TriggerTime <= SystemTime) {
+      RemoveEntryList (&Event->u.Timer.Link);
+      InsertTailList (Expired, &Event->u.Timer.Link);
+    }
+  }
+}
+
+
+/**
+  Computes a lower bound of the earliest trigger time in the timer wheel,
+  that the tick handler compares against the system time.
+
+**/
+VOID
+CoreUpdateNextTimerTrigger (
+  VOID
+  )
+{
+  UINT64          NextTrigger;
+  UINT64          CascadeTime;
+  LIST_ENTRY      *Slot;
+  LIST_ENTRY      *Link;
+  IEVENT          *Event;
+  UINTN           Level;
+  UINTN           Index;
+
+  NextTrigger = TIMER_WHEEL_NO_TRIGGER;
+
+  //
+  // The timers left in the current slot are not due yet, take the earliest one
+  //
+  Slot = &mEfiTimerWheel[0][(UINTN) mEfiTimerWheelSlot & TIMER_WHEEL_SLOT_MASK];
+  for (Link = Slot->ForwardLink; Link != Slot; Link = Link->ForwardLink) {
+    Event = CR (Link, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+    if (Event->u.Timer.TriggerTime < NextTrigger) {
+      NextTrigger = Event->u.Timer.TriggerTime;
+    }
+  }
+
+  //
+  // Otherwise the start of the next busy slot of level 0 ...
+  //
+  if (NextTrigger == TIMER_WHEEL_NO_TRIGGER) {
+    for (Index = 1; Index < TIMER_WHEEL_SLOTS; Index++) {
+      if (!IsListEmpty (&mEfiTimerWheel[0][(UINTN) (mEfiTimerWheelSlot + Index) & TIMER_WHEEL_SLOT_MASK])) {
+        NextTrigger = LShiftU64 (mEfiTimerWheelSlot + Index, TIMER_WHEEL_SLOT_SHIFT);
+        break;
+      }
+    }
+  }
+
+  //
+  // ... but no later than the next cascade if upper levels hold timers
+  //
+  for (Level = 1; Level < TIMER_WHEEL_LEVELS; Level++) {
+    for (Index = 0; Index < TIMER_WHEEL_SLOTS; Index++) {
+      if (!IsListEmpty (&mEfiTimerWheel[Level][Index])) {
+        break;
+      }
+    }
+    if (Index < TIMER_WHEEL_SLOTS) {
+      CascadeTime = LShiftU64 ((mEfiTimerWheelSlot | TIMER_WHEEL_SLOT_MASK) + 1, TIMER_WHEEL_SLOT_SHIFT);
+      if (CascadeTime < NextTrigger) {
+        NextTrigger = CascadeTime;
+      }
+      break;
+    }
+  }
+
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerNextTrigger = NextTrigger;
+  CoreReleaseLock (&mEfiSystemTimeLock);
 }
 
 /**
@@ -88,7 +299,7 @@ CoreCurrentSystemTime (
 }
 
 /**
-  Checks the sorted timer list against the current system time.
+  Advances the timer wheel to the current system time.
   Signals any expired event timer.
 
   @param  CheckEvent             Not used
@@ -103,26 +314,53 @@ CoreCheckTimers (
   )
 {
   UINT64                  SystemTime;
+  UINT64                  SystemSlot;
+  UINT64                  StartTime;
+  UINT64                  EndTime;
+  UINTN                   Level;
   IEVENT                  *Event;
+  LIST_ENTRY              Expired;
+
+  StartTime = 0;
+  PERF_CODE (
+    StartTime = GetPerformanceCounter ();
+  );
 
   //
   // Check the timer database for expired timers
   //
   CoreAcquireLock (&mEfiTimerLock);
   SystemTime = CoreCurrentSystemTime ();
+  SystemSlot = RShiftU64 (SystemTime, TIMER_WHEEL_SLOT_SHIFT);
+  InitializeListHead (&Expired);
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
+  //
+  // Every timer in the slots that have passed is expired. Each time level 0
+  // wraps, bring the timers of the next slot of the upper levels down. After
+  // a long time without a check, e.g. with no timer armed, rebuild the wheel
+  // at the current slot rather than walk all the slots in between at high TPL.
+  //
+  if (SystemSlot - mEfiTimerWheelSlot > TIMER_WHEEL_SLOTS) {
+    CoreAdvanceEventTimers (SystemSlot);
+  }
 
-    //
-    // If this timer is not expired, then we're done
-    //
-    if (Event->u.Timer.TriggerTime > SystemTime) {
-      break;
+  while (mEfiTimerWheelSlot < SystemSlot) {
+    CoreExpireEventTimers (SystemTime, &Expired);
+    mEfiTimerWheelSlot++;
+    for (Level = 1; Level < TIMER_WHEEL_LEVELS; Level++) {
+      if ((RShiftU64 (mEfiTimerWheelSlot, (Level - 1) * TIMER_WHEEL_LEVEL_SHIFT) & TIMER_WHEEL_SLOT_MASK) != 0) {
+        break;
+      }
+      CoreCascadeEventTimers (Level);
     }
+  }
+  CoreExpireEventTimers (SystemTime, &Expired);
+
+  while (!IsListEmpty (&Expired)) {
+    Event = CR (Expired.ForwardLink, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
 
     //
-    // Remove this timer from the timer queue
+    // Remove this timer from the expired list
     //
 
     RemoveEntryList (&Event->u.Timer.Link);
@@ -157,7 +395,19 @@ CoreCheckTimers (
     }
   }
 
+  CoreUpdateNextTimerTrigger ();
+
   CoreReleaseLock (&mEfiTimerLock);
+
+  mEfiTimerCheckCount++;
+  PERF_CODE (
+    EndTime = GetPerformanceCounter ();
+    EndTime = (EndTime > StartTime) ? EndTime - StartTime : StartTime - EndTime;
+    mEfiTimerCheckTime += EndTime;
+    if (EndTime > mEfiTimerCheckMaxTime) {
+      mEfiTimerCheckMaxTime = EndTime;
+    }
+  );
 }
 
 
@@ -171,6 +421,14 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Level;
+  UINTN       Index;
+
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    for (Index = 0; Index < TIMER_WHEEL_SLOTS; Index++) {
+      InitializeListHead (&mEfiTimerWheel[Level][Index]);
+    }
+  }
 
   Status = CoreCreateEvent (
              EVT_NOTIFY_SIGNAL,
@@ -196,8 +454,6 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
-
   //
   // Check runtiem flag in case there are ticks while exiting boot services
   //
@@ -207,17 +463,14 @@ CoreTimerTick (
   // Update the system time
   //
   mEfiSystemTime += Duration;
+  mEfiTimerTickCount++;
 
   //
-  // If the head of the list is expired, fire the timer event
+  // If the earliest timer may have expired, fire the timer event
   // to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, u.Timer.Link, EVENT_SIGNATURE);
-
-    if (Event->u.Timer.TriggerTime <= mEfiSystemTime) {
-      CoreSignalEvent (mEfiCheckTimerEvent);
-    }
+  if (mEfiTimerNextTrigger <= mEfiSystemTime) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
   }
 
   CoreReleaseLock (&mEfiSystemTimeLock);
@@ -295,3 +548,26 @@ CoreSetTimer (
 
   return EFI_SUCCESS;
 }
+
+
+
+/**
+  Display the number of timer ticks and of timer database checks, and the
+  time spent checking the timer database in performance counter ticks when
+  performance measurement is enabled.
+
+**/
+VOID
+CoreDisplayTimerStatistics (
+  VOID
+  )
+{
+  DEBUG ((
+    DEBUG_INFO,
+    "Timer: %ld ticks, %ld checks, check time %ld total %ld max\n",
+    mEfiTimerTickCount,
+    mEfiTimerCheckCount,
+    mEfiTimerCheckTime,
+    mEfiTimerCheckMaxTime
+    ));
+}
@@ -276,6 +276,183 @@ FreeFvDeviceResource (
 
 
 
+/**
+  Check that the cached FV holds no file after a given point that FvCheck()
+  would list, i.e. only deleted files and invalid file headers come before the
+  free space or the end of the FV.
+
+  @param  FvDevice              A pointer to the FvDevice whose FV is cached.
+  @param  FfsHeader             The point of the cached FV to check from.
+
+  @retval TRUE                  There is no file to list after FfsHeader.
+  @retval FALSE                 A file was added or the FV is corrupted after FfsHeader.
+
+**/
+BOOLEAN
+FvIsTailFree (
+  IN FV_DEVICE            *FvDevice,
+  IN EFI_FFS_FILE_HEADER  *FfsHeader
+  )
+{
+  EFI_FFS_FILE_STATE                    FileState;
+  UINT8                                 *TopFvAddress;
+  UINTN                                 TestLength;
+  UINTN                                 FileLength;
+
+  TopFvAddress = FvDevice->EndOfCachedFv;
+  while ((UINT8 *) FfsHeader < TopFvAddress) {
+
+    TestLength = TopFvAddress - ((UINT8 *) FfsHeader);
+    if (TestLength > sizeof (EFI_FFS_FILE_HEADER)) {
+      TestLength = sizeof (EFI_FFS_FILE_HEADER);
+    }
+
+    if (IsBufferErased (FvDevice->ErasePolarity, FfsHeader, TestLength)) {
+      return TRUE;
+    }
+
+    if (TestLength < sizeof (EFI_FFS_FILE_HEADER)) {
+      return FALSE;
+    }
+
+    if (!IsValidFfsHeader (FvDevice->ErasePolarity, FfsHeader, &FileState)) {
+      if ((FileState == EFI_FILE_HEADER_INVALID) ||
+          (FileState == EFI_FILE_HEADER_CONSTRUCTION)) {
+        FfsHeader++;
+        continue;
+      }
+      return FALSE;
+    }
+
+    if (GetFileState (FvDevice->ErasePolarity, FfsHeader) != EFI_FILE_DELETED) {
+      return FALSE;
+    }
+
+    FileLength = *(UINT32 *)&FfsHeader->Size[0] & 0x00FFFFFF;
+    if (FileLength < sizeof (EFI_FFS_FILE_HEADER)) {
+      return FALSE;
+    }
+
+    FfsHeader = (EFI_FFS_FILE_HEADER *)(((UINT8 *)FfsHeader) + FileLength);
+    FfsHeader = (EFI_FFS_FILE_HEADER *)(((UINTN)FfsHeader + 7) & ~0x07);
+  }
+
+  return TRUE;
+}
+
+
+
+/**
+  Build the FFS file list of an FV from the file index that the PEI Core saved
+  in a HOB, instead of walking all the file headers of the cached FV. Every
+  indexed file is still validated, and so is the space after the last one,
+  since a file may have been written to the FV after the index was built. The
+  list is discarded if the index does not match the FV.
+
+  @param  FvDevice              A pointer to the FvDevice whose FV is cached.
+
+  @retval TRUE                  The FFS file list was built from the index.
+  @retval FALSE                 There is no usable index, the FFS file list is empty.
+
+**/
+BOOLEAN
+FvBuildFileListFromIndex (
+  IN OUT FV_DEVICE  *FvDevice
+  )
+{
+  EFI_STATUS                            Status;
+  EFI_PHYSICAL_ADDRESS                  FvBase;
+  EFI_PEI_HOB_POINTERS                  GuidHob;
+  FV_FILE_INDEX                         *FileIndex;
+  FV_FILE_INDEX_ENTRY                   *Entry;
+  FFS_FILE_LIST_ENTRY                   *FfsFileEntry;
+  EFI_FFS_FILE_HEADER                   *FfsHeader;
+  EFI_FFS_FILE_STATE                    FileState;
+  LIST_ENTRY                            *Link;
+  UINTN                                 HeaderLength;
+  UINTN                                 Index;
+  UINTN                                 FileLength;
+
+  Status = FvDevice->Fvb->GetPhysicalAddress (FvDevice->Fvb, &FvBase);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  //
+  // Find the index of this FV. Only a complete index lists every file.
+  //
+  FileIndex = NULL;
+  GuidHob.Raw = GetFirstGuidHob (&gFvFileIndexHobGuid);
+  while (GuidHob.Raw != NULL) {
+    FileIndex = GET_GUID_HOB_DATA (GuidHob.Guid);
+    if ((FileIndex->FvBase == FvBase) &&
+        (FileIndex->FvLength == FvDevice->FwVolHeader->FvLength) &&
+        FileIndex->Complete) {
+      break;
+    }
+    FileIndex = NULL;
+    GuidHob.Raw = GetNextGuidHob (&gFvFileIndexHobGuid, GET_NEXT_HOB (GuidHob));
+  }
+
+  if (FileIndex == NULL) {
+    return FALSE;
+  }
+
+  HeaderLength = FvDevice->FwVolHeader->HeaderLength;
+  FfsHeader    = (EFI_FFS_FILE_HEADER *) FvDevice->CachedFv;
+  for (Index = 0; Index < FileIndex->FileCount; Index++) {
+    Entry = &FileIndex->Entry[Index];
+    if ((Entry->Offset < HeaderLength) ||
+        (FvDevice->CachedFv + (Entry->Offset - HeaderLength) + sizeof (EFI_FFS_FILE_HEADER) > FvDevice->EndOfCachedFv)) {
+      break;
+    }
+
+    FfsHeader = (EFI_FFS_FILE_HEADER *) (FvDevice->CachedFv + (Entry->Offset - HeaderLength));
+    if (!IsValidFfsHeader (FvDevice->ErasePolarity, FfsHeader, &FileState) ||
+        !IsValidFfsFile (FvDevice->ErasePolarity, FfsHeader) ||
+        !CompareGuid (&FfsHeader->Name, &Entry->Name)) {
+      break;
+    }
+
+    FfsFileEntry = AllocateZeroPool (sizeof (FFS_FILE_LIST_ENTRY));
+    if (FfsFileEntry == NULL) {
+      break;
+    }
+
+    FfsFileEntry->FfsHeader = FfsHeader;
+    InsertTailList (&FvDevice->FfsFileListHeader, &FfsFileEntry->Link);
+  }
+
+  //
+  // Nothing but free space, deleted files or invalid headers may follow the
+  // last indexed file
+  //
+  if (Index == FileIndex->FileCount) {
+    if (Index > 0) {
+      FileLength = *(UINT32 *)&FfsHeader->Size[0] & 0x00FFFFFF;
+      FfsHeader  = (EFI_FFS_FILE_HEADER *)(((UINT8 *)FfsHeader) + FileLength);
+      FfsHeader  = (EFI_FFS_FILE_HEADER *)(((UINTN)FfsHeader + 7) & ~0x07);
+    }
+
+    if (FvIsTailFree (FvDevice, FfsHeader)) {
+      return TRUE;
+    }
+  }
+
+  //
+  // The index does not match the FV, so drop the entries built from it
+  //
+  while (!IsListEmpty (&FvDevice->FfsFileListHeader)) {
+    Link = GetFirstNode (&FvDevice->FfsFileListHeader);
+    RemoveEntryList (Link);
+    CoreFreePool (BASE_CR (Link, FFS_FILE_LIST_ENTRY, Link));
+  }
+
+  return FALSE;
+}
+
+
+
 /**
   Check if an FV is consistent and allocate cache for it.
 
@@ -416,6 +593,13 @@ FvCheck (
   Status = EFI_SUCCESS;
   InitializeListHead (&FvDevice->FfsFileListHeader);
 
+  //
+  // Use the file index built by the PEI Core if there is one for this FV
+  //
+  if (FvBuildFileListFromIndex (FvDevice)) {
+    goto Done;
+  }
+
   //
   // Build FFS list
   //
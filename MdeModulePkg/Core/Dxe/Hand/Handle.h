@@ -41,7 +41,8 @@ typedef struct {
 /// database.  Each handler that supports this protocol is listed, along
 /// with a list of registered notifies.
 ///
-typedef struct {
+typedef struct _PROTOCOL_ENTRY  PROTOCOL_ENTRY;
+struct _PROTOCOL_ENTRY {
   UINTN               Signature;
   /// Link Entry inserted to mProtocolDatabase
   LIST_ENTRY          AllEntries;  
@@ -51,7 +52,14 @@ typedef struct {
   LIST_ENTRY          Protocols;     
   /// Registerd notification handlers
   LIST_ENTRY          Notify;                 
-} PROTOCOL_ENTRY;
+  /// Next entry in the same mProtocolHashTable bucket
+  PROTOCOL_ENTRY      *NextHash;
+};
+
+///
+/// Number of buckets in the GUID hash of the protocol database, a power of 2
+///
+#define PROTOCOL_HASH_BUCKETS           64
 
 
 #define PROTOCOL_INTERFACE_SIGNATURE  SIGNATURE_32('p','i','f','c')
@@ -84,6 +84,11 @@ CoreRemoveInterfaceFromProtocol (
     // Remove the protocol interface entry
     //
     RemoveEntryList (&Prot->ByProtocol);
+
+    //
+    // Let the dispatcher evaluate the drivers whose Depex refers to this protocol
+    //
+    CoreNotifyDepexProtocolChange (Protocol);
   }
 
   return Prot;
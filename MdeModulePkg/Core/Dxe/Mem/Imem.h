@@ -37,7 +37,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 
 #define MEMORY_MAP_SIGNATURE   SIGNATURE_32('m','m','a','p')
-typedef struct {
+typedef struct _MEMORY_MAP  MEMORY_MAP;
+struct _MEMORY_MAP {
   UINTN           Signature;
   LIST_ENTRY      Link;
   BOOLEAN         FromPages;
@@ -48,7 +49,17 @@ typedef struct {
 
   UINT64          VirtualStart;
   UINT64          Attribute;
-} MEMORY_MAP;
+
+  //
+  // Node in the address ordered tree of all entries. MaxFreeSize is the size
+  // of the largest EfiConventionalMemory entry in the subtree rooted here.
+  //
+  MEMORY_MAP      *Parent;
+  MEMORY_MAP      *Left;
+  MEMORY_MAP      *Right;
+  BOOLEAN         Red;
+  UINT64          MaxFreeSize;
+};
 
 //
 // Internal prototypes
@@ -125,6 +136,117 @@ CoreFreePoolI (
 
 
 
+/**
+  Insert a memory map entry into the tree.
+
+  @param  Entry                  The entry to insert
+
+**/
+VOID
+MemoryMapTreeInsert (
+  IN OUT MEMORY_MAP  *Entry
+  );
+
+
+
+/**
+  Remove a memory map entry from the tree.
+
+  @param  Entry                  The entry to remove
+
+**/
+VOID
+MemoryMapTreeRemove (
+  IN OUT MEMORY_MAP  *Entry
+  );
+
+
+
+/**
+  Make a copy of a memory map entry take the place of the original in the
+  tree. Used when an entry moves from the descriptor stack to heap.
+
+  @param  Old                    The entry in the tree
+  @param  New                    The copy of Old that replaces it
+
+**/
+VOID
+MemoryMapTreeReplace (
+  IN OUT MEMORY_MAP  *Old,
+  IN OUT MEMORY_MAP  *New
+  );
+
+
+
+/**
+  Refresh the cached largest free size of a node and all of its ancestors.
+  Must be called whenever the Start or End of an entry in the tree changes.
+
+  @param  Entry                  The node that changed, may be NULL
+
+**/
+VOID
+MemoryMapTreeUpdate (
+  IN MEMORY_MAP      *Entry
+  );
+
+
+
+/**
+  Find the memory map entry that covers an address.
+
+  @param  Address                The address to look up
+
+  @return The entry covering Address, or NULL if there is none
+
+**/
+MEMORY_MAP *
+MemoryMapTreeFind (
+  IN UINT64          Address
+  );
+
+
+
+/**
+  Return the entry that follows another one in address order.
+
+  @param  Entry                  The entry in the tree
+
+  @return The next entry, or NULL if Entry is the highest one
+
+**/
+MEMORY_MAP *
+MemoryMapTreeNext (
+  IN MEMORY_MAP      *Entry
+  );
+
+
+
+/**
+  Search a subtree, from the highest address down, for a free descriptor
+  that can hold the requested number of bytes between MinAddress and
+  MaxAddress.
+
+  @param  Entry                  The root of the subtree
+  @param  MaxAddress             The last usable byte, the end of a page
+  @param  MinAddress             The lowest usable address
+  @param  NumberOfBytes          Number of bytes needed
+  @param  Alignment              Bits to align with
+
+  @return The last byte of the highest usable range, or 0 if none was found
+
+**/
+UINT64
+MemoryMapTreeFindFree (
+  IN MEMORY_MAP      *Entry,
+  IN UINT64          MaxAddress,
+  IN UINT64          MinAddress,
+  IN UINT64          NumberOfBytes,
+  IN UINTN           Alignment
+  );
+
+
+
 /**
   Enter critical section by gaining lock on gMemoryLock.
 
@@ -151,5 +273,6 @@ CoreReleaseMemoryLock (
 
 extern EFI_LOCK           gMemoryLock;
 extern LIST_ENTRY         gMemoryMap;
+extern MEMORY_MAP         *mMemoryMapRoot;
 extern LIST_ENTRY         mGcdMemorySpaceMap;
 #endif
@@ -0,0 +1,529 @@
+/** @file
+  Address ordered red-black tree over the memory map descriptors.
+
+  Every MEMORY_MAP entry on gMemoryMap is also a node of this tree, keyed by
+  its start address. Each node caches the size of the largest free
+  (EfiConventionalMemory) descriptor in its subtree, so that a search for free
+  pages can skip every subtree that is too small to satisfy the request.
+
+Copyright (c) 2011, Intel Corporation. <BR>
+All rights reserved. This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "DxeMain.h"
+#include "Imem.h"
+
+///
+/// Root of the memory map tree
+///
+MEMORY_MAP  *mMemoryMapRoot = NULL;
+
+
+/**
+  Recompute the cached largest free size of a node from the node itself
+  and its two children.
+
+  @param  Entry                  The node to refresh
+
+**/
+VOID
+MemoryMapTreeRefresh (
+  IN OUT MEMORY_MAP  *Entry
+  )
+{
+  UINT64  MaxFreeSize;
+
+  MaxFreeSize = 0;
+  if (Entry->Type == EfiConventionalMemory && Entry->End >= Entry->Start) {
+    MaxFreeSize = Entry->End - Entry->Start + 1;
+  }
+  if (Entry->Left != NULL && Entry->Left->MaxFreeSize > MaxFreeSize) {
+    MaxFreeSize = Entry->Left->MaxFreeSize;
+  }
+  if (Entry->Right != NULL && Entry->Right->MaxFreeSize > MaxFreeSize) {
+    MaxFreeSize = Entry->Right->MaxFreeSize;
+  }
+  Entry->MaxFreeSize = MaxFreeSize;
+}
+
+
+/**
+  Make a node take the place of another one below a given parent.
+
+  @param  Parent                 The parent of Old, or NULL if Old is the root
+  @param  Old                    The node being replaced
+  @param  New                    The replacing node, may be NULL
+
+**/
+VOID
+MemoryMapTreeReplaceChild (
+  IN MEMORY_MAP      *Parent,
+  IN MEMORY_MAP      *Old,
+  IN MEMORY_MAP      *New
+  )
+{
+  if (Parent == NULL) {
+    mMemoryMapRoot = New;
+  } else if (Parent->Left == Old) {
+    Parent->Left = New;
+  } else {
+    Parent->Right = New;
+  }
+
+  if (New != NULL) {
+    New->Parent = Parent;
+  }
+}
+
+
+/**
+  Rotate the subtree rooted at a node to the left.
+
+  @param  Entry                  The root of the subtree
+
+**/
+VOID
+MemoryMapTreeRotateLeft (
+  IN OUT MEMORY_MAP  *Entry
+  )
+{
+  MEMORY_MAP  *Pivot;
+
+  Pivot        = Entry->Right;
+  Entry->Right = Pivot->Left;
+  if (Pivot->Left != NULL) {
+    Pivot->Left->Parent = Entry;
+  }
+  MemoryMapTreeReplaceChild (Entry->Parent, Entry, Pivot);
+  Pivot->Left   = Entry;
+  Entry->Parent = Pivot;
+
+  MemoryMapTreeRefresh (Entry);
+  MemoryMapTreeRefresh (Pivot);
+}
+
+
+/**
+  Rotate the subtree rooted at a node to the right.
+
+  @param  Entry                  The root of the subtree
+
+**/
+VOID
+MemoryMapTreeRotateRight (
+  IN OUT MEMORY_MAP  *Entry
+  )
+{
+  MEMORY_MAP  *Pivot;
+
+  Pivot       = Entry->Left;
+  Entry->Left = Pivot->Right;
+  if (Pivot->Right != NULL) {
+    Pivot->Right->Parent = Entry;
+  }
+  MemoryMapTreeReplaceChild (Entry->Parent, Entry, Pivot);
+  Pivot->Right  = Entry;
+  Entry->Parent = Pivot;
+
+  MemoryMapTreeRefresh (Entry);
+  MemoryMapTreeRefresh (Pivot);
+}
+
+
+/**
+  Refresh the cached largest free size of a node and all of its ancestors.
+  Must be called whenever the Start or End of an entry in the tree changes.
+
+  @param  Entry                  The node that changed, may be NULL
+
+**/
+VOID
+MemoryMapTreeUpdate (
+  IN MEMORY_MAP      *Entry
+  )
+{
+  for (; Entry != NULL; Entry = Entry->Parent) {
+    MemoryMapTreeRefresh (Entry);
+  }
+}
+
+
+/**
+  Insert a memory map entry into the tree.
+
+  @param  Entry                  The entry to insert
+
+**/
+VOID
+MemoryMapTreeInsert (
+  IN OUT MEMORY_MAP  *Entry
+  )
+{
+  MEMORY_MAP  **Link;
+  MEMORY_MAP  *Parent;
+  MEMORY_MAP  *Grand;
+  MEMORY_MAP  *Uncle;
+
+  Parent = NULL;
+  Link   = &mMemoryMapRoot;
+  while (*Link != NULL) {
+    Parent = *Link;
+    Link   = (Entry->Start < Parent->Start) ? &Parent->Left : &Parent->Right;
+  }
+
+  Entry->Parent = Parent;
+  Entry->Left   = NULL;
+  Entry->Right  = NULL;
+  Entry->Red    = TRUE;
+  *Link         = Entry;
+  MemoryMapTreeUpdate (Entry);
+
+  //
+  // Restore the red-black properties
+  //
+  while ((Parent = Entry->Parent) != NULL && Parent->Red) {
+    Grand = Parent->Parent;
+    if (Parent == Grand->Left) {
+      Uncle = Grand->Right;
+      if (Uncle != NULL && Uncle->Red) {
+        Parent->Red = FALSE;
+        Uncle->Red  = FALSE;
+        Grand->Red  = TRUE;
+        Entry       = Grand;
+        continue;
+      }
+      if (Entry == Parent->Right) {
+        MemoryMapTreeRotateLeft (Parent);
+        Entry  = Parent;
+        Parent = Entry->Parent;
+      }
+      Parent->Red = FALSE;
+      Grand->Red  = TRUE;
+      MemoryMapTreeRotateRight (Grand);
+    } else {
+      Uncle = Grand->Left;
+      if (Uncle != NULL && Uncle->Red) {
+        Parent->Red = FALSE;
+        Uncle->Red  = FALSE;
+        Grand->Red  = TRUE;
+        Entry       = Grand;
+        continue;
+      }
+      if (Entry == Parent->Left) {
+        MemoryMapTreeRotateRight (Parent);
+        Entry  = Parent;
+        Parent = Entry->Parent;
+      }
+      Parent->Red = FALSE;
+      Grand->Red  = TRUE;
+      MemoryMapTreeRotateLeft (Grand);
+    }
+  }
+
+  mMemoryMapRoot->Red = FALSE;
+}
+
+
+/**
+  Restore the red-black properties after a black node was unlinked.
+
+  @param  Child                  The node that took the place of the unlinked
+                                 node, may be NULL
+  @param  Parent                 The parent of Child
+
+**/
+VOID
+MemoryMapTreeRemoveFixup (
+  IN MEMORY_MAP      *Child,
+  IN MEMORY_MAP      *Parent
+  )
+{
+  MEMORY_MAP  *Sibling;
+
+  while (Child != mMemoryMapRoot && (Child == NULL || !Child->Red)) {
+    if (Child == Parent->Left) {
+      Sibling = Parent->Right;
+      if (Sibling->Red) {
+        Sibling->Red = FALSE;
+        Parent->Red  = TRUE;
+        MemoryMapTreeRotateLeft (Parent);
+        Sibling = Parent->Right;
+      }
+      if ((Sibling->Left == NULL || !Sibling->Left->Red) &&
+          (Sibling->Right == NULL || !Sibling->Right->Red)) {
+        Sibling->Red = TRUE;
+        Child        = Parent;
+        Parent       = Child->Parent;
+        continue;
+      }
+      if (Sibling->Right == NULL || !Sibling->Right->Red) {
+        Sibling->Left->Red = FALSE;
+        Sibling->Red       = TRUE;
+        MemoryMapTreeRotateRight (Sibling);
+        Sibling = Parent->Right;
+      }
+      Sibling->Red        = Parent->Red;
+      Parent->Red         = FALSE;
+      Sibling->Right->Red = FALSE;
+      MemoryMapTreeRotateLeft (Parent);
+    } else {
+      Sibling = Parent->Left;
+      if (Sibling->Red) {
+        Sibling->Red = FALSE;
+        Parent->Red  = TRUE;
+        MemoryMapTreeRotateRight (Parent);
+        Sibling = Parent->Left;
+      }
+      if ((Sibling->Left == NULL || !Sibling->Left->Red) &&
+          (Sibling->Right == NULL || !Sibling->Right->Red)) {
+        Sibling->Red = TRUE;
+        Child        = Parent;
+        Parent       = Child->Parent;
+        continue;
+      }
+      if (Sibling->Left == NULL || !Sibling->Left->Red) {
+        Sibling->Right->Red = FALSE;
+        Sibling->Red        = TRUE;
+        MemoryMapTreeRotateLeft (Sibling);
+        Sibling = Parent->Left;
+      }
+      Sibling->Red       = Parent->Red;
+      Parent->Red        = FALSE;
+      Sibling->Left->Red = FALSE;
+      MemoryMapTreeRotateRight (Parent);
+    }
+    Child = mMemoryMapRoot;
+  }
+
+  if (Child != NULL) {
+    Child->Red = FALSE;
+  }
+}
+
+
+/**
+  Remove a memory map entry from the tree.
+
+  @param  Entry                  The entry to remove
+
+**/
+VOID
+MemoryMapTreeRemove (
+  IN OUT MEMORY_MAP  *Entry
+  )
+{
+  MEMORY_MAP  *Next;
+  MEMORY_MAP  *Child;
+  MEMORY_MAP  *Parent;
+  BOOLEAN     Red;
+
+  if (Entry->Left != NULL && Entry->Right != NULL) {
+    //
+    // Move the in-order successor into the place of Entry
+    //
+    Next = Entry->Right;
+    while (Next->Left != NULL) {
+      Next = Next->Left;
+    }
+
+    Child  = Next->Right;
+    Parent = Next->Parent;
+    Red    = Next->Red;
+
+    if (Parent == Entry) {
+      Parent = Next;
+    } else {
+      Parent->Left = Child;
+      if (Child != NULL) {
+        Child->Parent = Parent;
+      }
+      Next->Right          = Entry->Right;
+      Entry->Right->Parent = Next;
+    }
+
+    Next->Left          = Entry->Left;
+    Entry->Left->Parent = Next;
+    Next->Red           = Entry->Red;
+    MemoryMapTreeReplaceChild (Entry->Parent, Entry, Next);
+  } else {
+    Child  = (Entry->Left != NULL) ? Entry->Left : Entry->Right;
+    Parent = Entry->Parent;
+    Red    = Entry->Red;
+    MemoryMapTreeReplaceChild (Parent, Entry, Child);
+  }
+
+  MemoryMapTreeUpdate (Parent);
+
+  if (!Red) {
+    MemoryMapTreeRemoveFixup (Child, Parent);
+  }
+
+  Entry->Parent = NULL;
+  Entry->Left   = NULL;
+  Entry->Right  = NULL;
+}
+
+
+/**
+  Make a copy of a memory map entry take the place of the original in the
+  tree. Used when an entry moves from the descriptor stack to heap.
+
+  @param  Old                    The entry in the tree
+  @param  New                    The copy of Old that replaces it
+
+**/
+VOID
+MemoryMapTreeReplace (
+  IN OUT MEMORY_MAP  *Old,
+  IN OUT MEMORY_MAP  *New
+  )
+{
+  MemoryMapTreeReplaceChild (Old->Parent, Old, New);
+  if (New->Left != NULL) {
+    New->Left->Parent = New;
+  }
+  if (New->Right != NULL) {
+    New->Right->Parent = New;
+  }
+
+  Old->Parent = NULL;
+  Old->Left   = NULL;
+  Old->Right  = NULL;
+}
+
+
+/**
+  Find the memory map entry that covers an address.
+
+  @param  Address                The address to look up
+
+  @return The entry covering Address, or NULL if there is none
+
+**/
+MEMORY_MAP *
+MemoryMapTreeFind (
+  IN UINT64          Address
+  )
+{
+  MEMORY_MAP  *Entry;
+
+  Entry = mMemoryMapRoot;
+  while (Entry != NULL) {
+    if (Address < Entry->Start) {
+      Entry = Entry->Left;
+    } else if (Address > Entry->End) {
+      Entry = Entry->Right;
+    } else {
+      break;
+    }
+  }
+
+  return Entry;
+}
+
+
+/**
+  Return the entry that follows another one in address order.
+
+  @param  Entry                  The entry in the tree
+
+  @return The next entry, or NULL if Entry is the highest one
+
+**/
+MEMORY_MAP *
+MemoryMapTreeNext (
+  IN MEMORY_MAP      *Entry
+  )
+{
+  MEMORY_MAP  *Parent;
+
+  if (Entry->Right != NULL) {
+    Entry = Entry->Right;
+    while (Entry->Left != NULL) {
+      Entry = Entry->Left;
+    }
+    return Entry;
+  }
+
+  Parent = Entry->Parent;
+  while (Parent != NULL && Entry == Parent->Right) {
+    Entry  = Parent;
+    Parent = Parent->Parent;
+  }
+
+  return Parent;
+}
+
+
+/**
+  Search a subtree, from the highest address down, for a free descriptor
+  that can hold the requested number of bytes between MinAddress and
+  MaxAddress.
+
+  @param  Entry                  The root of the subtree
+  @param  MaxAddress             The last usable byte, the end of a page
+  @param  MinAddress             The lowest usable address
+  @param  NumberOfBytes          Number of bytes needed
+  @param  Alignment              Bits to align with
+
+  @return The last byte of the highest usable range, or 0 if none was found
+
+**/
+UINT64
+MemoryMapTreeFindFree (
+  IN MEMORY_MAP      *Entry,
+  IN UINT64          MaxAddress,
+  IN UINT64          MinAddress,
+  IN UINT64          NumberOfBytes,
+  IN UINTN           Alignment
+  )
+{
+  UINT64  DescEnd;
+
+  while (Entry != NULL && Entry->MaxFreeSize >= NumberOfBytes) {
+    //
+    // Everything to the right starts after Entry, so it is only worth
+    // looking at when Entry itself starts below MaxAddress
+    //
+    if (Entry->Start < MaxAddress) {
+      DescEnd = MemoryMapTreeFindFree (Entry->Right, MaxAddress, MinAddress, NumberOfBytes, Alignment);
+      if (DescEnd != 0) {
+        return DescEnd;
+      }
+
+      if (Entry->Type == EfiConventionalMemory && Entry->End >= MinAddress) {
+        DescEnd = Entry->End;
+        if (DescEnd >= MaxAddress) {
+          DescEnd = MaxAddress;
+        }
+        DescEnd = ((DescEnd + 1) & (~((UINT64) Alignment - 1))) - 1;
+
+        //
+        // Skip descriptors that vanish once their end is aligned down
+        //
+        if (DescEnd >= Entry->Start &&
+            DescEnd - Entry->Start + 1 >= NumberOfBytes &&
+            DescEnd - NumberOfBytes + 1 >= MinAddress) {
+          return DescEnd;
+        }
+      }
+    }
+
+    //
+    // Everything to the left ends before Entry starts
+    //
+    if (Entry->Start <= MinAddress) {
+      break;
+    }
+    Entry = Entry->Left;
+  }
+
+  return 0;
+}
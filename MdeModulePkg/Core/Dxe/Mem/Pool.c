@@ -56,6 +56,35 @@ typedef struct {
 
 #define MAX_POOL_SIZE     (MAX_ADDRESS - POOL_OVERHEAD)
 
+//
+// Small allocations are carved from slabs. A slab is one DEFAULT_PAGE_ALLOCATION
+// chunk that holds blocks of a single size class only, so the chunk can be
+// handed back to the page allocator as soon as its last block is freed.
+//
+#define POOL_SLAB_SIGNATURE   SIGNATURE_32('p','s','l','b')
+typedef struct {
+  UINT32          Signature;
+  UINT32          Class;
+  UINT32          InUse;
+  UINT32          Total;
+  LIST_ENTRY      Link;
+  LIST_ENTRY      FreeList;
+} POOL_SLAB;
+
+#define SLAB_SHIFT            4
+
+#define SLAB_HEADER_SIZE      ALIGN_VALUE (sizeof (POOL_SLAB), 1 << SLAB_SHIFT)
+
+#define SIZE_TO_SLAB_CLASS(a) (((a) - 1) >> SLAB_SHIFT)
+#define SLAB_CLASS_TO_SIZE(a) (((a) + 1) << SLAB_SHIFT)
+
+#define MAX_SLAB_OBJECT_SIZE  512
+
+#define MAX_SLAB_CLASS        (SIZE_TO_SLAB_CLASS (MAX_SLAB_OBJECT_SIZE) + 1)
+
+#define BLOCK_TO_SLAB(a)      \
+  ((POOL_SLAB *) ((UINTN) (a) & ~((UINTN) DEFAULT_PAGE_ALLOCATION - 1)))
+
 //
 // Globals
 //
@@ -64,8 +93,10 @@ typedef struct {
 typedef struct {
     INTN             Signature;
     UINTN            Used;
+    UINTN            Pages;
     EFI_MEMORY_TYPE  MemoryType;
     LIST_ENTRY       FreeList[MAX_POOL_LIST];
+    LIST_ENTRY       SlabList[MAX_SLAB_CLASS];
     LIST_ENTRY       Link;
 } POOL;
 
@@ -95,10 +126,14 @@ CoreInitializePool (
   for (Type=0; Type < EfiMaxMemoryType; Type++) {
     mPoolHead[Type].Signature  = 0;
     mPoolHead[Type].Used       = 0;
+    mPoolHead[Type].Pages      = 0;
     mPoolHead[Type].MemoryType = (EFI_MEMORY_TYPE) Type;
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
         InitializeListHead (&mPoolHead[Type].FreeList[Index]);
     }
+    for (Index=0; Index < MAX_SLAB_CLASS; Index++) {
+        InitializeListHead (&mPoolHead[Type].SlabList[Index]);
+    }
   }
 }
 
@@ -144,10 +179,14 @@ LookupPoolHead (
 
     Pool->Signature = POOL_SIGNATURE;
     Pool->Used      = 0;
+    Pool->Pages     = 0;
     Pool->MemoryType = MemoryType;
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&Pool->FreeList[Index]);
     }
+    for (Index=0; Index < MAX_SLAB_CLASS; Index++) {
+      InitializeListHead (&Pool->SlabList[Index]);
+    }
 
     InsertHeadList (&mPoolHeadList, &Pool->Link);
 
@@ -159,6 +198,134 @@ LookupPoolHead (
 
 
 
+/**
+  Take one free block out of the slabs of the given size class, creating
+  a new slab when every slab of that class is full.
+  Caller must have the memory lock held
+
+  @param  Pool                   Pool head of the memory type to allocate from
+  @param  Class                  Slab size class of the block
+
+  @return The free block, or NULL
+
+**/
+POOL_FREE *
+CoreAllocateSlabBlock (
+  IN POOL         *Pool,
+  IN UINTN        Class
+  )
+{
+  POOL_SLAB   *Slab;
+  POOL_FREE   *Free;
+  UINTN       FSize;
+  UINTN       Offset;
+
+  ASSERT (Class < MAX_SLAB_CLASS);
+
+  if (IsListEmpty (&Pool->SlabList[Class])) {
+    Slab = CoreAllocatePoolPages (Pool->MemoryType, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION), DEFAULT_PAGE_ALLOCATION);
+    if (Slab == NULL) {
+      return NULL;
+    }
+    Pool->Pages += EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION);
+
+    Slab->Signature = POOL_SLAB_SIGNATURE;
+    Slab->Class     = (UINT32) Class;
+    Slab->InUse     = 0;
+    Slab->Total     = 0;
+    InitializeListHead (&Slab->FreeList);
+
+    //
+    // Carve up the rest of the new page into blocks of this class only
+    //
+    FSize = SLAB_CLASS_TO_SIZE (Class);
+    for (Offset = SLAB_HEADER_SIZE; Offset + FSize <= DEFAULT_PAGE_ALLOCATION; Offset += FSize) {
+      Free = (POOL_FREE *) ((CHAR8 *) Slab + Offset);
+      Free->Signature = POOL_FREE_SIGNATURE;
+      Free->Index     = (UINT32) Class;
+      InsertTailList (&Slab->FreeList, &Free->Link);
+      Slab->Total++;
+    }
+
+    InsertHeadList (&Pool->SlabList[Class], &Slab->Link);
+  }
+
+  Slab = CR (Pool->SlabList[Class].ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+  Free = CR (Slab->FreeList.ForwardLink, POOL_FREE, Link, POOL_FREE_SIGNATURE);
+  RemoveEntryList (&Free->Link);
+  Slab->InUse++;
+
+  //
+  // A full slab leaves the list until one of its blocks is freed
+  //
+  if (Slab->InUse == Slab->Total) {
+    RemoveEntryList (&Slab->Link);
+  }
+
+  return Free;
+}
+
+
+
+/**
+  Return a block to its slab. The slab's page is given back to the page
+  allocator once all of its blocks are free, unless it is the last slab
+  of its size class, which is kept to absorb alloc/free bursts.
+  Caller must have the memory lock held
+
+  @param  Pool                   Pool head of the memory type of the block
+  @param  Head                   The block to free
+
+**/
+VOID
+CoreFreeSlabBlock (
+  IN POOL         *Pool,
+  IN POOL_HEAD    *Head
+  )
+{
+  POOL_SLAB   *Slab;
+  POOL_FREE   *Free;
+  UINTN       Class;
+
+  Slab = BLOCK_TO_SLAB (Head);
+  ASSERT (Slab->Signature == POOL_SLAB_SIGNATURE);
+  ASSERT (Slab->InUse != 0);
+
+  Class = Slab->Class;
+
+  //
+  // A full slab is back on the list once it has a free block again
+  //
+  if (Slab->InUse == Slab->Total) {
+    InsertHeadList (&Pool->SlabList[Class], &Slab->Link);
+  }
+
+  Free = (POOL_FREE *) Head;
+  Free->Signature = POOL_FREE_SIGNATURE;
+  Free->Index     = (UINT32) Class;
+  InsertHeadList (&Slab->FreeList, &Free->Link);
+  Slab->InUse--;
+
+  if (Slab->InUse != 0) {
+    return;
+  }
+
+  //
+  // Keep one empty slab per class, except for OS specific memory types
+  // whose pool head is released when the last allocation goes away
+  //
+  if (Pool->MemoryType >= 0 && Slab->Link.ForwardLink == Slab->Link.BackLink) {
+    return;
+  }
+
+  RemoveEntryList (&Slab->Link);
+  Slab->Signature = 0;
+  Pool->Pages -= EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION);
+  CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN) Slab, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION));
+}
+
+
+
 /**
   Allocate pool of a particular type.
 
@@ -263,6 +430,14 @@ CoreAllocatePoolI (
   }
   Head = NULL;
 
+  //
+  // Small allocations come from the slab of their size class
+  //
+  if (Size <= MAX_SLAB_OBJECT_SIZE) {
+    Head = (POOL_HEAD *) CoreAllocateSlabBlock (Pool, SIZE_TO_SLAB_CLASS (Size));
+    goto Done;
+  }
+
   //
   // If allocation is over max size, just allocate pages for the request
   // (slow)
@@ -271,6 +446,9 @@ CoreAllocatePoolI (
     NoPages = EFI_SIZE_TO_PAGES(Size) + EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION) - 1;
     NoPages &= ~(EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION) - 1);
     Head = CoreAllocatePoolPages (PoolType, NoPages, DEFAULT_PAGE_ALLOCATION);
+    if (Head != NULL) {
+      Pool->Pages += NoPages;
+    }
     goto Done;
   }
 
@@ -286,6 +464,7 @@ CoreAllocatePoolI (
     if (NewPage == NULL) {
       goto Done;
     }
+    Pool->Pages += EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION);
 
     //
     // Carve up new page into free pool blocks
@@ -460,15 +639,23 @@ CoreFreePoolI (
   DEBUG_CLEAR_MEMORY (Head, Size);
 
   //
-  // If it's not on the list, it must be pool pages
+  // Small blocks always live in a slab
   //
-  if (Index >= MAX_POOL_LIST) {
+  if (Size <= MAX_SLAB_OBJECT_SIZE) {
+
+    CoreFreeSlabBlock (Pool, Head);
+
+  } else if (Index >= MAX_POOL_LIST) {
+    //
+    // If it's not on the list, it must be pool pages
+    //
 
     //
     // Return the memory pages back to free memory
     //
     NoPages = EFI_SIZE_TO_PAGES(Size) + EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION) - 1;
     NoPages &= ~(EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION) - 1);
+    Pool->Pages -= NoPages;
     CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN) Head, NoPages);
 
   } else {
@@ -536,6 +723,7 @@ CoreFreePoolI (
         //
         // Free the page
         //
+        Pool->Pages -= EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION);
         CoreFreePoolPages ((EFI_PHYSICAL_ADDRESS) (UINTN)NewPage, EFI_SIZE_TO_PAGES (DEFAULT_PAGE_ALLOCATION));
       }
     }
@@ -553,3 +741,54 @@ CoreFreePoolI (
 
   return EFI_SUCCESS;
 }
+
+
+
+/**
+  Display, for every memory type that holds pool pages, the bytes in use by
+  pool allocations against the bytes of pages backing them. The difference
+  is the fragmentation of that pool.
+
+**/
+VOID
+CoreDisplayPoolStatistics (
+  VOID
+  )
+{
+  LIST_ENTRY      *Link;
+  POOL            *Pool;
+  UINTN           Type;
+  UINTN           Reserved;
+
+  CoreAcquireMemoryLock ();
+
+  Link = NULL;
+  Type = 0;
+  while (TRUE) {
+    if (Type < EfiMaxMemoryType) {
+      Pool = &mPoolHead[Type++];
+    } else {
+      Link = (Link == NULL) ? mPoolHeadList.ForwardLink : Link->ForwardLink;
+      if (Link == &mPoolHeadList) {
+        break;
+      }
+      Pool = CR (Link, POOL, Link, POOL_SIGNATURE);
+    }
+
+    if (Pool->Pages == 0) {
+      continue;
+    }
+
+    Reserved = EFI_PAGES_TO_SIZE (Pool->Pages);
+    DEBUG ((
+      DEBUG_POOL,
+      "Pool Type %x: %,ld bytes used in %,ld pages, %d%% fragmented\n",
+      Pool->MemoryType,
+      (UINT64) Pool->Used,
+      (UINT64) Pool->Pages,
+      (Reserved > Pool->Used) ? (UINT32) ((Reserved - Pool->Used) / (Reserved / 100)) : 0
+      ));
+  }
+
+  CoreReleaseMemoryLock ();
+}
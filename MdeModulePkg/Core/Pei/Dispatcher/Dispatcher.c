@@ -556,6 +556,15 @@ PeiDispatcher (
               PrivateInMem->HobList.Raw = (VOID*) ((UINTN) PrivateInMem->HobList.Raw + HeapOffset);
               PrivateInMem->StackBase   = (EFI_PHYSICAL_ADDRESS)(((UINTN)PrivateInMem->PhysicalMemoryBegin + EFI_PAGE_MASK) & ~EFI_PAGE_MASK);
 
+              //
+              // The FV file indexes live in the HOB list that has just been moved
+              //
+              for (Index1 = 0; Index1 < PrivateInMem->FvCount; Index1++) {
+                if (PrivateInMem->Fv[Index1].FileIndex != NULL) {
+                  PrivateInMem->Fv[Index1].FileIndex = (FV_FILE_INDEX *) ((UINTN) PrivateInMem->Fv[Index1].FileIndex + HeapOffset);
+                }
+              }
+
               PeiServices = (CONST EFI_PEI_SERVICES **) &PrivateInMem->PS;
 
               //
@@ -595,6 +604,18 @@ PeiDispatcher (
               //
               PrivateInMem->PeiMemoryInstalled     = TRUE;
 
+              //
+              // Index the volumes that were too large to index in temporary memory
+              //
+              for (Index1 = 0; Index1 < PrivateInMem->FvCount; Index1++) {
+                if (PrivateInMem->Fv[Index1].FileIndex == NULL) {
+                  PrivateInMem->Fv[Index1].FileIndex = PeiBuildFvFileIndex (
+                                                         PrivateInMem,
+                                                         (EFI_PEI_FV_HANDLE) PrivateInMem->Fv[Index1].FvHeader
+                                                         );
+                }
+              }
+
               //
               // Indicate that PeiCore reenter
               //
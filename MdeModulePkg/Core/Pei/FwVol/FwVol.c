@@ -120,6 +120,283 @@ PeiFileHandleToVolume (
   return FALSE;
 }
 
+/**
+  Walk the FFS file headers of a firmware volume the way PeiFindFileEx () does,
+  counting the valid files and recording them in FileIndex if it is given.
+
+  @param FwVolHeader     Pointer to the FV header of the volume to walk.
+  @param FileIndex       The index to fill in, or NULL to only count the files.
+  @param FileCount       The number of valid files found.
+  @param Complete        Set to TRUE if the walk reached the end of the FV or its
+                         free space, FALSE if it stopped at a file it can not use.
+
+  @retval EFI_SUCCESS           The walk ended at the end of the FV, its free space
+                                or a file header that is not valid.
+  @retval EFI_VOLUME_CORRUPTED  The walk stopped at a file whose header checksum
+                                is wrong.
+
+**/
+EFI_STATUS
+PeiWalkFvFiles (
+  IN  EFI_FIRMWARE_VOLUME_HEADER  *FwVolHeader,
+  IN  FV_FILE_INDEX               *FileIndex,  OPTIONAL
+  OUT UINT32                      *FileCount,
+  OUT BOOLEAN                     *Complete
+  )
+{
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  FV_FILE_INDEX_ENTRY                   *Entry;
+  UINT32                                FileLength;
+  UINT32                                FileOccupiedSize;
+  UINT32                                FileOffset;
+  UINT64                                FvLength;
+  UINT8                                 ErasePolarity;
+  UINT8                                 ErasedByte;
+  UINTN                                 Index;
+
+  FvLength = FwVolHeader->FvLength;
+  if ((FwVolHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0) {
+    ErasePolarity = 1;
+    ErasedByte    = 0xFF;
+  } else {
+    ErasePolarity = 0;
+    ErasedByte    = 0;
+  }
+
+  *FileCount    = 0;
+  *Complete     = TRUE;
+  FileOffset    = FwVolHeader->HeaderLength;
+  FfsFileHeader = (EFI_FFS_FILE_HEADER *)((UINT8 *)FwVolHeader + FileOffset);
+
+  while (FileOffset < (FvLength - sizeof (EFI_FFS_FILE_HEADER))) {
+    switch (GetFileState (ErasePolarity, FfsFileHeader)) {
+
+    case EFI_FILE_HEADER_INVALID:
+      FileOffset    += sizeof(EFI_FFS_FILE_HEADER);
+      FfsFileHeader =  (EFI_FFS_FILE_HEADER *)((UINT8 *)FfsFileHeader + sizeof(EFI_FFS_FILE_HEADER));
+      break;
+
+    case EFI_FILE_DATA_VALID:
+    case EFI_FILE_MARKED_FOR_UPDATE:
+      if (CalculateHeaderChecksum (FfsFileHeader) != 0) {
+        *Complete = FALSE;
+        return EFI_VOLUME_CORRUPTED;
+      }
+
+      if (FileIndex != NULL) {
+        Entry = &FileIndex->Entry[*FileCount];
+        CopyGuid (&Entry->Name, &FfsFileHeader->Name);
+        Entry->Offset = FileOffset;
+        Entry->Type   = FfsFileHeader->Type;
+        FileIndex->TypeBitmap[FfsFileHeader->Type >> 5] |= (UINT32) 1 << (FfsFileHeader->Type & 0x1F);
+      }
+      (*FileCount)++;
+
+      FileLength       = *(UINT32 *)(FfsFileHeader->Size) & 0x00FFFFFF;
+      FileOccupiedSize = GET_OCCUPIED_SIZE(FileLength, 8);
+      FileOffset       += FileOccupiedSize;
+      FfsFileHeader    =  (EFI_FFS_FILE_HEADER *)((UINT8 *)FfsFileHeader + FileOccupiedSize);
+      break;
+
+    case EFI_FILE_DELETED:
+      FileLength       =  *(UINT32 *)(FfsFileHeader->Size) & 0x00FFFFFF;
+      FileOccupiedSize =  GET_OCCUPIED_SIZE(FileLength, 8);
+      FileOffset       += FileOccupiedSize;
+      FfsFileHeader    =  (EFI_FFS_FILE_HEADER *)((UINT8 *)FfsFileHeader + FileOccupiedSize);
+      break;
+
+    default:
+      //
+      // The walk ends here. It is only complete if this is the free space.
+      //
+      for (Index = 0; Index < sizeof (EFI_FFS_FILE_HEADER); Index++) {
+        if (((UINT8 *)FfsFileHeader)[Index] != ErasedByte) {
+          *Complete = FALSE;
+          break;
+        }
+      }
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Walk the file headers of a firmware volume once and save the name, offset
+  and type of every valid file in a HOB, so that later searches of the
+  firmware volume, in PEI and in the DXE Core, do not walk the headers again.
+
+  A volume holding a file whose header checksum is wrong is not indexed, so
+  that PeiFindFileEx () asserts when it reaches the file. Before permanent
+  memory is installed, the HOB takes temporary RAM, so volumes of more than
+  PcdPeiCoreMaxPreMemoryFvFileIndexEntries files are only indexed afterwards.
+
+  @param PrivateData     Pointer to the PEI Core data.
+  @param FvHandle        Pointer to the FV header of the volume to index.
+
+  @return Pointer to the index in the HOB list, or NULL if the volume is not indexed.
+
+**/
+FV_FILE_INDEX *
+PeiBuildFvFileIndex (
+  IN PEI_CORE_INSTANCE            *PrivateData,
+  IN EFI_PEI_FV_HANDLE            FvHandle
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER            *FwVolHeader;
+  FV_FILE_INDEX                         *FileIndex;
+  UINT32                                FileCount;
+  UINTN                                 Size;
+  BOOLEAN                               Complete;
+  EFI_STATUS                            Status;
+
+  FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *)FvHandle;
+
+  //
+  // Count the files first, the HOB can not grow once it is built.
+  //
+  Status = PeiWalkFvFiles (FwVolHeader, NULL, &FileCount, &Complete);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+  if (!PrivateData->PeiMemoryInstalled &&
+      (FileCount > FixedPcdGet32 (PcdPeiCoreMaxPreMemoryFvFileIndexEntries))) {
+    return NULL;
+  }
+
+  Size = sizeof (FV_FILE_INDEX) + FileCount * sizeof (FV_FILE_INDEX_ENTRY);
+  if (Size > 0xFFF8 - sizeof (EFI_HOB_GUID_TYPE)) {
+    return NULL;
+  }
+
+  FileIndex = BuildGuidHob (&gFvFileIndexHobGuid, Size);
+  ZeroMem (FileIndex, Size);
+  FileIndex->FvBase    = (EFI_PHYSICAL_ADDRESS) (UINTN) FwVolHeader;
+  FileIndex->FvLength  = FwVolHeader->FvLength;
+  PeiWalkFvFiles (FwVolHeader, FileIndex, &FileIndex->FileCount, &FileIndex->Complete);
+  ASSERT (FileIndex->FileCount == FileCount);
+
+  return FileIndex;
+}
+
+/**
+  Return the file index of a firmware volume known to the PEI Core.
+
+  @param FvHandle        Pointer to the FV header of the volume.
+
+  @return Pointer to the index, or NULL if the FV has none.
+
+**/
+FV_FILE_INDEX *
+PeiGetFvFileIndex (
+  IN CONST EFI_PEI_FV_HANDLE      FvHandle
+  )
+{
+  PEI_CORE_INSTANCE                     *PrivateData;
+  UINTN                                 Index;
+
+  PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS (GetPeiServicesTablePointer ());
+  for (Index = 0; Index < PrivateData->FvCount; Index++) {
+    if ((EFI_PEI_FV_HANDLE) PrivateData->Fv[Index].FvHeader == FvHandle) {
+      return PrivateData->Fv[Index].FileIndex;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Search the file index of a firmware volume for the first file matching
+  FileName or SearchType, with the same rules as PeiFindFileEx ().
+
+  @param FwVolHeader     Pointer to the FV header of the volume to search
+  @param FileIndex       The file index of the volume
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+PeiFindFileInIndex (
+  IN        EFI_FIRMWARE_VOLUME_HEADER *FwVolHeader,
+  IN        FV_FILE_INDEX              *FileIndex,
+  IN  CONST EFI_GUID                   *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE            SearchType,
+  IN OUT    EFI_FFS_FILE_HEADER        **FileHeader,
+  IN OUT    EFI_PEI_FV_HANDLE          *AprioriFile  OPTIONAL
+  )
+{
+  FV_FILE_INDEX_ENTRY                   *Entry;
+  UINT32                                Offset;
+  UINTN                                 Index;
+  UINTN                                 Low;
+  UINTN                                 High;
+
+  //
+  // Start after FileHeader, the entries are sorted by offset.
+  //
+  Index = 0;
+  if ((*FileHeader != NULL) && (FileName == NULL)) {
+    Offset = (UINT32) ((UINT8 *)*FileHeader - (UINT8 *)FwVolHeader);
+    Low    = 0;
+    High   = FileIndex->FileCount;
+    while (Low < High) {
+      Index = (Low + High) / 2;
+      if (FileIndex->Entry[Index].Offset <= Offset) {
+        Low = Index + 1;
+      } else {
+        High = Index;
+      }
+    }
+    Index = Low;
+  }
+
+  //
+  // A type that is not in the volume can not be found.
+  //
+  if ((FileName == NULL) &&
+      (SearchType != EFI_FV_FILETYPE_ALL) &&
+      (SearchType != PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) &&
+      !FV_FILE_INDEX_HAS_TYPE (FileIndex, SearchType)) {
+    Index = FileIndex->FileCount;
+  }
+
+  for (; Index < FileIndex->FileCount; Index++) {
+    Entry = &FileIndex->Entry[Index];
+    if (FileName != NULL) {
+      if (CompareGuid (&Entry->Name, FileName)) {
+        break;
+      }
+    } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
+      if ((Entry->Type == EFI_FV_FILETYPE_PEIM) ||
+          (Entry->Type == EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) ||
+          (Entry->Type == EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+        break;
+      } else if (AprioriFile != NULL) {
+        if ((Entry->Type == EFI_FV_FILETYPE_FREEFORM) &&
+            CompareGuid (&Entry->Name, &gPeiAprioriFileNameGuid)) {
+          *AprioriFile = (UINT8 *)FwVolHeader + Entry->Offset;
+        }
+      }
+    } else if (((SearchType == Entry->Type) || (SearchType == EFI_FV_FILETYPE_ALL)) &&
+               (Entry->Type != EFI_FV_FILETYPE_FFS_PAD)) {
+      break;
+    }
+  }
+
+  if (Index >= FileIndex->FileCount) {
+    *FileHeader = NULL;
+    return EFI_NOT_FOUND;
+  }
+
+  *FileHeader = (EFI_FFS_FILE_HEADER *)((UINT8 *)FwVolHeader + FileIndex->Entry[Index].Offset);
+  return EFI_SUCCESS;
+}
+
 /**
   Given the input file pointer, search for the first matching file in the
   FFS volume as defined by SearchType. The search starts from FileHeader inside
@@ -157,10 +434,19 @@ PeiFindFileEx (
   UINT64                                FvLength;
   UINT8                                 ErasePolarity;
   UINT8                                 FileState;
+  FV_FILE_INDEX                         *FileIndex;
 
   FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *)FvHandle;
   FileHeader  = (EFI_FFS_FILE_HEADER **)FileHandle;
 
+  //
+  // Search the file index of the FV instead of its file headers if there is one
+  //
+  FileIndex = PeiGetFvFileIndex (FvHandle);
+  if (FileIndex != NULL) {
+    return PeiFindFileInIndex (FwVolHeader, FileIndex, FileName, SearchType, FileHeader, AprioriFile);
+  }
+
   FvLength = FwVolHeader->FvLength;
   if ((FwVolHeader->Attributes & EFI_FVB2_ERASE_POLARITY) != 0) {
     ErasePolarity = 1;
@@ -282,6 +568,10 @@ PeiInitializeFv (
   PrivateData->AllFvCount = 1;
   PrivateData->AllFv[0] = (EFI_PEI_FV_HANDLE)PrivateData->Fv[0].FvHeader;
 
+  //
+  // Index the files of the BFV, so that it is not walked again for every search
+  //
+  PrivateData->Fv[0].FileIndex = PeiBuildFvFileIndex (PrivateData, (EFI_PEI_FV_HANDLE)PrivateData->Fv[0].FvHeader);
 
   //
   // Post a call-back for the FvInfoPPI services to expose
@@ -350,7 +640,9 @@ FirmwareVolmeInfoPpiNotifyCallback (
       return Status;
     }
     
-    PrivateData->Fv[PrivateData->FvCount++].FvHeader = (EFI_FIRMWARE_VOLUME_HEADER*)Fv->FvInfo;
+    PrivateData->Fv[PrivateData->FvCount].FvHeader  = (EFI_FIRMWARE_VOLUME_HEADER*)Fv->FvInfo;
+    PrivateData->Fv[PrivateData->FvCount].FileIndex = PeiBuildFvFileIndex (PrivateData, (EFI_PEI_FV_HANDLE)Fv->FvInfo);
+    PrivateData->FvCount++;
 
     PrivateData->AllFv[PrivateData->AllFvCount++] = (EFI_PEI_FV_HANDLE)Fv->FvInfo;
     
@@ -45,6 +45,8 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/MemoryAllocationLib.h>
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/AprioriFileName.h>
+#include <Guid/FvFileIndexHob.h>
+#include <Guid/PeiPpiStatisticsHob.h>
 
 ///
 /// It is an FFS type extension used for PeiFindFileEx. It indicates current
@@ -61,6 +63,23 @@ typedef union {
   VOID                        *Raw;
 } PEI_PPI_LIST_POINTERS;
 
+///
+/// Number of buckets of the PPI GUID hash. Must be a power of 2.
+///
+#define PEI_PPI_HASH_BUCKETS  16
+
+///
+/// End of a PPI GUID hash chain.
+///
+#define PEI_PPI_HASH_END      0xFFFF
+
+///
+/// The hash key of a PPI GUID is its first 32 bits, which are random for any
+/// GUID generated the usual way.
+///
+#define PEI_PPI_GUID_KEY(Guid)  (((UINT32 *) (Guid))[0])
+#define PEI_PPI_HASH(Key)       (((Key) ^ ((Key) >> 16)) & (PEI_PPI_HASH_BUCKETS - 1))
+
 ///
 /// PPI database structure which contains two link: PpiList and NotifyList. PpiList
 /// is in head of PpiListPtrs array and notify is in end of PpiListPtrs.
@@ -90,6 +109,18 @@ typedef struct {
   /// Ppi database.
   ///
   PEI_PPI_LIST_POINTERS   PpiListPtrs[FixedPcdGet32 (PcdPeiCoreMaxPpiSupported)];
+  ///
+  /// Hash of the installed PPIs by GUID. Each chain links PpiListPtrs indexes in
+  /// install order, so the index needs no fixup when the PEI Core data migrates.
+  ///
+  UINT16                  PpiHashHead[PEI_PPI_HASH_BUCKETS];
+  UINT16                  PpiHashNext[FixedPcdGet32 (PcdPeiCoreMaxPpiSupported)];
+  ///
+  /// PEI_PPI_GUID_KEY of each installed PPI, so that the chains can be searched
+  /// without reading the PPI descriptors.
+  ///
+  UINT32                  PpiGuidKey[FixedPcdGet32 (PcdPeiCoreMaxPpiSupported)];
+  PEI_PPI_STATISTICS      Statistics;
 } PEI_PPI_DATABASE;
 
 
@@ -108,6 +139,10 @@ typedef struct {
   UINT8                               PeimState[FixedPcdGet32 (PcdPeiCoreMaxPeimPerFv)];
   EFI_PEI_FILE_HANDLE                 FvFileHandles[FixedPcdGet32 (PcdPeiCoreMaxPeimPerFv)];
   BOOLEAN                             ScanFv;
+  ///
+  /// Index of the files in the FV, held in a HOB. NULL if it could not be built.
+  ///
+  FV_FILE_INDEX                       *FileIndex;
 } PEI_CORE_FV_HANDLE;
 
 #define CACHE_SETION_MAX_NUMBER       0x10
@@ -474,6 +509,18 @@ DispatchNotify (
   IN INTN                NotifyStopIndex
   );
 
+/**
+
+  Report the PPI database statistics in a GUID HOB.
+
+  @param PrivateData        PeiCore's private data structure
+
+**/
+VOID
+PeiReportPpiStatistics (
+  IN PEI_CORE_INSTANCE  *PrivateData
+  );
+
 //
 // Boot mode support functions
 //
@@ -868,6 +915,28 @@ PeiInitializeFv (
   IN CONST EFI_SEC_PEI_HAND_OFF   *SecCoreData
   );
 
+/**
+  Walk the file headers of a firmware volume once and save the name, offset
+  and type of every valid file in a HOB, so that later searches of the
+  firmware volume, in PEI and in the DXE Core, do not walk the headers again.
+
+  A volume holding a file whose header checksum is wrong is not indexed, so
+  that PeiFindFileEx () asserts when it reaches the file. Before permanent
+  memory is installed, the HOB takes temporary RAM, so volumes of more than
+  PcdPeiCoreMaxPreMemoryFvFileIndexEntries files are only indexed afterwards.
+
+  @param PrivateData     Pointer to the PEI Core data.
+  @param FvHandle        Pointer to the FV header of the volume to index.
+
+  @return Pointer to the index in the HOB list, or NULL if the volume is not indexed.
+
+**/
+FV_FILE_INDEX *
+PeiBuildFvFileIndex (
+  IN PEI_CORE_INSTANCE            *PrivateData,
+  IN EFI_PEI_FV_HANDLE            FvHandle
+  );
+
 /**
   Process Firmware Volum Information once FvInfoPPI install.
 
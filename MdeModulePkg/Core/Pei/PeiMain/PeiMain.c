@@ -230,6 +230,10 @@ PeiCore (
   //
   PERF_END (NULL, "PostMem", NULL, 0);
 
+  PERF_CODE (
+    PeiReportPpiStatistics (&PrivateData);
+  );
+
   Status = PeiServicesLocatePpi (
              &gEfiDxeIplPpiGuid,
              0,
@@ -14,6 +14,102 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include "PeiMain.h"
 
+/**
+
+  Add an installed PPI to the PPI GUID hash. The chains are kept in install order
+  so that LocatePpi returns the instances in the order they were installed.
+
+  @param PrivateData     Pointer to the PEI Core data.
+  @param Index           Index of the PPI in the PPI database.
+
+**/
+VOID
+PeiAddPpiToHash (
+  IN PEI_CORE_INSTANCE   *PrivateData,
+  IN INTN                Index
+  )
+{
+  PEI_PPI_DATABASE      *PpiData;
+  UINT32                Key;
+  UINT16                *Link;
+  UINT32                Length;
+
+  ASSERT (Index < PEI_PPI_HASH_END);
+
+  PpiData = &PrivateData->PpiData;
+  Key     = PEI_PPI_GUID_KEY (PpiData->PpiListPtrs[Index].Ppi->Guid);
+  PpiData->PpiGuidKey[Index] = Key;
+
+  Length = 1;
+  Link   = &PpiData->PpiHashHead[PEI_PPI_HASH (Key)];
+  while ((*Link != PEI_PPI_HASH_END) && (*Link < Index)) {
+    Link = &PpiData->PpiHashNext[*Link];
+    Length++;
+  }
+  PpiData->PpiHashNext[Index] = *Link;
+  *Link = (UINT16) Index;
+
+  for (Index = PpiData->PpiHashNext[Index]; Index != PEI_PPI_HASH_END; Index = PpiData->PpiHashNext[Index]) {
+    Length++;
+  }
+  if (Length > PpiData->Statistics.MaxHashChainLength) {
+    PpiData->Statistics.MaxHashChainLength = Length;
+  }
+}
+
+/**
+
+  Remove an installed PPI from the PPI GUID hash.
+
+  @param PrivateData     Pointer to the PEI Core data.
+  @param Index           Index of the PPI in the PPI database.
+
+**/
+VOID
+PeiRemovePpiFromHash (
+  IN PEI_CORE_INSTANCE   *PrivateData,
+  IN INTN                Index
+  )
+{
+  PEI_PPI_DATABASE      *PpiData;
+  UINT16                *Link;
+
+  PpiData = &PrivateData->PpiData;
+  Link    = &PpiData->PpiHashHead[PEI_PPI_HASH (PpiData->PpiGuidKey[Index])];
+  while (*Link != PEI_PPI_HASH_END) {
+    if (*Link == Index) {
+      *Link = PpiData->PpiHashNext[Index];
+      return;
+    }
+    Link = &PpiData->PpiHashNext[*Link];
+  }
+  ASSERT (FALSE);
+}
+
+/**
+
+  Add the PPIs installed by one InstallPpi call to the PPI GUID hash.
+
+  @param PrivateData     Pointer to the PEI Core data.
+  @param StartIndex      Index of the first PPI installed by the call.
+
+**/
+VOID
+PeiAddPpiListToHash (
+  IN PEI_CORE_INSTANCE   *PrivateData,
+  IN INTN                StartIndex
+  )
+{
+  INTN                  Index;
+
+  for (Index = StartIndex; Index < PrivateData->PpiData.PpiListEnd; Index++) {
+    PeiAddPpiToHash (PrivateData, Index);
+  }
+  if ((UINT32) PrivateData->PpiData.PpiListEnd > PrivateData->PpiData.Statistics.MaxPpiCount) {
+    PrivateData->PpiData.Statistics.MaxPpiCount = (UINT32) PrivateData->PpiData.PpiListEnd;
+  }
+}
+
 /**
 
   Initialize PPI services.
@@ -29,10 +125,16 @@ InitializePpiServices (
   IN PEI_CORE_INSTANCE *OldCoreData
   )
 {
+  UINTN                 Index;
+
   if (OldCoreData == NULL) {
     PrivateData->PpiData.NotifyListEnd = FixedPcdGet32 (PcdPeiCoreMaxPpiSupported)-1;
     PrivateData->PpiData.DispatchListEnd = FixedPcdGet32 (PcdPeiCoreMaxPpiSupported)-1;
     PrivateData->PpiData.LastDispatchedNotify = FixedPcdGet32 (PcdPeiCoreMaxPpiSupported)-1;
+
+    for (Index = 0; Index < PEI_PPI_HASH_BUCKETS; Index++) {
+      PrivateData->PpiData.PpiHashHead[Index] = PEI_PPI_HASH_END;
+    }
   }
 }
 
@@ -60,6 +162,10 @@ ConvertPpiPointers (
   UINT8                 Index;
   PEI_PPI_LIST_POINTERS *PpiPointer;
 
+  //
+  // The PPI GUID hash links PpiListPtrs indexes and caches the GUID values, not
+  // pointers, so it has moved with the PEI Core data and needs no fixup here.
+  //
   for (Index = 0; Index < FixedPcdGet32 (PcdPeiCoreMaxPpiSupported); Index++) {
     if (Index < PrivateData->PpiData.PpiListEnd ||
         Index > PrivateData->PpiData.NotifyListEnd) {
@@ -137,6 +243,7 @@ PeiInstallPpi (
   }
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PrivateData->PpiData.Statistics.InstallCount++;
 
   Index = PrivateData->PpiData.PpiListEnd;
   LastCallbackInstall = Index;
@@ -154,6 +261,7 @@ PeiInstallPpi (
     // PcdPeiCoreMaxPpiSupported can be set to a larger value in DSC to satisfy more PPI requirement.
     //
     if (Index == PrivateData->PpiData.NotifyListEnd + 1) {
+      PeiAddPpiListToHash (PrivateData, LastCallbackInstall);
       return  EFI_OUT_OF_RESOURCES;
     }
     //
@@ -182,6 +290,8 @@ PeiInstallPpi (
     Index++;
   }
 
+  PeiAddPpiListToHash (PrivateData, LastCallbackInstall);
+
   //
   // Dispatch any callback level notifies for newly installed PPIs.
   //
@@ -236,6 +346,7 @@ PeiReInstallPpi (
   }
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PrivateData->PpiData.Statistics.ReInstallCount++;
 
   //
   // Find the old PPI instance in the database.  If we can not find it,
@@ -255,7 +366,9 @@ PeiReInstallPpi (
   //
   DEBUG((EFI_D_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
   ASSERT (Index < FixedPcdGet32 (PcdPeiCoreMaxPpiSupported));
+  PeiRemovePpiFromHash (PrivateData, Index);
   PrivateData->PpiData.PpiListPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  PeiAddPpiToHash (PrivateData, Index);
 
   //
   // Dispatch any callback level notifies for the newly installed PPI.
@@ -301,26 +414,37 @@ PeiLocatePpi (
 {
   PEI_CORE_INSTANCE   *PrivateData;
   INTN                Index;
+  UINT32              Key;
   EFI_GUID            *CheckGuid;
   EFI_PEI_PPI_DESCRIPTOR  *TempPtr;
 
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PrivateData->PpiData.Statistics.LocateCount++;
 
   //
-  // Search the data base for the matching instance of the GUIDed PPI.
+  // Search the hash chain of the GUID for the matching instance of the GUIDed PPI.
+  // The chain is in install order, and only the PPIs whose cached GUID key matches
+  // need their descriptor read.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiListEnd; Index++) {
+  Key = PEI_PPI_GUID_KEY (Guid);
+  for (Index = PrivateData->PpiData.PpiHashHead[PEI_PPI_HASH (Key)];
+       Index != PEI_PPI_HASH_END;
+       Index = PrivateData->PpiData.PpiHashNext[Index]) {
+    if (PrivateData->PpiData.PpiGuidKey[Index] != Key) {
+      continue;
+    }
+
     TempPtr = PrivateData->PpiData.PpiListPtrs[Index].Ppi;
     CheckGuid = TempPtr->Guid;
+    PrivateData->PpiData.Statistics.GuidCompareCount++;
 
     //
     // Don't use CompareGuid function here for performance reasons.
     // Instead we compare the GUID as INT32 at a time and branch
     // on the first failed comparison.
     //
-    if ((((INT32 *)Guid)[0] == ((INT32 *)CheckGuid)[0]) &&
-        (((INT32 *)Guid)[1] == ((INT32 *)CheckGuid)[1]) &&
+    if ((((INT32 *)Guid)[1] == ((INT32 *)CheckGuid)[1]) &&
         (((INT32 *)Guid)[2] == ((INT32 *)CheckGuid)[2]) &&
         (((INT32 *)Guid)[3] == ((INT32 *)CheckGuid)[3])) {
       if (Instance == 0) {
@@ -379,6 +503,7 @@ PeiNotifyPpi (
   }
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PrivateData->PpiData.Statistics.NotifyCount++;
 
   Index = PrivateData->PpiData.NotifyListEnd;
   LastCallbackNotify = Index;
@@ -549,6 +674,8 @@ DispatchNotify (
 {
   INTN                   Index1;
   INTN                   Index2;
+  INTN                   NextIndex;
+  UINT32                 Key;
   EFI_GUID                *SearchGuid;
   EFI_GUID                *CheckGuid;
   EFI_PEI_NOTIFY_DESCRIPTOR   *NotifyDescriptor;
@@ -560,22 +687,36 @@ DispatchNotify (
     NotifyDescriptor = PrivateData->PpiData.PpiListPtrs[Index1].Notify;
 
     CheckGuid = NotifyDescriptor->Guid;
+    Key       = PEI_PPI_GUID_KEY (CheckGuid);
+
+    //
+    // Only the installed PPIs on the hash chain of the notify GUID can match. The
+    // chain is in install order, so it can be cut at InstallStopIndex. The next link
+    // is read before the notification function runs, as it may reinstall the PPI.
+    //
+    for (Index2 = PrivateData->PpiData.PpiHashHead[PEI_PPI_HASH (Key)];
+         (Index2 != PEI_PPI_HASH_END) && (Index2 < InstallStopIndex);
+         Index2 = NextIndex) {
+      NextIndex = PrivateData->PpiData.PpiHashNext[Index2];
+      if ((Index2 < InstallStartIndex) || (PrivateData->PpiData.PpiGuidKey[Index2] != Key)) {
+        continue;
+      }
 
-    for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
       SearchGuid = PrivateData->PpiData.PpiListPtrs[Index2].Ppi->Guid;
+      PrivateData->PpiData.Statistics.GuidCompareCount++;
       //
       // Don't use CompareGuid function here for performance reasons.
       // Instead we compare the GUID as INT32 at a time and branch
       // on the first failed comparison.
       //
-      if ((((INT32 *)SearchGuid)[0] == ((INT32 *)CheckGuid)[0]) &&
-          (((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
+      if ((((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
           (((INT32 *)SearchGuid)[2] == ((INT32 *)CheckGuid)[2]) &&
           (((INT32 *)SearchGuid)[3] == ((INT32 *)CheckGuid)[3])) {
         DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
           SearchGuid,
           NotifyDescriptor->Notify
           ));
+        PrivateData->PpiData.Statistics.NotifyDispatchCount++;
         NotifyDescriptor->Notify (
                             (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
                             NotifyDescriptor,
@@ -586,3 +727,32 @@ DispatchNotify (
   }
 }
 
+
+/**
+
+  Report the PPI database statistics in a GUID HOB.
+
+  @param PrivateData        PeiCore's private data structure
+
+**/
+VOID
+PeiReportPpiStatistics (
+  IN PEI_CORE_INSTANCE  *PrivateData
+  )
+{
+  PEI_PPI_STATISTICS    *Statistics;
+
+  Statistics = &PrivateData->PpiData.Statistics;
+  DEBUG ((
+    EFI_D_INFO,
+    "PPI database: %d installs, %d reinstalls, %d locates, %d notifies, %d notify calls, %d GUID compares\n",
+    Statistics->InstallCount,
+    Statistics->ReInstallCount,
+    Statistics->LocateCount,
+    Statistics->NotifyCount,
+    Statistics->NotifyDispatchCount,
+    Statistics->GuidCompareCount
+    ));
+
+  BuildGuidDataHob (&gPeiPpiStatisticsHobGuid, Statistics, sizeof (PEI_PPI_STATISTICS));
+}
@@ -21,7 +21,12 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <Uefi.h>
 
-UINT32  mCrcTable[256];
+//
+// mCrcTable[0] is the byte-wise CRC32 table. mCrcTable[N][Byte] is the CRC
+// contribution of Byte followed by N zero bytes, so that 8 bytes can be folded
+// per step (slice-by-8).
+//
+UINT32  mCrcTable[8][256];
 
 /**
   Calculate CRC32 for target data.
@@ -44,7 +49,8 @@ RuntimeDriverCalculateCrc32 (
   )
 {
   UINT32  Crc;
-  UINTN   Index;
+  UINT32  Low;
+  UINT32  High;
   UINT8   *Ptr;
 
   if (Data == NULL || DataSize == 0 || CrcOut == NULL) {
@@ -52,8 +58,30 @@ RuntimeDriverCalculateCrc32 (
   }
 
   Crc = 0xffffffff;
-  for (Index = 0, Ptr = Data; Index < DataSize; Index++, Ptr++) {
-    Crc = (Crc >> 8) ^ mCrcTable[(UINT8) Crc ^ *Ptr];
+  Ptr = Data;
+
+  //
+  // Go byte by byte up to a 32-bit boundary, then fold 8 bytes per step.
+  //
+  for (; DataSize > 0 && ((UINTN) Ptr & 3) != 0; DataSize--, Ptr++) {
+    Crc = (Crc >> 8) ^ mCrcTable[0][(UINT8) Crc ^ *Ptr];
+  }
+
+  for (; DataSize >= 8; DataSize -= 8, Ptr += 8) {
+    Low  = Crc ^ *(UINT32 *) Ptr;
+    High = *(UINT32 *) (Ptr + 4);
+    Crc  = mCrcTable[7][Low & 0xff] ^
+           mCrcTable[6][(Low >> 8) & 0xff] ^
+           mCrcTable[5][(Low >> 16) & 0xff] ^
+           mCrcTable[4][Low >> 24] ^
+           mCrcTable[3][High & 0xff] ^
+           mCrcTable[2][(High >> 8) & 0xff] ^
+           mCrcTable[1][(High >> 16) & 0xff] ^
+           mCrcTable[0][High >> 24];
+  }
+
+  for (; DataSize > 0; DataSize--, Ptr++) {
+    Crc = (Crc >> 8) ^ mCrcTable[0][(UINT8) Crc ^ *Ptr];
   }
 
   *CrcOut = Crc ^ 0xffffffff;
@@ -98,6 +126,7 @@ RuntimeDriverInitializeCrc32Table (
 {
   UINTN   TableEntry;
   UINTN   Index;
+  UINTN   Slice;
   UINT32  Value;
 
   for (TableEntry = 0; TableEntry < 256; TableEntry++) {
@@ -110,6 +139,14 @@ RuntimeDriverInitializeCrc32Table (
       }
     }
 
-    mCrcTable[TableEntry] = ReverseBits (Value);
+    mCrcTable[0][TableEntry] = ReverseBits (Value);
+  }
+
+  for (TableEntry = 0; TableEntry < 256; TableEntry++) {
+    Value = mCrcTable[0][TableEntry];
+    for (Slice = 1; Slice < 8; Slice++) {
+      Value = (Value >> 8) ^ mCrcTable[0][Value & 0xff];
+      mCrcTable[Slice][TableEntry] = Value;
+    }
   }
 }
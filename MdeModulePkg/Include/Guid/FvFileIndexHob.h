@@ -0,0 +1,69 @@
+/** @file
+  Hob guid and data structure for the index of the files in a firmware volume.
+
+  The PEI Core builds one such HOB for every PI 1.0 firmware volume it dispatches
+  from, so that file lookups in PEI and the DXE Core firmware volume driver do not
+  need to walk the FFS file headers again. Volumes holding a file whose header
+  checksum is wrong are not indexed, and large volumes are only indexed once permanent memory is
+  installed.
+
+  Copyright (c) 2009, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _FV_FILE_INDEX_HOB_GUID_H_
+#define _FV_FILE_INDEX_HOB_GUID_H_
+
+#define FV_FILE_INDEX_HOB_GUID \
+  { \
+    0xBE7D2A38, 0xDF98, 0x43FD, { 0x99, 0x33, 0xEA, 0x04, 0x87, 0x0C, 0x47, 0x18 } \
+  }
+
+///
+/// A valid (EFI_FILE_DATA_VALID or EFI_FILE_MARKED_FOR_UPDATE) file of the
+/// firmware volume, including pad files.
+///
+typedef struct {
+  EFI_GUID                Name;
+  ///
+  /// Offset of the FFS file header from the start of the firmware volume.
+  ///
+  UINT32                  Offset;
+  EFI_FV_FILETYPE         Type;
+  UINT8                   Reserved[3];
+} FV_FILE_INDEX_ENTRY;
+
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    FvBase;
+  UINT64                  FvLength;
+  UINT32                  FileCount;
+  ///
+  /// TRUE if the walk of the file headers ended at the end of the firmware
+  /// volume or in its free space, FALSE if it stopped at a file header that is
+  /// not valid, such as a file under construction.
+  ///
+  BOOLEAN                 Complete;
+  UINT8                   Reserved[3];
+  ///
+  /// Bit N is set if the firmware volume holds a file of type N.
+  ///
+  UINT32                  TypeBitmap[256 / 32];
+  ///
+  /// FileCount entries, in the order the files are in the firmware volume.
+  ///
+  FV_FILE_INDEX_ENTRY     Entry[1];
+} FV_FILE_INDEX;
+
+#define FV_FILE_INDEX_HAS_TYPE(Index, Type) \
+  (((Index)->TypeBitmap[(UINT8) (Type) >> 5] & ((UINT32) 1 << ((Type) & 0x1F))) != 0)
+
+extern EFI_GUID gFvFileIndexHobGuid;
+
+#endif
@@ -0,0 +1,55 @@
+/** @file
+  Hob guid and data structure for the PPI database statistics of the PEI Core.
+
+  The PEI Core builds this HOB at the end of PEI, when performance measurement is
+  enabled, to report how often the PPI services were called and how many PPI GUIDs
+  had to be compared to serve them.
+
+  Copyright (c) 2009, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _PEI_PPI_STATISTICS_HOB_GUID_H_
+#define _PEI_PPI_STATISTICS_HOB_GUID_H_
+
+#define PEI_PPI_STATISTICS_HOB_GUID \
+  { \
+    0xE12FA063, 0x6E7C, 0x400D, { 0xBA, 0xC6, 0xD0, 0xAB, 0x02, 0x86, 0xEF, 0x40 } \
+  }
+
+typedef struct {
+  ///
+  /// Number of InstallPpi, ReInstallPpi, LocatePpi and NotifyPpi calls.
+  ///
+  UINT32                  InstallCount;
+  UINT32                  ReInstallCount;
+  UINT32                  LocateCount;
+  UINT32                  NotifyCount;
+  ///
+  /// Number of notification functions called.
+  ///
+  UINT32                  NotifyDispatchCount;
+  ///
+  /// Number of full GUID comparisons against installed PPIs.
+  ///
+  UINT32                  GuidCompareCount;
+  ///
+  /// Largest number of PPIs installed at the same time.
+  ///
+  UINT32                  MaxPpiCount;
+  ///
+  /// Longest chain of PPIs sharing a bucket of the PPI GUID hash.
+  ///
+  UINT32                  MaxHashChainLength;
+} PEI_PPI_STATISTICS;
+
+extern EFI_GUID gPeiPpiStatisticsHobGuid;
+
+#endif
@@ -0,0 +1,72 @@
+/** @file
+  Hob guid and data structure for the index of the non-volatile variable store.
+
+  The PEI variable driver builds this HOB the first time a variable is read in
+  PEI, so that later lookups binary search it instead of walking the store, and
+  the DXE variable driver can set up its own index without walking it again.
+
+  Copyright (c) 2009, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _VARIABLE_INDEX_HOB_GUID_H_
+#define _VARIABLE_INDEX_HOB_GUID_H_
+
+#define VARIABLE_INDEX_HOB_GUID \
+  { \
+    0x36A5440C, 0x8D51, 0x4B05, { 0xB0, 0xC3, 0x0D, 0xEF, 0xD3, 0xDB, 0x0F, 0x37 } \
+  }
+
+///
+/// A VAR_ADDED or VAR_IN_DELETED_TRANSITION variable of the store.
+///
+typedef struct {
+  ///
+  /// The hash of the variable starts as the first UINT32 of its vendor GUID.
+  /// For every CHAR16 of its name, it is multiplied by 31 and the CHAR16 is added.
+  ///
+  UINT32                  Hash;
+  ///
+  /// Offset of the variable header from the variable store header.
+  ///
+  UINT32                  Offset;
+} VARIABLE_INDEX_HOB_ENTRY;
+
+typedef struct {
+  ///
+  /// Address of the variable store header.
+  ///
+  EFI_PHYSICAL_ADDRESS      StoreBase;
+  ///
+  /// Offset of the free space of the store from the variable store header.
+  ///
+  UINT32                    LastVariableOffset;
+  ///
+  /// Space used by all variables of the store, deleted ones included, as the
+  /// DXE variable driver accounts it.
+  ///
+  UINT32                    CommonVariableTotalSize;
+  UINT32                    HwErrVariableTotalSize;
+  UINT32                    EntryCount;
+  ///
+  /// FALSE if the store has more variables than the HOB can hold. EntryCount
+  /// is then 0.
+  ///
+  BOOLEAN                   Complete;
+  UINT8                     Reserved[7];
+  ///
+  /// EntryCount entries, sorted by Hash and then by Offset.
+  ///
+  VARIABLE_INDEX_HOB_ENTRY  Entry[1];
+} VARIABLE_INDEX_HOB;
+
+extern EFI_GUID gVariableIndexHobGuid;
+
+#endif
@@ -0,0 +1,79 @@
+/** @file
+  Configuration table guid and data structure for the write statistics of the
+  non-volatile variable store.
+
+  The variable driver installs this table when PcdVariableCollectStatistics is
+  TRUE. It records how many bytes SetVariable() and the batched variable updates
+  programmed into the store, how long each reclaim of the store took and how
+  many times each block of the store has been rewritten, so that VariableInfo.efi
+  can report them. Only writes done during boot services are counted.
+
+  Copyright (c) 2012, Intel Corporation
+  All rights reserved. This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef _VARIABLE_STORE_STATISTICS_GUID_H_
+#define _VARIABLE_STORE_STATISTICS_GUID_H_
+
+#define VARIABLE_STORE_STATISTICS_GUID \
+  { \
+    0xDE4B5F7F, 0x868C, 0x4E9B, { 0x98, 0x41, 0x8D, 0x6C, 0xBA, 0x94, 0x77, 0x85 } \
+  }
+
+///
+/// Bucket N of the latency histogram counts the reclaims that took less than
+/// 2^N milliseconds and at least 2^(N-1). The last bucket also counts all the
+/// slower ones.
+///
+#define VARIABLE_RECLAIM_LATENCY_BUCKETS  12
+
+typedef struct {
+  ///
+  /// Non-volatile variables written or deleted one at a time by SetVariable(),
+  /// and the bytes programmed into the store to do so.
+  ///
+  UINT32    VariableWriteCount;
+  UINT64    VariableBytesWritten;
+  ///
+  /// Batches committed through the variable batch protocol, the variables they
+  /// held and the bytes written to the store by their Fault Tolerant Writes.
+  ///
+  UINT32    BatchCount;
+  UINT32    BatchVariableCount;
+  UINT64    BatchBytesWritten;
+  ///
+  /// Reclaims of the store and the bytes written by their Fault Tolerant Writes.
+  ///
+  UINT32    ReclaimCount;
+  UINT64    ReclaimBytesWritten;
+  UINT32    MaxLatency;
+  UINT32    LatencyHistogram[VARIABLE_RECLAIM_LATENCY_BUCKETS];
+  ///
+  /// Number of blocks rewritten and number of blocks left untouched, over all
+  /// the Fault Tolerant Writes of the store.
+  ///
+  UINT32    BlocksWritten;
+  UINT32    BlocksSkipped;
+  ///
+  /// Size of the blocks holding the store and number of them. Block 0 is the
+  /// block of the firmware volume holding the start of the store.
+  ///
+  UINT32    BlockSize;
+  UINT32    BlockCount;
+  ///
+  /// BlockCount entries, the number of times each block has been erased by a
+  /// Fault Tolerant Write of the store since the platform was reset.
+  ///
+  UINT32    EraseCount[1];
+} VARIABLE_STORE_STATISTICS;
+
+extern EFI_GUID gVariableStoreStatisticsGuid;
+
+#endif
@@ -872,7 +872,8 @@ typedef enum {
   NET_PROTO_DATA       = 64,   // Opaque buffer for protocols
   NET_BUF_HEAD         = 1,    // Trim or allocate space from head
   NET_BUF_TAIL         = 0,    // Trim or allocate space from tail
-  NET_VECTOR_OWN_FIRST = 0x01  // We allocated the 1st block in the vector
+  NET_VECTOR_OWN_FIRST = 0x01, // We allocated the 1st block in the vector
+  NET_VECTOR_CACHED_BLOCK = 0x02 // The only block is from the block cache
 } NET_SIGNATURE_TYPE;
 
 #define NET_CHECK_SIGNATURE(PData, SIGNATURE) \
@@ -901,7 +902,7 @@ typedef struct {
   INTN                RefCnt;  // Reference count to share NET_VECTOR.
   NET_VECTOR_EXT_FREE Free;    // external function to free NET_VECTOR
   VOID                *Arg;    // opeque argument to Free
-  UINT32              Flag;    // Flags, NET_VECTOR_OWN_FIRST
+  UINT32              Flag;    // Flags, NET_VECTOR_OWN_FIRST or NET_VECTOR_CACHED_BLOCK
   UINT32              Len;     // Total length of the assocated BLOCKs
 
   UINT32              BlockNum;
@@ -998,6 +999,28 @@ typedef struct {
 #define NET_BUF_SIZE(BlockOpNum)  \
   (sizeof (NET_BUF) + ((BlockOpNum) - 1) * sizeof (NET_BLOCK_OP))
 
+//
+// Counters of one of the object caches used by the net buffer functions.
+//
+typedef struct {
+  UINT64              Allocated;  // Objects allocated
+  UINT64              CacheHits;  // Allocations served from the cache
+  UINT64              Freed;      // Objects freed
+  UINT32              Cached;     // Objects held by the cache
+  UINT32              Reserved;
+} NET_BUF_CACHE_COUNTER;
+
+//
+// The net buffer functions keep the freed NET_BUF and NET_VECTOR structures
+// and MTU-sized data blocks for reuse. Each driver links its own copy of the
+// library, so these are the statistics of the calling driver.
+//
+typedef struct {
+  NET_BUF_CACHE_COUNTER Buf;      // NET_BUF structures
+  NET_BUF_CACHE_COUNTER Vector;   // NET_VECTOR structures
+  NET_BUF_CACHE_COUNTER Block;    // Data blocks of NetbufAlloc
+} NET_BUF_CACHE_STATISTICS;
+
 #define NET_HEADSPACE(BlockOp)  \
   (UINTN)((BlockOp)->Head - (BlockOp)->BlockHead)
 
@@ -1038,6 +1061,33 @@ NetbufFree (
   IN NET_BUF                *Nbuf
   );
 
+/**
+  Release the NET_BUF, NET_VECTOR and data block objects cached by the net
+  buffer functions of the calling driver to the pool.
+
+  The caches are refilled by the following allocations, so this is meant for a
+  driver that stops its network service or runs short of memory.
+
+**/
+VOID
+EFIAPI
+NetbufFlushCache (
+  VOID
+  );
+
+/**
+  Get the counters of the NET_BUF, NET_VECTOR and data block caches used by the
+  net buffer functions of the calling driver.
+
+  @param[out]  Statistics    The counters of the caches.
+
+**/
+VOID
+EFIAPI
+NetbufGetCacheStatistics (
+  OUT NET_BUF_CACHE_STATISTICS  *Statistics
+  );
+
 /**
   Get the index of NET_BLOCK_OP that contains the byte at Offset in the net 
   buffer. 
@@ -1,6 +1,10 @@
 /** @file
+  This library provides the memory management routines shared by the USB
+  host controller drivers. The memory is allocated and mapped through the
+  PCI I/O protocol as common buffer, then handed out in USBHC_MEM_UNIT
+  granularity by a buddy allocator.
 
-  This file contains the definination for host controller memory management routines.
+  This library is only intended to be used by USB host controller drivers.
 
 Copyright (c) 2007 - 2009, Intel Corporation
 All rights reserved. This program and the accompanying materials
@@ -13,24 +17,53 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 **/
 
-#ifndef _EFI_EHCI_MEM_H_
-#define _EFI_EHCI_MEM_H_
+#ifndef _USB_HC_MEM_LIB_H_
+#define _USB_HC_MEM_LIB_H_
 
-#define USB_HC_BIT(a)                  ((UINTN)(1 << (a)))
-
-#define USB_HC_BIT_IS_SET(Data, Bit)   \
-          ((BOOLEAN)(((Data) & USB_HC_BIT(Bit)) == USB_HC_BIT(Bit)))
+#include <Protocol/PciIo.h>
 
 #define USB_HC_HIGH_32BIT(Addr64)    \
           ((UINT32)(RShiftU64((UINTN)(Addr64), 32) & 0XFFFFFFFF))
 
+typedef enum {
+  USBHC_MEM_UNIT           = 64,     // Memory allocation unit, must be 2^n, n>4
+
+  USBHC_MEM_UNIT_MASK      = USBHC_MEM_UNIT - 1,
+  USBHC_MEM_DEFAULT_PAGES  = 16,     // Default block size, must be 2^n
+
+  //
+  // A block holds at most 2^USBHC_MEM_MAX_ORDER units, that is 64MB.
+  //
+  USBHC_MEM_MAX_ORDER      = 20
+} USBHC_MEM_UNIT_DATA;
+
+#define USBHC_MEM_ROUND(Len)  (((Len) + USBHC_MEM_UNIT_MASK) & (~USBHC_MEM_UNIT_MASK))
+
+//
+// Each unit that starts a chunk records the chunk's order in the
+// block's Order array, with USBHC_MEM_FREE set if the chunk is on
+// a free list. USBHC_MEM_NIL terminates the free lists.
+//
+#define USBHC_MEM_FREE        0x80
+#define USBHC_MEM_NIL         0xFFFFFFFF
+
+//
+// USBHC_MEM_BLOCK is a power-of-two number of units managed as a
+// buddy system: a free chunk of 2^n units is kept on FreeHead[n],
+// and bit n of FreeMask is set if that list isn't empty. Both the
+// allocation and the release are bounded by MaxOrder steps.
+//
 typedef struct _USBHC_MEM_BLOCK {
-  UINT8                   *Bits;    // Bit array to record which unit is allocated
-  UINTN                   BitsLen;
   UINT8                   *Buf;
   UINT8                   *BufHost;
   UINTN                   BufLen;   // Memory size in bytes
   VOID                    *Mapping;
+  UINTN                   MaxOrder; // The block holds 2^MaxOrder units
+  UINT32                  FreeMask;
+  UINT32                  FreeHead[USBHC_MEM_MAX_ORDER + 1];
+  UINT8                   *Order;   // Per unit chunk order and free flag
+  UINT32                  *FreeNext;
+  UINT32                  *FreePrev;
   struct _USBHC_MEM_BLOCK *Next;
 } USBHC_MEM_BLOCK;
 
@@ -46,42 +79,20 @@ typedef struct _USBHC_MEM_POOL {
   USBHC_MEM_BLOCK         *Head;
 } USBHC_MEM_POOL;
 
-typedef enum {
-  USBHC_MEM_UNIT           = 64,     // Memory allocation unit, must be 2^n, n>4
-
-  USBHC_MEM_UNIT_MASK      = USBHC_MEM_UNIT - 1,
-  USBHC_MEM_DEFAULT_PAGES  = 16
-} USBHC_MEM_UNIT_DATA;
-
-#define USBHC_MEM_ROUND(Len)  (((Len) + USBHC_MEM_UNIT_MASK) & (~USBHC_MEM_UNIT_MASK))
-
-//
-// Advance the byte and bit to the next bit, adjust byte accordingly.
-//
-#define NEXT_BIT(Byte, Bit)   \
-          do {                \
-            (Bit)++;          \
-            if ((Bit) > 7) {  \
-              (Byte)++;       \
-              (Bit) = 0;      \
-            }                 \
-          } while (0)
-
-
 
 /**
   Initialize the memory management pool for the host controller.
 
-  @param  PciIo               The PciIo that can be used to access the host controller.
-  @param  Check4G             Whether the host controller requires allocated memory
-                              from one 4G address space.
-  @param  Which4G             The 4G memory area each memory allocated should be from.
+  @param  PciIo                The PciIo that can be used to access the host controller.
+  @param  Check4G              Whether the host controller requires allocated memory
+                               from one 4G address space.
+  @param  Which4G              The 4G memory area each memory allocated should be from.
 
-  @retval EFI_SUCCESS         The memory pool is initialized.
-  @retval EFI_OUT_OF_RESOURCE Fail to init the memory pool.
+  @return The initialized memory pool or NULL if failed.
 
 **/
 USBHC_MEM_POOL *
+EFIAPI
 UsbHcInitMemPool (
   IN EFI_PCI_IO_PROTOCOL  *PciIo,
   IN BOOLEAN              Check4G,
@@ -92,13 +103,14 @@ UsbHcInitMemPool (
 /**
   Release the memory management pool.
 
-  @param   Pool               The USB memory pool to free.
+  @param  Pool              The USB memory pool to free.
 
   @retval EFI_SUCCESS       The memory pool is freed.
   @retval EFI_DEVICE_ERROR  Failed to free the memory pool.
 
 **/
 EFI_STATUS
+EFIAPI
 UsbHcFreeMemPool (
   IN USBHC_MEM_POOL       *Pool
   );
@@ -108,13 +120,14 @@ UsbHcFreeMemPool (
   Allocate some memory from the host controller's memory pool
   which can be used to communicate with host controller.
 
-  @param  Pool  The host controller's memory pool.
-  @param  Size  Size of the memory to allocate.
+  @param  Pool           The host controller's memory pool.
+  @param  Size           Size of the memory to allocate.
 
   @return The allocated memory or NULL.
 
 **/
 VOID *
+EFIAPI
 UsbHcAllocateMem (
   IN  USBHC_MEM_POOL      *Pool,
   IN  UINTN               Size
@@ -124,15 +137,17 @@ UsbHcAllocateMem (
 /**
   Free the allocated memory back to the memory pool.
 
-  @param  Pool  The memory pool of the host controller.
-  @param  Mem   The memory to free.
-  @param  Size  The size of the memory to free.
+  @param  Pool           The memory pool of the host controller.
+  @param  Mem            The memory to free.
+  @param  Size           The size of the memory to free.
 
 **/
 VOID
+EFIAPI
 UsbHcFreeMem (
   IN USBHC_MEM_POOL       *Pool,
   IN VOID                 *Mem,
   IN UINTN                Size
   );
+
 #endif
@@ -0,0 +1,98 @@
+/** @file
+  Fault Tolerant Write Batch Protocol
+
+  Writes a group of updates of blocks with Fault Tolerant Write. Consecutive
+  updates that fall in the same spare-sized range of the target share one write
+  record and one spare block cycle, and the content of the spare block is saved
+  and restored once for the whole group instead of once per update. Each update
+  is durable when the function returns, as with the Write() service of the
+  Fault Tolerant Write Protocol.
+
+  The protocol is installed on the handle of the Fault Tolerant Write Protocol.
+  Its users must fall back to that protocol when it is not installed.
+
+Copyright (c) 2012, Intel Corporation
+All rights reserved. This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __FAULT_TOLERANT_WRITE_BATCH_H__
+#define __FAULT_TOLERANT_WRITE_BATCH_H__
+
+#define EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL_GUID \
+  { \
+    0x9043C6A2, 0xBF4A, 0x49FA, { 0x98, 0x09, 0x4B, 0x5A, 0x32, 0xCF, 0x7A, 0xB8 } \
+  }
+
+//
+// Forward reference for pure ANSI compatability
+//
+typedef struct _EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL;
+
+///
+/// One update of the batch. The fields have the meaning of the parameters of
+/// the Write() service of the Fault Tolerant Write Protocol.
+///
+typedef struct {
+  EFI_LBA     Lba;
+  UINTN       Offset;
+  UINTN       Length;
+  VOID        *Buffer;
+} EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY;
+
+/**
+  Writes a group of block updates in a fault tolerant manner.
+
+  The updates are applied in the order of the array. An update is merged with the
+  ones before it when it starts at or after their Lba and ends within the spare
+  area size of it, so callers should sort the updates by their target.
+
+  @param  This                   Protocol instance pointer.
+  @param  CallerId               The GUID identifying the writes.
+  @param  FvBlockHandle          The handle of FVB protocol that provides services
+                                 for reading, writing, and erasing the target blocks.
+  @param  EntryCount             Number of entries in Entries.
+  @param  Entries                The block updates.
+
+  @retval EFI_SUCCESS            All the updates were written.
+  @retval EFI_INVALID_PARAMETER  CallerId or Entries is NULL, or EntryCount is 0.
+  @retval EFI_BAD_BUFFER_SIZE    The data of an update can't fit within the spare block.
+  @retval EFI_BUFFER_TOO_SMALL   The work space can't hold a write record for each
+                                 group of merged updates.
+  @retval EFI_ACCESS_DENIED      A previous fault tolerant write has not completed.
+  @retval EFI_NOT_FOUND          Cannot find FVB protocol by handle.
+  @retval EFI_OUT_OF_RESOURCES   Cannot allocate enough memory resource.
+  @retval EFI_ABORTED            The writes could not complete successfully. The
+                                 pending write can be completed or aborted through
+                                 the Fault Tolerant Write Protocol.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_FAULT_TOLERANT_WRITE_BATCH_WRITE)(
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This,
+  IN EFI_GUID                                 *CallerId,
+  IN EFI_HANDLE                               FvBlockHandle,
+  IN UINTN                                    EntryCount,
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY     *Entries
+  );
+
+///
+/// Fault Tolerant Write Batch Protocol structure
+///
+struct _EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL {
+  EFI_FAULT_TOLERANT_WRITE_BATCH_WRITE  Write;
+};
+
+///
+/// Fault Tolerant Write Batch Protocol GUID variable
+///
+extern EFI_GUID gEfiFaultTolerantWriteBatchProtocolGuid;
+
+#endif
@@ -0,0 +1,94 @@
+/** @file
+  Variable Batch Protocol
+
+  Commits a group of updates of non-volatile variables as a whole. The variable
+  driver applies the updates to an image of the variable store and writes the
+  image with a single Fault Tolerant Write, so that after a reset either all or
+  none of the updates are visible. Updating BootOrder together with the Boot####
+  variables it references is the typical use.
+
+  The protocol is a boot services protocol. Its users must fall back to
+  SetVariable() when it is not installed.
+
+Copyright (c) 2012, Intel Corporation
+All rights reserved. This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#ifndef __VARIABLE_BATCH_H__
+#define __VARIABLE_BATCH_H__
+
+#define EFI_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0x16690635, 0x0A48, 0x46C3, { 0xA2, 0x55, 0x83, 0x20, 0xA3, 0x35, 0x43, 0xD4 } \
+  }
+
+//
+// Forward reference for pure ANSI compatability
+//
+typedef struct _EFI_VARIABLE_BATCH_PROTOCOL  EFI_VARIABLE_BATCH_PROTOCOL;
+
+///
+/// One update of the batch. The fields have the meaning of the parameters of
+/// SetVariable(): a DataSize of 0, or Attributes without access bits, delete
+/// the variable.
+///
+typedef struct {
+  CHAR16      *VariableName;
+  EFI_GUID    *VendorGuid;
+  UINT32      Attributes;
+  UINTN       DataSize;
+  VOID        *Data;
+} EFI_VARIABLE_BATCH_ENTRY;
+
+/**
+  Sets a group of non-volatile variables in one atomic update of the variable store.
+
+  The updates are applied in the order of the array, so a later entry for the
+  same variable overrides an earlier one.
+
+  @param  This                   Protocol instance pointer.
+  @param  EntryCount             Number of entries in Entries.
+  @param  Entries                The variable updates.
+
+  @retval EFI_SUCCESS            All the updates were committed.
+  @retval EFI_INVALID_PARAMETER  EntryCount is 0 or Entries is NULL.
+  @retval EFI_INVALID_PARAMETER  An entry is not a valid SetVariable() request, is
+                                 not for a non-volatile variable, is a hardware error
+                                 record, or names a variable that exists as a
+                                 volatile variable.
+  @retval EFI_UNSUPPORTED        An entry sets L"Lang" or L"PlatformLang", whose
+                                 updates have side effects that SetVariable() handles.
+  @retval EFI_NOT_FOUND          An entry deletes a variable that does not exist.
+  @retval EFI_OUT_OF_RESOURCES   The variable store cannot hold all the updates.
+  @retval Others                 The Fault Tolerant Write of the store failed. None
+                                 of the updates were committed.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EFI_VARIABLE_BATCH_SET_VARIABLES)(
+  IN EFI_VARIABLE_BATCH_PROTOCOL  *This,
+  IN UINTN                        EntryCount,
+  IN EFI_VARIABLE_BATCH_ENTRY     *Entries
+  );
+
+///
+/// Variable Batch Protocol structure
+///
+struct _EFI_VARIABLE_BATCH_PROTOCOL {
+  EFI_VARIABLE_BATCH_SET_VARIABLES  SetVariables;
+};
+
+///
+/// Variable Batch Protocol GUID variable
+///
+extern EFI_GUID gEfiVariableBatchProtocolGuid;
+
+#endif
@@ -21,6 +21,255 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/MemoryAllocationLib.h>
 
 
+//
+// Fixed size object caches for the net buffer structures and the MTU-sized
+// data blocks, so that the per-packet allocations don't go to the pool. Every
+// network driver links its own copy of this library, so each layer has its own
+// caches and counters. A NET_BUF never leaves the driver that allocated it: the
+// layers pass packets through their protocols and wrap them with NetbufFromExt,
+// whose free function hands the data back to its owner.
+//
+// NET_BUFs with up to NET_BUF_CACHE_BLOCK_OP block operations and NET_VECTORs
+// with up to NET_VECTOR_CACHE_BLOCK blocks are always allocated with the size
+// of the cache objects, so they can be returned to the cache when freed. Data
+// blocks are taken from the cache only for lengths above half the block size.
+//
+#define NET_BUF_CACHE_BLOCK_OP    2
+#define NET_VECTOR_CACHE_BLOCK    2
+#define NET_BLOCK_CACHE_SIZE      2048
+#define NET_CACHE_DEPTH           64
+
+typedef struct _NET_CACHE_ENTRY {
+  struct _NET_CACHE_ENTRY   *Next;
+} NET_CACHE_ENTRY;
+
+typedef struct {
+  NET_CACHE_ENTRY           *Free;        // Free objects
+  UINTN                     ObjectSize;   // Size of each object
+  NET_BUF_CACHE_COUNTER     *Counter;
+} NET_CACHE;
+
+NET_BUF_CACHE_STATISTICS    mNetbufCacheStatistics;
+
+NET_CACHE mNetbufCache  = { NULL, NET_BUF_SIZE (NET_BUF_CACHE_BLOCK_OP), &mNetbufCacheStatistics.Buf };
+NET_CACHE mVectorCache  = { NULL, NET_VECTOR_SIZE (NET_VECTOR_CACHE_BLOCK), &mNetbufCacheStatistics.Vector };
+NET_CACHE mBlockCache   = { NULL, NET_BLOCK_CACHE_SIZE, &mNetbufCacheStatistics.Block };
+
+
+/**
+  Allocate Size bytes of memory, from the cache if the objects of the cache are
+  large enough.
+
+  @param[in]  Cache          The cache to allocate from.
+  @param[in]  Size           The number of bytes to allocate.
+
+  @return                    Pointer to the memory, or NULL if the allocation
+                             failed due to resource limit.
+
+**/
+VOID *
+NetCacheAllocate (
+  IN NET_CACHE              *Cache,
+  IN UINTN                  Size
+  )
+{
+  NET_CACHE_ENTRY           *Entry;
+  EFI_TPL                   OldTpl;
+
+  if (Size > Cache->ObjectSize) {
+    return AllocatePool (Size);
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Entry  = Cache->Free;
+
+  if (Entry != NULL) {
+    Cache->Free = Entry->Next;
+    Cache->Counter->Cached--;
+    Cache->Counter->CacheHits++;
+    Cache->Counter->Allocated++;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+
+  if (Entry == NULL) {
+    Entry = AllocatePool (Cache->ObjectSize);
+
+    if (Entry == NULL) {
+      return NULL;
+    }
+
+    OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+    Cache->Counter->Allocated++;
+    gBS->RestoreTPL (OldTpl);
+  }
+
+  return Entry;
+}
+
+
+/**
+  Free memory allocated by NetCacheAllocate. The memory is kept in the cache
+  unless the cache is full.
+
+  @param[in]  Cache          The cache the memory was allocated from.
+  @param[in]  Object         The memory to free.
+  @param[in]  Size           The number of bytes passed to NetCacheAllocate.
+
+**/
+VOID
+NetCacheFree (
+  IN NET_CACHE              *Cache,
+  IN VOID                   *Object,
+  IN UINTN                  Size
+  )
+{
+  NET_CACHE_ENTRY           *Entry;
+  EFI_TPL                   OldTpl;
+
+  if (Size > Cache->ObjectSize) {
+    FreePool (Object);
+    return;
+  }
+
+  Entry  = (NET_CACHE_ENTRY *) Object;
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Cache->Counter->Freed++;
+
+  if (Cache->Counter->Cached < NET_CACHE_DEPTH) {
+    Entry->Next = Cache->Free;
+    Cache->Free = Entry;
+    Cache->Counter->Cached++;
+    Entry       = NULL;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+
+  if (Entry != NULL) {
+    FreePool (Entry);
+  }
+}
+
+
+/**
+  Release all the objects held in a cache to the pool.
+
+  @param[in]  Cache          The cache to empty.
+
+**/
+VOID
+NetCacheFlush (
+  IN NET_CACHE              *Cache
+  )
+{
+  NET_CACHE_ENTRY           *Entry;
+  NET_CACHE_ENTRY           *Next;
+  EFI_TPL                   OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Entry  = Cache->Free;
+  Cache->Free = NULL;
+  Cache->Counter->Cached = 0;
+  gBS->RestoreTPL (OldTpl);
+
+  while (Entry != NULL) {
+    Next = Entry->Next;
+    FreePool (Entry);
+    Entry = Next;
+  }
+}
+
+
+/**
+  Release the NET_BUF, NET_VECTOR and data block objects cached by the net
+  buffer functions of the calling driver to the pool.
+
+  The caches are refilled by the following allocations, so this is meant for a
+  driver that stops its network service or runs short of memory.
+
+**/
+VOID
+EFIAPI
+NetbufFlushCache (
+  VOID
+  )
+{
+  NetCacheFlush (&mNetbufCache);
+  NetCacheFlush (&mVectorCache);
+  NetCacheFlush (&mBlockCache);
+}
+
+
+/**
+  Get the counters of the NET_BUF, NET_VECTOR and data block caches used by the
+  net buffer functions of the calling driver.
+
+  @param[out]  Statistics    The counters of the caches.
+
+**/
+VOID
+EFIAPI
+NetbufGetCacheStatistics (
+  OUT NET_BUF_CACHE_STATISTICS  *Statistics
+  )
+{
+  EFI_TPL                   OldTpl;
+
+  ASSERT (Statistics != NULL);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  CopyMem (Statistics, &mNetbufCacheStatistics, sizeof (NET_BUF_CACHE_STATISTICS));
+  gBS->RestoreTPL (OldTpl);
+}
+
+
+/**
+  Release the cached net buffer objects when the driver is unloaded.
+
+  @param[in]  ImageHandle    The firmware allocated handle for the EFI image.
+  @param[in]  SystemTable    A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS        Always returns EFI_SUCCESS.
+
+**/
+EFI_STATUS
+EFIAPI
+NetbufCacheDestructor (
+  IN EFI_HANDLE             ImageHandle,
+  IN EFI_SYSTEM_TABLE       *SystemTable
+  )
+{
+  DEBUG ((
+    EFI_D_NET,
+    "NetLib: NET_BUF %ld/%ld, NET_VECTOR %ld/%ld, block %ld/%ld cache hits/allocations\n",
+    mNetbufCacheStatistics.Buf.CacheHits,
+    mNetbufCacheStatistics.Buf.Allocated,
+    mNetbufCacheStatistics.Vector.CacheHits,
+    mNetbufCacheStatistics.Vector.Allocated,
+    mNetbufCacheStatistics.Block.CacheHits,
+    mNetbufCacheStatistics.Block.Allocated
+    ));
+
+  NetbufFlushCache ();
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Free a NET_BUF structure, which has no vector or whose vector has been freed.
+
+  @param[in]  Nbuf           Pointer to the NET_BUF structure to free.
+
+**/
+VOID
+NetbufFreeStruct (
+  IN NET_BUF                *Nbuf
+  )
+{
+  NetCacheFree (&mNetbufCache, Nbuf, NET_BUF_SIZE (Nbuf->BlockOpNum));
+}
+
+
 /**
   Allocate and build up the sketch for a NET_BUF. 
    
@@ -49,24 +298,26 @@ NetbufAllocStruct (
   //
   // Allocate three memory blocks.
   //
-  Nbuf = AllocateZeroPool (NET_BUF_SIZE (BlockOpNum));
+  Nbuf = NetCacheAllocate (&mNetbufCache, NET_BUF_SIZE (BlockOpNum));
 
   if (Nbuf == NULL) {
     return NULL;
   }
 
+  ZeroMem (Nbuf, NET_BUF_SIZE (BlockOpNum));
   Nbuf->Signature           = NET_BUF_SIGNATURE;
   Nbuf->RefCnt              = 1;
   Nbuf->BlockOpNum          = BlockOpNum;
   InitializeListHead (&Nbuf->List);
 
   if (BlockNum != 0) {
-    Vector = AllocateZeroPool (NET_VECTOR_SIZE (BlockNum));
+    Vector = NetCacheAllocate (&mVectorCache, NET_VECTOR_SIZE (BlockNum));
 
     if (Vector == NULL) {
       goto FreeNbuf;
     }
 
+    ZeroMem (Vector, NET_VECTOR_SIZE (BlockNum));
     Vector->Signature = NET_VECTOR_SIGNATURE;
     Vector->RefCnt    = 1;
     Vector->BlockNum  = BlockNum;
@@ -77,7 +328,7 @@ NetbufAllocStruct (
 
 FreeNbuf:
 
-  FreePool (Nbuf);
+  NetbufFreeStruct (Nbuf);
   return NULL;
 }
 
@@ -110,13 +361,22 @@ NetbufAlloc (
     return NULL;
   }
 
-  Bulk = AllocatePool (Len);
+  Vector = Nbuf->Vector;
+
+  //
+  // Take the MTU-sized blocks from the block cache.
+  //
+  if ((Len > NET_BLOCK_CACHE_SIZE / 2) && (Len <= NET_BLOCK_CACHE_SIZE)) {
+    Bulk          = NetCacheAllocate (&mBlockCache, Len);
+    Vector->Flag  = NET_VECTOR_CACHED_BLOCK;
+  } else {
+    Bulk          = AllocatePool (Len);
+  }
 
   if (Bulk == NULL) {
     goto FreeNBuf;
   }
 
-  Vector = Nbuf->Vector;
   Vector->Len                 = Len;
 
   Vector->Block[0].Bulk       = Bulk;
@@ -132,7 +392,8 @@ NetbufAlloc (
   return Nbuf;
 
 FreeNBuf:
-  FreePool (Nbuf);
+  NetCacheFree (&mVectorCache, Vector, NET_VECTOR_SIZE (Vector->BlockNum));
+  NetbufFreeStruct (Nbuf);
   return NULL;
 }
 
@@ -175,6 +436,12 @@ NetbufFreeVector (
 
     Vector->Free (Vector->Arg);
 
+  } else if ((Vector->Flag & NET_VECTOR_CACHED_BLOCK) != 0) {
+    //
+    // The only block is from the block cache, see NetbufAlloc
+    //
+    NetCacheFree (&mBlockCache, Vector->Block[0].Bulk, NET_BLOCK_CACHE_SIZE);
+
   } else {
     //
     // Free each memory block associated with the Vector
@@ -184,7 +451,7 @@ NetbufFreeVector (
     }
   }
 
-  FreePool (Vector);
+  NetCacheFree (&mVectorCache, Vector, NET_VECTOR_SIZE (Vector->BlockNum));
 }
 
 
@@ -218,7 +485,7 @@ NetbufFree (
     // all the sharing of Nbuf increse Vector's RefCnt by one
     //
     NetbufFreeVector (Nbuf->Vector);
-    FreePool (Nbuf);
+    NetbufFreeStruct (Nbuf);
   }
 }
 
@@ -245,7 +512,7 @@ NetbufClone (
 
   NET_CHECK_SIGNATURE (Nbuf, NET_BUF_SIGNATURE);
 
-  Clone = AllocatePool (NET_BUF_SIZE (Nbuf->BlockOpNum));
+  Clone = NetCacheAllocate (&mNetbufCache, NET_BUF_SIZE (Nbuf->BlockOpNum));
 
   if (Clone == NULL) {
     return NULL;
@@ -664,7 +931,7 @@ NetbufGetFragment (
     CurBlockOp++
     );
 
-  for (Index = First + 1; Index <= Last - 1 ; Index++) {
+  for (Index = First + 1; Index < Last; Index++) {
     NetbufSetBlockOp (
       Child,
       BlockOp[Index].Head,
@@ -687,7 +954,8 @@ NetbufGetFragment (
 
 FreeChild:
 
-  FreePool (Child);
+  NetCacheFree (&mVectorCache, Child->Vector, NET_VECTOR_SIZE (Child->Vector->BlockNum));
+  NetbufFreeStruct (Child);
   return NULL;
 }
 
@@ -2,6 +2,12 @@
 
   Routine procedures for memory allocate/free.
 
+  Each memory block is managed as a buddy system. A request is rounded
+  up to 2^n units and taken from the smallest free chunk that can hold
+  it, splitting the chunk in halves as needed. A released chunk is merged
+  with its buddy for as long as the buddy is free too. Both operations
+  take at most MaxOrder steps, independent of how fragmented the block is.
+
 Copyright (c) 2007 - 2009, Intel Corporation
 All rights reserved. This program and the accompanying materials
 are licensed and made available under the terms and conditions of the BSD License
@@ -13,15 +19,149 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 **/
 
+#include <Uefi.h>
+
+#include <Protocol/PciIo.h>
+
+#include <Library/UsbHcMemLib.h>
+#include <Library/DebugLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+
+/**
+  Get the buddy order of the chunk to allocate for Units memory units,
+  that is, the smallest n with 2^n >= Units.
+
+  @param  Units          Number of memory units.
+
+  @return The buddy order.
+
+**/
+UINTN
+UsbHcGetMemOrder (
+  IN UINTN                Units
+  )
+{
+  UINTN                   Order;
+
+  ASSERT ((Units != 0) && (Units <= 0x80000000));
+
+  Order = (UINTN) HighBitSet32 ((UINT32) Units);
+
+  if ((Units & (Units - 1)) != 0) {
+    Order++;
+  }
+
+  return Order;
+}
+
+
+/**
+  Put the free chunk that starts at Unit to the free list of its order.
+
+  @param  Block          The memory block the chunk belongs to.
+  @param  Unit           The first unit of the chunk.
+  @param  Order          The buddy order of the chunk.
+
+**/
+VOID
+UsbHcPushFreeChunk (
+  IN USBHC_MEM_BLOCK      *Block,
+  IN UINT32               Unit,
+  IN UINTN                Order
+  )
+{
+  UINT32                  Head;
+
+  Head                   = Block->FreeHead[Order];
+  Block->Order[Unit]     = (UINT8) (USBHC_MEM_FREE | Order);
+  Block->FreeNext[Unit]  = Head;
+  Block->FreePrev[Unit]  = USBHC_MEM_NIL;
+
+  if (Head != USBHC_MEM_NIL) {
+    Block->FreePrev[Head] = Unit;
+  }
+
+  Block->FreeHead[Order] = Unit;
+  Block->FreeMask       |= (UINT32) (1 << Order);
+}
+
+
+/**
+  Remove the free chunk that starts at Unit from the free list of its order.
+
+  @param  Block          The memory block the chunk belongs to.
+  @param  Unit           The first unit of the chunk.
+  @param  Order          The buddy order of the chunk.
+
+**/
+VOID
+UsbHcRemoveFreeChunk (
+  IN USBHC_MEM_BLOCK      *Block,
+  IN UINT32               Unit,
+  IN UINTN                Order
+  )
+{
+  UINT32                  Next;
+  UINT32                  Prev;
+
+  ASSERT (Block->Order[Unit] == (USBHC_MEM_FREE | Order));
+
+  Next = Block->FreeNext[Unit];
+  Prev = Block->FreePrev[Unit];
+
+  if (Prev != USBHC_MEM_NIL) {
+    Block->FreeNext[Prev] = Next;
+  } else {
+    Block->FreeHead[Order] = Next;
+  }
+
+  if (Next != USBHC_MEM_NIL) {
+    Block->FreePrev[Next] = Prev;
+  }
+
+  if (Block->FreeHead[Order] == USBHC_MEM_NIL) {
+    Block->FreeMask &= ~((UINT32) (1 << Order));
+  }
+
+  Block->Order[Unit] = (UINT8) Order;
+}
+
+
+/**
+  Free the bookkeeping arrays and the memory block structure.
+
+  @param  Block          The memory block to release.
+
+**/
+VOID
+UsbHcFreeBlockInfo (
+  IN USBHC_MEM_BLOCK      *Block
+  )
+{
+  if (Block->Order != NULL) {
+    FreePool (Block->Order);
+  }
+
+  if (Block->FreeNext != NULL) {
+    FreePool (Block->FreeNext);
+  }
+
+  if (Block->FreePrev != NULL) {
+    FreePool (Block->FreePrev);
+  }
 
-#include "Ehci.h"
+  FreePool (Block);
+}
 
 
 /**
   Allocate a block of memory to be used by the buffer pool.
 
   @param  Pool           The buffer pool to allocate memory for.
-  @param  Pages          How many pages to allocate.
+  @param  Pages          How many pages to allocate, must be 2^n.
 
   @return The allocated memory block or NULL if failed.
 
@@ -38,8 +178,12 @@ UsbHcAllocMemBlock (
   VOID                    *Mapping;
   EFI_PHYSICAL_ADDRESS    MappedAddr;
   UINTN                   Bytes;
+  UINTN                   Units;
   EFI_STATUS              Status;
 
+  ASSERT ((Pages & (Pages - 1)) == 0);
+  ASSERT (EFI_PAGE_SIZE % USBHC_MEM_UNIT == 0);
+
   PciIo = Pool->PciIo;
 
   Block = AllocateZeroPool (sizeof (USBHC_MEM_BLOCK));
@@ -48,17 +192,19 @@ UsbHcAllocMemBlock (
   }
 
   //
-  // each bit in the bit array represents USBHC_MEM_UNIT
-  // bytes of memory in the memory block.
+  // Each memory unit has an order tag and the free list links.
+  // The links are only meaningful while the unit starts a free chunk.
   //
-  ASSERT (USBHC_MEM_UNIT * 8 <= EFI_PAGE_SIZE);
-
   Block->BufLen   = EFI_PAGES_TO_SIZE (Pages);
-  Block->BitsLen  = Block->BufLen / (USBHC_MEM_UNIT * 8);
-  Block->Bits     = AllocateZeroPool (Block->BitsLen);
-
-  if (Block->Bits == NULL) {
-    gBS->FreePool (Block);
+  Units           = Block->BufLen / USBHC_MEM_UNIT;
+  Block->MaxOrder = UsbHcGetMemOrder (Units);
+  Block->Order    = AllocateZeroPool (Units);
+  Block->FreeNext = AllocatePool (Units * sizeof (UINT32));
+  Block->FreePrev = AllocatePool (Units * sizeof (UINT32));
+
+  if ((Block->MaxOrder > USBHC_MEM_MAX_ORDER) || (Block->Order == NULL) ||
+      (Block->FreeNext == NULL) || (Block->FreePrev == NULL)) {
+    UsbHcFreeBlockInfo (Block);
     return NULL;
   }
 
@@ -76,7 +222,7 @@ UsbHcAllocMemBlock (
                     );
 
   if (EFI_ERROR (Status)) {
-    goto FREE_BITARRAY;
+    goto FREE_BLOCKINFO;
   }
 
   Bytes = EFI_PAGES_TO_SIZE (Pages);
@@ -106,14 +252,19 @@ UsbHcAllocMemBlock (
   Block->Buf      = (UINT8 *) ((UINTN) MappedAddr);
   Block->Mapping  = Mapping;
 
+  //
+  // The whole block starts as one free chunk of the top order.
+  //
+  SetMem (Block->FreeHead, sizeof (Block->FreeHead), 0xFF);
+  UsbHcPushFreeChunk (Block, 0, Block->MaxOrder);
+
   return Block;
 
 FREE_BUFFER:
   PciIo->FreeBuffer (PciIo, Pages, BufHost);
 
-FREE_BITARRAY:
-  gBS->FreePool (Block->Bits);
-  gBS->FreePool (Block);
+FREE_BLOCKINFO:
+  UsbHcFreeBlockInfo (Block);
   return NULL;
 }
 
@@ -143,16 +294,15 @@ UsbHcFreeMemBlock (
   PciIo->Unmap (PciIo, Block->Mapping);
   PciIo->FreeBuffer (PciIo, EFI_SIZE_TO_PAGES (Block->BufLen), Block->BufHost);
 
-  gBS->FreePool (Block->Bits);
-  gBS->FreePool (Block);
+  UsbHcFreeBlockInfo (Block);
 }
 
 
 /**
-  Alloc some memory from the block.
+  Alloc a chunk of 2^Order units from the block.
 
   @param  Block          The memory block to allocate memory from.
-  @param  Units          Number of memory units to allocate.
+  @param  Order          The buddy order of the chunk to allocate.
 
   @return The pointer to the allocated memory. If couldn't allocate the needed memory,
           the return value is NULL.
@@ -161,64 +311,43 @@ UsbHcFreeMemBlock (
 VOID *
 UsbHcAllocMemFromBlock (
   IN  USBHC_MEM_BLOCK     *Block,
-  IN  UINTN               Units
+  IN  UINTN               Order
   )
 {
-  UINTN                   Byte;
-  UINT8                   Bit;
-  UINTN                   StartByte;
-  UINT8                   StartBit;
-  UINTN                   Available;
-  UINTN                   Count;
-
-  ASSERT ((Block != 0) && (Units != 0));
-
-  StartByte  = 0;
-  StartBit   = 0;
-  Available  = 0;
-
-  for (Byte = 0, Bit = 0; Byte < Block->BitsLen;) {
-    //
-    // If current bit is zero, the corresponding memory unit is
-    // available, otherwise we need to restart our searching.
-    // Available counts the consective number of zero bit.
-    //
-    if (!USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit)) {
-      Available++;
-
-      if (Available >= Units) {
-        break;
-      }
-
-      NEXT_BIT (Byte, Bit);
-
-    } else {
-      NEXT_BIT (Byte, Bit);
+  UINT32                  Mask;
+  UINT32                  Unit;
+  UINTN                   Index;
 
-      Available  = 0;
-      StartByte  = Byte;
-      StartBit   = Bit;
-    }
-  }
+  ASSERT (Block != NULL);
 
-  if (Available < Units) {
+  if (Order > Block->MaxOrder) {
     return NULL;
   }
 
   //
-  // Mark the memory as allocated
+  // Take the smallest free chunk that is large enough, then split
+  // it in halves down to the requested order. The upper halves are
+  // put on the free lists.
   //
-  Byte  = StartByte;
-  Bit   = StartBit;
+  Mask = Block->FreeMask & ~((UINT32) ((1 << Order) - 1));
+
+  if (Mask == 0) {
+    return NULL;
+  }
 
-  for (Count = 0; Count < Units; Count++) {
-    ASSERT (!USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit));
+  Index = (UINTN) LowBitSet32 (Mask);
+  Unit  = Block->FreeHead[Index];
 
-    Block->Bits[Byte] = (UINT8) (Block->Bits[Byte] | USB_HC_BIT (Bit));
-    NEXT_BIT (Byte, Bit);
+  UsbHcRemoveFreeChunk (Block, Unit, Index);
+
+  while (Index > Order) {
+    Index--;
+    UsbHcPushFreeChunk (Block, Unit + (UINT32) (1 << Index), Index);
   }
 
-  return Block->Buf + (StartByte * 8 + StartBit) * USBHC_MEM_UNIT;
+  Block->Order[Unit] = (UINT8) Order;
+
+  return Block->Buf + Unit * USBHC_MEM_UNIT;
 }
 
 
@@ -255,15 +384,10 @@ UsbHcIsMemBlockEmpty (
   IN USBHC_MEM_BLOCK     *Block
   )
 {
-  UINTN                   Index;
-
-  for (Index = 0; Index < Block->BitsLen; Index++) {
-    if (Block->Bits[Index] != 0) {
-      return FALSE;
-    }
-  }
-
-  return TRUE;
+  //
+  // Only a fully merged block has a free chunk of the top order.
+  //
+  return (BOOLEAN) ((Block->FreeMask & (1 << Block->MaxOrder)) != 0);
 }
 
 
@@ -302,11 +426,11 @@ UsbHcUnlinkMemBlock (
                                from one 4G address space.
   @param  Which4G              The 4G memory area each memory allocated should be from.
 
-  @retval EFI_SUCCESS          The memory pool is initialized.
-  @retval EFI_OUT_OF_RESOURCE  Fail to init the memory pool.
+  @return The initialized memory pool or NULL if failed.
 
 **/
 USBHC_MEM_POOL *
+EFIAPI
 UsbHcInitMemPool (
   IN EFI_PCI_IO_PROTOCOL  *PciIo,
   IN BOOLEAN              Check4G,
@@ -327,7 +451,7 @@ UsbHcInitMemPool (
   Pool->Head    = UsbHcAllocMemBlock (Pool, USBHC_MEM_DEFAULT_PAGES);
 
   if (Pool->Head == NULL) {
-    gBS->FreePool (Pool);
+    FreePool (Pool);
     Pool = NULL;
   }
 
@@ -345,6 +469,7 @@ UsbHcInitMemPool (
 
 **/
 EFI_STATUS
+EFIAPI
 UsbHcFreeMemPool (
   IN USBHC_MEM_POOL       *Pool
   )
@@ -364,7 +489,7 @@ UsbHcFreeMemPool (
   }
 
   UsbHcFreeMemBlock (Pool, Pool->Head);
-  gBS->FreePool (Pool);
+  FreePool (Pool);
   return EFI_SUCCESS;
 }
 
@@ -380,6 +505,7 @@ UsbHcFreeMemPool (
 
 **/
 VOID *
+EFIAPI
 UsbHcAllocateMem (
   IN  USBHC_MEM_POOL      *Pool,
   IN  UINTN               Size
@@ -389,27 +515,35 @@ UsbHcAllocateMem (
   USBHC_MEM_BLOCK         *Block;
   USBHC_MEM_BLOCK         *NewBlock;
   VOID                    *Mem;
-  UINTN                   AllocSize;
+  UINTN                   Order;
   UINTN                   Pages;
 
-  Mem       = NULL;
-  AllocSize = USBHC_MEM_ROUND (Size);
-  Head      = Pool->Head;
+  ASSERT (Size != 0);
+
+  Mem   = NULL;
+  Order = UsbHcGetMemOrder (USBHC_MEM_ROUND (Size) / USBHC_MEM_UNIT);
+  Head  = Pool->Head;
   ASSERT (Head != NULL);
 
+  if (Order > USBHC_MEM_MAX_ORDER) {
+    DEBUG ((EFI_D_ERROR, "UsbHcAllocateMem: %d bytes is too large\n", Size));
+    return NULL;
+  }
+
   //
   // First check whether current memory blocks can satisfy the allocation.
+  // FreeMask tells at once whether a block has a chunk large enough.
   //
   for (Block = Head; Block != NULL; Block = Block->Next) {
-    Mem = UsbHcAllocMemFromBlock (Block, AllocSize / USBHC_MEM_UNIT);
-
-    if (Mem != NULL) {
-      ZeroMem (Mem, Size);
+    if ((Block->FreeMask >> Order) != 0) {
+      Mem = UsbHcAllocMemFromBlock (Block, Order);
+      ASSERT (Mem != NULL);
       break;
     }
   }
 
   if (Mem != NULL) {
+    ZeroMem (Mem, Size);
     return Mem;
   }
 
@@ -417,11 +551,12 @@ UsbHcAllocateMem (
   // Create a new memory block if there is not enough memory
   // in the pool. If the allocation size is larger than the
   // default page number, just allocate a large enough memory
-  // block. Otherwise allocate default pages.
+  // block. Otherwise allocate default pages. Either way the
+  // block size is 2^n pages.
   //
-  if (AllocSize > EFI_PAGES_TO_SIZE (USBHC_MEM_DEFAULT_PAGES)) {
-    Pages = EFI_SIZE_TO_PAGES (AllocSize) + 1;
-  } else {
+  Pages = EFI_SIZE_TO_PAGES ((UINTN) LShiftU64 (USBHC_MEM_UNIT, Order));
+
+  if (Pages < USBHC_MEM_DEFAULT_PAGES) {
     Pages = USBHC_MEM_DEFAULT_PAGES;
   }
 
@@ -436,7 +571,7 @@ UsbHcAllocateMem (
   // Add the new memory block to the pool, then allocate memory from it
   //
   UsbHcInsertMemBlockToPool (Head, NewBlock);
-  Mem = UsbHcAllocMemFromBlock (NewBlock, AllocSize / USBHC_MEM_UNIT);
+  Mem = UsbHcAllocMemFromBlock (NewBlock, Order);
 
   if (Mem != NULL) {
     ZeroMem (Mem, Size);
@@ -455,6 +590,7 @@ UsbHcAllocateMem (
 
 **/
 VOID
+EFIAPI
 UsbHcFreeMem (
   IN USBHC_MEM_POOL       *Pool,
   IN VOID                 *Mem,
@@ -465,12 +601,13 @@ UsbHcFreeMem (
   USBHC_MEM_BLOCK         *Block;
   UINT8                   *ToFree;
   UINTN                   AllocSize;
-  UINTN                   Byte;
-  UINTN                   Bit;
-  UINTN                   Count;
+  UINTN                   Order;
+  UINT32                  Unit;
+  UINT32                  Buddy;
 
   Head      = Pool->Head;
-  AllocSize = USBHC_MEM_ROUND (Size);
+  Order     = UsbHcGetMemOrder (USBHC_MEM_ROUND (Size) / USBHC_MEM_UNIT);
+  AllocSize = (UINTN) LShiftU64 (USBHC_MEM_UNIT, Order);
   ToFree    = (UINT8 *) Mem;
 
   for (Block = Head; Block != NULL; Block = Block->Next) {
@@ -479,22 +616,6 @@ UsbHcFreeMem (
     // completely contains the memory to free.
     //
     if ((Block->Buf <= ToFree) && ((ToFree + AllocSize) <= (Block->Buf + Block->BufLen))) {
-      //
-      // compute the start byte and bit in the bit array
-      //
-      Byte  = ((ToFree - Block->Buf) / USBHC_MEM_UNIT) / 8;
-      Bit   = ((ToFree - Block->Buf) / USBHC_MEM_UNIT) % 8;
-
-      //
-      // reset associated bits in bit arry
-      //
-      for (Count = 0; Count < (AllocSize / USBHC_MEM_UNIT); Count++) {
-        ASSERT (USB_HC_BIT_IS_SET (Block->Bits[Byte], Bit));
-
-        Block->Bits[Byte] = (UINT8) (Block->Bits[Byte] ^ USB_HC_BIT (Bit));
-        NEXT_BIT (Byte, Bit);
-      }
-
       break;
     }
   }
@@ -506,6 +627,32 @@ UsbHcFreeMem (
   //
   ASSERT (Block != NULL);
 
+  if (Block == NULL) {
+    return ;
+  }
+
+  Unit = (UINT32) ((ToFree - Block->Buf) / USBHC_MEM_UNIT);
+  ASSERT (Block->Order[Unit] == Order);
+
+  //
+  // Merge the chunk with its buddy for as long as the buddy is a
+  // free chunk of the same order. The buddy of a chunk is found by
+  // flipping the bit of its order in the unit index.
+  //
+  while (Order < Block->MaxOrder) {
+    Buddy = Unit ^ (UINT32) (1 << Order);
+
+    if (Block->Order[Buddy] != (USBHC_MEM_FREE | Order)) {
+      break;
+    }
+
+    UsbHcRemoveFreeChunk (Block, Buddy, Order);
+    Unit &= ~((UINT32) (1 << Order));
+    Order++;
+  }
+
+  UsbHcPushFreeChunk (Block, Unit, Order);
+
   //
   // Release the current memory block if it is empty and not the head
   //
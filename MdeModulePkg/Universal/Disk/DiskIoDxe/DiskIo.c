@@ -45,6 +45,7 @@ DISK_IO_PRIVATE_DATA        gDiskIoPrivateDataTemplate = {
     DiskIoReadDisk,
     DiskIoWriteDisk
   },
+  NULL,
   NULL
 };
 
@@ -151,6 +152,11 @@ DiskIoDriverBindingStart (
     Status = EFI_OUT_OF_RESOURCES;
     goto ErrorExit;
   }
+
+  Status = DiskIoCacheCreate (Private);
+  if (EFI_ERROR (Status)) {
+    goto ErrorExit;
+  }
   
   //
   // Install protocol interfaces for the Disk IO device.
@@ -166,6 +172,7 @@ ErrorExit:
   if (EFI_ERROR (Status)) {
 
     if (Private != NULL) {
+      DiskIoCacheDestroy (Private);
       FreePool (Private);
     }
 
@@ -231,6 +238,8 @@ DiskIoDriverBindingStop (
                   &Private->DiskIo
                   );
   if (!EFI_ERROR (Status)) {
+    DiskIoCacheDestroy (Private);
+
     Status = gBS->CloseProtocol (
                     ControllerHandle,
                     &gEfiBlockIoProtocolGuid,
@@ -299,6 +308,8 @@ DiskIoReadDisk (
   UINTN                 IsBufferAligned;
   UINTN                 DataBufferSize;
   BOOLEAN               LastRead;
+  UINT64                BlockNum;
+  EFI_TPL               OldTpl;
 
   Private   = DISK_IO_PRIVATE_DATA_FROM_THIS (This);
 
@@ -310,6 +321,22 @@ DiskIoReadDisk (
     return EFI_MEDIA_CHANGED;
   }
 
+  OldTpl  = gBS->RaiseTPL (TPL_CALLBACK);
+  PreData = NULL;
+
+  if (DiskIoCacheCheckMedia (Private)) {
+    //
+    // Small requests within the media are served by the block cache.
+    //
+    Lba      = DivU64x32Remainder (Offset, BlockSize, &UnderRun);
+    BlockNum = DivU64x32 ((UINT64) UnderRun + BufferSize + BlockSize - 1, BlockSize);
+
+    if ((BlockNum <= DATA_BUFFER_BLOCK_NUM) && (Lba + BlockNum <= Media->LastBlock + 1)) {
+      Status = DiskIoCacheRead (Private, Offset, BufferSize, Buffer);
+      goto Done;
+    }
+  }
+
   WorkingBuffer     = Buffer;
   WorkingBufferSize = BufferSize;
 
@@ -327,6 +354,7 @@ DiskIoReadDisk (
   }
 
   if (PreData == NULL) {
+    gBS->RestoreTPL (OldTpl);
     return EFI_OUT_OF_RESOURCES;
   }
 
@@ -460,6 +488,7 @@ Done:
     FreePool (PreData);
   }
 
+  gBS->RestoreTPL (OldTpl);
   return Status;
 }
 
@@ -517,6 +546,8 @@ DiskIoWriteDisk (
   UINTN                 IsBufferAligned;
   UINTN                 DataBufferSize;
   BOOLEAN               LastWrite;
+  UINT64                BlockNum;
+  EFI_TPL               OldTpl;
 
   Private   = DISK_IO_PRIVATE_DATA_FROM_THIS (This);
 
@@ -532,6 +563,25 @@ DiskIoWriteDisk (
     return EFI_MEDIA_CHANGED;
   }
 
+  OldTpl  = gBS->RaiseTPL (TPL_CALLBACK);
+  PreData = NULL;
+
+  if (DiskIoCacheCheckMedia (Private)) {
+    //
+    // Small requests within the media go through the block cache. The
+    // cached copies of the blocks of a larger request are dropped.
+    //
+    Lba      = DivU64x32Remainder (Offset, BlockSize, &UnderRun);
+    BlockNum = DivU64x32 ((UINT64) UnderRun + BufferSize + BlockSize - 1, BlockSize);
+
+    if ((BlockNum <= DATA_BUFFER_BLOCK_NUM) && (Lba + BlockNum <= Media->LastBlock + 1)) {
+      Status = DiskIoCacheWrite (Private, Offset, BufferSize, Buffer);
+      goto Done;
+    }
+
+    DiskIoCacheInvalidate (Private, Lba, (UINTN) BlockNum);
+  }
+
   DataBufferSize = BlockSize * DATA_BUFFER_BLOCK_NUM;
 
   if (Media->IoAlign > 1) {
@@ -543,6 +593,7 @@ DiskIoWriteDisk (
   }
 
   if (PreData == NULL) {
+    gBS->RestoreTPL (OldTpl);
     return EFI_OUT_OF_RESOURCES;
   }
 
@@ -700,6 +751,7 @@ Done:
     FreePool (PreData);
   }
 
+  gBS->RestoreTPL (OldTpl);
   return Status;
 }
 
@@ -27,16 +27,86 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseMemoryLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/PcdLib.h>
 
 
 #define DATA_BUFFER_BLOCK_NUM             64
 
+//
+// The cache never holds fewer blocks than this, so that one request
+// plus its read-ahead never replaces blocks of the same request.
+//
+#define DISK_IO_CACHE_MIN_BLOCK_NUM       (DATA_BUFFER_BLOCK_NUM * 2)
+#define DISK_IO_CACHE_HASH_SIZE           128
+#define DISK_IO_CACHE_HASH(Lba)           ((UINTN) (Lba) & (DISK_IO_CACHE_HASH_SIZE - 1))
+
+//
+// Read-ahead window of a sequential stream of small reads, in blocks.
+// It starts at the minimum and doubles on every sequential read. A few
+// streams are tracked at once, as a file system interleaves the reads
+// of its metadata with the reads of the file data.
+//
+#define DISK_IO_READ_AHEAD_MIN            8
+#define DISK_IO_READ_STREAM_NUM           4
+
+typedef struct {
+  EFI_LBA               NextLba;    ///< The block after the last read of the stream
+  UINTN                 ReadAhead;
+} DISK_IO_READ_STREAM;
+
+///
+/// A block held in the cache.
+///
+typedef struct {
+  LIST_ENTRY            Link;       ///< Link in the LRU list, most recently used first
+  LIST_ENTRY            HashLink;   ///< Link in the hash bucket of Lba, if Valid
+  EFI_LBA               Lba;
+  BOOLEAN               Valid;
+  UINT8                 *Data;
+} DISK_IO_CACHE_BLOCK;
+
+///
+/// The block cache of one Disk I/O instance.
+///
+typedef struct {
+  UINT32                MediaId;
+  UINT32                BlockSize;
+  UINTN                 BlockNum;
+  DISK_IO_CACHE_BLOCK   *Blocks;
+  UINT8                 *PreData;
+  LIST_ENTRY            Lru;
+  LIST_ENTRY            Hash[DISK_IO_CACHE_HASH_SIZE];
+
+  //
+  // Staging buffer of DATA_BUFFER_BLOCK_NUM blocks, aligned to IoAlign.
+  // A cached request is assembled in it before it is copied out or
+  // written to the device.
+  //
+  UINT8                 *PreStage;
+  UINT8                 *Stage;
+
+  //
+  // Sequential read detection, the streams are replaced round robin
+  //
+  DISK_IO_READ_STREAM   Stream[DISK_IO_READ_STREAM_NUM];
+  UINTN                 StreamNext;
+
+  //
+  // Statistics, in blocks
+  //
+  UINT64                Hits;
+  UINT64                Misses;
+  UINT64                ReadAheads;
+} DISK_IO_CACHE;
+
 #define DISK_IO_PRIVATE_DATA_SIGNATURE  SIGNATURE_32 ('d', 's', 'k', 'I')
 
 typedef struct {
   UINTN                 Signature;
   EFI_DISK_IO_PROTOCOL  DiskIo;
   EFI_BLOCK_IO_PROTOCOL *BlockIo;
+
+  DISK_IO_CACHE         *Cache;         ///< NULL if the cache is disabled
 } DISK_IO_PRIVATE_DATA;
 
 #define DISK_IO_PRIVATE_DATA_FROM_THIS(a) CR (a, DISK_IO_PRIVATE_DATA, DiskIo, DISK_IO_PRIVATE_DATA_SIGNATURE)
@@ -189,6 +259,107 @@ DiskIoWriteDisk (
   IN VOID                  *Buffer
   );
 
+//
+// Block cache
+//
+/**
+  Create the block cache of a Disk I/O instance, sized by PcdDiskIoCacheSize.
+
+  @param  Private               The Disk I/O instance.
+
+  @retval EFI_SUCCESS           The cache is created, or it is disabled.
+  @retval EFI_OUT_OF_RESOURCES  There is no memory for the cache.
+
+**/
+EFI_STATUS
+DiskIoCacheCreate (
+  IN DISK_IO_PRIVATE_DATA  *Private
+  );
+
+/**
+  Free the block cache of a Disk I/O instance.
+
+  @param  Private               The Disk I/O instance.
+
+**/
+VOID
+DiskIoCacheDestroy (
+  IN DISK_IO_PRIVATE_DATA  *Private
+  );
+
+/**
+  Drop the cache if the media has changed since it was filled.
+
+  @param  Private               The Disk I/O instance.
+
+  @retval TRUE                  The cache can serve the current media.
+  @retval FALSE                 The cache can't be used, the request must go to
+                                the device directly.
+
+**/
+BOOLEAN
+DiskIoCacheCheckMedia (
+  IN DISK_IO_PRIVATE_DATA  *Private
+  );
+
+/**
+  Drop the cached copies of the blocks from Lba to the end of the request.
+  It is called before the request is sent to the device without the cache.
+
+  @param  Private               The Disk I/O instance.
+  @param  Lba                   The first block of the request.
+  @param  BlockNum              The number of blocks in the request.
+
+**/
+VOID
+DiskIoCacheInvalidate (
+  IN DISK_IO_PRIVATE_DATA  *Private,
+  IN EFI_LBA               Lba,
+  IN UINTN                 BlockNum
+  );
+
+/**
+  Read BufferSize bytes from Offset into Buffer through the block cache.
+  The request must span no more than DATA_BUFFER_BLOCK_NUM blocks.
+
+  @param  Private               The Disk I/O instance.
+  @param  Offset                The starting byte offset to read from.
+  @param  BufferSize            Size of Buffer.
+  @param  Buffer                Buffer to receive the data.
+
+  @retval EFI_SUCCESS           The data was read.
+  @retval other                 The device reported an error.
+
+**/
+EFI_STATUS
+DiskIoCacheRead (
+  IN  DISK_IO_PRIVATE_DATA  *Private,
+  IN  UINT64                Offset,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  );
+
+/**
+  Write BufferSize bytes from Buffer to Offset through the block cache.
+  The request must span no more than DATA_BUFFER_BLOCK_NUM blocks.
+
+  @param  Private               The Disk I/O instance.
+  @param  Offset                The starting byte offset to write to.
+  @param  BufferSize            Size of Buffer.
+  @param  Buffer                Buffer holding the data.
+
+  @retval EFI_SUCCESS           The data was written.
+  @retval other                 The device reported an error.
+
+**/
+EFI_STATUS
+DiskIoCacheWrite (
+  IN DISK_IO_PRIVATE_DATA  *Private,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  IN VOID                  *Buffer
+  );
+
 //
 // EFI Component Name Functions
 //
@@ -0,0 +1,649 @@
+/** @file
+  Block cache of the DiskIo driver.
+
+  Every Disk I/O instance keeps the most recently used blocks of its media in
+  an LRU cache, so that the small and unaligned requests of the file systems,
+  such as FAT and directory reads, don't go to the device each time. A stream
+  of small sequential reads is detected and the blocks after it are read
+  ahead in the same device request. Requests larger than DATA_BUFFER_BLOCK_NUM
+  blocks go to the device directly.
+
+  The Disk I/O instances of partitions have no cache. The partition driver
+  does its I/O through the Disk I/O of the parent disk, so all the accesses
+  to a disk meet in the single cache of the disk. Removable media have no
+  cache either, as the media can be changed without a new MediaId.
+
+  Writes go through to the device before they update the cache, so the cache
+  never holds data the device doesn't have.
+
+Copyright (c) 2006 - 2008, Intel Corporation. <BR>
+All rights reserved. This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include "DiskIo.h"
+
+
+/**
+  Allocate the blocks and the staging buffer of the cache for the media.
+
+  @param  Cache                 The block cache.
+  @param  Media                 The media to cache.
+
+  @retval EFI_SUCCESS           The buffers are allocated.
+  @retval EFI_OUT_OF_RESOURCES  There is no memory for the buffers.
+
+**/
+EFI_STATUS
+DiskIoCacheAllocate (
+  IN DISK_IO_CACHE       *Cache,
+  IN EFI_BLOCK_IO_MEDIA  *Media
+  )
+{
+  DISK_IO_CACHE_BLOCK  *Block;
+  UINTN                BlockNum;
+  UINTN                Index;
+
+  BlockNum = PcdGet32 (PcdDiskIoCacheSize) / Media->BlockSize;
+  if (BlockNum < DISK_IO_CACHE_MIN_BLOCK_NUM) {
+    BlockNum = DISK_IO_CACHE_MIN_BLOCK_NUM;
+  }
+
+  Cache->Blocks   = AllocateZeroPool (BlockNum * sizeof (DISK_IO_CACHE_BLOCK));
+  Cache->PreData  = AllocatePool (BlockNum * Media->BlockSize);
+
+  if (Media->IoAlign > 1) {
+    Cache->PreStage = AllocatePool (DATA_BUFFER_BLOCK_NUM * Media->BlockSize + Media->IoAlign);
+    Cache->Stage    = Cache->PreStage - ((UINTN) Cache->PreStage & (Media->IoAlign - 1)) + Media->IoAlign;
+  } else {
+    Cache->PreStage = AllocatePool (DATA_BUFFER_BLOCK_NUM * Media->BlockSize);
+    Cache->Stage    = Cache->PreStage;
+  }
+
+  if ((Cache->Blocks == NULL) || (Cache->PreData == NULL) || (Cache->PreStage == NULL)) {
+    if (Cache->Blocks != NULL) {
+      FreePool (Cache->Blocks);
+    }
+    if (Cache->PreData != NULL) {
+      FreePool (Cache->PreData);
+    }
+    if (Cache->PreStage != NULL) {
+      FreePool (Cache->PreStage);
+    }
+
+    Cache->Blocks   = NULL;
+    Cache->PreData  = NULL;
+    Cache->PreStage = NULL;
+    Cache->BlockNum = 0;
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  InitializeListHead (&Cache->Lru);
+  for (Index = 0; Index < DISK_IO_CACHE_HASH_SIZE; Index++) {
+    InitializeListHead (&Cache->Hash[Index]);
+  }
+
+  for (Index = 0; Index < BlockNum; Index++) {
+    Block       = &Cache->Blocks[Index];
+    Block->Data = Cache->PreData + Index * Media->BlockSize;
+    InitializeListHead (&Block->HashLink);
+    InsertTailList (&Cache->Lru, &Block->Link);
+  }
+
+  Cache->MediaId   = Media->MediaId;
+  Cache->BlockSize = Media->BlockSize;
+  Cache->BlockNum  = BlockNum;
+  ZeroMem (Cache->Stream, sizeof (Cache->Stream));
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Free the blocks and the staging buffer of the cache.
+
+  @param  Cache                 The block cache.
+
+**/
+VOID
+DiskIoCacheFree (
+  IN DISK_IO_CACHE  *Cache
+  )
+{
+  UINTN  Index;
+
+  if (Cache->BlockNum == 0) {
+    return;
+  }
+
+  FreePool (Cache->Blocks);
+  FreePool (Cache->PreData);
+  FreePool (Cache->PreStage);
+
+  InitializeListHead (&Cache->Lru);
+  for (Index = 0; Index < DISK_IO_CACHE_HASH_SIZE; Index++) {
+    InitializeListHead (&Cache->Hash[Index]);
+  }
+
+  Cache->Blocks   = NULL;
+  Cache->PreData  = NULL;
+  Cache->PreStage = NULL;
+  Cache->Stage    = NULL;
+  Cache->BlockNum = 0;
+}
+
+
+/**
+  Find the cached copy of a block.
+
+  @param  Cache                 The block cache.
+  @param  Lba                   The block to find.
+
+  @return The cached block, or NULL if the block isn't cached.
+
+**/
+DISK_IO_CACHE_BLOCK *
+DiskIoCacheLookup (
+  IN DISK_IO_CACHE  *Cache,
+  IN EFI_LBA        Lba
+  )
+{
+  LIST_ENTRY           *Head;
+  LIST_ENTRY           *Entry;
+  DISK_IO_CACHE_BLOCK  *Block;
+
+  Head = &Cache->Hash[DISK_IO_CACHE_HASH (Lba)];
+
+  for (Entry = Head->ForwardLink; Entry != Head; Entry = Entry->ForwardLink) {
+    Block = BASE_CR (Entry, DISK_IO_CACHE_BLOCK, HashLink);
+    if (Block->Lba == Lba) {
+      return Block;
+    }
+  }
+
+  return NULL;
+}
+
+
+/**
+  Drop a block from the cache.
+
+  @param  Cache                 The block cache.
+  @param  Block                 The block to drop.
+
+**/
+VOID
+DiskIoCacheDrop (
+  IN DISK_IO_CACHE        *Cache,
+  IN DISK_IO_CACHE_BLOCK  *Block
+  )
+{
+  RemoveEntryList (&Block->HashLink);
+  InitializeListHead (&Block->HashLink);
+  Block->Valid = FALSE;
+
+  RemoveEntryList (&Block->Link);
+  InsertTailList (&Cache->Lru, &Block->Link);
+}
+
+
+/**
+  Store the data of a block in the cache, replacing the least recently used
+  block if the block isn't cached yet.
+
+  @param  Cache                 The block cache.
+  @param  Lba                   The block to store.
+  @param  Data                  The data of the block, as it is on the device.
+
+**/
+VOID
+DiskIoCacheUpdate (
+  IN DISK_IO_CACHE  *Cache,
+  IN EFI_LBA        Lba,
+  IN UINT8          *Data
+  )
+{
+  DISK_IO_CACHE_BLOCK  *Block;
+
+  Block = DiskIoCacheLookup (Cache, Lba);
+
+  if (Block == NULL) {
+    Block = BASE_CR (Cache->Lru.BackLink, DISK_IO_CACHE_BLOCK, Link);
+
+    RemoveEntryList (&Block->HashLink);
+    Block->Lba   = Lba;
+    Block->Valid = TRUE;
+    InsertHeadList (&Cache->Hash[DISK_IO_CACHE_HASH (Lba)], &Block->HashLink);
+  }
+
+  CopyMem (Block->Data, Data, Cache->BlockSize);
+
+  RemoveEntryList (&Block->Link);
+  InsertHeadList (&Cache->Lru, &Block->Link);
+}
+
+
+/**
+  Get the current data of one block into Buffer, from the cache if it is
+  cached, or else from the device.
+
+  @param  Private               The Disk I/O instance.
+  @param  Lba                   The block to read.
+  @param  Buffer                Buffer of one block, aligned to IoAlign.
+
+  @retval EFI_SUCCESS           The block is read.
+  @retval other                 The device reported an error.
+
+**/
+EFI_STATUS
+DiskIoCacheFetch (
+  IN  DISK_IO_PRIVATE_DATA  *Private,
+  IN  EFI_LBA               Lba,
+  OUT UINT8                 *Buffer
+  )
+{
+  DISK_IO_CACHE        *Cache;
+  DISK_IO_CACHE_BLOCK  *Block;
+
+  Cache = Private->Cache;
+  Block = DiskIoCacheLookup (Cache, Lba);
+
+  if (Block != NULL) {
+    Cache->Hits++;
+    CopyMem (Buffer, Block->Data, Cache->BlockSize);
+    return EFI_SUCCESS;
+  }
+
+  Cache->Misses++;
+  return Private->BlockIo->ReadBlocks (
+                             Private->BlockIo,
+                             Cache->MediaId,
+                             Lba,
+                             Cache->BlockSize,
+                             Buffer
+                             );
+}
+
+
+/**
+  Create the block cache of a Disk I/O instance, sized by PcdDiskIoCacheSize.
+  No cache is created for the Disk I/O instances of logical partitions and of
+  removable media.
+
+  @param  Private               The Disk I/O instance.
+
+  @retval EFI_SUCCESS           The cache is created, or it is disabled.
+  @retval EFI_OUT_OF_RESOURCES  There is no memory for the cache.
+
+**/
+EFI_STATUS
+DiskIoCacheCreate (
+  IN DISK_IO_PRIVATE_DATA  *Private
+  )
+{
+  EFI_STATUS          Status;
+  DISK_IO_CACHE       *Cache;
+  EFI_BLOCK_IO_MEDIA  *Media;
+
+  Private->Cache = NULL;
+  Media          = Private->BlockIo->Media;
+
+  //
+  // A removable media may be swapped without the MediaId changing, and the
+  // cache could then serve the blocks of the previous media.
+  //
+  if ((PcdGet32 (PcdDiskIoCacheSize) == 0) || Media->LogicalPartition || Media->RemovableMedia) {
+    return EFI_SUCCESS;
+  }
+
+  Cache = AllocateZeroPool (sizeof (DISK_IO_CACHE));
+  if (Cache == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = DiskIoCacheAllocate (Cache, Media);
+  if (EFI_ERROR (Status)) {
+    FreePool (Cache);
+    return Status;
+  }
+
+  Private->Cache = Cache;
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Free the block cache of a Disk I/O instance.
+
+  @param  Private               The Disk I/O instance.
+
+**/
+VOID
+DiskIoCacheDestroy (
+  IN DISK_IO_PRIVATE_DATA  *Private
+  )
+{
+  DISK_IO_CACHE  *Cache;
+
+  Cache = Private->Cache;
+  if (Cache == NULL) {
+    return;
+  }
+
+  DEBUG ((
+    EFI_D_INFO,
+    "DiskIo: cache hits %ld, misses %ld, read ahead %ld blocks\n",
+    Cache->Hits,
+    Cache->Misses,
+    Cache->ReadAheads
+    ));
+
+  DiskIoCacheFree (Cache);
+  FreePool (Cache);
+  Private->Cache = NULL;
+}
+
+
+/**
+  Drop the cache if the media has changed since it was filled.
+
+  @param  Private               The Disk I/O instance.
+
+  @retval TRUE                  The cache can serve the current media.
+  @retval FALSE                 The cache can't be used, the request must go to
+                                the device directly.
+
+**/
+BOOLEAN
+DiskIoCacheCheckMedia (
+  IN DISK_IO_PRIVATE_DATA  *Private
+  )
+{
+  DISK_IO_CACHE       *Cache;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  UINTN               Index;
+
+  Cache = Private->Cache;
+  Media = Private->BlockIo->Media;
+
+  if ((Cache == NULL) || !Media->MediaPresent) {
+    return FALSE;
+  }
+
+  if ((Cache->BlockNum != 0) &&
+      (Cache->MediaId == Media->MediaId) &&
+      (Cache->BlockSize == Media->BlockSize)) {
+    return TRUE;
+  }
+
+  if ((Cache->BlockNum != 0) && (Cache->BlockSize == Media->BlockSize)) {
+    for (Index = 0; Index < Cache->BlockNum; Index++) {
+      if (Cache->Blocks[Index].Valid) {
+        DiskIoCacheDrop (Cache, &Cache->Blocks[Index]);
+      }
+    }
+
+    Cache->MediaId = Media->MediaId;
+    ZeroMem (Cache->Stream, sizeof (Cache->Stream));
+    return TRUE;
+  }
+
+  DiskIoCacheFree (Cache);
+  return (BOOLEAN) !EFI_ERROR (DiskIoCacheAllocate (Cache, Media));
+}
+
+
+/**
+  Drop the cached copies of the blocks from Lba to the end of the request.
+  It is called before the request is sent to the device without the cache.
+
+  @param  Private               The Disk I/O instance.
+  @param  Lba                   The first block of the request.
+  @param  BlockNum              The number of blocks in the request.
+
+**/
+VOID
+DiskIoCacheInvalidate (
+  IN DISK_IO_PRIVATE_DATA  *Private,
+  IN EFI_LBA               Lba,
+  IN UINTN                 BlockNum
+  )
+{
+  DISK_IO_CACHE        *Cache;
+  DISK_IO_CACHE_BLOCK  *Block;
+  UINTN                Index;
+
+  Cache = Private->Cache;
+
+  for (Index = 0; Index < Cache->BlockNum; Index++) {
+    Block = &Cache->Blocks[Index];
+    if (Block->Valid && (Block->Lba >= Lba) && (Block->Lba - Lba < BlockNum)) {
+      DiskIoCacheDrop (Cache, Block);
+    }
+  }
+}
+
+
+/**
+  Read BufferSize bytes from Offset into Buffer through the block cache.
+  The request must span no more than DATA_BUFFER_BLOCK_NUM blocks.
+
+  @param  Private               The Disk I/O instance.
+  @param  Offset                The starting byte offset to read from.
+  @param  BufferSize            Size of Buffer.
+  @param  Buffer                Buffer to receive the data.
+
+  @retval EFI_SUCCESS           The data was read.
+  @retval other                 The device reported an error.
+
+**/
+EFI_STATUS
+DiskIoCacheRead (
+  IN  DISK_IO_PRIVATE_DATA  *Private,
+  IN  UINT64                Offset,
+  IN  UINTN                 BufferSize,
+  OUT VOID                  *Buffer
+  )
+{
+  EFI_STATUS           Status;
+  DISK_IO_CACHE        *Cache;
+  DISK_IO_CACHE_BLOCK  *Block;
+  DISK_IO_READ_STREAM  *Stream;
+  EFI_LBA              Lba;
+  EFI_LBA              LastBlock;
+  UINT32               UnderRun;
+  UINT32               BlockSize;
+  UINTN                BlockNum;
+  UINTN                Extra;
+  UINTN                ExtraRead;
+  UINTN                Index;
+  UINTN                Start;
+  UINTN                Count;
+
+  Cache     = Private->Cache;
+  BlockSize = Cache->BlockSize;
+  LastBlock = Private->BlockIo->Media->LastBlock;
+
+  Lba       = DivU64x32Remainder (Offset, BlockSize, &UnderRun);
+  BlockNum  = (UnderRun + BufferSize + BlockSize - 1) / BlockSize;
+
+  ASSERT (BlockNum <= DATA_BUFFER_BLOCK_NUM);
+
+  //
+  // A read that starts in the block after the last read of a stream, or
+  // in the last block of it, continues the stream: grow its read-ahead
+  // window. Any other read starts a new stream.
+  //
+  for (Index = 0; Index < DISK_IO_READ_STREAM_NUM; Index++) {
+    Stream = &Cache->Stream[Index];
+    if ((Lba == Stream->NextLba) || (Lba + 1 == Stream->NextLba)) {
+      break;
+    }
+  }
+
+  if (Index < DISK_IO_READ_STREAM_NUM) {
+    if (Stream->ReadAhead == 0) {
+      Stream->ReadAhead = DISK_IO_READ_AHEAD_MIN;
+    } else {
+      Stream->ReadAhead = MIN (Stream->ReadAhead * 2, DATA_BUFFER_BLOCK_NUM);
+    }
+  } else {
+    Stream            = &Cache->Stream[Cache->StreamNext];
+    Stream->ReadAhead = 0;
+    Cache->StreamNext = (Cache->StreamNext + 1) % DISK_IO_READ_STREAM_NUM;
+  }
+
+  Stream->NextLba = Lba + BlockNum;
+
+  Extra = MIN (Stream->ReadAhead, DATA_BUFFER_BLOCK_NUM - BlockNum);
+  if (Lba + BlockNum + Extra > LastBlock + 1) {
+    Extra = (UINTN) (LastBlock + 1 - (Lba + BlockNum));
+  }
+
+  ExtraRead = 0;
+  Index     = 0;
+  while (Index < BlockNum) {
+    Block = DiskIoCacheLookup (Cache, Lba + Index);
+    if (Block != NULL) {
+      CopyMem (Cache->Stage + Index * BlockSize, Block->Data, BlockSize);
+      RemoveEntryList (&Block->Link);
+      InsertHeadList (&Cache->Lru, &Block->Link);
+      Cache->Hits++;
+      Index++;
+      continue;
+    }
+
+    //
+    // Read the run of missing blocks with one request, plus the
+    // read-ahead if the run reaches the end of the request.
+    //
+    Start = Index;
+    do {
+      Index++;
+    } while ((Index < BlockNum) && (DiskIoCacheLookup (Cache, Lba + Index) == NULL));
+
+    Count = Index - Start;
+    if (Index == BlockNum) {
+      ExtraRead = Extra;
+      Count    += Extra;
+    }
+
+    Status = Private->BlockIo->ReadBlocks (
+                                 Private->BlockIo,
+                                 Cache->MediaId,
+                                 Lba + Start,
+                                 Count * BlockSize,
+                                 Cache->Stage + Start * BlockSize
+                                 );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Cache->Misses += Index - Start;
+
+    for (; Start < Index; Start++) {
+      DiskIoCacheUpdate (Cache, Lba + Start, Cache->Stage + Start * BlockSize);
+    }
+  }
+
+  //
+  // Keep the blocks read ahead that aren't cached yet.
+  //
+  for (Index = BlockNum; Index < BlockNum + ExtraRead; Index++) {
+    if (DiskIoCacheLookup (Cache, Lba + Index) == NULL) {
+      DiskIoCacheUpdate (Cache, Lba + Index, Cache->Stage + Index * BlockSize);
+      Cache->ReadAheads++;
+    }
+  }
+
+  CopyMem (Buffer, Cache->Stage + UnderRun, BufferSize);
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Write BufferSize bytes from Buffer to Offset through the block cache.
+  The request must span no more than DATA_BUFFER_BLOCK_NUM blocks.
+
+  @param  Private               The Disk I/O instance.
+  @param  Offset                The starting byte offset to write to.
+  @param  BufferSize            Size of Buffer.
+  @param  Buffer                Buffer holding the data.
+
+  @retval EFI_SUCCESS           The data was written.
+  @retval other                 The device reported an error.
+
+**/
+EFI_STATUS
+DiskIoCacheWrite (
+  IN DISK_IO_PRIVATE_DATA  *Private,
+  IN UINT64                Offset,
+  IN UINTN                 BufferSize,
+  IN VOID                  *Buffer
+  )
+{
+  EFI_STATUS           Status;
+  DISK_IO_CACHE        *Cache;
+  EFI_LBA              Lba;
+  UINT32               UnderRun;
+  UINT32               BlockSize;
+  UINTN                BlockNum;
+  UINTN                Index;
+
+  Cache     = Private->Cache;
+  BlockSize = Cache->BlockSize;
+
+  Lba       = DivU64x32Remainder (Offset, BlockSize, &UnderRun);
+  BlockNum  = (UnderRun + BufferSize + BlockSize - 1) / BlockSize;
+
+  ASSERT (BlockNum <= DATA_BUFFER_BLOCK_NUM);
+
+  //
+  // Read modify write the first and the last block if they are
+  // partially written.
+  //
+  if ((UnderRun != 0) || (BufferSize < BlockSize)) {
+    Status = DiskIoCacheFetch (Private, Lba, Cache->Stage);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if ((BlockNum > 1) && ((UnderRun + BufferSize) % BlockSize != 0)) {
+    Status = DiskIoCacheFetch (
+               Private,
+               Lba + BlockNum - 1,
+               Cache->Stage + (BlockNum - 1) * BlockSize
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  CopyMem (Cache->Stage + UnderRun, Buffer, BufferSize);
+
+  Status = Private->BlockIo->WriteBlocks (
+                               Private->BlockIo,
+                               Cache->MediaId,
+                               Lba,
+                               BlockNum * BlockSize,
+                               Cache->Stage
+                               );
+  if (EFI_ERROR (Status)) {
+    DiskIoCacheInvalidate (Private, Lba, BlockNum);
+    return Status;
+  }
+
+  for (Index = 0; Index < BlockNum; Index++) {
+    DiskIoCacheUpdate (Cache, Lba + Index, Cache->Stage + Index * BlockSize);
+  }
+
+  return EFI_SUCCESS;
+}
@@ -26,6 +26,10 @@
   Then write the spare memory buffer into the spare block.
   Final copy the data from the spare block to the target block.
 
+  The Fault Tolerant Write Batch protocol writes a group of updates this way. The
+  consecutive updates that fit in one spare area size range share one write record
+  and one spare block cycle, and the spare block is saved and restored once per call.
+
   To make this drive work well, the following conditions must be satisfied:
   1. The write NumBytes data must be fit within Spare area. 
      Offset + NumBytes <= SpareAreaLength
@@ -161,6 +165,7 @@ FtwAllocate (
     }
 
     FtwHeader = FtwDevice->FtwLastWriteHeader;
+    Offset    = (UINT8 *) FtwHeader - (UINT8 *) FtwDevice->FtwWorkSpace;
   }
   //
   // Prepare FTW write header,
@@ -316,127 +321,74 @@ FtwWriteRecord (
 }
 
 /**
-  Starts a target block update. This function will record data about write
-  in fault tolerant storage and will complete the write in a recoverable
-  manner, ensuring at all times that either the original contents or
-  the modified contents are available.
+  Write the data of a group of updates of one spare area size range with a
+  single write record and a single spare block cycle.
+
+  The current last write record of the work space must be unused. The spare
+  block content is not preserved; the caller saves and restores it.
 
   @param This            The pointer to this protocol instance. 
+  @param Fvb             The FVB protocol that provides services for
+                         reading, writing, and erasing the target block.
   @param Lba             The logical block address of the target block.
-  @param Offset          The offset within the target block to place the data.
-  @param Length          The number of bytes to write to the target block.
   @param PrivateData     A pointer to private data that the caller requires to
                          complete any pending writes in the event of a fault.
-  @param FvBlockHandle   The handle of FVB protocol that provides services for
-                         reading, writing, and erasing the target block.
-  @param Buffer          The data to write.
+  @param EntryCount      Number of entries in Entries.
+  @param Entries         The updates. Each of them must be within SpareAreaLength
+                         bytes from the start of Lba.
 
   @retval EFI_SUCCESS          The function completed successfully 
   @retval EFI_ABORTED          The function could not complete successfully. 
-  @retval EFI_BAD_BUFFER_SIZE  The input data can't fit within the spare block. 
-                               Offset + *NumBytes > SpareAreaLength.
-  @retval EFI_ACCESS_DENIED    No writes have been allocated. 
   @retval EFI_OUT_OF_RESOURCES Cannot allocate enough memory resource.
-  @retval EFI_NOT_FOUND        Cannot find FVB protocol by handle.
 
 **/
 EFI_STATUS
-EFIAPI
-FtwWrite (
+FtwWriteData (
   IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL     *This,
+  IN EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL    *Fvb,
   IN EFI_LBA                               Lba,
-  IN UINTN                                 Offset,
-  IN UINTN                                 Length,
   IN VOID                                  *PrivateData,
-  IN EFI_HANDLE                            FvBlockHandle,
-  IN VOID                                  *Buffer
+  IN UINTN                                 EntryCount,
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY  *Entries
   )
 {
   EFI_STATUS                          Status;
   EFI_FTW_DEVICE                      *FtwDevice;
   EFI_FAULT_TOLERANT_WRITE_HEADER     *Header;
   EFI_FAULT_TOLERANT_WRITE_RECORD     *Record;
-  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
   UINTN                               MyLength;
   UINTN                               MyOffset;
-  UINTN                               MyBufferSize;
   UINT8                               *MyBuffer;
-  UINTN                               SpareBufferSize;
-  UINT8                               *SpareBuffer;
   UINTN                               Index;
+  UINTN                               Start;
+  UINTN                               End;
+  UINTN                               EntryOffset;
   UINT8                               *Ptr;
   EFI_PHYSICAL_ADDRESS                FvbPhysicalAddress;
 
   FtwDevice = FTW_CONTEXT_FROM_THIS (This);
+  Header    = FtwDevice->FtwLastWriteHeader;
+  Record    = FtwDevice->FtwLastWriteRecord;
 
-  Status    = WorkSpaceRefresh (FtwDevice);
+  Status = Fvb->GetPhysicalAddress (Fvb, &FvbPhysicalAddress);
   if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "FtwLite: Get FVB physical address - %r\n", Status));
     return EFI_ABORTED;
   }
 
-  Header  = FtwDevice->FtwLastWriteHeader;
-  Record  = FtwDevice->FtwLastWriteRecord;
-  
-  if (IsErasedFlashBuffer ((UINT8 *) Header, sizeof (EFI_FAULT_TOLERANT_WRITE_HEADER))) {
-    if (PrivateData == NULL) {
-      //
-      // Ftw Write Header is not allocated.
-      // No additional private data, the private data size is zero. Number of record can be set to 1.
-      //
-      Status = FtwAllocate (This, &gEfiCallerIdGuid, 0, 1);
-      if (EFI_ERROR (Status)) {
-        return Status;
-      }
-    } else {
-      //
-      // Ftw Write Header is not allocated
-      // Additional private data is not NULL, the private data size can't be determined.
-      //
-      DEBUG ((EFI_D_ERROR, "Ftw: no allocates space for write record!\n"));
-      DEBUG ((EFI_D_ERROR, "Ftw: Allocate service should be called before Write service!\n"));
-      return EFI_NOT_READY;
-    }
-  }
-
   //
-  // If Record is out of the range of Header, return access denied.
+  // The record covers the union of the updated ranges.
   //
-  if (((UINTN)((UINT8 *) Record - (UINT8 *) Header)) > WRITE_TOTAL_SIZE (Header->NumberOfWrites - 1, Header->PrivateDataSize)) {
-    return EFI_ACCESS_DENIED;
-  }
-
-  //
-  // Check the COMPLETE flag of last write header
-  //
-  if (Header->Complete == FTW_VALID_STATE) {
-    return EFI_ACCESS_DENIED;
-  }
-
-  if (Record->DestinationComplete == FTW_VALID_STATE) {
-    return EFI_ACCESS_DENIED;
-  }
-
-  if ((Record->SpareComplete == FTW_VALID_STATE) && (Record->DestinationComplete != FTW_VALID_STATE)) {
-    return EFI_NOT_READY;
-  }
-  //
-  // Check if the input data can fit within the target block
-  //
-  if ((Offset + Length) > FtwDevice->SpareAreaLength) {
-    return EFI_BAD_BUFFER_SIZE;
-  }
-  //
-  // Get the FVB protocol by handle
-  //
-  Status = FtwGetFvbByHandle (FvBlockHandle, &Fvb);
-  if (EFI_ERROR (Status)) {
-    return EFI_NOT_FOUND;
-  }
-
-  Status = Fvb->GetPhysicalAddress (Fvb, &FvbPhysicalAddress);
-  if (EFI_ERROR (Status)) {
-    DEBUG ((EFI_D_ERROR, "FtwLite: Get FVB physical address - %r\n", Status));
-    return EFI_ABORTED;
+  Start = FtwDevice->SpareAreaLength;
+  End   = 0;
+  for (Index = 0; Index < EntryCount; Index += 1) {
+    EntryOffset = (UINTN) (Entries[Index].Lba - Lba) * FtwDevice->BlockSize + Entries[Index].Offset;
+    if (EntryOffset < Start) {
+      Start = EntryOffset;
+    }
+    if (EntryOffset + Entries[Index].Length > End) {
+      End = EntryOffset + Entries[Index].Length;
+    }
   }
 
   //
@@ -449,8 +401,8 @@ FtwWrite (
   // Write the record to the work space.
   //
   Record->Lba     = Lba;
-  Record->Offset  = Offset;
-  Record->Length  = Length;
+  Record->Offset  = Start;
+  Record->Length  = End - Start;
   Record->FvBaseAddress = FvbPhysicalAddress;
   if (PrivateData != NULL) {
     CopyMem ((Record + 1), PrivateData, Header->PrivateDataSize);
@@ -475,8 +427,7 @@ FtwWrite (
   //
   // Allocate a memory buffer
   //
-  MyBufferSize  = FtwDevice->SpareAreaLength;
-  MyBuffer      = AllocatePool (MyBufferSize);
+  MyBuffer = AllocatePool (FtwDevice->SpareAreaLength);
   if (MyBuffer == NULL) {
     return EFI_OUT_OF_RESOURCES;
   }
@@ -495,66 +446,22 @@ FtwWrite (
     Ptr += MyLength;
   }
   //
-  // Overwrite the updating range data with
-  // the input buffer content
-  //
-  CopyMem (MyBuffer + Offset, Buffer, Length);
-
-  //
-  // Try to keep the content of spare block
-  // Save spare block into a spare backup memory buffer (Sparebuffer)
+  // Overwrite the updating ranges with the input buffer contents,
+  // in order, so a later update of the same bytes wins.
   //
-  SpareBufferSize = FtwDevice->SpareAreaLength;
-  SpareBuffer     = AllocatePool (SpareBufferSize);
-  if (SpareBuffer == NULL) {
-    FreePool (MyBuffer);
-    return EFI_OUT_OF_RESOURCES;
+  for (Index = 0; Index < EntryCount; Index += 1) {
+    EntryOffset = (UINTN) (Entries[Index].Lba - Lba) * FtwDevice->BlockSize + Entries[Index].Offset;
+    CopyMem (MyBuffer + EntryOffset, Entries[Index].Buffer, Entries[Index].Length);
   }
 
-  Ptr = SpareBuffer;
-  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
-    MyLength = FtwDevice->BlockSize;
-    Status = FtwDevice->FtwBackupFvb->Read (
-                                        FtwDevice->FtwBackupFvb,
-                                        FtwDevice->FtwSpareLba + Index,
-                                        0,
-                                        &MyLength,
-                                        Ptr
-                                        );
-    if (EFI_ERROR (Status)) {
-      FreePool (MyBuffer);
-      FreePool (SpareBuffer);
-      return EFI_ABORTED;
-    }
-
-    Ptr += MyLength;
-  }
   //
   // Write the memory buffer to spare block
   //
-  Status  = FtwEraseSpareBlock (FtwDevice);
-  Ptr     = MyBuffer;
-  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
-    MyLength = FtwDevice->BlockSize;
-    Status = FtwDevice->FtwBackupFvb->Write (
-                                        FtwDevice->FtwBackupFvb,
-                                        FtwDevice->FtwSpareLba + Index,
-                                        0,
-                                        &MyLength,
-                                        Ptr
-                                        );
-    if (EFI_ERROR (Status)) {
-      FreePool (MyBuffer);
-      FreePool (SpareBuffer);
-      return EFI_ABORTED;
-    }
-
-    Ptr += MyLength;
-  }
-  //
-  // Free MyBuffer
-  //
+  Status = FtwWriteSpareBlock (FtwDevice, MyBuffer);
   FreePool (MyBuffer);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
 
   //
   // Set the SpareComplete in the FTW record,
@@ -567,7 +474,6 @@ FtwWrite (
             SPARE_COMPLETED
             );
   if (EFI_ERROR (Status)) {
-    FreePool (SpareBuffer);
     return EFI_ABORTED;
   }
 
@@ -579,34 +485,165 @@ FtwWrite (
   //
   Status = FtwWriteRecord (This, Fvb);
   if (EFI_ERROR (Status)) {
-    FreePool (SpareBuffer);
     return EFI_ABORTED;
   }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Starts a target block update. This function will record data about write
+  in fault tolerant storage and will complete the write in a recoverable
+  manner, ensuring at all times that either the original contents or
+  the modified contents are available.
+
+  @param This            The pointer to this protocol instance. 
+  @param Lba             The logical block address of the target block.
+  @param Offset          The offset within the target block to place the data.
+  @param Length          The number of bytes to write to the target block.
+  @param PrivateData     A pointer to private data that the caller requires to
+                         complete any pending writes in the event of a fault.
+  @param FvBlockHandle   The handle of FVB protocol that provides services for
+                         reading, writing, and erasing the target block.
+  @param Buffer          The data to write.
+
+  @retval EFI_SUCCESS          The function completed successfully 
+  @retval EFI_ABORTED          The function could not complete successfully. 
+  @retval EFI_BAD_BUFFER_SIZE  The input data can't fit within the spare block. 
+                               Offset + *NumBytes > SpareAreaLength.
+  @retval EFI_ACCESS_DENIED    No writes have been allocated. 
+  @retval EFI_OUT_OF_RESOURCES Cannot allocate enough memory resource.
+  @retval EFI_NOT_FOUND        Cannot find FVB protocol by handle.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL     *This,
+  IN EFI_LBA                               Lba,
+  IN UINTN                                 Offset,
+  IN UINTN                                 Length,
+  IN VOID                                  *PrivateData,
+  IN EFI_HANDLE                            FvBlockHandle,
+  IN VOID                                  *Buffer
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FTW_DEVICE                      *FtwDevice;
+  EFI_FAULT_TOLERANT_WRITE_HEADER     *Header;
+  EFI_FAULT_TOLERANT_WRITE_RECORD     *Record;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  UINT8                               *SpareBuffer;
+  EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY Entry;
+
+  FtwDevice = FTW_CONTEXT_FROM_THIS (This);
+
+  Status    = WorkSpaceRefresh (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
+  Header  = FtwDevice->FtwLastWriteHeader;
+  Record  = FtwDevice->FtwLastWriteRecord;
+  
+  if (IsErasedFlashBuffer ((UINT8 *) Header, sizeof (EFI_FAULT_TOLERANT_WRITE_HEADER))) {
+    if (PrivateData == NULL) {
+      //
+      // Ftw Write Header is not allocated.
+      // No additional private data, the private data size is zero. Number of record can be set to 1.
+      //
+      Status = FtwAllocate (This, &gEfiCallerIdGuid, 0, 1);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+      //
+      // The allocation may have reclaimed the work space, which moves the header.
+      //
+      Status = WorkSpaceRefresh (FtwDevice);
+      if (EFI_ERROR (Status)) {
+        return EFI_ABORTED;
+      }
+
+      Header  = FtwDevice->FtwLastWriteHeader;
+      Record  = FtwDevice->FtwLastWriteRecord;
+    } else {
+      //
+      // Ftw Write Header is not allocated
+      // Additional private data is not NULL, the private data size can't be determined.
+      //
+      DEBUG ((EFI_D_ERROR, "Ftw: no allocates space for write record!\n"));
+      DEBUG ((EFI_D_ERROR, "Ftw: Allocate service should be called before Write service!\n"));
+      return EFI_NOT_READY;
+    }
+  }
+
   //
-  // Restore spare backup buffer into spare block , if no failure happened during FtwWrite.
+  // If Record is out of the range of Header, return access denied.
   //
-  Status  = FtwEraseSpareBlock (FtwDevice);
-  Ptr     = SpareBuffer;
-  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
-    MyLength = FtwDevice->BlockSize;
-    Status = FtwDevice->FtwBackupFvb->Write (
-                                        FtwDevice->FtwBackupFvb,
-                                        FtwDevice->FtwSpareLba + Index,
-                                        0,
-                                        &MyLength,
-                                        Ptr
-                                        );
-    if (EFI_ERROR (Status)) {
-      FreePool (SpareBuffer);
-      return EFI_ABORTED;
-    }
+  if (((UINTN)((UINT8 *) Record - (UINT8 *) Header)) > WRITE_TOTAL_SIZE (Header->NumberOfWrites - 1, Header->PrivateDataSize)) {
+    return EFI_ACCESS_DENIED;
+  }
 
-    Ptr += MyLength;
+  //
+  // Check the COMPLETE flag of last write header
+  //
+  if (Header->Complete == FTW_VALID_STATE) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  if (Record->DestinationComplete == FTW_VALID_STATE) {
+    return EFI_ACCESS_DENIED;
+  }
+
+  if ((Record->SpareComplete == FTW_VALID_STATE) && (Record->DestinationComplete != FTW_VALID_STATE)) {
+    return EFI_NOT_READY;
   }
   //
-  // All success.
+  // Check if the input data can fit within the target block
   //
+  if ((Offset + Length) > FtwDevice->SpareAreaLength) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+  //
+  // Get the FVB protocol by handle
+  //
+  Status = FtwGetFvbByHandle (FvBlockHandle, &Fvb);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Try to keep the content of spare block
+  // Save spare block into a spare backup memory buffer (Sparebuffer)
+  //
+  SpareBuffer = AllocatePool (FtwDevice->SpareAreaLength);
+  if (SpareBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = FtwReadSpareBlock (FtwDevice, SpareBuffer);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return EFI_ABORTED;
+  }
+
+  Entry.Lba    = Lba;
+  Entry.Offset = Offset;
+  Entry.Length = Length;
+  Entry.Buffer = Buffer;
+  Status = FtwWriteData (This, Fvb, Lba, PrivateData, 1, &Entry);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return Status;
+  }
+  //
+  // Restore spare backup buffer into spare block , if no failure happened during FtwWrite.
+  //
+  Status = FtwWriteSpareBlock (FtwDevice, SpareBuffer);
   FreePool (SpareBuffer);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
 
   DEBUG (
     (EFI_D_ERROR,
@@ -863,6 +900,168 @@ FtwGetLastWrite (
   return Status;
 }
 
+//
+// Fault Tolerant Write Batch Protocol API
+//
+/**
+  Count the updates at the start of an array that fit in the spare area size
+  range starting at the Lba of the first of them.
+
+  @param FtwDevice       The private data of FTW driver.
+  @param Entries         The updates.
+  @param EntryCount      Number of entries in Entries, at least 1.
+
+  @return The number of updates that can share one write record.
+
+**/
+UINTN
+FtwBatchGroupSize (
+  IN EFI_FTW_DEVICE                        *FtwDevice,
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY  *Entries,
+  IN UINTN                                 EntryCount
+  )
+{
+  UINTN    Index;
+  EFI_LBA  Lba;
+
+  Lba = Entries[0].Lba;
+  for (Index = 1; Index < EntryCount; Index += 1) {
+    if ((Entries[Index].Lba < Lba) || (Entries[Index].Lba - Lba >= FtwDevice->NumberOfSpareBlock)) {
+      break;
+    }
+
+    if ((UINTN) (Entries[Index].Lba - Lba) * FtwDevice->BlockSize + Entries[Index].Offset + Entries[Index].Length >
+        FtwDevice->SpareAreaLength) {
+      break;
+    }
+  }
+
+  return Index;
+}
+
+/**
+  Writes a group of block updates in a fault tolerant manner.
+
+  Consecutive updates that fall in the spare area size from the Lba of the first
+  of them are merged into one write record, so they share one spare block cycle.
+  The spare block is saved before the first record and restored after the last.
+
+  @param This            The pointer to this protocol instance.
+  @param CallerId        The GUID identifying the writes.
+  @param FvBlockHandle   The handle of FVB protocol that provides services for
+                         reading, writing, and erasing the target blocks.
+  @param EntryCount      Number of entries in Entries.
+  @param Entries         The block updates.
+
+  @retval EFI_SUCCESS           All the updates were written.
+  @retval EFI_INVALID_PARAMETER CallerId or Entries is NULL, or EntryCount is 0.
+  @retval EFI_BAD_BUFFER_SIZE   The data of an update can't fit within the spare block.
+  @retval EFI_BUFFER_TOO_SMALL  The work space can't hold the write records.
+  @retval EFI_ACCESS_DENIED     A previous fault tolerant write has not completed.
+  @retval EFI_NOT_FOUND         Cannot find FVB protocol by handle.
+  @retval EFI_OUT_OF_RESOURCES  Cannot allocate enough memory resource.
+  @retval EFI_ABORTED           The writes could not complete successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwBatchWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This,
+  IN EFI_GUID                                 *CallerId,
+  IN EFI_HANDLE                               FvBlockHandle,
+  IN UINTN                                    EntryCount,
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY     *Entries
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_FTW_DEVICE                      *FtwDevice;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  UINT8                               *SpareBuffer;
+  UINTN                               Index;
+  UINTN                               Count;
+  UINTN                               RecordCount;
+
+  FtwDevice = FTW_CONTEXT_FROM_BATCH (This);
+
+  if ((CallerId == NULL) || (Entries == NULL) || (EntryCount == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < EntryCount; Index += 1) {
+    if ((Entries[Index].Buffer == NULL) && (Entries[Index].Length != 0)) {
+      return EFI_INVALID_PARAMETER;
+    }
+    //
+    // Check if the input data can fit within the target block
+    //
+    if ((Entries[Index].Offset + Entries[Index].Length) > FtwDevice->SpareAreaLength) {
+      return EFI_BAD_BUFFER_SIZE;
+    }
+  }
+  //
+  // Get the FVB protocol by handle
+  //
+  Status = FtwGetFvbByHandle (FvBlockHandle, &Fvb);
+  if (EFI_ERROR (Status)) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Save the spare block once for the whole batch.
+  //
+  SpareBuffer = AllocatePool (FtwDevice->SpareAreaLength);
+  if (SpareBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = FtwReadSpareBlock (FtwDevice, SpareBuffer);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return EFI_ABORTED;
+  }
+
+  //
+  // Allocate one write record per group of updates that share a spare block cycle.
+  //
+  RecordCount = 0;
+  for (Index = 0; Index < EntryCount; Index += Count) {
+    Count = FtwBatchGroupSize (FtwDevice, &Entries[Index], EntryCount - Index);
+    RecordCount += 1;
+  }
+
+  Status = FtwAllocate (&FtwDevice->FtwInstance, CallerId, 0, RecordCount);
+  if (EFI_ERROR (Status)) {
+    FreePool (SpareBuffer);
+    return Status;
+  }
+
+  for (Index = 0; Index < EntryCount; Index += Count) {
+    Count = FtwBatchGroupSize (FtwDevice, &Entries[Index], EntryCount - Index);
+
+    Status = WorkSpaceRefresh (FtwDevice);
+    if (!EFI_ERROR (Status)) {
+      Status = FtwWriteData (&FtwDevice->FtwInstance, Fvb, Entries[Index].Lba, NULL, Count, &Entries[Index]);
+    }
+    if (EFI_ERROR (Status)) {
+      FreePool (SpareBuffer);
+      return EFI_ABORTED;
+    }
+  }
+
+  //
+  // Restore spare backup buffer into spare block, if no failure happened during the writes.
+  //
+  Status = FtwWriteSpareBlock (FtwDevice, SpareBuffer);
+  FreePool (SpareBuffer);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
+  DEBUG ((EFI_D_INFO, "Ftw: BatchWrite() success, Caller:%g, %d updates in %d records\n", CallerId, EntryCount, RecordCount));
+
+  return EFI_SUCCESS;
+}
+
 VOID
 EFIAPI
 FvbNotificationEvent (
@@ -1143,16 +1342,19 @@ FvbNotificationEvent (
   FtwDevice->FtwInstance.Restart         = FtwRestart;
   FtwDevice->FtwInstance.Abort           = FtwAbort;
   FtwDevice->FtwInstance.GetLastWrite    = FtwGetLastWrite;
+  FtwDevice->FtwBatchInstance.Write      = FtwBatchWrite;
   
   //
   // Install protocol interface
   //
-  Status = gBS->InstallProtocolInterface (
-            &FtwDevice->Handle,
-            &gEfiFaultTolerantWriteProtocolGuid,
-            EFI_NATIVE_INTERFACE,
-            &FtwDevice->FtwInstance
-            );
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &FtwDevice->Handle,
+                  &gEfiFaultTolerantWriteProtocolGuid,
+                  &FtwDevice->FtwInstance,
+                  &gEfiFaultTolerantWriteBatchProtocolGuid,
+                  &FtwDevice->FtwBatchInstance,
+                  NULL
+                  );
 
   ASSERT_EFI_ERROR (Status);
   
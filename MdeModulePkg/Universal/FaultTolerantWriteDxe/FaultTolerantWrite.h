@@ -21,6 +21,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <Guid/SystemNvDataGuid.h>
 #include <Protocol/FaultTolerantWrite.h>
+#include <Protocol/FaultTolerantWriteBatch.h>
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Protocol/SwapAddressRange.h>
 
@@ -100,6 +101,7 @@ typedef struct {
   UINTN                                   Signature;
   EFI_HANDLE                              Handle;
   EFI_FAULT_TOLERANT_WRITE_PROTOCOL       FtwInstance;
+  EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL FtwBatchInstance;
   EFI_PHYSICAL_ADDRESS                    WorkSpaceAddress;   // Base address of working space range in flash.
   EFI_PHYSICAL_ADDRESS                    SpareAreaAddress;   // Base address of spare range in flash.
   UINTN                                   WorkSpaceLength;    // Size of working space range in flash.
@@ -124,6 +126,7 @@ typedef struct {
 } EFI_FTW_DEVICE;
 
 #define FTW_CONTEXT_FROM_THIS(a)  CR (a, EFI_FTW_DEVICE, FtwInstance, FTW_DEVICE_SIGNATURE)
+#define FTW_CONTEXT_FROM_BATCH(a) CR (a, EFI_FTW_DEVICE, FtwBatchInstance, FTW_DEVICE_SIGNATURE)
 
 //
 // Driver entry point
@@ -311,6 +314,44 @@ FtwGetLastWrite (
   OUT BOOLEAN                              *Complete
   );
 
+//
+// Fault Tolerant Write Batch Protocol API
+//
+
+/**
+  Writes a group of block updates in a fault tolerant manner.
+
+  Consecutive updates that fall in the spare area size from the Lba of the first
+  of them are merged into one write record, so they share one spare block cycle.
+  The spare block is saved before the first record and restored after the last.
+
+  @param This            The pointer to this protocol instance.
+  @param CallerId        The GUID identifying the writes.
+  @param FvBlockHandle   The handle of FVB protocol that provides services for
+                         reading, writing, and erasing the target blocks.
+  @param EntryCount      Number of entries in Entries.
+  @param Entries         The block updates.
+
+  @retval EFI_SUCCESS           All the updates were written.
+  @retval EFI_INVALID_PARAMETER CallerId or Entries is NULL, or EntryCount is 0.
+  @retval EFI_BAD_BUFFER_SIZE   The data of an update can't fit within the spare block.
+  @retval EFI_BUFFER_TOO_SMALL  The work space can't hold the write records.
+  @retval EFI_ACCESS_DENIED     A previous fault tolerant write has not completed.
+  @retval EFI_NOT_FOUND         Cannot find FVB protocol by handle.
+  @retval EFI_OUT_OF_RESOURCES  Cannot allocate enough memory resource.
+  @retval EFI_ABORTED           The writes could not complete successfully.
+
+**/
+EFI_STATUS
+EFIAPI
+FtwBatchWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_PROTOCOL  *This,
+  IN EFI_GUID                                 *CallerId,
+  IN EFI_HANDLE                               FvBlockHandle,
+  IN UINTN                                    EntryCount,
+  IN EFI_FAULT_TOLERANT_WRITE_BATCH_ENTRY     *Entries
+  );
+
 /**
   Erase spare block.
 
@@ -333,6 +374,38 @@ FtwEraseSpareBlock (
   IN EFI_FTW_DEVICE   *FtwDevice
   );
 
+/**
+  Read the whole spare block into a memory buffer.
+
+  @param FtwDevice        The private data of FTW driver
+  @param Buffer           The buffer of SpareAreaLength bytes that receives the data
+
+  @retval EFI_SUCCESS     The spare block was read.
+  @retval EFI_ABORTED     The spare block could not be read.
+
+**/
+EFI_STATUS
+FtwReadSpareBlock (
+  IN  EFI_FTW_DEVICE  *FtwDevice,
+  OUT UINT8           *Buffer
+  );
+
+/**
+  Erase the spare block and write a memory buffer into it.
+
+  @param FtwDevice        The private data of FTW driver
+  @param Buffer           The buffer of SpareAreaLength bytes to write
+
+  @retval EFI_SUCCESS     The spare block was written.
+  @retval EFI_ABORTED     The spare block could not be erased or written.
+
+**/
+EFI_STATUS
+FtwWriteSpareBlock (
+  IN EFI_FTW_DEVICE   *FtwDevice,
+  IN UINT8            *Buffer
+  );
+
 /**
   Retrive the proper FVB protocol interface by HANDLE.
 
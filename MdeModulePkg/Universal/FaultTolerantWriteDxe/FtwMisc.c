@@ -104,6 +104,89 @@ FtwEraseSpareBlock (
                                     );
 }
 
+/**
+  Read the whole spare block into a memory buffer.
+
+  @param FtwDevice        The private data of FTW driver
+  @param Buffer           The buffer of SpareAreaLength bytes that receives the data
+
+  @retval EFI_SUCCESS     The spare block was read.
+  @retval EFI_ABORTED     The spare block could not be read.
+
+**/
+EFI_STATUS
+FtwReadSpareBlock (
+  IN  EFI_FTW_DEVICE  *FtwDevice,
+  OUT UINT8           *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Length;
+  UINTN       Index;
+
+  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
+    Length = FtwDevice->BlockSize;
+    Status = FtwDevice->FtwBackupFvb->Read (
+                                        FtwDevice->FtwBackupFvb,
+                                        FtwDevice->FtwSpareLba + Index,
+                                        0,
+                                        &Length,
+                                        Buffer
+                                        );
+    if (EFI_ERROR (Status)) {
+      return EFI_ABORTED;
+    }
+
+    Buffer += Length;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Erase the spare block and write a memory buffer into it.
+
+  @param FtwDevice        The private data of FTW driver
+  @param Buffer           The buffer of SpareAreaLength bytes to write
+
+  @retval EFI_SUCCESS     The spare block was written.
+  @retval EFI_ABORTED     The spare block could not be erased or written.
+
+**/
+EFI_STATUS
+FtwWriteSpareBlock (
+  IN EFI_FTW_DEVICE   *FtwDevice,
+  IN UINT8            *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Length;
+  UINTN       Index;
+
+  Status = FtwEraseSpareBlock (FtwDevice);
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
+  for (Index = 0; Index < FtwDevice->NumberOfSpareBlock; Index += 1) {
+    Length = FtwDevice->BlockSize;
+    Status = FtwDevice->FtwBackupFvb->Write (
+                                        FtwDevice->FtwBackupFvb,
+                                        FtwDevice->FtwSpareLba + Index,
+                                        0,
+                                        &Length,
+                                        Buffer
+                                        );
+    if (EFI_ERROR (Status)) {
+      return EFI_ABORTED;
+    }
+
+    Buffer += Length;
+  }
+
+  return EFI_SUCCESS;
+}
+
 /**
   Retrive the proper FVB protocol interface by HANDLE.
 
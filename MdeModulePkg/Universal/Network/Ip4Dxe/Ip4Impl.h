@@ -95,12 +95,14 @@ typedef struct {
 /// All the fragments of the Packet is organized by a
 /// IP4_ASSEMBLE_ENTRY structure. If the Packet is recycled by
 /// the upper layer, the assemble entry and its associated
-/// fragments will be freed at last.
+/// fragments will be freed at last. If the Packet is shared
+/// with other IP4 children, its head is copied to Head.
 ///
 typedef struct {
   LIST_ENTRY                Link;
   IP4_PROTOCOL              *IpInstance;
   NET_BUF                   *Packet;
+  UINT32                    Head[IP4_MAX_HEADLEN / sizeof (UINT32)];
   EFI_IP4_RECEIVE_DATA      RxData;
 } IP4_RXDATA_WRAP;
 
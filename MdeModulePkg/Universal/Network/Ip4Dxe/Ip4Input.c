@@ -790,7 +790,6 @@ Ip4OnRecyclePacket (
   RemoveEntryList (&Wrap->Link);
   EfiReleaseLock (&Wrap->IpInstance->RecycleLock);
 
-  ASSERT (!NET_BUF_SHARED (Wrap->Packet));
   NetbufFree (Wrap->Packet);
 
   gBS->CloseEvent (Wrap->RxData.RecycleSignal);
@@ -801,10 +800,12 @@ Ip4OnRecyclePacket (
 /**
   Wrap the received packet to a IP4_RXDATA_WRAP, which will be
   delivered to the upper layer. Each IP4 child that accepts the
-  packet will get a not-shared copy of the packet which is wrapped
-  in the IP4_RXDATA_WRAP. The IP4_RXDATA_WRAP->RxData is passed
-  to the upper layer. Upper layer will signal the recycle event in
-  it when it is done with the packet.
+  packet will get a reference to the packet which is wrapped in
+  the IP4_RXDATA_WRAP. If the packet is shared with other children,
+  the IP head is copied into the wrap before it is converted to
+  network byte order, the data itself is never copied. The
+  IP4_RXDATA_WRAP->RxData is passed to the upper layer. Upper layer
+  will signal the recycle event in it when it is done with the packet.
 
   @param[in]  IpInstance             The IP4 child to receive the packet
   @param[in]  Packet                 The packet to deliver up.
@@ -821,6 +822,7 @@ Ip4WrapRxData (
 {
   IP4_RXDATA_WRAP           *Wrap;
   EFI_IP4_RECEIVE_DATA      *RxData;
+  IP4_HEAD                  *Head;
   EFI_STATUS                Status;
 
   Wrap = AllocatePool (IP4_RXDATA_WRAP_SIZE (Packet->BlockOpNum));
@@ -853,10 +855,19 @@ Ip4WrapRxData (
   ASSERT (Packet->Ip != NULL);
 
   //
-  // The application expects a network byte order header.
+  // The application expects a network byte order header. The
+  // head of a shared packet is also used by the other children,
+  // so convert a private copy of it.
   //
-  RxData->HeaderLength  = (Packet->Ip->HeadLen << 2);
-  RxData->Header        = (EFI_IP4_HEADER *) Ip4NtohHead (Packet->Ip);
+  Head = Packet->Ip;
+
+  if (NET_BUF_SHARED (Packet)) {
+    Head = (IP4_HEAD *) Wrap->Head;
+    CopyMem (Head, Packet->Ip, Packet->Ip->HeadLen << 2);
+  }
+
+  RxData->HeaderLength  = (Head->HeadLen << 2);
+  RxData->Header        = (EFI_IP4_HEADER *) Ip4NtohHead (Head);
 
   RxData->OptionsLength = RxData->HeaderLength - IP4_MIN_HEADLEN;
   RxData->Options       = NULL;
@@ -879,9 +890,9 @@ Ip4WrapRxData (
 
 /**
   Deliver the received packets to upper layer if there are both received
-  requests and enqueued packets. If the enqueued packet is shared, it will
-  duplicate it to a non-shared packet, release the shared packet, then
-  deliver the non-shared packet up.
+  requests and enqueued packets. The packet is delivered up by reference
+  even if it is shared with other IP4 children, the upper layer only
+  reads the data and releases its reference through the recycle event.
 
   @param[in]  IpInstance         The IP child to deliver the packet up.
 
@@ -899,8 +910,6 @@ Ip4InstanceDeliverPacket (
   EFI_IP4_COMPLETION_TOKEN  *Token;
   IP4_RXDATA_WRAP           *Wrap;
   NET_BUF                   *Packet;
-  NET_BUF                   *Dup;
-  UINT8                     *Head;
 
   //
   // Deliver a packet if there are both a packet and a receive token.
@@ -910,52 +919,18 @@ Ip4InstanceDeliverPacket (
 
     Packet = NET_LIST_HEAD (&IpInstance->Received, NET_BUF, List);
 
-    if (!NET_BUF_SHARED (Packet)) {
-      //
-      // If this is the only instance that wants the packet, wrap it up.
-      //
-      Wrap = Ip4WrapRxData (IpInstance, Packet);
-
-      if (Wrap == NULL) {
-        return EFI_OUT_OF_RESOURCES;
-      }
-
-      RemoveEntryList (&Packet->List);
-
-    } else {
-      //
-      // Create a duplicated packet if this packet is shared
-      //
-      Dup = NetbufDuplicate (Packet, NULL, IP4_MAX_HEADLEN);
-
-      if (Dup == NULL) {
-        return EFI_OUT_OF_RESOURCES;
-      }
-
-      //
-      // Copy the IP head over. The packet to deliver up is
-      // headless. Trim the head off after copy. The IP head
-      // may be not continuous before the data.
-      //
-      Head    = NetbufAllocSpace (Dup, IP4_MAX_HEADLEN, NET_BUF_HEAD);
-      Dup->Ip = (IP4_HEAD *) Head;
-
-      CopyMem (Head, Packet->Ip, Packet->Ip->HeadLen << 2);
-      NetbufTrim (Dup, IP4_MAX_HEADLEN, TRUE);
-
-      Wrap = Ip4WrapRxData (IpInstance, Dup);
-
-      if (Wrap == NULL) {
-        NetbufFree (Dup);
-        return EFI_OUT_OF_RESOURCES;
-      }
-
-      RemoveEntryList (&Packet->List);
-      NetbufFree (Packet);
+    //
+    // Wrap the packet up. If other instances also want the packet,
+    // they share its data, which is read only to the upper layers.
+    //
+    Wrap = Ip4WrapRxData (IpInstance, Packet);
 
-      Packet = Dup;
+    if (Wrap == NULL) {
+      return EFI_OUT_OF_RESOURCES;
     }
 
+    RemoveEntryList (&Packet->List);
+
     //
     // Insert it into the delivered packet, then get a user's
     // receive token, pass the wrapped packet up.
@@ -1098,10 +1073,10 @@ Ip4InterfaceDeliverPacket (
   Demultiple the packet. the packet delivery is processed in two
   passes. The first pass will enque a shared copy of the packet
   to each IP4 child that accepts the packet. The second pass will
-  deliver a non-shared copy of the packet to each IP4 child that
-  has pending receive requests. Data is copied if more than one
-  child wants to consume the packet because each IP child needs
-  its own copy of the packet to make changes.
+  deliver the packet to each IP4 child that has pending receive
+  requests. The packet data is delivered by reference even if more
+  than one child wants to consume it, only the IP head is copied
+  for each child because it is converted to network byte order.
 
   @param[in]  IpSb                   The IP4 service instance that received the packet
   @param[in]  Head                   The header of the received packet
@@ -1138,9 +1113,9 @@ Ip4Demultiplex (
   }
 
   //
-  // Second: deliver a duplicate of the packet to each instance.
-  // Release the local reference first, so that the last instance
-  // getting the packet will not copy the data.
+  // Second: deliver the packet to each instance. Release the local
+  // reference first, so that the last instance getting the packet
+  // will not copy the IP head.
   //
   NetbufFree (Packet);
 
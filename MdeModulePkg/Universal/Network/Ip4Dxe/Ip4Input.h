@@ -134,10 +134,10 @@ Ip4AccpetFrame (
   Demultiple the packet. the packet delivery is processed in two
   passes. The first pass will enque a shared copy of the packet
   to each IP4 child that accepts the packet. The second pass will
-  deliver a non-shared copy of the packet to each IP4 child that
-  has pending receive requests. Data is copied if more than one
-  child wants to consume the packet because each IP child needs
-  its own copy of the packet to make changes.
+  deliver the packet to each IP4 child that has pending receive
+  requests. The packet data is delivered by reference even if more
+  than one child wants to consume it, only the IP head is copied
+  for each child because it is converted to network byte order.
 
   @param[in]  IpSb                   The IP4 service instance that received the packet
   @param[in]  Head                   The header of the received packet
@@ -177,9 +177,9 @@ Ip4InterfaceEnquePacket (
 
 /**
   Deliver the received packets to upper layer if there are both received
-  requests and enqueued packets. If the enqueued packet is shared, it will
-  duplicate it to a non-shared packet, release the shared packet, then
-  deliver the non-shared packet up.
+  requests and enqueued packets. The packet is delivered up by reference
+  even if it is shared with other IP4 children, the upper layer only
+  reads the data and releases its reference through the recycle event.
 
   @param[in]  IpInstance         The IP child to deliver the packet up.
 
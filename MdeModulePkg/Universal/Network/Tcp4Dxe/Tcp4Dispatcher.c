@@ -126,7 +126,7 @@ Tcp4GetMode (
       Option->EnableTimeStamp     = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_TS));
       Option->EnableWindowScaling = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_WS));
 
-      Option->EnableSelectiveAck      = FALSE;
+      Option->EnableSelectiveAck      = (BOOLEAN) (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK));
       Option->EnablePathMtuDiscovery  = FALSE;
     }
   }
@@ -224,7 +224,7 @@ Tcp4FlushPcb (
   TcpProto = (TCP4_PROTO_DATA *) Sock->ProtoReserved;
 
   if (SOCK_IS_CONFIGURED (Sock)) {
-    RemoveEntryList (&Tcb->List);
+    TcpRemoveTcb (Tcb);
 
     //
     // Uninstall the device path protocl.
@@ -284,6 +284,8 @@ Tcp4AttachPcb (
   }
 
   InitializeListHead (&Tcb->List);
+  InitializeListHead (&Tcb->HashList);
+  InitializeListHead (&Tcb->PortList);
   InitializeListHead (&Tcb->SndQue);
   InitializeListHead (&Tcb->RcvQue);
 
@@ -448,7 +450,7 @@ Tcp4ConfigurePcb (
       Sk,
       (UINT32) (TCP_COMP_VAL (
                   TCP_RCV_BUF_SIZE_MIN,
-                  TCP_RCV_BUF_SIZE,
+                  TCP_RCV_BUF_SIZE_MAX,
                   TCP_RCV_BUF_SIZE,
                   Option->ReceiveBufferSize
                   )
@@ -458,7 +460,7 @@ Tcp4ConfigurePcb (
       Sk,
       (UINT32) (TCP_COMP_VAL (
                   TCP_SND_BUF_SIZE_MIN,
-                  TCP_SND_BUF_SIZE,
+                  TCP_SND_BUF_SIZE_MAX,
                   TCP_SND_BUF_SIZE,
                   Option->SendBufferSize
                   )
@@ -541,6 +543,10 @@ Tcp4ConfigurePcb (
     if (Option->EnableWindowScaling == FALSE) {
       TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_NO_WS);
     }
+
+    if (Option->EnableSelectiveAck == FALSE) {
+      TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_NO_SACK);
+    }
   }
 
   //
@@ -168,6 +168,9 @@ Tcp4DriverEntryPoint (
              &gTcp4ComponentName2
              );
   ASSERT_EFI_ERROR (Status);
+
+  TcpInitHash ();
+
   //
   // Initialize ISS and random port.
   //
@@ -76,6 +76,41 @@ TcpInsertTcb (
   IN TCP_CB *Tcb
   );
 
+/**
+  Remove a Tcb from its queue and the hash tables.
+
+  @param  Tcb                   Pointer to the TCP_CB to be removed.
+
+**/
+VOID
+TcpRemoveTcb (
+  IN TCP_CB *Tcb
+  );
+
+/**
+  Initialize the buckets of the TCB hash tables.
+
+**/
+VOID
+TcpInitHash (
+  VOID
+  );
+
+/**
+  Compute the run hash bucket of a socket pair.
+
+  @param  Local                 Pointer to the local (IP, Port).
+  @param  Remote                Pointer to the remote (IP, Port).
+
+  @return  The index of the bucket in mTcpRunHash.
+
+**/
+UINTN
+TcpHashTuple (
+  IN TCP_PEER *Local,
+  IN TCP_PEER *Remote
+  );
+
 /**
   Clone a TCP_CB from Tcb.
 
@@ -308,6 +343,22 @@ TcpRetransmit (
   IN TCP_SEQNO Seq
   );
 
+/**
+  Retransmit the first hole in the SACK scoreboard. A hole is the data
+  on the SndQue that is neither SACKed by the peer nor retransmitted in
+  the current fast recovery, and that is followed by SACKed data.
+
+  @param  Tcb     Pointer to the TCP_CB of this TCP instance.
+
+  @retval 1       A hole is retransmitted.
+  @retval 0       No hole is found or the retransmission failed.
+
+**/
+INTN
+TcpSackRetransmit (
+  IN OUT TCP_CB *Tcb
+  );
+
 /**
   Compute how much data to send.
 
@@ -552,6 +603,34 @@ TcpAdjustSndQue (
   IN TCP_SEQNO Ack
   );
 
+/**
+  Update the SACK scoreboard in the send queue. The segments on the
+  SndQue that are completely covered by the SACK blocks the peer sent
+  are marked as SACKed, so they are not retransmitted in fast recovery.
+
+  @param  Tcb      Pointer to the TCP_CB of this TCP instance.
+  @param  Option   Pointer to the options of the received segment.
+
+**/
+VOID
+TcpSackMarkSndQue (
+  IN TCP_CB     *Tcb,
+  IN TCP_OPTION *Option
+  );
+
+/**
+  Clear the SACK scoreboard in the send queue. RFC2018 requires the
+  sender to ignore the SACK information after a retransmission timeout,
+  because the receiver may discard the data it has SACKed.
+
+  @param  Tcb      Pointer to the TCP_CB of this TCP instance.
+
+**/
+VOID
+TcpSackClearSndQue (
+  IN TCP_CB     *Tcb
+  );
+
 //
 // Functions from Tcp4Misc.c
 //
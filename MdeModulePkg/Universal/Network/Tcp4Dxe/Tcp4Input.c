@@ -38,7 +38,8 @@ TcpSeqAcceptable (
 
 
 /**
-  NewReno fast recovery, RFC3782.
+  NewReno fast recovery, RFC3782. If SACK is in use, the holes
+  in the SACK scoreboard are retransmitted as RFC2018 suggests.
 
   @param  Tcb      Pointer to the TCP_CB of this TCP instance.
   @param  Seg      Segment that triggers the fast recovery.
@@ -65,6 +66,7 @@ TcpFastRecover (
 
     Tcb->Ssthresh     = MAX (FlightSize >> 1, (UINT32) (2 * Tcb->SndMss));
     Tcb->Recover      = Tcb->SndNxt;
+    Tcb->SackRexmit   = Tcb->SndUna;
 
     Tcb->CongestState = TCP_CONGEST_RECOVER;
     TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_RTT_ON);
@@ -88,12 +90,18 @@ TcpFastRecover (
     //
     // Step 3: Fast Recovery,
     // If this is a duplicated ACK, increse Cwnd by SMSS.
+    // With SACK, the segment that has left the network is
+    // replaced by the next hole in the scoreboard instead.
     //
 
     // Step 4 is skipped here only to be executed later
     // by TcpToSendData
     //
-    Tcb->CWnd += Tcb->SndMss;
+    if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) ||
+        (TcpSackRetransmit (Tcb) == 0)) {
+
+      Tcb->CWnd += Tcb->SndMss;
+    }
     DEBUG ((EFI_D_INFO, "TcpFastRecover: received another"
       " duplicated ACK (%d) for TCB %p\n", Seg->Ack, Tcb));
 
@@ -122,9 +130,19 @@ TcpFastRecover (
       //
       // Step 5 - Partial ACK:
       // fast retransmit the first unacknowledge field
-      // , then deflate the CWnd
+      // , then deflate the CWnd. With SACK, the data at
+      // SEG.ACK may have been retransmitted already, then
+      // retransmit the next hole.
       //
-      TcpRetransmit (Tcb, Seg->Ack);
+      if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) ||
+          TCP_SEQ_GEQ (Seg->Ack, Tcb->SackRexmit)) {
+
+        TcpRetransmit (Tcb, Seg->Ack);
+      } else {
+
+        TcpSackRetransmit (Tcb);
+      }
+
       Acked = TCP_SUB_SEQ (Seg->Ack, Tcb->SndUna);
 
       //
@@ -550,6 +568,12 @@ TcpQueueData (
   Seg   = TCPSEG_NETBUF (Nbuf);
   Head  = &Tcb->RcvQue;
 
+  //
+  // Remember the latest segment, its block is reported
+  // first in the SACK option.
+  //
+  Tcb->RcvSackSeq = Seg->Seq;
+
   //
   // Fast path to process normal case. That is,
   // no out-of-order segments are received.
@@ -676,6 +700,85 @@ TcpAdjustSndQue (
 }
 
 
+/**
+  Update the SACK scoreboard in the send queue. The segments on the
+  SndQue that are completely covered by the SACK blocks the peer sent
+  are marked as SACKed, so they are not retransmitted in fast recovery.
+
+  @param  Tcb      Pointer to the TCP_CB of this TCP instance.
+  @param  Option   Pointer to the options of the received segment.
+
+**/
+VOID
+TcpSackMarkSndQue (
+  IN TCP_CB     *Tcb,
+  IN TCP_OPTION *Option
+  )
+{
+  LIST_ENTRY      *Entry;
+  NET_BUF         *Node;
+  TCP_SEG         *Seg;
+  TCP_SACK_BLOCK  *Block;
+  TCP_SEQNO       MaxSndNxt;
+  UINT32          Index;
+
+  MaxSndNxt = TcpGetMaxSndNxt (Tcb);
+
+  for (Index = 0; Index < Option->SackNum; Index++) {
+    Block = &Option->Sack[Index];
+
+    //
+    // Ignore the blocks that are not in the outstanding data,
+    // such as a D-SACK block or a bogus one.
+    //
+    if (!TCP_SEQ_LT (Block->Left, Block->Right) ||
+        TCP_SEQ_LEQ (Block->Left, Tcb->SndUna) ||
+        TCP_SEQ_GT (Block->Right, MaxSndNxt)) {
+
+      continue;
+    }
+
+    NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+      Node  = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
+      Seg   = TCPSEG_NETBUF (Node);
+
+      if (TCP_SEQ_GEQ (Seg->Seq, Block->Right)) {
+        break;
+      }
+
+      if (TCP_SEQ_GEQ (Seg->Seq, Block->Left) &&
+          TCP_SEQ_LEQ (Seg->End, Block->Right)) {
+
+        Seg->Sacked = TRUE;
+      }
+    }
+  }
+}
+
+
+/**
+  Clear the SACK scoreboard in the send queue. RFC2018 requires the
+  sender to ignore the SACK information after a retransmission timeout,
+  because the receiver may discard the data it has SACKed.
+
+  @param  Tcb      Pointer to the TCP_CB of this TCP instance.
+
+**/
+VOID
+TcpSackClearSndQue (
+  IN TCP_CB     *Tcb
+  )
+{
+  LIST_ENTRY      *Entry;
+  NET_BUF         *Node;
+
+  NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+    Node = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
+    TCPSEG_NETBUF (Node)->Sacked = FALSE;
+  }
+}
+
+
 /**
   Process the received TCP segments.
 
@@ -1095,6 +1198,16 @@ TcpInput (
     TcpSetTimer (Tcb, TCP_TIMER_REXMIT, Tcb->Rto);
   }
 
+  //
+  // Update the SACK scoreboard before the fast recovery
+  // looks for the holes to retransmit.
+  //
+  if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) &&
+      TCP_FLG_ON (Option.Flag, TCP_OPTION_RCVD_SACK)) {
+
+    TcpSackMarkSndQue (Tcb, &Option);
+  }
+
   //
   // Count duplicate acks.
   //
@@ -1328,6 +1441,10 @@ StepSix:
       goto RESET_THEN_DROP;
     }
 
+    if (Nbuf->TotalSize != 0) {
+      Tcb->DataSegRcvd++;
+    }
+
     TcpQueueData (Tcb, Nbuf);
     if (TcpDeliverData (Tcb) == -1) {
       goto RESET_THEN_DROP;
@@ -27,6 +27,15 @@ LIST_ENTRY      mTcpListenQue = {
   &mTcpListenQue
 };
 
+//
+// The hash tables index the TCBs on the above two queues so that
+// the incoming segments needn't walk all of them. They are set
+// up by TcpInitHash when the driver is loaded.
+//
+LIST_ENTRY      mTcpRunHash[TCP_HASH_SIZE];
+LIST_ENTRY      mTcpListenHash[TCP_HASH_SIZE];
+LIST_ENTRY      mTcpPortHash[TCP_HASH_SIZE];
+
 TCP_SEQNO       mTcpGlobalIss = 0x4d7e980b;
 
 CHAR16   *mTcpStateName[] = {
@@ -151,6 +160,12 @@ TcpInitTcbPeer (
     Tcb->RcvWndScale = 0;
   }
 
+  if (TCP_FLG_ON (Opt->Flag, TCP_OPTION_RCVD_SACK_PERM) &&
+      !TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK)) {
+
+    TCP_SET_FLG (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK);
+  }
+
   if (TCP_FLG_ON (Opt->Flag, TCP_OPTION_RCVD_TS) &&
       !TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_TS)) {
 
@@ -167,6 +182,51 @@ TcpInitTcbPeer (
 }
 
 
+/**
+  Initialize the buckets of the TCB hash tables.
+
+**/
+VOID
+TcpInitHash (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TCP_HASH_SIZE; Index++) {
+    InitializeListHead (&mTcpRunHash[Index]);
+    InitializeListHead (&mTcpListenHash[Index]);
+    InitializeListHead (&mTcpPortHash[Index]);
+  }
+}
+
+
+/**
+  Compute the run hash bucket of a socket pair.
+
+  @param  Local                 Pointer to the local (IP, Port).
+  @param  Remote                Pointer to the remote (IP, Port).
+
+  @return  The index of the bucket in mTcpRunHash.
+
+**/
+UINTN
+TcpHashTuple (
+  IN TCP_PEER *Local,
+  IN TCP_PEER *Remote
+  )
+{
+  UINT32  Hash;
+
+  Hash  = Local->Ip ^ Remote->Ip;
+  Hash ^= ((UINT32) Local->Port << 16) | Remote->Port;
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+
+  return (UINTN) (Hash & (TCP_HASH_SIZE - 1));
+}
+
+
 /**
   Locate a listen TCB that matchs the Local and Remote.
 
@@ -192,8 +252,8 @@ TcpLocateListenTcb (
   Last  = 4;
   Match = NULL;
 
-  NET_LIST_FOR_EACH (Entry, &mTcpListenQue) {
-    Node = NET_LIST_USER_STRUCT (Entry, TCP_CB, List);
+  NET_LIST_FOR_EACH (Entry, &mTcpListenHash[TCP_PORT_HASH (Local->Port)]) {
+    Node = NET_LIST_USER_STRUCT (Entry, TCP_CB, HashList);
 
     if ((Local->Port != Node->LocalEnd.Port) ||
         !TCP_PEER_MATCH (Remote, &Node->RemoteEnd) ||
@@ -255,18 +315,8 @@ TcpFindTcbByPeer (
 
   LocalPort = HTONS (Port);
 
-  NET_LIST_FOR_EACH (Entry, &mTcpListenQue) {
-    Tcb = NET_LIST_USER_STRUCT (Entry, TCP_CB, List);
-
-    if (EFI_IP4_EQUAL (Addr, &Tcb->LocalEnd.Ip) &&
-      (LocalPort == Tcb->LocalEnd.Port)) {
-
-      return TRUE;
-    }
-  }
-
-  NET_LIST_FOR_EACH (Entry, &mTcpRunQue) {
-    Tcb = NET_LIST_USER_STRUCT (Entry, TCP_CB, List);
+  NET_LIST_FOR_EACH (Entry, &mTcpPortHash[TCP_PORT_HASH (LocalPort)]) {
+    Tcb = NET_LIST_USER_STRUCT (Entry, TCP_CB, PortList);
 
     if (EFI_IP4_EQUAL (Addr, &Tcb->LocalEnd.Ip) &&
       (LocalPort == Tcb->LocalEnd.Port)) {
@@ -303,6 +353,7 @@ TcpLocateTcb (
 {
   TCP_PEER        Local;
   TCP_PEER        Remote;
+  LIST_ENTRY      *Bucket;
   LIST_ENTRY      *Entry;
   TCP_CB          *Tcb;
 
@@ -315,14 +366,16 @@ TcpLocateTcb (
   //
   // First check for exact match.
   //
-  NET_LIST_FOR_EACH (Entry, &mTcpRunQue) {
-    Tcb = NET_LIST_USER_STRUCT (Entry, TCP_CB, List);
+  Bucket = &mTcpRunHash[TcpHashTuple (&Local, &Remote)];
+
+  NET_LIST_FOR_EACH (Entry, Bucket) {
+    Tcb = NET_LIST_USER_STRUCT (Entry, TCP_CB, HashList);
 
     if (TCP_PEER_EQUAL (&Remote, &Tcb->RemoteEnd) &&
         TCP_PEER_EQUAL (&Local, &Tcb->LocalEnd)) {
 
-      RemoveEntryList (&Tcb->List);
-      InsertHeadList (&mTcpRunQue, &Tcb->List);
+      RemoveEntryList (&Tcb->HashList);
+      InsertHeadList (Bucket, &Tcb->HashList);
 
       return Tcb;
     }
@@ -355,6 +408,7 @@ TcpInsertTcb (
 {
   LIST_ENTRY       *Entry;
   LIST_ENTRY       *Head;
+  LIST_ENTRY       *Bucket;
   TCP_CB           *Node;
   TCP4_PROTO_DATA  *TcpProto;
 
@@ -370,17 +424,20 @@ TcpInsertTcb (
     return -1;
   }
 
-  Head = &mTcpRunQue;
+  Head   = &mTcpRunQue;
+  Bucket = &mTcpRunHash[TcpHashTuple (&Tcb->LocalEnd, &Tcb->RemoteEnd)];
 
   if (Tcb->State == TCP_LISTEN) {
-    Head = &mTcpListenQue;
+    Head   = &mTcpListenQue;
+    Bucket = &mTcpListenHash[TCP_PORT_HASH (Tcb->LocalEnd.Port)];
   }
 
   //
-  // Check that Tcb isn't already on the list.
+  // Check that Tcb isn't already on the list. A duplicate is
+  // always in the same bucket.
   //
-  NET_LIST_FOR_EACH (Entry, Head) {
-    Node = NET_LIST_USER_STRUCT (Entry, TCP_CB, List);
+  NET_LIST_FOR_EACH (Entry, Bucket) {
+    Node = NET_LIST_USER_STRUCT (Entry, TCP_CB, HashList);
 
     if (TCP_PEER_EQUAL (&Tcb->LocalEnd, &Node->LocalEnd) &&
         TCP_PEER_EQUAL (&Tcb->RemoteEnd, &Node->RemoteEnd)) {
@@ -390,6 +447,8 @@ TcpInsertTcb (
   }
 
   InsertHeadList (Head, &Tcb->List);
+  InsertHeadList (Bucket, &Tcb->HashList);
+  InsertHeadList (&mTcpPortHash[TCP_PORT_HASH (Tcb->LocalEnd.Port)], &Tcb->PortList);
 
   TcpProto = (TCP4_PROTO_DATA *) Tcb->Sk->ProtoReserved;
   TcpSetVariableData (TcpProto->TcpService);
@@ -398,6 +457,26 @@ TcpInsertTcb (
 }
 
 
+/**
+  Remove a Tcb from its queue and the hash tables.
+
+  @param  Tcb                   Pointer to the TCP_CB to be removed.
+
+**/
+VOID
+TcpRemoveTcb (
+  IN TCP_CB *Tcb
+  )
+{
+  RemoveEntryList (&Tcb->List);
+  RemoveEntryList (&Tcb->HashList);
+  RemoveEntryList (&Tcb->PortList);
+
+  InitializeListHead (&Tcb->HashList);
+  InitializeListHead (&Tcb->PortList);
+}
+
+
 /**
   Clone a TCB_CB from Tcb.
 
@@ -428,6 +507,8 @@ TcpCloneTcb (
   NET_GET_REF (Tcb->IpInfo);
 
   InitializeListHead (&Clone->List);
+  InitializeListHead (&Clone->HashList);
+  InitializeListHead (&Clone->PortList);
   InitializeListHead (&Clone->SndQue);
   InitializeListHead (&Clone->RcvQue);
 
@@ -529,6 +610,14 @@ TcpSetState (
 
   case TCP_CLOSED:
 
+    DEBUG (
+      (EFI_D_INFO,
+      "Tcb (%p) received %d data segments, sent %d ACKs\n",
+      Tcb,
+      Tcb->DataSegRcvd,
+      Tcb->AckSent)
+      );
+
     SockConnClosed (Tcb->Sk);
 
     break;
@@ -823,6 +912,7 @@ TcpOnAppConsume (
           " ACK to update window for Tcb %p\n", Tcb));
 
         Tcb->DelayedAck = 1;
+        TcpSetTimer (Tcb, TCP_TIMER_DELAYED_ACK, TCP_DELAYED_ACK_TIME);
       }
     }
 
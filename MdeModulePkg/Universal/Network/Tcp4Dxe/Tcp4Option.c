@@ -165,6 +165,27 @@ TcpSynBuildOption (
     TcpPutUint32 (Data, TCP_OPTION_WS_FAST | TcpComputeScale (Tcb));
   }
 
+  //
+  // Build SACK permitted option, only when SACK isn't
+  // disabled, and either we are doing active open or
+  // we have received SACK permitted option from peer.
+  //
+  if (!TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_NO_SACK) &&
+      (!TCP_FLG_ON (TCPSEG_NETBUF (Nbuf)->Flag, TCP_FLG_ACK) ||
+        TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK))) {
+
+    Data = NetbufAllocSpace (
+            Nbuf,
+            TCP_OPTION_SACK_PERM_ALIGNED_LEN,
+            NET_BUF_HEAD
+            );
+
+    ASSERT (Data != NULL);
+
+    Len += TCP_OPTION_SACK_PERM_ALIGNED_LEN;
+    TcpPutUint32 (Data, TCP_OPTION_SACK_PERM_FAST);
+  }
+
   //
   // Build MSS option
   //
@@ -178,6 +199,81 @@ TcpSynBuildOption (
 }
 
 
+/**
+  Collect the blocks of out-of-order data on the reassemble queue to
+  report them in a SACK option. The block that holds the most recently
+  received segment is reported first as RFC2018 requires, the other
+  blocks follow in sequence order.
+
+  @param  Tcb     Pointer to the TCP_CB of this TCP instance.
+  @param  Sack    Pointer to the array to store the blocks.
+  @param  MaxNum  The maximum number of blocks to collect.
+
+  @return         The number of blocks collected.
+
+**/
+UINT32
+TcpCollectSack (
+  IN     TCP_CB         *Tcb,
+  IN OUT TCP_SACK_BLOCK *Sack,
+  IN     UINT32         MaxNum
+  )
+{
+  LIST_ENTRY      *Entry;
+  NET_BUF         *Node;
+  TCP_SACK_BLOCK  Block;
+  UINT32          Num;
+  BOOLEAN         Found;
+
+  //
+  // Slot zero is reserved for the most recent block.
+  //
+  Num   = 1;
+  Found = FALSE;
+  Entry = Tcb->RcvQue.ForwardLink;
+
+  while (Entry != &Tcb->RcvQue) {
+    Node        = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
+    Block.Left  = TCPSEG_NETBUF (Node)->Seq;
+    Block.Right = TCPSEG_NETBUF (Node)->End;
+
+    //
+    // Merge the following segments that are contiguous.
+    //
+    for (Entry = Entry->ForwardLink; Entry != &Tcb->RcvQue; Entry = Entry->ForwardLink) {
+      Node = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
+
+      if (TCPSEG_NETBUF (Node)->Seq != Block.Right) {
+        break;
+      }
+
+      Block.Right = TCPSEG_NETBUF (Node)->End;
+    }
+
+    if (!Found &&
+        TCP_SEQ_LEQ (Block.Left, Tcb->RcvSackSeq) &&
+        TCP_SEQ_LT (Tcb->RcvSackSeq, Block.Right)) {
+
+      CopyMem (&Sack[0], &Block, sizeof (Block));
+      Found = TRUE;
+    } else if (Num < MaxNum) {
+      CopyMem (&Sack[Num++], &Block, sizeof (Block));
+    }
+  }
+
+  //
+  // If the most recent segment has been delivered or
+  // dropped, slot zero is not used, move the others up.
+  //
+  if (!Found) {
+    Num--;
+    CopyMem (&Sack[0], &Sack[1], Num * sizeof (TCP_SACK_BLOCK));
+  }
+
+  return Num;
+}
+
+
 /**
   Build the TCP option in synchronized states.
 
@@ -193,8 +289,11 @@ TcpBuildOption (
   IN NET_BUF *Nbuf
   )
 {
-  UINT8   *Data;
-  UINT16  Len;
+  UINT8           *Data;
+  UINT16          Len;
+  TCP_SACK_BLOCK  Sack[TCP_SACK_MAX_BLOCK];
+  UINT32          SackNum;
+  UINT32          Index;
 
   ASSERT ((Tcb != NULL) && (Nbuf != NULL) && (Nbuf->Tcp == NULL));
   Len = 0;
@@ -219,6 +318,41 @@ TcpBuildOption (
     TcpPutUint32 (Data + 8, Tcb->TsRecent);
   }
 
+  //
+  // Build SACK option if there is out-of-order data on the
+  // reassemble queue. Only add it to segments without data,
+  // otherwise the segment would be larger than SndMss.
+  //
+  if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_RCVD_SACK) &&
+      !TCP_FLG_ON (TCPSEG_NETBUF (Nbuf)->Flag, TCP_FLG_RST) &&
+      (Nbuf->TotalSize == Len) &&
+      !IsListEmpty (&Tcb->RcvQue)) {
+
+    SackNum = TcpCollectSack (
+                Tcb,
+                Sack,
+                (40 - Len - TCP_OPTION_SACK_ALIGNED_LEN) / TCP_OPTION_SACK_BLOCK_LEN
+                );
+
+    if (SackNum != 0) {
+      Data = NetbufAllocSpace (
+              Nbuf,
+              TCP_OPTION_SACK_ALIGNED_LEN + SackNum * TCP_OPTION_SACK_BLOCK_LEN,
+              NET_BUF_HEAD
+              );
+
+      ASSERT (Data != NULL);
+      Len = (UINT16) (Len + TCP_OPTION_SACK_ALIGNED_LEN + SackNum * TCP_OPTION_SACK_BLOCK_LEN);
+
+      TcpPutUint32 (Data, TCP_OPTION_SACK_FAST | (2 + SackNum * TCP_OPTION_SACK_BLOCK_LEN));
+
+      for (Index = 0; Index < SackNum; Index++) {
+        TcpPutUint32 (Data + 4 + Index * TCP_OPTION_SACK_BLOCK_LEN, Sack[Index].Left);
+        TcpPutUint32 (Data + 8 + Index * TCP_OPTION_SACK_BLOCK_LEN, Sack[Index].Right);
+      }
+    }
+  }
+
   return Len;
 }
 
@@ -325,6 +459,49 @@ TcpParseOption (
       Cur += TCP_OPTION_TS_LEN;
       break;
 
+    case TCP_OPTION_SACK_PERM:
+      Len = Head[Cur + 1];
+
+      if ((Len != TCP_OPTION_SACK_PERM_LEN) ||
+          (TotalLen - Cur < TCP_OPTION_SACK_PERM_LEN)) {
+
+        return -1;
+      }
+
+      TCP_SET_FLG (Option->Flag, TCP_OPTION_RCVD_SACK_PERM);
+
+      Cur += TCP_OPTION_SACK_PERM_LEN;
+      break;
+
+    case TCP_OPTION_SACK:
+      Len = Head[Cur + 1];
+
+      if ((Len < 2 + TCP_OPTION_SACK_BLOCK_LEN) ||
+          ((Len - 2) % TCP_OPTION_SACK_BLOCK_LEN != 0) ||
+          (TotalLen - Cur < Len)) {
+
+        return -1;
+      }
+
+      Option->SackNum = 0;
+
+      while ((Option->SackNum < TCP_SACK_MAX_BLOCK) &&
+             (Option->SackNum < (UINT32) (Len - 2) / TCP_OPTION_SACK_BLOCK_LEN)) {
+
+        Option->Sack[Option->SackNum].Left  = TcpGetUint32 (
+                                                &Head[Cur + 2 + Option->SackNum * TCP_OPTION_SACK_BLOCK_LEN]
+                                                );
+        Option->Sack[Option->SackNum].Right = TcpGetUint32 (
+                                                &Head[Cur + 6 + Option->SackNum * TCP_OPTION_SACK_BLOCK_LEN]
+                                                );
+        Option->SackNum++;
+      }
+
+      TCP_SET_FLG (Option->Flag, TCP_OPTION_RCVD_SACK);
+
+      Cur = (UINT8) (Cur + Len);
+      break;
+
     case TCP_OPTION_NOP:
       Cur++;
       break;
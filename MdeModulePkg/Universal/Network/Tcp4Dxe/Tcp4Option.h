@@ -15,16 +15,32 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #ifndef _TCP4_OPTION_H_
 #define _TCP4_OPTION_H_
 
+///
+/// The maximum number of blocks in a SACK option, limited by
+/// the 40 bytes of TCP option space.
+///
+#define TCP_SACK_MAX_BLOCK  4
+
+///
+/// A block of data received by the peer out of order, RFC2018.
+///
+typedef struct _TCP_SACK_BLOCK {
+  UINT32  Left;     ///< The first sequence number of the block
+  UINT32  Right;    ///< The sequence number following the block
+} TCP_SACK_BLOCK;
+
 ///
 /// The structure to store the parse option value.
 /// ParseOption only parse the options, don't process them.
 ///
 typedef struct _TCP_OPTION {
-  UINT8   Flag;     ///< Flag such as TCP_OPTION_RCVD_MSS
-  UINT8   WndScale; ///< The WndScale received
-  UINT16  Mss;      ///< The Mss received
-  UINT32  TSVal;    ///< The TSVal field in a timestamp option
-  UINT32  TSEcr;    ///< The TSEcr field in a timestamp option
+  UINT8           Flag;     ///< Flag such as TCP_OPTION_RCVD_MSS
+  UINT8           WndScale; ///< The WndScale received
+  UINT16          Mss;      ///< The Mss received
+  UINT32          TSVal;    ///< The TSVal field in a timestamp option
+  UINT32          TSEcr;    ///< The TSEcr field in a timestamp option
+  UINT32          SackNum;  ///< The number of blocks in the SACK option
+  TCP_SACK_BLOCK  Sack[TCP_SACK_MAX_BLOCK]; ///< The SACK blocks received
 } TCP_OPTION;
 
 typedef enum {
@@ -36,11 +52,17 @@ typedef enum {
   TCP_OPTION_NOP            = 1,  ///< No-Option.
   TCP_OPTION_MSS            = 2,  ///< Maximum Segment Size
   TCP_OPTION_WS             = 3,  ///< Window scale
+  TCP_OPTION_SACK_PERM      = 4,  ///< SACK permitted
+  TCP_OPTION_SACK           = 5,  ///< SACK
   TCP_OPTION_TS             = 8,  ///< Timestamp
   TCP_OPTION_MSS_LEN        = 4,  ///< Length of MSS option
   TCP_OPTION_WS_LEN         = 3,  ///< Length of window scale option
+  TCP_OPTION_SACK_PERM_LEN  = 2,  ///< Length of SACK permitted option
+  TCP_OPTION_SACK_BLOCK_LEN = 8,  ///< Length of each block in SACK option
   TCP_OPTION_TS_LEN         = 10, ///< Length of timestamp option
   TCP_OPTION_WS_ALIGNED_LEN = 4,  ///< Length of window scale option, aligned
+  TCP_OPTION_SACK_PERM_ALIGNED_LEN = 4,  ///< Length of SACK permitted option, aligned
+  TCP_OPTION_SACK_ALIGNED_LEN      = 4,  ///< Length of SACK option without blocks, aligned
   TCP_OPTION_TS_ALIGNED_LEN = 12, ///< Length of timestamp option, aligned
 
   //
@@ -59,12 +81,23 @@ typedef enum {
   TCP_OPTION_MSS_FAST = ((TCP_OPTION_MSS << 24) |
                          (TCP_OPTION_MSS_LEN << 16)),
 
+  TCP_OPTION_SACK_PERM_FAST = ((TCP_OPTION_NOP << 24) |
+                               (TCP_OPTION_NOP << 16) |
+                               (TCP_OPTION_SACK_PERM << 8) |
+                               TCP_OPTION_SACK_PERM_LEN),
+
+  TCP_OPTION_SACK_FAST = ((TCP_OPTION_NOP << 24) |
+                          (TCP_OPTION_NOP << 16) |
+                          (TCP_OPTION_SACK << 8)),
+
   //
   // Other misc definations
   //
   TCP_OPTION_RCVD_MSS       = 0x01,
   TCP_OPTION_RCVD_WS        = 0x02,
   TCP_OPTION_RCVD_TS        = 0x04,
+  TCP_OPTION_RCVD_SACK_PERM = 0x08,
+  TCP_OPTION_RCVD_SACK      = 0x10,
   TCP_OPTION_MAX_WS         = 14,     ///< Maxium window scale value
   TCP_OPTION_MAX_WIN        = 0xffff  ///< Max window size in TCP header
 } TCP_OPTION_TYPE;
@@ -97,6 +130,26 @@ TcpSynBuildOption (
   IN NET_BUF *Nbuf
   );
 
+/**
+  Collect the blocks of out-of-order data on the reassemble queue to
+  report them in a SACK option. The block that holds the most recently
+  received segment is reported first as RFC2018 requires, the other
+  blocks follow in sequence order.
+
+  @param  Tcb     Pointer to the TCP_CB of this TCP instance.
+  @param  Sack    Pointer to the array to store the blocks.
+  @param  MaxNum  The maximum number of blocks to collect.
+
+  @return  The number of blocks collected.
+
+**/
+UINT32
+TcpCollectSack (
+  IN     TCP_CB         *Tcb,
+  IN OUT TCP_SACK_BLOCK *Sack,
+  IN     UINT32         MaxNum
+  );
+
 /**
   Build the TCP option in synchronized states.
 
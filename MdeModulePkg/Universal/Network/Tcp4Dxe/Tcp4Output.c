@@ -391,10 +391,14 @@ TcpTransmitSegment (
   }
 
   //
-  // clear delayedack flag
+  // clear delayedack flag, the ACK is piggybacked
   //
   Tcb->DelayedAck = 0;
 
+  if (TCP_TIMER_ON (Tcb->EnabledTimer, TCP_TIMER_DELAYED_ACK)) {
+    TcpClearTimer (Tcb, TCP_TIMER_DELAYED_ACK);
+  }
+
   return TcpSendIpPacket (Tcb, Nbuf, Tcb->LocalEnd.Ip, Tcb->RemoteEnd.Ip);
 }
 
@@ -692,6 +696,10 @@ TcpRetransmit (
     goto OnError;
   }
 
+  if (TCP_SEQ_GT (TCPSEG_NETBUF (Nbuf)->End, Tcb->SackRexmit)) {
+    Tcb->SackRexmit = TCPSEG_NETBUF (Nbuf)->End;
+  }
+
   //
   // The retransmitted buffer may be on the SndQue,
   // trim TCP head because all the buffer on SndQue
@@ -713,6 +721,78 @@ OnError:
 }
 
 
+/**
+  Retransmit the first hole in the SACK scoreboard. A hole is the data
+  on the SndQue that is neither SACKed by the peer nor retransmitted in
+  the current fast recovery, and that is followed by SACKed data.
+
+  @param  Tcb     Pointer to the TCP_CB of this TCP instance.
+
+  @retval 1       A hole is retransmitted.
+  @retval 0       No hole is found or the retransmission failed.
+
+**/
+INTN
+TcpSackRetransmit (
+  IN OUT TCP_CB *Tcb
+  )
+{
+  LIST_ENTRY  *Entry;
+  NET_BUF     *Node;
+  TCP_SEG     *Seg;
+  TCP_SEQNO   HighSacked;
+  TCP_SEQNO   Seq;
+  BOOLEAN     Sacked;
+
+  //
+  // Find the end of the highest SACKed segment, data after
+  // it isn't considered lost yet.
+  //
+  Sacked      = FALSE;
+  HighSacked  = Tcb->SndUna;
+
+  NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+    Node  = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
+    Seg   = TCPSEG_NETBUF (Node);
+
+    if (Seg->Sacked) {
+      Sacked      = TRUE;
+      HighSacked  = Seg->End;
+    }
+  }
+
+  if (!Sacked) {
+    return 0;
+  }
+
+  NET_LIST_FOR_EACH (Entry, &Tcb->SndQue) {
+    Node  = NET_LIST_USER_STRUCT (Entry, NET_BUF, List);
+    Seg   = TCPSEG_NETBUF (Node);
+
+    if (TCP_SEQ_GEQ (Seg->Seq, HighSacked) ||
+        TCP_SEQ_GEQ (Seg->Seq, Tcb->SndNxt)) {
+      break;
+    }
+
+    if (Seg->Sacked || TCP_SEQ_LEQ (Seg->End, Tcb->SackRexmit)) {
+      continue;
+    }
+
+    Seq = Seg->Seq;
+    if (TCP_SEQ_LT (Seq, Tcb->SackRexmit)) {
+      Seq = Tcb->SackRexmit;
+    }
+
+    DEBUG ((EFI_D_INFO, "TcpSackRetransmit: retransmit the hole"
+      " at %d for TCB %p\n", Seq, Tcb));
+
+    return (TcpRetransmit (Tcb, Seq) == 0) ? 1 : 0;
+  }
+
+  return 0;
+}
+
+
 /**
   Check whether to send data/SYN/FIN and piggy back an ACK.
 
@@ -936,6 +1016,7 @@ TcpSendAck (
   if (TcpTransmitSegment (Tcb, Nbuf) == 0) {
     TCP_CLEAR_FLG (Tcb->CtrlFlag, TCP_CTRL_ACK_NOW);
     Tcb->DelayedAck = 0;
+    Tcb->AckSent++;
   }
 
   NetbufFree (Nbuf);
@@ -1002,22 +1083,29 @@ TcpToSendAck (
   // Generally, TCP should send a delayed ACK unless:
   //   1. ACK at least every other FULL sized segment received,
   //   2. Packets received out of order
-  //   3. Receiving window is open
+  //   3. Receiving window is open, that is, the window to advertise
+  //      is at least one segment larger than the last advertised one.
+  // The peer's full sized segment is taken as SndMss since
+  // both ends use the smaller one of the two MSS.
   //
   if (TCP_FLG_ON (Tcb->CtrlFlag, TCP_CTRL_ACK_NOW) ||
-      (Tcb->DelayedAck >= 1) ||
-      (TcpNow > TcpRcvWinOld (Tcb))) {
+      (TCP_SUB_SEQ (Tcb->RcvNxt, Tcb->RcvWl2) >= 2 * (UINT32) Tcb->SndMss) ||
+      (TcpNow >= Tcb->RcvWnd + Tcb->SndMss)) {
     TcpSendAck (Tcb);
     return;
   }
 
-  DEBUG ((EFI_D_INFO, "TcpToSendAck: scheduled a delayed"
-    " ACK for TCB %p\n", Tcb));
-
   //
-  // schedule a delayed ACK
+  // schedule a delayed ACK, it is sent when the delayed
+  // ACK timer expires if no segment carries it earlier.
   //
-  Tcb->DelayedAck++;
+  if (Tcb->DelayedAck == 0) {
+    DEBUG ((EFI_D_INFO, "TcpToSendAck: scheduled a delayed"
+      " ACK for TCB %p\n", Tcb));
+
+    Tcb->DelayedAck = 1;
+    TcpSetTimer (Tcb, TCP_TIMER_DELAYED_ACK, TCP_DELAYED_ACK_TIME);
+  }
 }
 
 
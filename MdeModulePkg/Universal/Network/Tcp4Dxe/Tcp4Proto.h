@@ -90,6 +90,8 @@ typedef enum {
   TCP_CTRL_TIMER_ON       = 0x1000, ///< At least one of the timer is on
   TCP_CTRL_RTT_ON         = 0x2000, ///< The RTT measurement is on
   TCP_CTRL_ACK_NOW        = 0x4000, ///< Send the ACK now, don't delay
+  TCP_CTRL_NO_SACK        = 0x8000, ///< Disable SACK option
+  TCP_CTRL_RCVD_SACK      = 0x10000,///< Received a SACK permitted option in syn
 
   //
   // Timer related values
@@ -100,7 +102,8 @@ typedef enum {
   TCP_TIMER_KEEPALIVE     = 3,                  ///< Keepalive timer
   TCP_TIMER_FINWAIT2      = 4,                  ///< FIN_WAIT_2 timer
   TCP_TIMER_2MSL          = 5,                  ///< TIME_WAIT tiemr
-  TCP_TIMER_NUMBER        = 6,                  ///< The total number of TCP timer.
+  TCP_TIMER_DELAYED_ACK   = 6,                  ///< Delayed ACK timer
+  TCP_TIMER_NUMBER        = 7,                  ///< The total number of TCP timer.
   TCP_TICK                = 200,                ///< Every TCP tick is 200ms
   TCP_TICK_HZ             = 5,                  ///< The frequence of TCP tick
   TCP_RTT_SHIFT           = 3,                  ///< SRTT & RTTVAR scaled by 8
@@ -119,6 +122,7 @@ typedef enum {
   TCP_TIME_WAIT_TIME      = (2 * TCP_TICK_HZ),
   TCP_PAWS_24DAY          = (24 * 24 * 60 * 60 * TCP_TICK_HZ),
   TCP_CONNECT_TIME        = (75 * TCP_TICK_HZ),
+  TCP_DELAYED_ACK_TIME    = 1,                           ///< At most one tick, 200ms
 
   //
   // The header space to be reserved before TCP data to accomodate :
@@ -131,8 +135,10 @@ typedef enum {
   //
   TCP_RCV_BUF_SIZE        = (2 * 1024 * 1024),
   TCP_RCV_BUF_SIZE_MIN    = (8 * 1024),
+  TCP_RCV_BUF_SIZE_MAX    = (16 * 1024 * 1024),
   TCP_SND_BUF_SIZE        = (2 * 1024 * 1024),
   TCP_SND_BUF_SIZE_MIN    = (8 * 1024),
+  TCP_SND_BUF_SIZE_MAX    = (16 * 1024 * 1024),
   TCP_BACKLOG             = 10,
   TCP_BACKLOG_MIN         = 5,
   TCP_MAX_LOSS_MIN        = 6,
@@ -154,6 +160,7 @@ typedef struct _TCP_SEG {
   UINT8     Flag; ///< TCP header flags
   UINT16    Urg;  ///< Valid if URG flag is set.
   UINT32    Wnd;  ///< TCP window size field
+  BOOLEAN   Sacked; ///< The segment on SndQue is SACKed by the peer
 } TCP_SEG;
 
 ///
@@ -169,6 +176,8 @@ typedef struct _TCP_PEER {
 ///
 struct _TCP_CB {
   LIST_ENTRY        List;     ///< Back and forward link entry
+  LIST_ENTRY        HashList; ///< Link in the run or listen hash bucket
+  LIST_ENTRY        PortList; ///< Link in the local port hash bucket
   TCP_CB            *Parent;  ///< The parent TCP_CB structure
 
   SOCKET            *Sk;      ///< The socket it controled.
@@ -184,7 +193,7 @@ struct _TCP_CB {
   // RFC793 and RFC1122 defined variables
   //
   UINT8             State;      ///< TCP state, such as SYN_SENT, LISTEN
-  UINT8             DelayedAck; ///< Number of delayed ACKs
+  UINT8             DelayedAck; ///< Non-zero if an ACK is delayed
   UINT16            HeadSum;    ///< Checksum of the fixed parts of pesudo
                                 ///< header: Src IP, Dst IP, 0, Protocol,
                                 ///< not include the TCP length.
@@ -244,6 +253,18 @@ struct _TCP_CB {
   UINT8             LossTimes;    ///< Number of retxmit timeouts in a row
   TCP_SEQNO         LossRecover;  ///< Recover point for retxmit
 
+  //
+  // RFC2018 defined variables, about selective acknowledgment.
+  //
+  TCP_SEQNO         SackRexmit;   ///< Data before it is retxmitted in this recovery
+  TCP_SEQNO         RcvSackSeq;   ///< Seq of the latest out-of-order segment received
+
+  //
+  // Statistics of the delayed ACK
+  //
+  UINT32            DataSegRcvd;  ///< Number of segments with data received
+  UINT32            AckSent;      ///< Number of ACKs sent without data
+
   //
   // configuration parameters, for EFI_TCP4_PROTOCOL specification
   //
@@ -269,6 +290,9 @@ struct _TCP_CB {
 
 extern LIST_ENTRY     mTcpRunQue;
 extern LIST_ENTRY     mTcpListenQue;
+extern LIST_ENTRY     mTcpRunHash[];
+extern LIST_ENTRY     mTcpListenHash[];
+extern LIST_ENTRY     mTcpPortHash[];
 extern TCP_SEQNO      mTcpGlobalIss;
 extern UINT32         mTcpTick;
 
@@ -324,6 +348,16 @@ extern UINT32         mTcpTick;
 #define TCP_SET_FLG(Value, Flag)    ((Value) |= (Flag))
 #define TCP_CLEAR_FLG(Value, Flag)  ((Value) &= ~(Flag))
 
+//
+// Number of buckets in the TCB hash tables, must be a power of 2.
+// The run hash is keyed by the four tuple, the listen and the
+// port hash by the local port only.
+//
+#define TCP_HASH_SIZE               256
+
+#define TCP_PORT_HASH(Port) \
+  (((UINTN) (Port) ^ ((UINTN) (Port) >> 8)) & (TCP_HASH_SIZE - 1))
+
 //
 // Test whether two peers are equal
 //
@@ -82,6 +82,17 @@ Tcp2MSLTimeout (
   IN OUT TCP_CB *Tcb
   );
 
+/**
+  Timeout handler for delayed ACK timer.
+
+  @param  Tcb      Pointer to the TCP_CB of this TCP instance.
+
+**/
+VOID
+TcpDelayedAckTimeout (
+  IN OUT TCP_CB *Tcb
+  );
+
 TCP_TIMER_HANDLER mTcpTimerHandler[TCP_TIMER_NUMBER] = {
   TcpConnectTimeout,
   TcpRexmitTimeout,
@@ -89,6 +100,7 @@ TCP_TIMER_HANDLER mTcpTimerHandler[TCP_TIMER_NUMBER] = {
   TcpKeepaliveTimeout,
   TcpFinwait2Timeout,
   Tcp2MSLTimeout,
+  TcpDelayedAckTimeout,
 };
 
 /**
@@ -184,6 +196,7 @@ TcpRexmitTimeout (
   }
 
   TcpBackoffRto (Tcb);
+  TcpSackClearSndQue (Tcb);
   TcpRetransmit (Tcb, Tcb->SndUna);
   TcpSetTimer (Tcb, TCP_TIMER_REXMIT, Tcb->Rto);
 
@@ -288,6 +301,23 @@ Tcp2MSLTimeout (
 }
 
 
+/**
+  Timeout handler for delayed ACK timer.
+
+  @param  Tcb      Pointer to the TCP_CB of this TCP instance.
+
+**/
+VOID
+TcpDelayedAckTimeout (
+  IN OUT TCP_CB *Tcb
+  )
+{
+  if (Tcb->DelayedAck != 0) {
+    TcpSendAck (Tcb);
+  }
+}
+
+
 /**
   Update the timer status and the next expire time according to the timers 
   to expire in a specific future time slot.
@@ -518,10 +548,6 @@ TcpTickingDpc (
 
     Tcb->Idle++;
 
-    if (Tcb->DelayedAck != 0) {
-      TcpSendAck (Tcb);
-    }
-
     //
     // No timer is active or no timer expired
     //
@@ -1492,29 +1492,19 @@ Udp4InstanceDeliverDgram (
 {
   UDP4_RXDATA_WRAP           *Wrap;
   EFI_UDP4_COMPLETION_TOKEN  *Token;
-  NET_BUF                    *Dup;
   EFI_UDP4_RECEIVE_DATA      *RxData;
   EFI_TPL                    OldTpl;
 
   if (!IsListEmpty (&Instance->RcvdDgramQue) &&
       !NetMapIsEmpty (&Instance->RxTokens)) {
 
+    //
+    // The Packet may be shared between instances. It is delivered by
+    // reference anyway, the data is read only to the upper layer and
+    // the reference held by the Wrap is released when it is recycled.
+    //
     Wrap = NET_LIST_HEAD (&Instance->RcvdDgramQue, UDP4_RXDATA_WRAP, Link);
 
-    if (NET_BUF_SHARED (Wrap->Packet)) {
-      //
-      // Duplicate the Packet if it is shared between instances.
-      //
-      Dup = NetbufDuplicate (Wrap->Packet, NULL, 0);
-      if (Dup == NULL) {
-        return;
-      }
-
-      NetbufFree (Wrap->Packet);
-
-      Wrap->Packet = Dup;
-    }
-
     NetListRemoveHead (&Instance->RcvdDgramQue);
 
     Token = (EFI_UDP4_COMPLETION_TOKEN *) NetMapRemoveHead (&Instance->RxTokens, NULL);
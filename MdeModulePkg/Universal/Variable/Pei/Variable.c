@@ -34,7 +34,6 @@ EFI_PEI_PPI_DESCRIPTOR     mPpiListVariable = {
 
 EFI_GUID mEfiVariableIndexTableGuid = EFI_VARIABLE_INDEX_TABLE_GUID;
 
-
 /**
   Provide the functionality of the variable services.
   
@@ -343,40 +342,232 @@ CompareWithValidVariable (
 
 
 /**
-  This code finds variable in storage blocks (Non-Volatile).
+  Computes the index hash of a variable name and vendor GUID.
 
-  @param  PeiServices   General purpose services available to every PEIM.
-  @param  VariableName  Name of the variable to be found
-  @param  VendorGuid    Vendor GUID to be found.
-  @param  PtrTrack      Variable Track Pointer structure that contains Variable Information.
+  The DXE variable driver hashes variables the same way, so that it can use
+  the hashes of the variable index HOB.
+
+  @param  VariableName  Name of the variable.
+  @param  NameSize      Size in bytes of the buffer holding VariableName.
+  @param  VendorGuid    Vendor GUID of the variable.
+
+  @return The hash of VariableName and VendorGuid.
+
+**/
+UINT32
+VariableIndexHash (
+  IN  CONST CHAR16    *VariableName,
+  IN  UINTN           NameSize,
+  IN  CONST EFI_GUID  *VendorGuid
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  Hash = ReadUnaligned32 ((CONST UINT32 *) VendorGuid);
+  for (Index = 0; Index < NameSize / sizeof (CHAR16) && VariableName[Index] != 0; Index++) {
+    Hash = (Hash * 31) + VariableName[Index];
+  }
+
+  return Hash;
+}
+
+/**
+  Sorts the entries of the variable index HOB by hash and then by offset.
+
+  @param  Entry       The entries to sort.
+  @param  EntryCount  Number of entries.
+
+**/
+VOID
+SortVariableIndex (
+  IN OUT VARIABLE_INDEX_HOB_ENTRY  *Entry,
+  IN     UINTN                     EntryCount
+  )
+{
+  VARIABLE_INDEX_HOB_ENTRY  Key;
+  UINTN                     Gap;
+  UINTN                     Index;
+  UINTN                     Position;
+
+  //
+  // Shell sort, which needs no memory besides the HOB itself.
+  //
+  for (Gap = EntryCount / 2; Gap > 0; Gap /= 2) {
+    for (Index = Gap; Index < EntryCount; Index++) {
+      Key = Entry[Index];
+      for (Position = Index; Position >= Gap; Position -= Gap) {
+        if (Entry[Position - Gap].Hash < Key.Hash ||
+            (Entry[Position - Gap].Hash == Key.Hash && Entry[Position - Gap].Offset < Key.Offset)) {
+          break;
+        }
+        Entry[Position] = Entry[Position - Gap];
+      }
+      Entry[Position] = Key;
+    }
+  }
+}
+
+/**
+  Gets the index of the non-volatile variable store, and builds it the first
+  time it is needed.
+
+  The index HOB records every VAR_ADDED and VAR_IN_DELETED_TRANSITION variable
+  of the store, with the space the variables use and the offset of the free
+  space, which the DXE variable driver needs at its initialization. If the store
+  has more variables than a HOB can hold, the HOB only records the store and
+  lookups walk it.
+
+  The HOB can be about 64KB, so it is only built once the permanent memory is
+  installed. Before that the HOB list is in the temporary RAM, no index HOB is
+  returned and lookups use the small VARIABLE_INDEX_TABLE HOB instead.
+
+  @param  StoreHeader   Returns the variable store.
+  @param  IndexHob      Returns the variable index HOB, or NULL if the permanent
+                        memory is not installed yet.
+
+  @retval EFI_SUCCESS       The variable store is returned.
+  @retval EFI_NOT_FOUND     The variable store is empty.
+  @retval EFI_UNSUPPORTED   The variable store is not valid.
+
+**/
+EFI_STATUS
+GetVariableIndexHob (
+  OUT VARIABLE_STORE_HEADER **StoreHeader,
+  OUT VARIABLE_INDEX_HOB    **IndexHob
+  )
+{
+  EFI_STATUS                Status;
+  EFI_HOB_GUID_TYPE         *GuidHob;
+  VARIABLE_INDEX_HOB        *Hob;
+  VARIABLE_STORE_HEADER     *VariableStoreHeader;
+  VARIABLE_HEADER           *Variable;
+  UINT8                     *VariableBase;
+  UINTN                     EntryCount;
+  UINTN                     VariableSize;
+  UINTN                     Index;
+  VOID                      *MemoryDiscoveredPpi;
+
+  GuidHob = GetFirstGuidHob (&gVariableIndexHobGuid);
+  if (GuidHob != NULL) {
+    *IndexHob    = GET_GUID_HOB_DATA (GuidHob);
+    *StoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) (*IndexHob)->StoreBase;
+    return EFI_SUCCESS;
+  }
+
+  VariableBase = (UINT8 *) (UINTN) PcdGet32 (PcdFlashNvStorageVariableBase);
+  VariableStoreHeader = (VARIABLE_STORE_HEADER *) (VariableBase + \
+                        ((EFI_FIRMWARE_VOLUME_HEADER *) (VariableBase)) -> HeaderLength);
+
+  *IndexHob    = NULL;
+  *StoreHeader = VariableStoreHeader;
+
+  if (GetVariableStoreStatus (VariableStoreHeader) != EfiValid) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (~VariableStoreHeader->Size == 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  Status = PeiServicesLocatePpi (&gEfiPeiMemoryDiscoveredPpiGuid, 0, NULL, &MemoryDiscoveredPpi);
+  if (EFI_ERROR (Status)) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Count the variables to size the HOB
+  //
+  EntryCount = 0;
+  for (Variable = GetStartPointer (VariableStoreHeader);
+       (Variable < GetEndPointer (VariableStoreHeader)) && IsValidVariableHeader (Variable);
+       Variable = GetNextVariablePtr (Variable)) {
+    if (Variable->State == VAR_ADDED ||
+        Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)
+       ) {
+      EntryCount++;
+    }
+  }
+
+  if (EntryCount > VARIABLE_INDEX_HOB_MAX_ENTRIES) {
+    Hob = BuildGuidHob (&gVariableIndexHobGuid, OFFSET_OF (VARIABLE_INDEX_HOB, Entry));
+    Hob->Complete = FALSE;
+    EntryCount    = 0;
+  } else {
+    Hob = BuildGuidHob (
+            &gVariableIndexHobGuid,
+            OFFSET_OF (VARIABLE_INDEX_HOB, Entry) + EntryCount * sizeof (VARIABLE_INDEX_HOB_ENTRY)
+            );
+    Hob->Complete = TRUE;
+  }
+  Hob->StoreBase               = (EFI_PHYSICAL_ADDRESS) (UINTN) VariableStoreHeader;
+  Hob->EntryCount              = (UINT32) EntryCount;
+  Hob->CommonVariableTotalSize = 0;
+  Hob->HwErrVariableTotalSize  = 0;
+  ZeroMem (Hob->Reserved, sizeof (Hob->Reserved));
+
+  Index = 0;
+  for (Variable = GetStartPointer (VariableStoreHeader);
+       (Variable < GetEndPointer (VariableStoreHeader)) && IsValidVariableHeader (Variable);
+       Variable = GetNextVariablePtr (Variable)) {
+    VariableSize = Variable->NameSize + Variable->DataSize + sizeof (VARIABLE_HEADER);
+    if ((Variable->Attributes & (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) == (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
+      Hob->HwErrVariableTotalSize += (UINT32) HEADER_ALIGN (VariableSize);
+    } else {
+      Hob->CommonVariableTotalSize += (UINT32) HEADER_ALIGN (VariableSize);
+    }
+
+    if (Hob->Complete &&
+        (Variable->State == VAR_ADDED ||
+         Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED))
+       ) {
+      Hob->Entry[Index].Hash   = VariableIndexHash (GetVariableNamePtr (Variable), NameSizeOfVariable (Variable), &Variable->VendorGuid);
+      Hob->Entry[Index].Offset = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+      Index++;
+    }
+  }
+  Hob->LastVariableOffset = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+
+  SortVariableIndex (Hob->Entry, EntryCount);
+
+  *IndexHob = Hob;
+  return EFI_SUCCESS;
+}
+
+/**
+  This code finds variable in storage blocks (Non-Volatile) before the
+  permanent memory is installed.
+
+  The VARIABLE_INDEX_TABLE HOB records the first VARIABLE_INDEX_TABLE_VOLUME
+  VAR_ADDED variables met by the lookups. A lookup checks them first, then walks
+  the store from the last recorded variable.
+
+  @param  VariableStoreHeader   The variable store.
+  @param  VariableName          Name of the variable to be found
+  @param  VendorGuid            Vendor GUID to be found.
+  @param  PtrTrack              Variable Track Pointer structure that contains Variable Information.
 
   @retval  EFI_SUCCESS            Variable found successfully
   @retval  EFI_NOT_FOUND          Variable not found
-  @retval  EFI_INVALID_PARAMETER  Invalid variable name
 
 **/
 EFI_STATUS
-FindVariable (
-  IN CONST EFI_PEI_SERVICES   **PeiServices,
+FindVariableInIndexTable (
+  IN  VARIABLE_STORE_HEADER   *VariableStoreHeader,
   IN CONST  CHAR16            *VariableName,
   IN CONST  EFI_GUID          *VendorGuid,
   OUT VARIABLE_POINTER_TRACK  *PtrTrack
   )
 {
   EFI_HOB_GUID_TYPE       *GuidHob;
-  VARIABLE_STORE_HEADER   *VariableStoreHeader;
   VARIABLE_HEADER         *Variable;
   VARIABLE_HEADER         *LastVariable;
   VARIABLE_HEADER         *MaxIndex;
   VARIABLE_INDEX_TABLE    *IndexTable;
   UINT32                  Count;
   UINT32                  Offset;
-  UINT8                   *VariableBase;
   BOOLEAN                 StopRecord;
 
-  if (VariableName[0] != 0 && VendorGuid == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
   //
   // No Variable Address equals zero, so 0 as initial value is safe.
   //
@@ -393,8 +584,8 @@ FindVariable (
     //
     IndexTable = BuildGuidHob (&mEfiVariableIndexTableGuid, sizeof (VARIABLE_INDEX_TABLE));
     IndexTable->Length      = 0;
-    IndexTable->StartPtr    = NULL;
-    IndexTable->EndPtr      = NULL;
+    IndexTable->StartPtr    = GetStartPointer (VariableStoreHeader);
+    IndexTable->EndPtr      = GetEndPointer (VariableStoreHeader);
     IndexTable->GoneThrough = 0;
   } else {
     IndexTable = GET_GUID_HOB_DATA (GuidHob);
@@ -407,9 +598,6 @@ FindVariable (
       Offset   += IndexTable->Index[Count];
       MaxIndex  = (VARIABLE_HEADER *)((CHAR8 *)(IndexTable->StartPtr) + Offset);
       if (CompareWithValidVariable (MaxIndex, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
-        PtrTrack->StartPtr  = IndexTable->StartPtr;
-        PtrTrack->EndPtr    = IndexTable->EndPtr;
-
         return EFI_SUCCESS;
       }
     }
@@ -425,41 +613,12 @@ FindVariable (
     Variable     = GetNextVariablePtr (MaxIndex);
     LastVariable = MaxIndex;
   } else {
-    if ((IndexTable->StartPtr != NULL) || (IndexTable->EndPtr != NULL)) {
-      Variable = IndexTable->StartPtr;
-    } else {
-      VariableBase = (UINT8 *) (UINTN) PcdGet32 (PcdFlashNvStorageVariableBase);
-      VariableStoreHeader = (VARIABLE_STORE_HEADER *) (VariableBase + \
-                            ((EFI_FIRMWARE_VOLUME_HEADER *) (VariableBase)) -> HeaderLength);
-
-      if (GetVariableStoreStatus (VariableStoreHeader) != EfiValid) {
-        return EFI_UNSUPPORTED;
-      }
-
-      if (~VariableStoreHeader->Size == 0) {
-        return EFI_NOT_FOUND;
-      }
-      //
-      // Find the variable by walk through non-volatile variable store
-      //
-      IndexTable->StartPtr  = GetStartPointer (VariableStoreHeader);
-      IndexTable->EndPtr    = GetEndPointer (VariableStoreHeader);
-
-      //
-      // Start Pointers for the variable.
-      // Actual Data Pointer where data can be written.
-      //
-      Variable = IndexTable->StartPtr;
-    }
-
+    Variable     = IndexTable->StartPtr;
     LastVariable = IndexTable->StartPtr;
   }
   //
   // Find the variable by walk through non-volatile variable store
   //
-  PtrTrack->StartPtr  = IndexTable->StartPtr;
-  PtrTrack->EndPtr    = IndexTable->EndPtr;
-
   while ((Variable < IndexTable->EndPtr) && IsValidVariableHeader (Variable)) {
     if (Variable->State == VAR_ADDED) {
       //
@@ -501,6 +660,102 @@ FindVariable (
   return EFI_NOT_FOUND;
 }
 
+/**
+  This code finds variable in storage blocks (Non-Volatile).
+
+  A named variable is binary searched in the variable index HOB, which is
+  built on the first lookup after the permanent memory is installed. Before
+  that, lookups use the VARIABLE_INDEX_TABLE HOB. The store is walked for the
+  first variable, or when it has more variables than the index can hold.
+
+  @param  PeiServices   General purpose services available to every PEIM.
+  @param  VariableName  Name of the variable to be found
+  @param  VendorGuid    Vendor GUID to be found.
+  @param  PtrTrack      Variable Track Pointer structure that contains Variable Information.
+
+  @retval  EFI_SUCCESS            Variable found successfully
+  @retval  EFI_NOT_FOUND          Variable not found
+  @retval  EFI_INVALID_PARAMETER  Invalid variable name
+
+**/
+EFI_STATUS
+FindVariable (
+  IN CONST EFI_PEI_SERVICES   **PeiServices,
+  IN CONST  CHAR16            *VariableName,
+  IN CONST  EFI_GUID          *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  EFI_STATUS              Status;
+  VARIABLE_INDEX_HOB      *IndexHob;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader;
+  VARIABLE_HEADER         *Variable;
+  UINT32                  Hash;
+  UINTN                   Low;
+  UINTN                   High;
+  UINTN                   Middle;
+
+  if (VariableName[0] != 0 && VendorGuid == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = GetVariableIndexHob (&VariableStoreHeader, &IndexHob);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  PtrTrack->StartPtr  = GetStartPointer (VariableStoreHeader);
+  PtrTrack->EndPtr    = GetEndPointer (VariableStoreHeader);
+  PtrTrack->CurrPtr   = NULL;
+
+  if (IndexHob == NULL) {
+    return FindVariableInIndexTable (VariableStoreHeader, VariableName, VendorGuid, PtrTrack);
+  }
+
+  if (VariableName[0] != 0 && IndexHob->Complete) {
+    //
+    // Find the first entry with the hash of the variable, then check the
+    // entries with that hash in the order of the store.
+    //
+    Hash = VariableIndexHash (VariableName, StrSize (VariableName), VendorGuid);
+    Low  = 0;
+    High = IndexHob->EntryCount;
+    while (Low < High) {
+      Middle = (Low + High) / 2;
+      if (IndexHob->Entry[Middle].Hash < Hash) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    for (; Low < IndexHob->EntryCount && IndexHob->Entry[Low].Hash == Hash; Low++) {
+      Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + IndexHob->Entry[Low].Offset);
+      if (Variable->State == VAR_ADDED &&
+          CompareWithValidVariable (Variable, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
+        return EFI_SUCCESS;
+      }
+    }
+
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Find the variable by walk through non-volatile variable store
+  //
+  Variable = PtrTrack->StartPtr;
+  while ((Variable < PtrTrack->EndPtr) && IsValidVariableHeader (Variable)) {
+    if (Variable->State == VAR_ADDED &&
+        CompareWithValidVariable (Variable, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
+      return EFI_SUCCESS;
+    }
+
+    Variable = GetNextVariablePtr (Variable);
+  }
+
+  return EFI_NOT_FOUND;
+}
+
 /**
   This service retrieves a variable's value using its name and GUID.
 
@@ -19,7 +19,9 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 
 #include <PiPei.h>
 #include <Ppi/ReadOnlyVariable2.h>
+#include <Ppi/MemoryDiscovered.h>
 
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PeimEntryPoint.h>
 #include <Library/HobLib.h>
@@ -29,6 +31,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/PeiServicesLib.h>
 
 #include <Guid/VariableFormat.h>
+#include <Guid/VariableIndexHob.h>
 
 typedef struct {
   VARIABLE_HEADER *CurrPtr;
@@ -43,7 +46,7 @@ typedef struct {
 
 ///
 /// Use this data structure to store variable-related info, which can decrease
-/// the cost of access to NV.
+/// the cost of access to NV before the permanent memory is installed.
 ///
 typedef struct {
   UINT16          Length;
@@ -56,6 +59,13 @@ typedef struct {
   UINT16          Index[VARIABLE_INDEX_TABLE_VOLUME];
 } VARIABLE_INDEX_TABLE;
 
+///
+/// The number of entries the variable index HOB can hold, as the length of
+/// a HOB is a UINT16.
+///
+#define VARIABLE_INDEX_HOB_MAX_ENTRIES \
+  ((0xFFF8 - sizeof (EFI_HOB_GUID_TYPE) - OFFSET_OF (VARIABLE_INDEX_HOB, Entry)) / sizeof (VARIABLE_INDEX_HOB_ENTRY))
+
 
 //
 // Functions
@@ -191,9 +191,19 @@ GetLbaAndOffsetByAddress (
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the range of the store whose content changes is handed to FTW. FTW
+  rewrites the spare area sized window of blocks that starts at the LBA it is
+  given, so the window is started at the block holding the first changed byte,
+  moved back if needed to keep it within the blocks of the store. When the store
+  has more blocks than the spare area, the blocks before the window keep their
+  content without being erased. As a reclaim keeps the order of the variables,
+  the long lived ones settle at the start of the store and their blocks stop
+  being rewritten.
+
   @param  VariableBase   Base address of variable to write
   @param  Buffer         Point to the data buffer
   @param  BufferSize     The number of bytes of the data Buffer
+  @param  WrittenSize    Returns the number of bytes written to the store
 
   @retval EFI_SUCCESS    The function completed successfully
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol
@@ -204,16 +214,30 @@ EFI_STATUS
 FtwVariableSpace (
   IN EFI_PHYSICAL_ADDRESS   VariableBase,
   IN UINT8                  *Buffer,
-  IN UINTN                  BufferSize
+  IN UINTN                  BufferSize,
+  OUT UINTN                 *WrittenSize
   )
 {
   EFI_STATUS                         Status;
   EFI_HANDLE                         FvbHandle;
-  EFI_LBA                            VarLba;
-  UINTN                              VarOffset;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL *Fvb;
+  EFI_LBA                            StoreLba;
+  UINTN                              StoreOffset;
+  UINTN                              BlockSize;
+  UINTN                              NumberOfBlocks;
+  UINTN                              SpareSize;
+  UINTN                              StoreBlocks;
+  UINTN                              WindowBlocks;
+  UINTN                              FirstBlock;
+  UINTN                              Index;
+  EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
   UINT8                              *FtwBuffer;
   UINTN                              FtwBufferSize;
-  EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
+  UINT8                              *Store;
+  UINTN                              Start;
+  UINTN                              End;
+
+  *WrittenSize = 0;
 
   //
   // Locate fault tolerant write protocol
@@ -234,12 +258,31 @@ FtwVariableSpace (
     return Status;
   }
   //
-  // Get LBA and Offset by address
+  // Get LBA and Offset of the store, the size of its blocks and of the spare area
   //
-  Status = GetLbaAndOffsetByAddress (VariableBase, &VarLba, &VarOffset);
+  Status = GetLbaAndOffsetByAddress (VariableBase, &StoreLba, &StoreOffset);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
+
+  Status = gBS->HandleProtocol (
+                  FvbHandle,
+                  &gEfiFirmwareVolumeBlockProtocolGuid,
+                  (VOID **) &Fvb
+                  );
+  if (EFI_ERROR (Status)) {
+    return EFI_ABORTED;
+  }
+
+  Status = Fvb->GetBlockSize (Fvb, StoreLba, &BlockSize, &NumberOfBlocks);
+  if (EFI_ERROR (Status) || BlockSize == 0) {
+    return EFI_ABORTED;
+  }
+
+  Status = FtwProtocol->GetMaxBlockSize (FtwProtocol, &SpareSize);
+  if (EFI_ERROR (Status) || SpareSize < BlockSize) {
+    return EFI_ABORTED;
+  }
   //
   // Prepare for the variable data
   //
@@ -252,19 +295,66 @@ FtwVariableSpace (
   SetMem (FtwBuffer, FtwBufferSize, (UINT8) 0xff);
   CopyMem (FtwBuffer, Buffer, BufferSize);
 
+  //
+  // Find the range of the store that changes
+  //
+  Store = (UINT8 *) (UINTN) VariableBase;
+  for (Start = 0; Start < FtwBufferSize && FtwBuffer[Start] == Store[Start]; Start++) {
+  }
+  for (End = FtwBufferSize; End > Start && FtwBuffer[End - 1] == Store[End - 1]; End--) {
+  }
+  if (Start == End) {
+    FreePool (FtwBuffer);
+    return EFI_SUCCESS;
+  }
+
+  //
+  // FTW erases and rewrites WindowBlocks blocks from the LBA of the write. Start
+  // them at the block holding the first changed byte, but no later than the last
+  // window that ends within the store. If the store has no more blocks than the
+  // spare area, the window starts at the store base, as the write of the whole
+  // store did.
+  //
+  StoreBlocks  = (StoreOffset + FtwBufferSize + BlockSize - 1) / BlockSize;
+  WindowBlocks = SpareSize / BlockSize;
+  FirstBlock   = (StoreOffset + Start) / BlockSize;
+  if (StoreBlocks <= WindowBlocks) {
+    FirstBlock = 0;
+  } else if (FirstBlock > StoreBlocks - WindowBlocks) {
+    FirstBlock = StoreBlocks - WindowBlocks;
+  }
+
   //
   // FTW write record
   //
   Status = FtwProtocol->Write (
                               FtwProtocol,
-                              VarLba,         // LBA
-                              VarOffset,      // Offset
-                              FtwBufferSize,  // NumBytes
-                              NULL,           // PrivateData NULL
-                              FvbHandle,      // Fvb Handle
-                              FtwBuffer       // write buffer
+                              StoreLba + FirstBlock,                         // LBA
+                              StoreOffset + Start - FirstBlock * BlockSize,  // Offset
+                              End - Start,                                   // NumBytes
+                              NULL,                                          // PrivateData NULL
+                              FvbHandle,                                     // Fvb Handle
+                              FtwBuffer + Start                              // write buffer
                               );
 
   FreePool (FtwBuffer);
+
+  if (!EFI_ERROR (Status)) {
+    *WrittenSize = End - Start;
+  }
+
+  if (!EFI_ERROR (Status) && mVariableStoreStatistics != NULL) {
+    //
+    // Account the blocks of the store in the window FTW rewrote, and the ones
+    // it left alone. Block N of the statistics is block N of the store.
+    //
+    WindowBlocks = MIN (WindowBlocks, StoreBlocks - FirstBlock);
+    mVariableStoreStatistics->BlocksWritten += (UINT32) WindowBlocks;
+    mVariableStoreStatistics->BlocksSkipped += (UINT32) (StoreBlocks - WindowBlocks);
+    for (Index = FirstBlock; Index < FirstBlock + WindowBlocks && Index < mVariableStoreStatistics->BlockCount; Index++) {
+      mVariableStoreStatistics->EraseCount[Index]++;
+    }
+  }
+
   return Status;
 }
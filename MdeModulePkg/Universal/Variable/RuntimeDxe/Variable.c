@@ -44,6 +44,7 @@ VARIABLE_CACHE_ENTRY mVariableCache[] = {
 };
 
 VARIABLE_INFO_ENTRY *gVariableInfo      = NULL;
+VARIABLE_STORE_STATISTICS *mVariableStoreStatistics = NULL;
 EFI_EVENT           mFvbRegistration    = NULL;
 
 /**
@@ -220,6 +221,61 @@ UpdateVariableInfo (
   }
 }
 
+/**
+  Routine used to track how long the reclaims of the non-volatile variable store
+  take. The data is stored in the EFI system table with the other statistics of
+  the store, and VariableInfo.efi can dump it out. The PcdVariableCollectStatistics
+  build flag controls if this feature is enabled.
+
+  @param[in] StartTick      Value of the performance counter when the reclaim started.
+  @param[in] WrittenSize    Number of bytes the reclaim wrote to the store.
+
+**/
+VOID
+UpdateReclaimStatistics (
+  IN  UINT64                  StartTick,
+  IN  UINTN                   WrittenSize
+  )
+{
+  UINT64                Frequency;
+  UINT64                StartValue;
+  UINT64                EndValue;
+  UINT64                EndTick;
+  UINT64                Ticks;
+  UINT32                Latency;
+  UINTN                 Bucket;
+
+  if (mVariableStoreStatistics == NULL || EfiAtRuntime ()) {
+    return;
+  }
+
+  EndTick   = GetPerformanceCounter ();
+  Frequency = GetPerformanceCounterProperties (&StartValue, &EndValue);
+  if (StartValue > EndValue) {
+    Ticks = StartTick - EndTick;
+  } else {
+    Ticks = EndTick - StartTick;
+  }
+
+  //
+  // Latency in milliseconds
+  //
+  Latency = 0;
+  if (Frequency >= 1000) {
+    Latency = (UINT32) DivU64x64Remainder (Ticks, DivU64x32 (Frequency, 1000), NULL);
+  }
+
+  for (Bucket = 0; Bucket < VARIABLE_RECLAIM_LATENCY_BUCKETS - 1 && Latency >= (1U << Bucket); Bucket++) {
+  }
+
+  mVariableStoreStatistics->ReclaimCount++;
+  mVariableStoreStatistics->ReclaimBytesWritten += WrittenSize;
+  mVariableStoreStatistics->LatencyHistogram[Bucket]++;
+  if (Latency > mVariableStoreStatistics->MaxLatency) {
+    mVariableStoreStatistics->MaxLatency = Latency;
+  }
+}
+
 
 /**
 
@@ -334,6 +390,10 @@ UpdateVariableStore (
   //
   // If we are here we are dealing with Non-Volatile Variables
   //
+  if (mVariableStoreStatistics != NULL && !EfiAtRuntime ()) {
+    mVariableStoreStatistics->VariableBytesWritten += DataSize;
+  }
+
   LinearOffset  = (UINTN) FwVolHeader;
   CurrWritePtr  = (UINTN) DataPtr;
   CurrWriteSize = DataSize;
@@ -590,6 +650,365 @@ GetEndPointer (
   return (VARIABLE_HEADER *) HEADER_ALIGN ((UINTN) VarStoreHeader + VarStoreHeader->Size);
 }
 
+/**
+  Computes the index hash of a variable name and vendor GUID.
+
+  @param VariableName    Name of the variable.
+  @param NameSize        Size in bytes of the buffer holding VariableName.
+  @param VendorGuid      Vendor GUID of the variable.
+
+  @return The hash of VariableName and VendorGuid.
+
+**/
+UINT32
+VariableIndexHash (
+  IN  CONST CHAR16    *VariableName,
+  IN  UINTN           NameSize,
+  IN  CONST EFI_GUID  *VendorGuid
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  Hash = ReadUnaligned32 ((CONST UINT32 *) VendorGuid);
+  for (Index = 0; Index < NameSize / sizeof (CHAR16) && VariableName[Index] != 0; Index++) {
+    Hash = (Hash * 31) + VariableName[Index];
+  }
+
+  return Hash;
+}
+
+/**
+  Adds a variable record to the variable index.
+
+  If the index has no free entry left it is marked incomplete, and FindVariable()
+  walks the variable stores until the index is rebuilt.
+
+  @param Variable        Pointer to the variable header in its store.
+  @param Volatile        TRUE if Variable is in the volatile store.
+
+**/
+VOID
+VariableIndexInsert (
+  IN  VARIABLE_HEADER   *Variable,
+  IN  BOOLEAN           Volatile
+  )
+{
+  VARIABLE_INDEX        *VariableIndex;
+  VARIABLE_INDEX_ENTRY  *Entry;
+  UINT32                Slot;
+  UINTN                 Base;
+
+  VariableIndex = mVariableModuleGlobal->VariableIndex;
+  if (VariableIndex == NULL || !VariableIndex->Complete) {
+    return;
+  }
+
+  if (VariableIndex->FreeHead == VARIABLE_INDEX_END) {
+    VariableIndex->Complete = FALSE;
+    return;
+  }
+
+  if (Volatile) {
+    Base = (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+  } else {
+    Base = (UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  }
+
+  Slot                    = VariableIndex->FreeHead;
+  Entry                   = &VariableIndex->Entry[Slot];
+  VariableIndex->FreeHead = Entry->Next;
+
+  Entry->Hash     = VariableIndexHash (GetVariableNamePtr (Variable), NameSizeOfVariable (Variable), &Variable->VendorGuid);
+  Entry->Offset   = (UINT32) ((UINTN) Variable - Base);
+  Entry->Volatile = Volatile;
+  Entry->Next     = VariableIndex->Bucket[VARIABLE_INDEX_BUCKET (Entry->Hash)];
+  VariableIndex->Bucket[VARIABLE_INDEX_BUCKET (Entry->Hash)] = Slot;
+}
+
+/**
+  Removes a variable record from the variable index.
+
+  This is called once the record has been marked VAR_DELETED.
+
+  @param Variable        Pointer to the variable header in its store.
+  @param Volatile        TRUE if Variable is in the volatile store.
+
+**/
+VOID
+VariableIndexRemove (
+  IN  VARIABLE_HEADER   *Variable,
+  IN  BOOLEAN           Volatile
+  )
+{
+  VARIABLE_INDEX        *VariableIndex;
+  VARIABLE_INDEX_ENTRY  *Entry;
+  UINT32                *Link;
+  UINT32                Slot;
+  UINT32                Offset;
+
+  VariableIndex = mVariableModuleGlobal->VariableIndex;
+  if (VariableIndex == NULL || !VariableIndex->Complete) {
+    return;
+  }
+
+  if (Volatile) {
+    Offset = (UINT32) ((UINTN) Variable - (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase);
+  } else {
+    Offset = (UINT32) ((UINTN) Variable - (UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase);
+  }
+
+  Link = &VariableIndex->Bucket[
+           VARIABLE_INDEX_BUCKET (VariableIndexHash (GetVariableNamePtr (Variable), NameSizeOfVariable (Variable), &Variable->VendorGuid))
+           ];
+  for (Slot = *Link; Slot != VARIABLE_INDEX_END; Slot = *Link) {
+    Entry = &VariableIndex->Entry[Slot];
+    if (Entry->Offset == Offset && Entry->Volatile == Volatile) {
+      *Link                   = Entry->Next;
+      Entry->Next             = VariableIndex->FreeHead;
+      VariableIndex->FreeHead = Slot;
+      return;
+    }
+    Link = &Entry->Next;
+  }
+}
+
+/**
+  Empties the variable index.
+
+  @param VariableIndex   The variable index.
+
+**/
+VOID
+VariableIndexReset (
+  IN  VARIABLE_INDEX    *VariableIndex
+  )
+{
+  UINT32                Slot;
+  UINTN                 Index;
+
+  for (Index = 0; Index < VARIABLE_INDEX_BUCKETS; Index++) {
+    VariableIndex->Bucket[Index] = VARIABLE_INDEX_END;
+  }
+  for (Slot = 0; Slot < VariableIndex->EntryCount; Slot++) {
+    VariableIndex->Entry[Slot].Next = Slot + 1;
+  }
+  VariableIndex->Entry[VariableIndex->EntryCount - 1].Next = VARIABLE_INDEX_END;
+  VariableIndex->FreeHead = 0;
+  VariableIndex->Complete = TRUE;
+}
+
+/**
+  Rebuilds the variable index from the content of the volatile and non-volatile
+  variable stores.
+
+  The index has to be rebuilt whenever Reclaim() moves the records of a store.
+
+**/
+VOID
+VariableIndexRebuild (
+  VOID
+  )
+{
+  VARIABLE_INDEX        *VariableIndex;
+  VARIABLE_STORE_HEADER *VariableStoreHeader[2];
+  VARIABLE_HEADER       *Variable;
+  UINTN                 Index;
+
+  VariableIndex = mVariableModuleGlobal->VariableIndex;
+  if (VariableIndex == NULL) {
+    return;
+  }
+
+  VariableIndexReset (VariableIndex);
+
+  //
+  // 0: Volatile, 1: Non-Volatile, the order FindVariable() searches the stores in.
+  //
+  VariableStoreHeader[0] = (VARIABLE_STORE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase);
+  VariableStoreHeader[1] = (VARIABLE_STORE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase);
+
+  for (Index = 0; Index < 2; Index++) {
+    Variable = GetStartPointer (VariableStoreHeader[Index]);
+    while ((Variable < GetEndPointer (VariableStoreHeader[Index])) && IsValidVariableHeader (Variable)) {
+      if (Variable->State == VAR_ADDED ||
+          Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)
+         ) {
+        VariableIndexInsert (Variable, (BOOLEAN) (Index == 0));
+      }
+
+      Variable = GetNextVariablePtr (Variable);
+    }
+  }
+}
+
+/**
+  Sets up the variable index from the variable index HOB of the PEI variable driver.
+
+  The volatile store is empty at this point, so the index only holds the
+  variables of the HOB. Each of them is checked against the store, in case the
+  store changed after the HOB was built. So is the free space offset of the HOB,
+  which must be inside the store and must not hold a variable.
+
+  @retval TRUE           The index and the sizes of the non-volatile store were
+                         set up from the HOB.
+  @retval FALSE          There is no usable HOB, and the store has to be walked.
+
+**/
+BOOLEAN
+VariableIndexLoadHob (
+  VOID
+  )
+{
+  EFI_HOB_GUID_TYPE         *GuidHob;
+  VARIABLE_INDEX_HOB        *IndexHob;
+  VARIABLE_INDEX            *VariableIndex;
+  VARIABLE_STORE_HEADER     *VariableStoreHeader;
+  VARIABLE_HEADER           *Variable;
+  UINTN                     Index;
+
+  VariableIndex = mVariableModuleGlobal->VariableIndex;
+  GuidHob       = GetFirstGuidHob (&gVariableIndexHobGuid);
+  if (VariableIndex == NULL || GuidHob == NULL) {
+    return FALSE;
+  }
+
+  IndexHob            = GET_GUID_HOB_DATA (GuidHob);
+  VariableStoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  if (IndexHob->StoreBase != mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase ||
+      !IndexHob->Complete ||
+      IndexHob->LastVariableOffset < (UINTN) GetStartPointer (VariableStoreHeader) - (UINTN) VariableStoreHeader ||
+      IndexHob->LastVariableOffset > VariableStoreHeader->Size ||
+      IndexHob->EntryCount > VariableIndex->EntryCount) {
+    return FALSE;
+  }
+
+  //
+  // A variable written after the HOB was built would start at the free space
+  // offset of the HOB.
+  //
+  Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + IndexHob->LastVariableOffset);
+  if ((Variable < GetEndPointer (VariableStoreHeader)) && IsValidVariableHeader (Variable)) {
+    return FALSE;
+  }
+
+  VariableIndexReset (VariableIndex);
+  for (Index = 0; Index < IndexHob->EntryCount; Index++) {
+    if (IndexHob->Entry[Index].Offset < sizeof (VARIABLE_STORE_HEADER) ||
+        IndexHob->Entry[Index].Offset + sizeof (VARIABLE_HEADER) > IndexHob->LastVariableOffset) {
+      return FALSE;
+    }
+
+    Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader + IndexHob->Entry[Index].Offset);
+    if (!IsValidVariableHeader (Variable) ||
+        (Variable->State != VAR_ADDED && Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) ||
+        VariableIndexHash (GetVariableNamePtr (Variable), NameSizeOfVariable (Variable), &Variable->VendorGuid) != IndexHob->Entry[Index].Hash) {
+      return FALSE;
+    }
+
+    VariableIndexInsert (Variable, FALSE);
+  }
+
+  mVariableModuleGlobal->NonVolatileLastVariableOffset = IndexHob->LastVariableOffset;
+  mVariableModuleGlobal->CommonVariableTotalSize       = IndexHob->CommonVariableTotalSize;
+  mVariableModuleGlobal->HwErrVariableTotalSize        = IndexHob->HwErrVariableTotalSize;
+
+  return TRUE;
+}
+
+/**
+  Finds a variable through the variable index.
+
+  The result is the one FindVariable() gets by walking the stores: the volatile
+  store is searched before the non-volatile store, and in a store a VAR_ADDED
+  record is preferred to a VAR_IN_DELETED_TRANSITION one.
+
+  @param  VariableName                Name of the variable to be found, not empty.
+  @param  VendorGuid                  Vendor GUID to be found.
+  @param  PtrTrack                    VARIABLE_POINTER_TRACK structure for output,
+                                      including the range searched and the target position.
+
+  @retval EFI_SUCCESS                 Variable successfully found
+  @retval EFI_NOT_FOUND               Variable not found
+
+**/
+EFI_STATUS
+FindVariableInIndex (
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_INDEX          *VariableIndex;
+  VARIABLE_INDEX_ENTRY    *Entry;
+  VARIABLE_STORE_HEADER   *VariableStoreHeader[2];
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *AddedVariable;
+  VARIABLE_HEADER         *InDeletedVariable;
+  UINT32                  Hash;
+  UINT32                  Slot;
+  UINTN                   Index;
+
+  VariableIndex = mVariableModuleGlobal->VariableIndex;
+
+  VariableStoreHeader[0] = (VARIABLE_STORE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase);
+  VariableStoreHeader[1] = (VARIABLE_STORE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase);
+
+  Hash = VariableIndexHash (VariableName, StrSize (VariableName), VendorGuid);
+  for (Index = 0; Index < 2; Index++) {
+    AddedVariable     = NULL;
+    InDeletedVariable = NULL;
+
+    for (Slot = VariableIndex->Bucket[VARIABLE_INDEX_BUCKET (Hash)]; Slot != VARIABLE_INDEX_END; Slot = Entry->Next) {
+      Entry = &VariableIndex->Entry[Slot];
+      if (Entry->Hash != Hash || Entry->Volatile != (BOOLEAN) (Index == 0)) {
+        continue;
+      }
+
+      Variable = (VARIABLE_HEADER *) ((UINTN) VariableStoreHeader[Index] + Entry->Offset);
+      if (Variable->State != VAR_ADDED &&
+          Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)
+         ) {
+        continue;
+      }
+      if (EfiAtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+        continue;
+      }
+      ASSERT (NameSizeOfVariable (Variable) != 0);
+      if (!CompareGuid (VendorGuid, &Variable->VendorGuid) ||
+          CompareMem (VariableName, GetVariableNamePtr (Variable), NameSizeOfVariable (Variable)) != 0) {
+        continue;
+      }
+
+      //
+      // Match the store walk: the first VAR_ADDED record, else the last
+      // VAR_IN_DELETED_TRANSITION one.
+      //
+      if (Variable->State == VAR_ADDED) {
+        if (AddedVariable == NULL || Variable < AddedVariable) {
+          AddedVariable = Variable;
+        }
+      } else if (InDeletedVariable == NULL || Variable > InDeletedVariable) {
+        InDeletedVariable = Variable;
+      }
+    }
+
+    if (AddedVariable == NULL) {
+      AddedVariable = InDeletedVariable;
+    }
+    if (AddedVariable != NULL) {
+      PtrTrack->StartPtr  = GetStartPointer (VariableStoreHeader[Index]);
+      PtrTrack->EndPtr    = GetEndPointer (VariableStoreHeader[Index]);
+      PtrTrack->CurrPtr   = AddedVariable;
+      PtrTrack->Volatile  = (BOOLEAN) (Index == 0);
+      return EFI_SUCCESS;
+    }
+  }
+
+  PtrTrack->CurrPtr = NULL;
+  return EFI_NOT_FOUND;
+}
+
 
 /**
 
@@ -632,7 +1051,18 @@ Reclaim (
   EFI_STATUS            Status;
   CHAR16                *VariableNamePtr;
   CHAR16                *UpdatingVariableNamePtr;
+  UINT64                StartTick;
+  UINTN                 WrittenSize;
 
+  //
+  // Only read the performance counter when the statistics are collected. The
+  // TimerLib instance may not work at runtime, or may be a null instance.
+  //
+  StartTick           = 0;
+  if (mVariableStoreStatistics != NULL && !EfiAtRuntime ()) {
+    StartTick         = GetPerformanceCounter ();
+  }
+  WrittenSize         = 0;
   VariableStoreHeader = (VARIABLE_STORE_HEADER *) ((UINTN) VariableBase);
   //
   // recaluate the total size of Common/HwErr type variables in non-volatile area.
@@ -793,7 +1223,8 @@ Reclaim (
     Status = FtwVariableSpace (
               VariableBase,
               ValidBuffer,
-              (UINTN) (CurrPtr - (UINT8 *) ValidBuffer)
+              (UINTN) (CurrPtr - (UINT8 *) ValidBuffer),
+              &WrittenSize
               );
   }
   if (!EFI_ERROR (Status)) {
@@ -804,6 +1235,15 @@ Reclaim (
 
   FreePool (ValidBuffer);
 
+  //
+  // The records of the store have moved.
+  //
+  VariableIndexRebuild ();
+
+  if (!IsVolatile) {
+    UpdateReclaimStatistics (StartTick, WrittenSize);
+  }
+
   return Status;
 }
 
@@ -984,6 +1424,12 @@ FindVariable (
     return EFI_INVALID_PARAMETER;
   }
 
+  if (VariableName[0] != 0 &&
+      mVariableModuleGlobal->VariableIndex != NULL &&
+      mVariableModuleGlobal->VariableIndex->Complete) {
+    return FindVariableInIndex (VariableName, VendorGuid, PtrTrack);
+  }
+
   //
   // Find the variable by walk through volatile and then non-volatile variable store
   //
@@ -1625,6 +2071,10 @@ UpdateVariable (
                  &State
                  ); 
       if (!EFI_ERROR (Status)) {
+        VariableIndexRemove (Variable->CurrPtr, Variable->Volatile);
+        if (!Volatile && mVariableStoreStatistics != NULL && !EfiAtRuntime ()) {
+          mVariableStoreStatistics->VariableWriteCount++;
+        }
         UpdateVariableInfo (VariableName, VendorGuid, Volatile, FALSE, FALSE, TRUE, FALSE);
         UpdateVariableCache (VariableName, VendorGuid, Attributes, DataSize, Data);
       }
@@ -1840,6 +2290,10 @@ UpdateVariable (
       goto Done;
     }
 
+    VariableIndexInsert (
+      (VARIABLE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase + mVariableModuleGlobal->NonVolatileLastVariableOffset),
+      FALSE
+      );
     mVariableModuleGlobal->NonVolatileLastVariableOffset += HEADER_ALIGN (VarSize);
 
     if ((Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) {
@@ -1890,6 +2344,10 @@ UpdateVariable (
       goto Done;
     }
 
+    VariableIndexInsert (
+      (VARIABLE_HEADER *) ((UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase + mVariableModuleGlobal->VolatileLastVariableOffset),
+      TRUE
+      );
     mVariableModuleGlobal->VolatileLastVariableOffset += HEADER_ALIGN (VarSize);
   }
 
@@ -1909,9 +2367,15 @@ UpdateVariable (
              sizeof (UINT8),
              &State
              );
+    if (!EFI_ERROR (Status)) {
+      VariableIndexRemove (Variable->CurrPtr, Variable->Volatile);
+    }
   }
 
   if (!EFI_ERROR (Status)) {
+    if (!Volatile && mVariableStoreStatistics != NULL && !EfiAtRuntime ()) {
+      mVariableStoreStatistics->VariableWriteCount++;
+    }
     UpdateVariableInfo (VariableName, VendorGuid, Volatile, FALSE, TRUE, FALSE, FALSE);
     UpdateVariableCache (VariableName, VendorGuid, Attributes, DataSize, Data);
   }
@@ -2218,6 +2682,375 @@ RuntimeServiceSetVariable (
   return Status;
 }
 
+/**
+  Finds a variable in an image of the non-volatile variable store.
+
+  The variable is looked up the way FindVariable() does in a single store: the
+  first VAR_ADDED record is preferred to the last VAR_IN_DELETED_TRANSITION one.
+
+  @param  StoreHeader           The image of the variable store.
+  @param  VariableName          Name of the variable to be found.
+  @param  VendorGuid            Vendor GUID to be found.
+
+  @return The header of the variable in the image, or NULL if it is not there.
+
+**/
+VARIABLE_HEADER *
+FindVariableInImage (
+  IN  VARIABLE_STORE_HEADER   *StoreHeader,
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid
+  )
+{
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *InDeletedVariable;
+
+  InDeletedVariable = NULL;
+  for (Variable = GetStartPointer (StoreHeader);
+       (Variable < GetEndPointer (StoreHeader)) && IsValidVariableHeader (Variable);
+       Variable = GetNextVariablePtr (Variable)) {
+    if (Variable->State != VAR_ADDED &&
+        Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)
+       ) {
+      continue;
+    }
+    if (!CompareGuid (VendorGuid, &Variable->VendorGuid) ||
+        CompareMem (VariableName, GetVariableNamePtr (Variable), NameSizeOfVariable (Variable)) != 0) {
+      continue;
+    }
+    if (Variable->State == VAR_ADDED) {
+      return Variable;
+    }
+    InDeletedVariable = Variable;
+  }
+
+  return InDeletedVariable;
+}
+
+/**
+  Applies a batch of variable updates to an image of the non-volatile variable store.
+
+  New variables are appended after the last variable of the image. A variable
+  of the store that is replaced is only marked VAR_IN_DELETED_TRANSITION in the
+  image, and its offset is returned in ReplacedOffset so that the caller changes
+  its state in place, as UpdateVariable() does. A variable that is deleted is
+  marked VAR_DELETED in the image.
+
+  @param  Image                 The image of the variable store.
+  @param  EntryCount            Number of entries in Entries.
+  @param  Entries               The variable updates.
+  @param  ReplacedOffset        Returns, for each entry, the offset of the variable of
+                                the store it replaces, or 0.
+  @param  LastVariableOffset    On input, the offset of the end of the last variable
+                                of the image. On output, the offset once the updates
+                                are applied.
+  @param  CommonVariableSize    On input, the size used by the variables of the image.
+                                On output, the size once the updates are applied.
+
+  @retval EFI_SUCCESS           The updates were applied to the image.
+  @retval EFI_INVALID_PARAMETER An entry names a variable that exists as a volatile
+                                variable.
+  @retval EFI_NOT_FOUND         An entry deletes a variable that does not exist.
+  @retval EFI_OUT_OF_RESOURCES  The image has no room left for the updates.
+
+**/
+EFI_STATUS
+ApplyVariableBatch (
+  IN OUT  UINT8                     *Image,
+  IN      UINTN                     EntryCount,
+  IN      EFI_VARIABLE_BATCH_ENTRY  *Entries,
+  OUT     UINTN                     *ReplacedOffset,
+  IN OUT  UINTN                     *LastVariableOffset,
+  IN OUT  UINTN                     *CommonVariableSize
+  )
+{
+  VARIABLE_STORE_HEADER     *StoreHeader;
+  VARIABLE_POINTER_TRACK    Variable;
+  VARIABLE_HEADER           *OldVariable;
+  VARIABLE_HEADER           *NewVariable;
+  EFI_VARIABLE_BATCH_ENTRY  *Entry;
+  UINTN                     Index;
+  UINTN                     StoreEnd;
+  UINTN                     VarNameSize;
+  UINTN                     VarDataOffset;
+  UINTN                     VarSize;
+
+  StoreHeader = (VARIABLE_STORE_HEADER *) Image;
+  StoreEnd    = *LastVariableOffset;
+
+  for (Index = 0, Entry = Entries; Index < EntryCount; Index++, Entry++) {
+    ReplacedOffset[Index] = 0;
+
+    //
+    // A variable of the batch cannot live in the volatile store.
+    //
+    FindVariable (Entry->VariableName, Entry->VendorGuid, &Variable, &mVariableModuleGlobal->VariableGlobal);
+    if (Variable.CurrPtr != NULL && Variable.Volatile) {
+      return EFI_INVALID_PARAMETER;
+    }
+
+    OldVariable = FindVariableInImage (StoreHeader, Entry->VariableName, Entry->VendorGuid);
+
+    if (Entry->DataSize == 0 || (Entry->Attributes & (EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_BOOTSERVICE_ACCESS)) == 0) {
+      if (OldVariable == NULL) {
+        return EFI_NOT_FOUND;
+      }
+      OldVariable->State &= VAR_DELETED;
+      continue;
+    }
+
+    if (OldVariable != NULL &&
+        DataSizeOfVariable (OldVariable) == Entry->DataSize &&
+        CompareMem (Entry->Data, GetVariableDataPtr (OldVariable), Entry->DataSize) == 0) {
+      continue;
+    }
+
+    VarNameSize   = StrSize (Entry->VariableName);
+    VarDataOffset = sizeof (VARIABLE_HEADER) + VarNameSize + GET_PAD_SIZE (VarNameSize);
+    VarSize       = VarDataOffset + Entry->DataSize + GET_PAD_SIZE (Entry->DataSize);
+    if ((HEADER_ALIGN (VarSize) + *CommonVariableSize > StoreHeader->Size - sizeof (VARIABLE_STORE_HEADER) - FixedPcdGet32 (PcdHwErrStorageSize)) ||
+        (*LastVariableOffset + HEADER_ALIGN (VarSize) > StoreHeader->Size)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    NewVariable = (VARIABLE_HEADER *) (Image + *LastVariableOffset);
+    SetMem (NewVariable, HEADER_ALIGN (VarSize), 0xff);
+    NewVariable->StartId    = VARIABLE_DATA;
+    NewVariable->State      = VAR_ADDED;
+    NewVariable->Reserved   = 0;
+    NewVariable->Attributes = Entry->Attributes;
+    NewVariable->NameSize   = (UINT32) VarNameSize;
+    NewVariable->DataSize   = (UINT32) Entry->DataSize;
+    CopyGuid (&NewVariable->VendorGuid, Entry->VendorGuid);
+    CopyMem (GetVariableNamePtr (NewVariable), Entry->VariableName, VarNameSize);
+    CopyMem ((UINT8 *) NewVariable + VarDataOffset, Entry->Data, Entry->DataSize);
+
+    if (OldVariable != NULL) {
+      if ((UINTN) OldVariable - (UINTN) Image < StoreEnd) {
+        OldVariable->State &= VAR_IN_DELETED_TRANSITION;
+        ReplacedOffset[Index] = (UINTN) OldVariable - (UINTN) Image;
+      } else {
+        //
+        // Added earlier in this batch, so it is not in the store yet.
+        //
+        OldVariable->State &= VAR_DELETED;
+      }
+    }
+
+    *LastVariableOffset += HEADER_ALIGN (VarSize);
+    *CommonVariableSize += HEADER_ALIGN (VarSize);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Sets a group of non-volatile variables in one atomic update of the variable store.
+
+  The updates are applied to an image of the store. The variables they replace
+  are first marked VAR_IN_DELETED_TRANSITION in place, which leaves their values
+  visible. The new variables, and the deletions, are then written with a single
+  Fault Tolerant Write of the changed range, so that either all or none of them
+  reach the store. At last the replaced variables are marked VAR_DELETED. If the
+  store is too full, it is reclaimed once and the updates are applied again.
+
+  @param  This                   Protocol instance pointer.
+  @param  EntryCount             Number of entries in Entries.
+  @param  Entries                The variable updates.
+
+  @retval EFI_SUCCESS            All the updates were committed.
+  @retval EFI_INVALID_PARAMETER  An entry is not a valid batched update.
+  @retval EFI_UNSUPPORTED        An entry sets L"Lang" or L"PlatformLang".
+  @retval EFI_NOT_FOUND          An entry deletes a variable that does not exist.
+  @retval EFI_OUT_OF_RESOURCES   The variable store cannot hold all the updates.
+  @retval Others                 The Fault Tolerant Write of the store failed.
+
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN EFI_VARIABLE_BATCH_PROTOCOL  *This,
+  IN UINTN                        EntryCount,
+  IN EFI_VARIABLE_BATCH_ENTRY     *Entries
+  )
+{
+  EFI_STATUS                          Status;
+  EFI_VARIABLE_BATCH_ENTRY            *Entry;
+  EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  *Fvb;
+  VARIABLE_STORE_HEADER               *VariableStoreHeader;
+  UINT8                               *Image;
+  UINTN                               *ReplacedOffset;
+  UINTN                               Index;
+  UINTN                               LastVariableOffset;
+  UINTN                               CommonVariableSize;
+  UINTN                               WrittenSize;
+  UINT64                              VariableBytesWritten;
+  UINT8                               State;
+  BOOLEAN                             Reclaimed;
+
+  if (EntryCount == 0 || Entries == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Check the entries as SetVariable() checks its parameters
+  //
+  for (Index = 0, Entry = Entries; Index < EntryCount; Index++, Entry++) {
+    if (Entry->VariableName == NULL || Entry->VariableName[0] == 0 || Entry->VendorGuid == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+    if ((Entry->Attributes & (EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_BOOTSERVICE_ACCESS)) == EFI_VARIABLE_RUNTIME_ACCESS) {
+      return EFI_INVALID_PARAMETER;
+    }
+    if ((Entry->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) {
+      return EFI_INVALID_PARAMETER;
+    }
+    if (Entry->DataSize != 0 && (Entry->Attributes & (EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_BOOTSERVICE_ACCESS)) != 0) {
+      if ((Entry->Attributes & EFI_VARIABLE_NON_VOLATILE) == 0 || Entry->Data == NULL) {
+        return EFI_INVALID_PARAMETER;
+      }
+      if ((Entry->DataSize > FixedPcdGet32 (PcdMaxVariableSize)) ||
+          (sizeof (VARIABLE_HEADER) + StrSize (Entry->VariableName) + Entry->DataSize > FixedPcdGet32 (PcdMaxVariableSize))) {
+        return EFI_INVALID_PARAMETER;
+      }
+    }
+    //
+    // SetVariable() keeps Lang and PlatformLang in step, which the batch does not do.
+    //
+    if (CompareGuid (Entry->VendorGuid, &gEfiGlobalVariableGuid) &&
+        (StrCmp (Entry->VariableName, L"Lang") == 0 || StrCmp (Entry->VariableName, L"PlatformLang") == 0)) {
+      return EFI_UNSUPPORTED;
+    }
+  }
+
+  VariableStoreHeader = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase;
+  Image          = AllocatePool (VariableStoreHeader->Size);
+  ReplacedOffset = AllocatePool (EntryCount * sizeof (UINTN));
+  if (Image == NULL || ReplacedOffset == NULL) {
+    if (Image != NULL) {
+      FreePool (Image);
+    }
+    if (ReplacedOffset != NULL) {
+      FreePool (ReplacedOffset);
+    }
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+
+  Fvb                  = mVariableModuleGlobal->FvbInstance;
+  VariableBytesWritten = 0;
+  if (mVariableStoreStatistics != NULL) {
+    VariableBytesWritten = mVariableStoreStatistics->VariableBytesWritten;
+  }
+
+  Reclaimed = FALSE;
+  do {
+    CopyMem (Image, VariableStoreHeader, VariableStoreHeader->Size);
+    LastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+    CommonVariableSize = mVariableModuleGlobal->CommonVariableTotalSize;
+
+    Status = ApplyVariableBatch (Image, EntryCount, Entries, ReplacedOffset, &LastVariableOffset, &CommonVariableSize);
+    if (Status != EFI_OUT_OF_RESOURCES || Reclaimed) {
+      break;
+    }
+
+    //
+    // Perform garbage collection & reclaim operation, and try again
+    //
+    Status = Reclaim (
+               mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
+               &mVariableModuleGlobal->NonVolatileLastVariableOffset,
+               FALSE,
+               NULL
+               );
+    Reclaimed = TRUE;
+  } while (!EFI_ERROR (Status));
+
+  //
+  // Mark the replaced variables as in delete transition
+  //
+  for (Index = 0; Index < EntryCount && !EFI_ERROR (Status); Index++) {
+    if (ReplacedOffset[Index] != 0) {
+      State = Image[ReplacedOffset[Index] + OFFSET_OF (VARIABLE_HEADER, State)];
+      Status = UpdateVariableStore (
+                 &mVariableModuleGlobal->VariableGlobal,
+                 FALSE,
+                 FALSE,
+                 Fvb,
+                 (UINTN) VariableStoreHeader + ReplacedOffset[Index] + OFFSET_OF (VARIABLE_HEADER, State),
+                 sizeof (UINT8),
+                 &State
+                 );
+    }
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = FtwVariableSpace (
+               mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
+               Image,
+               LastVariableOffset,
+               &WrittenSize
+               );
+  }
+
+  if (!EFI_ERROR (Status)) {
+    mVariableModuleGlobal->NonVolatileLastVariableOffset = LastVariableOffset;
+    mVariableModuleGlobal->CommonVariableTotalSize       = CommonVariableSize;
+
+    //
+    // The batch is committed. A replaced variable left in delete transition
+    // is dropped by the next reclaim, so the status is not checked here.
+    //
+    for (Index = 0; Index < EntryCount; Index++) {
+      if (ReplacedOffset[Index] != 0) {
+        State = Image[ReplacedOffset[Index] + OFFSET_OF (VARIABLE_HEADER, State)] & VAR_DELETED;
+        UpdateVariableStore (
+          &mVariableModuleGlobal->VariableGlobal,
+          FALSE,
+          FALSE,
+          Fvb,
+          (UINTN) VariableStoreHeader + ReplacedOffset[Index] + OFFSET_OF (VARIABLE_HEADER, State),
+          sizeof (UINT8),
+          &State
+          );
+      }
+    }
+
+    for (Index = 0, Entry = Entries; Index < EntryCount; Index++, Entry++) {
+      if (Entry->DataSize == 0 || (Entry->Attributes & (EFI_VARIABLE_RUNTIME_ACCESS | EFI_VARIABLE_BOOTSERVICE_ACCESS)) == 0) {
+        UpdateVariableInfo (Entry->VariableName, Entry->VendorGuid, FALSE, FALSE, FALSE, TRUE, FALSE);
+      } else {
+        UpdateVariableInfo (Entry->VariableName, Entry->VendorGuid, FALSE, FALSE, TRUE, FALSE, FALSE);
+      }
+    }
+
+    if (mVariableStoreStatistics != NULL) {
+      //
+      // The state changes made in place are part of the batch.
+      //
+      mVariableStoreStatistics->BatchCount++;
+      mVariableStoreStatistics->BatchVariableCount += (UINT32) EntryCount;
+      mVariableStoreStatistics->BatchBytesWritten  += WrittenSize + (mVariableStoreStatistics->VariableBytesWritten - VariableBytesWritten);
+    }
+  }
+
+  if (mVariableStoreStatistics != NULL) {
+    mVariableStoreStatistics->VariableBytesWritten = VariableBytesWritten;
+  }
+  VariableIndexRebuild ();
+
+  ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+
+  FreePool (ReplacedOffset);
+  FreePool (Image);
+  return Status;
+}
+
+EFI_VARIABLE_BATCH_PROTOCOL mVariableBatch = {
+  VariableBatchSetVariables
+};
+
 /**
 
   This code returns information about the EFI variables.
@@ -2453,6 +3286,10 @@ VariableCommonInitialize (
   UINT64                          VariableStoreLength;
   EFI_EVENT                       ReadyToBootEvent;
   UINTN                           ScratchSize;
+  UINT32                          IndexEntryCount;
+  BOOLEAN                         IndexLoaded;
+  EFI_FIRMWARE_VOLUME_HEADER      *FwVolHeader;
+  UINT32                          BlockCount;
 
   Status = EFI_SUCCESS;
   //
@@ -2524,6 +3361,25 @@ VariableCommonInitialize (
   // Get address of non volatile variable store base
   //
   mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = VariableStoreBase;
+
+  if (FeaturePcdGet (PcdVariableCollectStatistics)) {
+    //
+    // Keep one erase counter per block holding the store, as FtwVariableSpace()
+    // counts them. As in GetLbaAndOffsetByAddress(), all blocks of the firmware
+    // volume are assumed to be the same size.
+    //
+    FwVolHeader = (EFI_FIRMWARE_VOLUME_HEADER *) (UINTN) TempVariableStoreHeader;
+    BlockCount  = (UINT32) ((((VariableStoreBase - TempVariableStoreHeader) % FwVolHeader->BlockMap[0].Length) +
+                             VariableStoreLength + FwVolHeader->BlockMap[0].Length - 1) / FwVolHeader->BlockMap[0].Length);
+    mVariableStoreStatistics = AllocateZeroPool (
+                                   sizeof (VARIABLE_STORE_STATISTICS) + (BlockCount - 1) * sizeof (UINT32)
+                                   );
+    if (mVariableStoreStatistics != NULL) {
+      mVariableStoreStatistics->BlockSize  = FwVolHeader->BlockMap[0].Length;
+      mVariableStoreStatistics->BlockCount = BlockCount;
+      gBS->InstallConfigurationTable (&gVariableStoreStatisticsGuid, mVariableStoreStatistics);
+    }
+  }
   VariableStoreHeader = (VARIABLE_STORE_HEADER *)(UINTN)VariableStoreBase;
   if (GetVariableStoreStatus (VariableStoreHeader) == EfiValid) {
     if (~VariableStoreHeader->Size == 0) {
@@ -2552,25 +3408,42 @@ VariableCommonInitialize (
     }
 
     //
-    // Parse non-volatile variable data and get last variable offset
+    // Index both variable stores by (VendorGuid, VariableName). Without the index
+    // FindVariable() walks the stores, so failing to allocate it is not fatal.
     //
-    NextVariable  = GetStartPointer ((VARIABLE_STORE_HEADER *)(UINTN)VariableStoreBase);
-    Status        = EFI_SUCCESS;
+    IndexEntryCount = (UINT32) ((VolatileVariableStore->Size + VariableStoreHeader->Size) / VARIABLE_INDEX_MIN_RECORD);
+    mVariableModuleGlobal->VariableIndex = AllocateRuntimePool (
+                                             sizeof (VARIABLE_INDEX) + (IndexEntryCount - 1) * sizeof (VARIABLE_INDEX_ENTRY)
+                                             );
+    if (mVariableModuleGlobal->VariableIndex != NULL) {
+      mVariableModuleGlobal->VariableIndex->EntryCount = IndexEntryCount;
+      mVariableModuleGlobal->VariableIndex->Complete   = FALSE;
+    }
 
-    while (IsValidVariableHeader (NextVariable)) {
-      UINTN VariableSize = 0;
-      VariableSize = NextVariable->NameSize + NextVariable->DataSize + sizeof (VARIABLE_HEADER);
-      if ((NextVariable->Attributes & (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) == (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
-        mVariableModuleGlobal->HwErrVariableTotalSize += HEADER_ALIGN (VariableSize);
-      } else {
-        mVariableModuleGlobal->CommonVariableTotalSize += HEADER_ALIGN (VariableSize);
+    //
+    // Parse non-volatile variable data and get last variable offset, unless the
+    // PEI variable driver already did it.
+    //
+    Status      = EFI_SUCCESS;
+    IndexLoaded = VariableIndexLoadHob ();
+    if (!IndexLoaded) {
+      NextVariable = GetStartPointer ((VARIABLE_STORE_HEADER *)(UINTN)VariableStoreBase);
+
+      while (IsValidVariableHeader (NextVariable)) {
+        UINTN VariableSize = 0;
+        VariableSize = NextVariable->NameSize + NextVariable->DataSize + sizeof (VARIABLE_HEADER);
+        if ((NextVariable->Attributes & (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) == (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_HARDWARE_ERROR_RECORD)) {
+          mVariableModuleGlobal->HwErrVariableTotalSize += HEADER_ALIGN (VariableSize);
+        } else {
+          mVariableModuleGlobal->CommonVariableTotalSize += HEADER_ALIGN (VariableSize);
+        }
+
+        NextVariable = GetNextVariablePtr (NextVariable);
       }
 
-      NextVariable = GetNextVariablePtr (NextVariable);
+      mVariableModuleGlobal->NonVolatileLastVariableOffset = (UINTN) NextVariable - (UINTN) VariableStoreBase;
     }
 
-    mVariableModuleGlobal->NonVolatileLastVariableOffset = (UINTN) NextVariable - (UINTN) VariableStoreBase;
-
     //
     // Check if the free area is really free.
     //
@@ -2591,10 +3464,18 @@ VariableCommonInitialize (
           goto Done;
         }
 
+        //
+        // Reclaim() rebuilt the index.
+        //
+        IndexLoaded = TRUE;
         break;
       }
     }
 
+    if (!IndexLoaded) {
+      VariableIndexRebuild ();
+    }
+
     //
     // Register the event handling function to reclaim variable for OS usage.
     //
@@ -2611,6 +3492,14 @@ VariableCommonInitialize (
 
 Done:
   if (EFI_ERROR (Status)) {
+    if (mVariableModuleGlobal->VariableIndex != NULL) {
+      FreePool (mVariableModuleGlobal->VariableIndex);
+    }
+    if (mVariableStoreStatistics != NULL) {
+      gBS->InstallConfigurationTable (&gVariableStoreStatisticsGuid, NULL);
+      FreePool (mVariableStoreStatistics);
+      mVariableStoreStatistics = NULL;
+    }
     FreePool (mVariableModuleGlobal);
     FreePool (VolatileVariableStore);
   }
@@ -2646,6 +3535,7 @@ VariableClassAddressChangeEvent (
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->PlatformLangCodes);
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->LangCodes);
   EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->PlatformLang);
+  EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->VariableIndex);
   EfiConvertPointer (
     0x0,
     (VOID **) &mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase
@@ -2752,6 +3642,7 @@ FvbNotificationEvent (
                   &mHandle,
                   &gEfiVariableArchProtocolGuid, NULL,
                   &gEfiVariableWriteArchProtocolGuid, NULL,
+                  &gEfiVariableBatchProtocolGuid, &mVariableBatch,
                   NULL
                   );
     ASSERT_EFI_ERROR (Status);
@@ -22,6 +22,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Protocol/FaultTolerantWrite.h>
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Protocol/Variable.h>
+#include <Protocol/VariableBatch.h>
 #include <Library/PcdLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/DxeServicesTableLib.h>
@@ -33,12 +34,32 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/SynchronizationLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/TimerLib.h>
+#include <Library/HobLib.h>
 #include <Guid/GlobalVariable.h>
 #include <Guid/EventGroup.h>
 #include <Guid/VariableFormat.h>
+#include <Guid/VariableStoreStatistics.h>
+#include <Guid/VariableIndexHob.h>
 
 #define VARIABLE_RECLAIM_THRESHOLD (1024)
 
+///
+/// Number of hash buckets of the (VendorGuid, VariableName) index of the variable stores.
+/// Must be a power of two.
+///
+#define VARIABLE_INDEX_BUCKETS     256
+#define VARIABLE_INDEX_END         0xFFFFFFFF
+#define VARIABLE_INDEX_BUCKET(Hash) \
+  (((Hash) ^ ((Hash) >> 8) ^ ((Hash) >> 16)) & (VARIABLE_INDEX_BUCKETS - 1))
+
+///
+/// The smallest record a variable store can hold: a header, a one character
+/// name and one byte of data. Sizing the index with it lets the index describe
+/// every record of both stores.
+///
+#define VARIABLE_INDEX_MIN_RECORD  HEADER_ALIGN (sizeof (VARIABLE_HEADER) + 2 * sizeof (CHAR16) + 1)
+
 ///
 /// The size of a 3 character ISO639 language code.
 ///
@@ -58,6 +79,30 @@ typedef struct {
   UINT32                ReentrantState;
 } VARIABLE_GLOBAL;
 
+///
+/// One VAR_ADDED or VAR_IN_DELETED_TRANSITION record of a variable store.
+/// Records are located by offset rather than by address so that the index
+/// needs no fixup when the stores are converted to virtual addresses.
+///
+typedef struct {
+  UINT32          Next;
+  UINT32          Hash;
+  UINT32          Offset;
+  BOOLEAN         Volatile;
+} VARIABLE_INDEX_ENTRY;
+
+typedef struct {
+  ///
+  /// FALSE if some record could not be indexed. FindVariable() then walks the
+  /// stores until the next Reclaim() rebuilds the index.
+  ///
+  BOOLEAN               Complete;
+  UINT32                EntryCount;
+  UINT32                FreeHead;
+  UINT32                Bucket[VARIABLE_INDEX_BUCKETS];
+  VARIABLE_INDEX_ENTRY  Entry[1];
+} VARIABLE_INDEX;
+
 typedef struct {
   VARIABLE_GLOBAL VariableGlobal;
   UINTN           VolatileLastVariableOffset;
@@ -69,8 +114,15 @@ typedef struct {
   CHAR8           *PlatformLang;
   CHAR8           Lang[ISO_639_2_ENTRY_SIZE + 1];
   EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL *FvbInstance;
+  VARIABLE_INDEX  *VariableIndex;
 } VARIABLE_MODULE_GLOBAL;
 
+///
+/// Reclaim statistics of the non-volatile store, NULL unless
+/// PcdVariableCollectStatistics is TRUE.
+///
+extern VARIABLE_STORE_STATISTICS  *mVariableStoreStatistics;
+
 typedef struct {
   EFI_GUID    *Guid;
   CHAR16      *Name;
@@ -86,9 +138,13 @@ typedef struct {
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the range of the store whose content changes is written.
+
   @param  VariableBase   Base address of variable to write
   @param  Buffer         Point to the data buffer
-  @param  BufferSize     The number of bytes of the data Buffer
+  @param  BufferSize     The number of bytes of the data Buffer, the rest of
+                         the store is written with 0xff
+  @param  WrittenSize    Returns the number of bytes written to the store
 
   @retval EFI_SUCCESS    The function completed successfully
   @retval EFI_NOT_FOUND  Fail to locate Fault Tolerant Write protocol
@@ -99,7 +155,8 @@ EFI_STATUS
 FtwVariableSpace (
   IN EFI_PHYSICAL_ADDRESS   VariableBase,
   IN UINT8                  *Buffer,
-  IN UINTN                  BufferSize
+  IN UINTN                  BufferSize,
+  OUT UINTN                 *WrittenSize
   );
 
 
@@ -194,6 +194,12 @@
 //
 #define EFI_SCSI_TYPE_UNKNOWN       0x1F  ///< Unknown or no device type
 
+//
+// Page Codes for INQUIRY command with the EVPD bit set
+//
+#define EFI_SCSI_PAGE_CODE_SUPPORTED_VPD_PAGES  0x00
+#define EFI_SCSI_PAGE_CODE_BLOCK_LIMITS         0xB0
+
 #pragma pack(1)
 ///
 /// Standard INQUIRY data format
@@ -263,6 +269,42 @@ typedef struct {
   UINT8 Reserved[16];  
 } EFI_SCSI_DISK_CAPACITY_DATA16;
 
+///
+/// Supported VPD Pages VPD page
+///
+typedef struct {
+  UINT8 Peripheral_Type : 5;
+  UINT8 Peripheral_Qualifier : 3;
+  UINT8 PageCode;
+  UINT8 PageLength1;
+  UINT8 PageLength0;
+  UINT8 SupportedVpdPageList[0xFF - 4 + 1];
+} EFI_SCSI_SUPPORTED_VPD_PAGES_VPD_PAGE;
+
+///
+/// Block Limits VPD page, the transfer lengths are in logical blocks
+///
+typedef struct {
+  UINT8 Peripheral_Type : 5;
+  UINT8 Peripheral_Qualifier : 3;
+  UINT8 PageCode;
+  UINT8 PageLength1;
+  UINT8 PageLength0;
+  UINT8 Reserved_4;
+  UINT8 MaximumCompareAndWriteLength;
+  UINT8 OptimalTransferLengthGranularity1;
+  UINT8 OptimalTransferLengthGranularity0;
+  UINT8 MaximumTransferLength3;
+  UINT8 MaximumTransferLength2;
+  UINT8 MaximumTransferLength1;
+  UINT8 MaximumTransferLength0;
+  UINT8 OptimalTransferLength3;
+  UINT8 OptimalTransferLength2;
+  UINT8 OptimalTransferLength1;
+  UINT8 OptimalTransferLength0;
+  UINT8 Reserved_16_63[63 - 16 + 1];
+} EFI_SCSI_BLOCK_LIMITS_VPD_PAGE;
+
 
 #pragma pack()
 
@@ -26,6 +26,10 @@
 
   Shift mBitBuf NumOfBits left. Read in NumOfBits of bits from source.
 
+  The source bytes are staged left aligned in mSubBitBuf, which is topped up
+  to at least 25 bits whenever it runs short, so that most calls are a pair
+  of shifts.
+
   @param  Sd        The global scratch data
   @param  NumOfBits The number of bits to shift and read.
 
@@ -36,45 +40,43 @@ FillBuf (
   IN  UINT16        NumOfBits
   )
 {
-  //
-  // Left shift NumOfBits of bits in advance
-  //
-  Sd->mBitBuf = (UINT32) (Sd->mBitBuf << NumOfBits);
-
-  //
-  // Copy data needed in bytes into mSbuBitBuf
-  //
-  while (NumOfBits > Sd->mBitCount) {
+  UINT32  Byte;
 
-    Sd->mBitBuf |= (UINT32) (Sd->mSubBitBuf << (NumOfBits = (UINT16) (NumOfBits - Sd->mBitCount)));
-
-    if (Sd->mCompSize > 0) {
-      //
-      // Get 1 byte into SubBitBuf
-      //
-      Sd->mCompSize--;
-      Sd->mSubBitBuf  = Sd->mSrcBase[Sd->mInBuf++];
-      Sd->mBitCount   = 8;
+  if (NumOfBits == 0) {
+    return;
+  }
 
-    } else {
-      //
-      // No more bits from the source, just pad zero bit.
-      //
-      Sd->mSubBitBuf  = 0;
-      Sd->mBitCount   = 8;
+  if (NumOfBits > 25) {
+    //
+    // More bits than a top up guarantees, only asked for by the initial fill
+    // of mBitBuf or for a corrupted source.
+    //
+    FillBuf (Sd, 16);
+    FillBuf (Sd, (UINT16) (NumOfBits - 16));
+    return;
+  }
 
+  if (NumOfBits > Sd->mBitCount) {
+    //
+    // Top up mSubBitBuf. Past the end of the source, just pad zero bits.
+    //
+    while (Sd->mBitCount <= 24) {
+      Byte = 0;
+      if (Sd->mCompSize > 0) {
+        Sd->mCompSize--;
+        Byte = Sd->mSrcBase[Sd->mInBuf++];
+      }
+      Sd->mSubBitBuf |= Byte << (24 - Sd->mBitCount);
+      Sd->mBitCount = (UINT16) (Sd->mBitCount + 8);
     }
   }
 
   //
-  // Caculate additional bit count read to update mBitCount
-  //
-  Sd->mBitCount = (UINT16) (Sd->mBitCount - NumOfBits);
-  
+  // Move NumOfBits of bits from the top of mSubBitBuf into mBitBuf
   //
-  // Copy NumOfBits of bits from mSubBitBuf into mBitBuf
-  //
-  Sd->mBitBuf |= Sd->mSubBitBuf >> Sd->mBitCount;
+  Sd->mBitBuf     = (Sd->mBitBuf << NumOfBits) | (Sd->mSubBitBuf >> (32 - NumOfBits));
+  Sd->mSubBitBuf  = Sd->mSubBitBuf << NumOfBits;
+  Sd->mBitCount   = (UINT16) (Sd->mBitCount - NumOfBits);
 }
 
 /**
@@ -556,6 +558,160 @@ DecodeC (
   return Index2;
 }
 
+/**
+  Decode the rest of the current block while neither buffer is close to its end.
+
+  This is the fast path of Decode. The bit buffer state is kept in locals, so
+  that it stays in registers across the stores to the destination, and the
+  Huffman table lookups, bit advances and string copies are done inline. It
+  returns at the end of the block, when fewer than 8 source bytes or MAXMATCH
+  destination bytes are left, so that none of these needs a bounds check per
+  symbol. Decode handles the block headers and the ends of the buffers.
+
+  @param  Sd The global scratch data
+
+**/
+VOID
+DecodeFast (
+  SCRATCH_DATA  *Sd
+  )
+{
+  UINT32  BitBuf;
+  UINT32  SubBitBuf;
+  UINT32  BitCount;
+  UINT8   *Src;
+  UINT32  CompSize;
+  UINT8   *Dst;
+  UINT32  OutBuf;
+  UINT32  BlockSize;
+  UINT32  Mask;
+  UINT16  CharC;
+  UINT16  Val;
+  UINT32  CodeLen;
+  UINT32  Pos;
+  UINT8   *CopyFrom;
+  UINT8   *CopyTo;
+
+  BitBuf    = Sd->mBitBuf;
+  SubBitBuf = Sd->mSubBitBuf;
+  BitCount  = Sd->mBitCount;
+  Src       = Sd->mSrcBase + Sd->mInBuf;
+  CompSize  = Sd->mCompSize;
+  Dst       = Sd->mDstBase;
+  OutBuf    = Sd->mOutBuf;
+  BlockSize = Sd->mBlockSize;
+
+  while (BlockSize != 0 && CompSize >= 8 && Sd->mOrigSize - OutBuf > MAXMATCH) {
+    BlockSize--;
+
+    //
+    // Stage at least 25 bits, then get one code according to the Code&Set
+    // Huffman Table. Codes are at most 16 bits long.
+    //
+    while (BitCount <= 24) {
+      SubBitBuf |= (UINT32) *Src++ << (24 - BitCount);
+      BitCount  += 8;
+      CompSize--;
+    }
+
+    CharC = Sd->mCTable[BitBuf >> (BITBUFSIZ - 12)];
+    if (CharC >= NC) {
+      Mask = 1U << (BITBUFSIZ - 1 - 12);
+      do {
+        if ((BitBuf & Mask) != 0) {
+          CharC = Sd->mRight[CharC];
+        } else {
+          CharC = Sd->mLeft[CharC];
+        }
+        Mask >>= 1;
+      } while (CharC >= NC);
+    }
+
+    CodeLen = Sd->mCLen[CharC];
+    if (CodeLen != 0) {
+      BitBuf     = (BitBuf << CodeLen) | (SubBitBuf >> (32 - CodeLen));
+      SubBitBuf <<= CodeLen;
+      BitCount  -= CodeLen;
+    }
+
+    if (CharC < 256) {
+      Dst[OutBuf++] = (UINT8) CharC;
+      continue;
+    }
+
+    //
+    // Get the position of the string according to the Position Huffman
+    // Table, advancing past the code and its extra bits at once
+    //
+    while (BitCount <= 24) {
+      SubBitBuf |= (UINT32) *Src++ << (24 - BitCount);
+      BitCount  += 8;
+      CompSize--;
+    }
+
+    Val = Sd->mPTTable[BitBuf >> (BITBUFSIZ - 8)];
+    if (Val >= MAXNP) {
+      Mask = 1U << (BITBUFSIZ - 1 - 8);
+      do {
+        if ((BitBuf & Mask) != 0) {
+          Val = Sd->mRight[Val];
+        } else {
+          Val = Sd->mLeft[Val];
+        }
+        Mask >>= 1;
+      } while (Val >= MAXNP);
+    }
+
+    CodeLen = Sd->mPTLen[Val];
+    Pos     = Val;
+    if (Val > 1) {
+      Pos      = (1U << (Val - 1)) + ((BitBuf << CodeLen) >> (BITBUFSIZ - (Val - 1)));
+      CodeLen += Val - 1;
+    }
+
+    if (CodeLen > 25) {
+      //
+      // Only a corrupted source can get here. Let DecodeP deal with it.
+      //
+      Sd->mBitBuf    = BitBuf;
+      Sd->mSubBitBuf = SubBitBuf;
+      Sd->mBitCount  = (UINT16) BitCount;
+      Sd->mInBuf     = (UINT32) (Src - Sd->mSrcBase);
+      Sd->mCompSize  = CompSize;
+      Pos            = DecodeP (Sd);
+      BitBuf         = Sd->mBitBuf;
+      SubBitBuf      = Sd->mSubBitBuf;
+      BitCount       = Sd->mBitCount;
+      Src            = Sd->mSrcBase + Sd->mInBuf;
+      CompSize       = Sd->mCompSize;
+    } else if (CodeLen != 0) {
+      BitBuf     = (BitBuf << CodeLen) | (SubBitBuf >> (32 - CodeLen));
+      SubBitBuf <<= CodeLen;
+      BitCount  -= CodeLen;
+    }
+
+    //
+    // Copy the string of CharC - (BIT8 - THRESHOLD) bytes. It may overlap its
+    // own output, so copy forwards byte by byte.
+    //
+    CopyFrom = Dst + (OutBuf - Pos - 1);
+    CopyTo   = Dst + OutBuf;
+    CharC    = (UINT16) (CharC - (BIT8 - THRESHOLD));
+    OutBuf  += CharC;
+    while (CharC-- > 0) {
+      *CopyTo++ = *CopyFrom++;
+    }
+  }
+
+  Sd->mBitBuf    = BitBuf;
+  Sd->mSubBitBuf = SubBitBuf;
+  Sd->mBitCount  = (UINT16) BitCount;
+  Sd->mInBuf     = (UINT32) (Src - Sd->mSrcBase);
+  Sd->mCompSize  = CompSize;
+  Sd->mOutBuf    = OutBuf;
+  Sd->mBlockSize = (UINT16) BlockSize;
+}
+
 /**
   Decode the source data and put the resulting data into the destination buffer.
 
@@ -570,12 +726,19 @@ Decode (
   UINT16  BytesRemain;
   UINT32  DataIdx;
   UINT16  CharC;
+  UINT8   *CopyFrom;
+  UINT8   *CopyTo;
 
   BytesRemain = (UINT16) (-1);
 
   DataIdx     = 0;
 
   for (;;) {
+    //
+    // Decode as much of the current block as the fast path allows
+    //
+    DecodeFast (Sd);
+
     //
     // Get one code from mBitBuf
     // 
@@ -614,16 +777,23 @@ Decode (
       DataIdx     = Sd->mOutBuf - DecodeP (Sd) - 1;
 
       //
-      // Write BytesRemain of bytes into mDstBase
+      // Write BytesRemain of bytes into mDstBase, stopping at the end of the
+      // output. The string may overlap its own output, so copy forwards
+      // byte by byte.
       //
-      BytesRemain--;
-      while ((INT16) (BytesRemain) >= 0) {
-        Sd->mDstBase[Sd->mOutBuf++] = Sd->mDstBase[DataIdx++];
-        if (Sd->mOutBuf >= Sd->mOrigSize) {
-          goto Done;
-        }
+      if (BytesRemain > Sd->mOrigSize - Sd->mOutBuf) {
+        BytesRemain = (UINT16) (Sd->mOrigSize - Sd->mOutBuf);
+      }
+
+      CopyFrom     = Sd->mDstBase + DataIdx;
+      CopyTo       = Sd->mDstBase + Sd->mOutBuf;
+      Sd->mOutBuf += BytesRemain;
+      while (BytesRemain-- > 0) {
+        *CopyTo++ = *CopyFrom++;
+      }
 
-        BytesRemain--;
+      if (Sd->mOutBuf >= Sd->mOrigSize) {
+        goto Done;
       }
     }
   }
@@ -45,9 +45,9 @@ typedef struct {
   UINT32  mOutBuf;
   UINT32  mInBuf;
 
-  UINT16  mBitCount;
+  UINT16  mBitCount;  // Number of valid bits in mSubBitBuf
   UINT32  mBitBuf;
-  UINT32  mSubBitBuf;
+  UINT32  mSubBitBuf; // Source bits that follow mBitBuf, left aligned
   UINT16  mBlockSize;
   UINT32  mCompSize;
   UINT32  mOrigSize;
@@ -196,6 +196,17 @@ DecodeC (
   SCRATCH_DATA  *Sd
   );
 
+/**
+  Decode the rest of the current block while neither buffer is close to its end.
+
+  @param  Sd The global scratch data
+
+**/
+VOID
+DecodeFast (
+  SCRATCH_DATA  *Sd
+  );
+
 /**
   Decode the source data and put the resulting data into the destination buffer.
 